@@ -31,6 +31,10 @@ void HttpServer::setProcessNum(int processNum) {
     tcpServer_.setProcessNum(processNum);
 }
 
+void HttpServer::setForkCallback(const TcpServer::ForkCallback& cb) {
+    tcpServer_.setForkCallback(cb);
+}
+
 void HttpServer::start() {
     tcpServer_.start();
 }
@@ -49,6 +49,12 @@ namespace tinyWS_process1 {
          */
         void setProcessNum(int processNum);
 
+        /**
+         * 设置 fork 之后的回调函数，需要在 start() 之前调用
+         * @param cb 回调函数
+         */
+        void setForkCallback(const TcpServer::ForkCallback& cb);
+
         /**
          * 启动 TcpServer
          */
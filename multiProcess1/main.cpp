@@ -3,6 +3,8 @@
 #include <sys/stat.h>   // struct stat
 #include <sys/mman.h>   // mmap()、munmap()
 
+#include <cstring>
+
 #include <iostream>
 #include <functional>
 
@@ -12,6 +14,7 @@
 #include "http/HttpResponse.h"
 #include "net/TimerId.h"
 #include "net/Timer.h"
+#include "base/CpuAffinity.h"
 
 using namespace std::placeholders;
 using namespace tinyWS_process1;
@@ -20,6 +23,10 @@ void test_runEvery();
 void httpCallback(const HttpRequest& request, HttpResponse& response);
 void set404NotFound(HttpResponse& response);
 
+// 用法：tinyWS_process1 [进程数] [端口] [选项...]
+// 选项：
+//   --cpu-affinity=auto|CPU列表  把子进程依次绑定到 CPU 上（如 0-3,8），auto 表示所有可用的 CPU，
+//                              并优先从 CPU 所在的 NUMA 节点分配内存，启动时输出绑定结果
 int main(int argc, char* argv[]) {
 //     debug() << "pid = " << ::getpid() << ", tid = " << Thread::gettid() << std::endl;
 
@@ -31,6 +38,12 @@ int main(int argc, char* argv[]) {
     if (argc > 2) {
         port = ::atoi(argv[2]);
     }
+    std::string cpuAffinity;
+    for (int i = 3; i < argc; ++i) {
+        if (::strncmp(argv[i], "--cpu-affinity=", 15) == 0) {
+            cpuAffinity = argv[i] + 15;
+        }
+    }
 
     InternetAddress listenAddress(port);
 //    InternetAddress listenAddress(std::string("127.0.0.1"), 12315); // for pressure test
@@ -40,6 +53,21 @@ int main(int argc, char* argv[]) {
 
     server.setProcessNum(processNum);
     server.setHttpCallback(std::bind(&httpCallback, _1, _2));
+
+    // 子进程 fork 之后，在开始事件循环之前绑定 CPU
+    CpuAffinity affinity(cpuAffinity);
+    if (!cpuAffinity.empty()) {
+        if (affinity.empty()) {
+            std::cout << "invalid --cpu-affinity: " << cpuAffinity << std::endl;
+        } else {
+            server.setForkCallback([&affinity](bool isParent, int index) {
+                if (!isParent) {
+                    std::cout << "[child " << index << "] pid " << ::getpid() << ": "
+                              << affinity.bindCurrentThread(index) << std::endl;
+                }
+            });
+        }
+    }
     // 在 server::start() 函数调用之前，必须配置好跟子进程相关的设置。
     // 因为直到程序结束，子进程都不会从 start() 函数返回。
     server.start();
@@ -114,14 +114,14 @@ void ProcessPool::createChildAndSetParent(int processNum) {
         }
 
         // 子进程创建后，一直在函数里运行，知道进程结束。
-        pid_t pid = createChildProcess(fds);
+        pid_t pid = createChildProcess(fds, i);
 
         // 父进程
         addChildInfoToParent(pid, fds);
     }
 }
 
-pid_t ProcessPool::createChildProcess(int fds[2]) {
+pid_t ProcessPool::createChildProcess(int fds[2], int index) {
     pid_t pid = fork();
 
     if (pid < 0) {
@@ -129,7 +129,7 @@ pid_t ProcessPool::createChildProcess(int fds[2]) {
     } else if (pid > 0) {
         // 父进程
 
-        forkFunction_(true); // fork 回调函数
+        forkFunction_(true, index); // fork 回调函数
 
 //        std::cout << "[processpool] create process(" << pid << ")" << std::endl;
 
@@ -138,7 +138,7 @@ pid_t ProcessPool::createChildProcess(int fds[2]) {
 
     // 子进程
 
-    forkFunction_(false); // fork 回调函数
+    forkFunction_(false, index); // fork 回调函数
 
     Process process(fds);
     process.setAsChild(static_cast<int>(getpid()));
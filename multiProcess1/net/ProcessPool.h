@@ -19,7 +19,8 @@ namespace tinyWS_process1 {
 
     class ProcessPool {
     public:
-        using ForkCallback = std::function<void(bool)>;
+        // fork 之后的回调函数，isParent 表示当前是否为父进程，index 为子进程的下标（从 0 开始）
+        using ForkCallback = std::function<void(bool isParent, int index)>;
 
     private:
         EventLoop* baseLoop_; // 父进程事件循环
@@ -62,7 +63,7 @@ namespace tinyWS_process1 {
     private:
         void createChildAndSetParent(int processNum);
 
-        pid_t createChildProcess(int fds[2]);
+        pid_t createChildProcess(int fds[2], int index);
 
         void addChildInfoToParent(pid_t childPid, int fds[2]);
 
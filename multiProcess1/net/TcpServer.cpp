@@ -26,7 +26,7 @@ TcpServer::TcpServer(const InternetAddress &address, const std::string& name)
     acceptor_->setNewConnectionCallback(
             std::bind(&TcpServer::newConnectionInParent, this, _1, _2));
 
-    processPool_->setForkFunction(std::bind(&TcpServer::clearInSubProcess, this, _1));
+    processPool_->setForkFunction(std::bind(&TcpServer::clearInSubProcess, this, _1, _2));
 }
 
 TcpServer::~TcpServer() {
@@ -55,6 +55,10 @@ void TcpServer::start() {
     }
 }
 
+void TcpServer::setForkCallback(const ForkCallback& cb) {
+    forkCallback_ = cb;
+}
+
 void TcpServer::setConnectionCallback(const ConnectionCallback& cb) {
     connectionCallback_ = cb;
 }
@@ -149,7 +153,7 @@ void TcpServer::removeConnection(const TcpConnectionPtr& connection) {
         connection->connectionDestroyed();
 }
 
-inline void TcpServer::clearInSubProcess(bool isParent) {
+inline void TcpServer::clearInSubProcess(bool isParent, int index) {
     if (!isParent) {
         // 将子进程中多余的资源释放了。
 
@@ -165,4 +169,8 @@ inline void TcpServer::clearInSubProcess(bool isParent) {
         processPool_->setChildConnectionCallback(
                 std::bind(&TcpServer::newConnectionInChild, this, _1, _2));
     }
+
+    if (forkCallback_) {
+        forkCallback_(isParent, index);
+    }
 }
@@ -29,6 +29,8 @@ namespace tinyWS_process1 {
     class TcpServer {
     public:
         using ProcessInitCallback = std::function<void(EventLoop*)>;
+        // fork 之后的回调函数，isParent 表示当前是否为父进程，index 为子进程的下标
+        using ForkCallback = std::function<void(bool isParent, int index)>;
 
     private:
         using ConnectionMap = std::map<std::string, TcpConnectionPtr>;
@@ -46,6 +48,7 @@ namespace tinyWS_process1 {
         ConnectionCallback connectionCallback_;             // 连接建立的回调函数
         MessageCallback messageCallback_;                   // 消息到来的回调函数
         ProcessInitCallback threadInitCallback_;             // 线程初始化的回调函数
+        ForkCallback forkCallback_;                         // fork 之后的回调函数
 
     public:
         TcpServer(const InternetAddress &address, const std::string &name);
@@ -70,6 +73,14 @@ namespace tinyWS_process1 {
          */
         void setMessageCallback(const MessageCallback &cb);
 
+        /**
+         * 设置 fork 之后的回调函数（如把子进程绑定到 CPU 上）。
+         * 父进程每创建一个子进程调用一次，子进程在开始事件循环之前调用一次。
+         * 需要在 start() 之前调用。
+         * @param cb 回调函数
+         */
+        void setForkCallback(const ForkCallback &cb);
+
         TimerId runAt(TimeType runTime, const Timer::TimerCallback& cb);
 
         TimerId runAfter(TimeType delay, const Timer::TimerCallback& cb);
@@ -83,7 +94,7 @@ namespace tinyWS_process1 {
 
         void removeConnection(const TcpConnectionPtr& connection);
 
-        void clearInSubProcess(bool isParent);
+        void clearInSubProcess(bool isParent, int index);
     };
 }
 
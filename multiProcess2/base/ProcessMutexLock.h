@@ -6,6 +6,7 @@
 #include <sys/mman.h>
 #include <unistd.h>
 
+#include <cerrno>
 #include <iostream>
 
 #include "noncopyable.h"
@@ -16,8 +17,9 @@ namespace tinyWS_process2 {
     class ProcessMutexLock : noncopyable {
     private:
         pthread_mutex_t* mutex_;
+        pid_t creator_; // 创建互斥量的进程
     public:
-        ProcessMutexLock() : mutex_(nullptr) {
+        ProcessMutexLock() : mutex_(nullptr), creator_(getpid()) {
             // 读设备 /dev/zero 时，该设备是 0 字节的无限资源。
             // 它可以接受写向它的任何数据，但又忽略这些数据。
             int fd = open("/dev/zero", O_RDWR, 0);
@@ -35,12 +37,18 @@ namespace tinyWS_process2 {
             pthread_mutexattr_init(&mutexattr);
             // PTHREAD_PROCESS_SHARED：允许在不同进程之间共享互斥量。
             pthread_mutexattr_setpshared(&mutexattr, PTHREAD_PROCESS_SHARED);
+            // PTHREAD_MUTEX_ROBUST：持有锁的进程退出后，下一个加锁的进程会得到 EOWNERDEAD，
+            // 而不是永远等待。否则子进程持有锁时被杀死，其他进程都无法再获取锁。
+            pthread_mutexattr_setrobust(&mutexattr, PTHREAD_MUTEX_ROBUST);
             pthread_mutex_init(mutex_, &mutexattr);
         }
 
         ~ProcessMutexLock() {
-            // 销毁互斥锁，释放映射的内存区域
-            pthread_mutex_destroy(mutex_);
+            // 销毁互斥锁，释放映射的内存区域。
+            // fork 出的子进程退出时也会析构，但其他进程还在使用互斥量，只能由创建它的进程销毁。
+            if (getpid() == creator_) {
+                pthread_mutex_destroy(mutex_);
+            }
             munmap(mutex_, sizeof(pthread_mutexattr_t));
         }
 
@@ -48,7 +56,9 @@ namespace tinyWS_process2 {
          * 加锁
          */
         void lock() {
-            pthread_mutex_lock(mutex_);
+            if (pthread_mutex_lock(mutex_) == EOWNERDEAD) {
+                pthread_mutex_consistent(mutex_);
+            }
         }
 
         /**
@@ -57,6 +67,11 @@ namespace tinyWS_process2 {
          */
         bool trylock() {
             int result = pthread_mutex_trylock(mutex_);
+            if (result == EOWNERDEAD) {
+                // 上一个持有锁的进程已退出，恢复锁的状态后由当前进程持有
+                pthread_mutex_consistent(mutex_);
+                result = 0;
+            }
 
             return  result == 0;
         }
@@ -10,8 +10,9 @@
 using namespace std::placeholders;
 using namespace tinyWS_process2;
 
-HttpServer::HttpServer(const InternetAddress& listenAddress, const std::string& name)
-        : tcpServer_(listenAddress, name),
+HttpServer::HttpServer(const InternetAddress& listenAddress, const std::string& name,
+                       TcpServer::AcceptStrategy strategy)
+        : tcpServer_(listenAddress, name, strategy),
           httpCallback_() {
     tcpServer_.setConnectionCallback(
             std::bind(&HttpServer::onConnection, this, _1));
@@ -27,6 +28,14 @@ void HttpServer::setHttpCallback(const HttpCallback& cb) {
     httpCallback_ = cb;
 }
 
+void HttpServer::setAcceptStatsInterval(int seconds) {
+    tcpServer_.setAcceptStatsInterval(seconds);
+}
+
+void HttpServer::setForkCallback(const TcpServer::ForkCallback& cb) {
+    tcpServer_.setForkCallback(cb);
+}
+
 void HttpServer::start() {
     tcpServer_.start();
 }
@@ -77,6 +86,7 @@ void HttpServer::onRequest(const TcpConnectionPtr& connection,
     if (httpCallback_) {
         httpCallback_(httpRequest, response);
     }
+    tcpServer_.getAcceptStats().recordRequest();
 
     Buffer buffer;
     response.appendToBuffer(&buffer);
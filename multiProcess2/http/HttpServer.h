@@ -28,8 +28,10 @@ namespace tinyWS_process2 {
          * @param loop 所属 EventLoop
          * @param listenAddress 监听地址
          * @param name TcpServer name
+         * @param strategy 多个进程 accept 新连接的策略
          */
-        HttpServer(const InternetAddress &listenAddress, const std::string &name);
+        HttpServer(const InternetAddress &listenAddress, const std::string &name,
+                   TcpServer::AcceptStrategy strategy = TcpServer::kAcceptMutex);
 
         /**
          * 获取所属 EventLoop
@@ -43,6 +45,18 @@ namespace tinyWS_process2 {
          */
         void setHttpCallback(const HttpCallback& cb);
 
+        /**
+         * 设置父进程输出 accept 分布和 QPS 报告的周期
+         * @param seconds 周期（秒），0 表示不输出
+         */
+        void setAcceptStatsInterval(int seconds);
+
+        /**
+         * 设置 fork 之后的回调函数，设置时立即在当前进程中调用一次
+         * @param cb 回调函数
+         */
+        void setForkCallback(const TcpServer::ForkCallback& cb);
+
         /**
          * 启动 TcpServer
          */
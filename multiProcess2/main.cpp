@@ -3,6 +3,8 @@
 #include <sys/stat.h>   // struct stat
 #include <sys/mman.h>   // mmap()、munmap()
 
+#include <cstring>
+
 #include <iostream>
 #include <functional>
 
@@ -12,6 +14,7 @@
 #include "http/HttpResponse.h"
 #include "net/TimerId.h"
 #include "net/Timer.h"
+#include "base/CpuAffinity.h"
 
 using namespace std::placeholders;
 using namespace tinyWS_process2;
@@ -20,26 +23,66 @@ void test_runEvery();
 void httpCallback(const HttpRequest& request, HttpResponse& response);
 void set404NotFound(HttpResponse& response);
 
+// 用法：tinyWS_process2 [进程数] [端口] [选项...]
+// 选项：
+//   --accept=mutex|exclusive|reuseport  多个进程 accept 新连接的策略（默认为 mutex）：
+//                                       mutex      竞争进程间互斥锁，持有锁的进程监听共享的 listen sockfd
+//                                       exclusive  所有进程以 EPOLLEXCLUSIVE 方式监听共享的 listen sockfd
+//                                       reuseport  每个进程有自己的 SO_REUSEPORT listen sockfd
+//   --accept-stats=秒                   父进程每隔若干秒输出每个进程 accept 的连接数、占比和 QPS，用于压测时比较各个策略
+//   --cpu-affinity=auto|CPU列表         把进程依次绑定到 CPU 上（如 0-3,8），父进程为第 0 个，auto 表示所有可用的 CPU，
+//                                       并优先从 CPU 所在的 NUMA 节点分配内存，启动时输出绑定结果
 int main(int argc, char* argv[]) {
 //     debug() << "pid = " << ::getpid() << ", tid = " << Thread::gettid() << std::endl;
 
     int processNum = 1;
     int port = 19123;
+    TcpServer::AcceptStrategy acceptStrategy = TcpServer::kAcceptMutex;
+    int acceptStatsInterval = 0;
+    std::string cpuAffinity;
     if (argc > 1) {
         processNum = ::atoi(argv[1]);
     }
     if (argc > 2) {
         port = ::atoi(argv[2]);
     }
+    for (int i = 3; i < argc; ++i) {
+        if (::strcmp(argv[i], "--accept=mutex") == 0) {
+            acceptStrategy = TcpServer::kAcceptMutex;
+        } else if (::strcmp(argv[i], "--accept=exclusive") == 0) {
+            acceptStrategy = TcpServer::kAcceptExclusive;
+        } else if (::strcmp(argv[i], "--accept=reuseport") == 0) {
+            acceptStrategy = TcpServer::kAcceptReusePort;
+        } else if (::strncmp(argv[i], "--accept-stats=", 15) == 0) {
+            acceptStatsInterval = ::atoi(argv[i] + 15);
+        } else if (::strncmp(argv[i], "--cpu-affinity=", 15) == 0) {
+            cpuAffinity = argv[i] + 15;
+        }
+    }
 
     InternetAddress listenAddress(port);
 //    InternetAddress listenAddress(std::string("127.0.0.1"), 12315); // for pressure test
-    HttpServer server(listenAddress, "tinyWS");
+    HttpServer server(listenAddress, "tinyWS", acceptStrategy);
 
 //    auto timerId = server.runEvery(2 * 1000 * 1000, std::bind(&test_runEvery));
 
 //    server.setProcessNum(processNum);
     server.setHttpCallback(std::bind(&httpCallback, _1, _2));
+    server.setAcceptStatsInterval(acceptStatsInterval);
+
+    // 构造 HttpServer 时已经 fork 了子进程，设置回调函数时立即在每个进程中绑定 CPU，
+    // 退出后重新创建的子进程沿用原来的下标，绑定到同一个 CPU 上
+    CpuAffinity affinity(cpuAffinity);
+    if (!cpuAffinity.empty()) {
+        if (affinity.empty()) {
+            std::cout << "invalid --cpu-affinity: " << cpuAffinity << std::endl;
+        } else {
+            server.setForkCallback([&affinity](bool isParent, int index) {
+                std::cout << (isParent ? "[parent " : "[child ") << index << "] pid " << ::getpid() << ": "
+                          << affinity.bindCurrentThread(index) << std::endl;
+            });
+        }
+    }
     // 在 server::start() 函数调用之前，必须配置好跟子进程相关的设置。
     // 因为直到程序结束，子进程都不会从 start() 函数返回。
     server.start();
@@ -0,0 +1,122 @@
+#include "AcceptStats.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+
+#include <cstdio>
+#include <iostream>
+#include <new>
+
+#include "Timer.h"
+
+using namespace tinyWS_process2;
+
+AcceptStats::AcceptStats()
+    : slots_(nullptr),
+      slot_(nullptr),
+      lastAccepts_(kMaxSlots, 0),
+      lastRequests_(kMaxSlots, 0),
+      lastReportTime_(0) {
+
+    // 与 ProcessMutexLock 一样，通过映射 /dev/zero 得到进程间共享的内存
+    int fd = open("/dev/zero", O_RDWR, 0);
+    void* address = mmap(nullptr,
+                         sizeof(Slot) * kMaxSlots,
+                         PROT_READ | PROT_WRITE, MAP_SHARED,
+                         fd,
+                         0);
+    close(fd); // 已经映射完成，可以关闭文件描述符。
+
+    if (address == MAP_FAILED) {
+        std::cout << "AcceptStats::AcceptStats mmap failed" << std::endl;
+        return;
+    }
+
+    slots_ = static_cast<Slot*>(address);
+    for (int i = 0; i < kMaxSlots; ++i) {
+        new (&slots_[i]) Slot();
+        slots_[i].pid.store(0);
+        slots_[i].accepts.store(0);
+        slots_[i].requests.store(0);
+    }
+}
+
+AcceptStats::~AcceptStats() {
+    if (slots_ != nullptr) {
+        munmap(slots_, sizeof(Slot) * kMaxSlots);
+    }
+}
+
+void AcceptStats::registerProcess(int index) {
+    slot_ = nullptr;
+    if (slots_ == nullptr || index < 0 || index >= kMaxSlots) {
+        return;
+    }
+
+    // 原来使用该槽的进程已经退出，不会再写计数器
+    slot_ = &slots_[index];
+    slot_->pid.store(getpid());
+}
+
+void AcceptStats::recordAccept() {
+    if (slot_ != nullptr) {
+        // 只有当前进程写自己的槽，不需要原子的读-改-写
+        slot_->accepts.store(slot_->accepts.load(std::memory_order_relaxed) + 1,
+                             std::memory_order_relaxed);
+    }
+}
+
+void AcceptStats::recordRequest() {
+    if (slot_ != nullptr) {
+        slot_->requests.store(slot_->requests.load(std::memory_order_relaxed) + 1,
+                              std::memory_order_relaxed);
+    }
+}
+
+void AcceptStats::report(const std::string& strategy) {
+    if (slots_ == nullptr) {
+        return;
+    }
+
+    TimeType now = Timer::now();
+    bool first = lastReportTime_ == 0;
+    double seconds = static_cast<double>(now - lastReportTime_) / Timer::kMicroSecondsPerSecond;
+    lastReportTime_ = now;
+
+    std::vector<int64_t> accepts(kMaxSlots, 0);
+    std::vector<int64_t> requests(kMaxSlots, 0);
+    int64_t totalAccepts = 0;
+    int64_t totalRequests = 0;
+    for (int i = 0; i < kMaxSlots; ++i) {
+        int64_t currentAccepts = slots_[i].accepts.load(std::memory_order_relaxed);
+        int64_t currentRequests = slots_[i].requests.load(std::memory_order_relaxed);
+        accepts[i] = currentAccepts - lastAccepts_[i];
+        requests[i] = currentRequests - lastRequests_[i];
+        lastAccepts_[i] = currentAccepts;
+        lastRequests_[i] = currentRequests;
+        totalAccepts += accepts[i];
+        totalRequests += requests[i];
+    }
+
+    if (first || seconds <= 0) {
+        return;
+    }
+
+    char line[128];
+    snprintf(line, sizeof(line), "[accept stats] strategy=%s interval=%.1fs",
+             strategy.c_str(), seconds);
+    std::cout << line << std::endl;
+    for (int i = 0; i < kMaxSlots; ++i) {
+        pid_t pid = slots_[i].pid.load();
+        if (pid == 0) {
+            continue;
+        }
+        double share = totalAccepts > 0 ? 100.0 * accepts[i] / totalAccepts : 0.0;
+        snprintf(line, sizeof(line), "  pid %-7d accepts %-8lld (%5.1f%%)  qps %.1f",
+                 pid, static_cast<long long>(accepts[i]), share, requests[i] / seconds);
+        std::cout << line << std::endl;
+    }
+    snprintf(line, sizeof(line), "  total       accepts %-8lld           qps %.1f",
+             static_cast<long long>(totalAccepts), totalRequests / seconds);
+    std::cout << line << std::endl;
+}
@@ -0,0 +1,75 @@
+#ifndef TINYWS_ACCEPTSTATS_H
+#define TINYWS_ACCEPTSTATS_H
+
+#include <unistd.h>
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "../base/noncopyable.h"
+#include "type.h"
+
+namespace tinyWS_process2 {
+
+    // 统计每个进程 accept 的连接数和处理的请求数，用于比较不同 accept 策略下连接在进程间的分布和 QPS。
+    //
+    // 计数器保存在 fork 之前映射的共享内存中，所有进程都能看到。
+    // 每个进程按进程下标（ProcessPool::index()）使用一个槽，重新创建的子进程沿用原来的下标和槽，
+    // 所以子进程退出再重新创建多少次都不会用完槽。同一时刻只有一个进程会写一个槽，所以计数时无须加锁；
+    // 父进程定期读取所有的槽，输出两次报告之间的增量。
+    class AcceptStats : noncopyable {
+    public:
+        static const int kMaxSlots = 64;    // 最多统计的进程数，下标不小于 kMaxSlots 的进程不计数
+
+    private:
+        // 每个槽独占一个 cache line，避免不同进程写计数器时伪共享
+        struct alignas(64) Slot {
+            std::atomic<pid_t> pid;         // 当前使用该槽的进程，0 表示未被使用
+            std::atomic<int64_t> accepts;   // accept 的连接数
+            std::atomic<int64_t> requests;  // 处理的请求数
+        };
+
+        Slot* slots_;                       // 共享内存中的槽
+        Slot* slot_;                        // 当前进程的槽，为 nullptr 时不计数
+
+        // 以下只有输出报告的进程使用
+        std::vector<int64_t> lastAccepts_;  // 上次报告时各个槽的连接数
+        std::vector<int64_t> lastRequests_; // 上次报告时各个槽的请求数
+        TimeType lastReportTime_;           // 上次报告的时间，0 表示还没有报告过
+
+    public:
+        /**
+         * 构造函数，映射共享内存。必须在 fork 之前构造。
+         */
+        AcceptStats();
+
+        ~AcceptStats();
+
+        /**
+         * 当前进程使用下标对应的槽，fork 之后在每个进程中调用一次。
+         * 重新创建的子进程接着原来的进程计数，报告按两次之间的增量计算，不受影响。
+         * @param index 进程下标，父进程为 0，子进程从 1 开始
+         */
+        void registerProcess(int index);
+
+        /**
+         * 当前进程 accept 了一个连接
+         */
+        void recordAccept();
+
+        /**
+         * 当前进程处理了一个请求
+         */
+        void recordRequest();
+
+        /**
+         * 输出自上次报告以来，每个进程 accept 的连接数、占比和 QPS。第一次调用只记录起点。
+         * @param strategy accept 策略的名称
+         */
+        void report(const std::string& strategy);
+    };
+}
+
+
+#endif //TINYWS_ACCEPTSTATS_H
@@ -25,13 +25,16 @@ Acceptor::Acceptor(EventLoop* loop, const InternetAddress& listenAddress)
 }
 
 Acceptor::Acceptor(EventLoop* loop, Socket socket,
-                   const InternetAddress &listenAddress)
+                   const InternetAddress &listenAddress, bool reusePort)
         : loop_(loop),
           acceptSocket_(std::move(socket)),
           acceptChannel_(loop_, acceptSocket_.fd()),
           isListening_(false) {
 
     acceptSocket_.setReuseAddr(true);
+    if (reusePort) {
+        acceptSocket_.setReusePort(true);
+    }
     acceptSocket_.bindAddress(listenAddress);
     acceptChannel_.setReadCallback(std::bind(&Acceptor::handleRead, this));
 }
@@ -64,6 +67,10 @@ void Acceptor::unlistenInEpoll() {
     acceptChannel_.disableReading();
 }
 
+void Acceptor::listenInEpollExclusive() {
+    acceptChannel_.enableReadingExclusive();
+}
+
 bool Acceptor::isLIstening() const {
     return isListening_;
 }
@@ -77,6 +84,8 @@ int Acceptor::createNonblocking() {
     if (sockfd < 0) {
 //        std::cout << "sockets::createNonblockingOrDie" << std::endl;;
     }
+
+    return sockfd;
 }
 
 void Acceptor::handleRead() {
@@ -28,7 +28,14 @@ namespace tinyWS_process2 {
     public:
         Acceptor(EventLoop* loop, const InternetAddress& listenAddress);
 
-        Acceptor(EventLoop* loop, Socket socket, const InternetAddress& listenAddress);
+        /**
+         * 构造函数
+         * @param loop 所属 EventLoop
+         * @param socket 监听 socket
+         * @param listenAddress 监听地址
+         * @param reusePort 是否在 bind 之前设置 SO_REUSEPORT
+         */
+        Acceptor(EventLoop* loop, Socket socket, const InternetAddress& listenAddress, bool reusePort = false);
 
         ~Acceptor();
 
@@ -42,6 +49,11 @@ namespace tinyWS_process2 {
 
         void unlistenInEpoll();
 
+        /**
+         * 以 EPOLLEXCLUSIVE 方式在 Epoll 中监听读事件，之后不能再调用 unlistenInEpoll()
+         */
+        void listenInEpollExclusive();
+
         bool isLIstening() const;
 
         int getSockfd() const;
@@ -87,6 +87,13 @@ void Channel::enableReading() {
     update();
 }
 
+void Channel::enableReadingExclusive() {
+    assert(isNoneEvent());
+    // EPOLLEXCLUSIVE 只能和 EPOLLIN、EPOLLOUT 等少数事件一起使用，不能带 EPOLLPRI
+    events_ = EPOLLIN | EPOLLEXCLUSIVE;
+    update();
+}
+
 void Channel::disableReading() {
     events_ &= ~kReadEvent;
     update();
@@ -72,6 +72,13 @@ namespace tinyWS_process2 {
 
         void enableReading();
 
+        /**
+         * 以 EPOLLEXCLUSIVE 方式关注读事件，多个 epoll 实例监听同一个文件描述符时，
+         * 一个事件只唤醒其中一个（或少数几个）。
+         * 只能在添加到 Epoll 时设置，之后不能再修改关心的事件（EPOLL_CTL_MOD 会失败），只能移除。
+         */
+        void enableReadingExclusive();
+
         void disableReading();
 
         void enableWriting();
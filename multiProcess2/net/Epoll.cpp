@@ -20,6 +20,7 @@ const int kDeleted = 2;
 
 Epoll::Epoll(EventLoop *loop)
     : loop_(loop),
+      pid_(getpid()),
       epollfd_(epoll_create1(EPOLL_CLOEXEC)),
       events_(kInitEventListSize) {
     if (epollfd_ < 0) {
@@ -115,6 +116,12 @@ void Epoll::fillActiveChannels(int eventNums, ChannelList *activeChannels) const
 }
 
 void Epoll::update(int operation, Channel *channel) {
+    // fork 之后子进程与父进程共享同一个 epoll 实例，子进程销毁继承的 EventLoop（TcpServer 重新创建子进程时）
+    // 不能修改它，否则会删除父进程的 Channel（如输出统计报告的定时器），只有创建它的进程才能修改
+    if (getpid() != pid_) {
+        return;
+    }
+
     epoll_event event{};
 
     // struct epoll_event {
@@ -2,6 +2,7 @@
 #define TINYWS_EPOLL_H
 
 #include <sys/epoll.h>
+#include <sys/types.h>
 
 #include <vector>
 #include <map>
@@ -36,6 +37,7 @@ namespace tinyWS_process2 {
         static const int kInitEventListSize = 16;   // 事件数组（EventList）的默认大小
 
         EventLoop* loop_;
+        pid_t pid_;         // 创建 epoll 实例的进程
         int epollfd_;
         EventList events_;
         ChannelMap channels_;
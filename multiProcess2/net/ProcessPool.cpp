@@ -18,12 +18,17 @@ using namespace tinyWS_process2;
 ProcessPool::ProcessPool(EventLoop* loop)
       : baseLoop_(loop),
         processNum_(1),
-        running_(false) {
+        running_(false),
+        isParent_(true),
+        index_(0) {
 
 }
 
 ProcessPool::ProcessPool(int processNum)
-    : processNum_(processNum) {
+    : processNum_(processNum),
+      running_(false),
+      isParent_(true),
+      index_(0) {
 
     createChildProcess(processNum_);
 
@@ -53,6 +58,9 @@ void ProcessPool::killAll() {
 
 void ProcessPool::setForkFunction(const ForkCallback& cb) {
     forkFunction_ = cb;
+    if (forkFunction_) {
+        forkFunction_(isParent_, index_);
+    }
 }
 
 void ProcessPool::setParentSignalHandlers() {
@@ -101,6 +109,8 @@ void ProcessPool::createChildProcess(int processNum) {
             // 子进程
 //            std::cout << "[processpool] child process(" << getpid() << ")" << std::endl;
 
+            isParent_ = false;
+            index_ = i + 1;
             setChildSignalHandlers();
 
             return;
@@ -120,30 +130,52 @@ void ProcessPool::createChildProcess(int processNum) {
 
 pid_t ProcessPool::createNewChildProcess() {
 //    std::cout << "pids size: " << pids_.size() << std::endl;
-    for (int i = pids_.size(); i <= processNum_; ++i) {
-        pid_t pid = fork();
-
-        if (pid < 0) {
-//            std::cout  << "[processpool] fork error" << std::endl;
-        } else if (pid == 0) {
-            // 子进程
-//            std::cout << "[processpool] new child process(" << getpid() << ")" << std::endl;
-
-            setChildSignalHandlers();
-
+    // 找到已经退出的子进程，新的子进程沿用它的下标
+    size_t slot = pids_.size();
+    for (size_t i = 0; i < pids_.size(); ++i) {
+        if (::kill(pids_[i], 0) == -1) {
+            slot = i;
             break;
-        } else {
-            // 父进程
+        }
+    }
 
-//        forkFunction_(true); // fork 回调函数
+    pid_t pid = fork();
 
-//            std::cout << "[processpool] " << getpid() << " create new process(" << pid << ")" << std::endl;
+    if (pid < 0) {
+//        std::cout  << "[processpool] fork error" << std::endl;
+        return -1;
+    } else if (pid == 0) {
+        // 子进程
+//        std::cout << "[processpool] new child process(" << getpid() << ")" << std::endl;
 
-            pids_.push_back(pid);
+        isParent_ = false;
+        index_ = static_cast<int>(slot) + 1;
+        setChildSignalHandlers();
+
+        if (forkFunction_) {
+            forkFunction_(false, index_); // fork 回调函数
         }
 
-        return pid;
+        return 0;
+    }
+
+    // 父进程
+//    std::cout << "[processpool] " << getpid() << " create new process(" << pid << ")" << std::endl;
+    if (slot < pids_.size()) {
+        pids_[slot] = pid;
+    } else {
+        pids_.push_back(pid);
     }
+
+    return pid;
+}
+
+bool ProcessPool::isParent() const {
+    return isParent_;
+}
+
+int ProcessPool::index() const {
+    return index_;
 }
 
 void ProcessPool::parentStart() {
@@ -17,7 +17,9 @@ namespace tinyWS_process2 {
 
     class ProcessPool {
     public:
-        using ForkCallback = std::function<void(bool)>;
+        // fork 之后的回调函数，isParent 表示当前是否为父进程，
+        // index 为当前进程的下标（父进程为 0，子进程从 1 开始，重新创建的子进程沿用原来的下标）
+        using ForkCallback = std::function<void(bool isParent, int index)>;
 
     private:
         EventLoop* baseLoop_; // 父进程事件循环
@@ -26,6 +28,8 @@ namespace tinyWS_process2 {
 
 //        std::string name_;
         bool running_;
+        bool isParent_;     // 当前进程是否为父进程
+        int index_;         // 当前进程的下标，父进程为 0
 
         SignalManager signalManager_;
 
@@ -42,6 +46,12 @@ namespace tinyWS_process2 {
 
         void killAll();
 
+        /**
+         * 设置 fork 之后的回调函数。
+         * 构造时已经 fork 了子进程，所以设置时立即在当前进程中调用一次，
+         * 之后每个重新创建的子进程在 fork 之后也调用一次。
+         * @param cb 回调函数
+         */
         void setForkFunction(const ForkCallback& cb);
 
         void setParentSignalHandlers();
@@ -49,6 +59,18 @@ namespace tinyWS_process2 {
         void setChildSignalHandlers();
 
         pid_t createNewChildProcess();
+
+        /**
+         * 当前进程是否为父进程
+         * @return 是否为父进程
+         */
+        bool isParent() const;
+
+        /**
+         * 当前进程的下标
+         * @return 父进程为 0，子进程从 1 开始
+         */
+        int index() const;
     private:
         void createChildProcess(int processNum);
 
@@ -126,6 +126,13 @@ void Socket::setReuseAddr(bool on) {
     setsockopt(sockfd_, IPPROTO_TCP, SO_REUSEADDR, &opt, sizeof(opt));
 }
 
+void Socket::setReusePort(bool on) {
+    int opt = on ? 1 : 0;
+    if (::setsockopt(sockfd_, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) < 0 && on) {
+        std::cout << "Socket::setReusePort failed" << std::endl;
+    }
+}
+
 void Socket::setKeepAlive(bool on) {
     int opt = on ? 1 : 0;
     setsockopt(sockfd_, SOL_SOCKET, SO_KEEPALIVE, &opt, sizeof(opt));
@@ -38,6 +38,12 @@ namespace tinyWS_process2 {
 
         void setReuseAddr(bool on);
 
+        /**
+         * 设置 SO_REUSEPORT，必须在 bind 之前调用
+         * @param on 是否开启
+         */
+        void setReusePort(bool on);
+
         void setKeepAlive(bool on);
 
         int getSocketError();
@@ -17,26 +17,37 @@
 using namespace tinyWS_process2;
 using namespace std::placeholders;
 
-TcpServer::TcpServer(const InternetAddress& address, const std::string& name)
-                     : socketBeforeFork_(Acceptor::createNonblocking()), // listen socket
+TcpServer::TcpServer(const InternetAddress& address, const std::string& name,
+                     AcceptStrategy strategy)
+                     : acceptStrategy_(strategy),
+                       listenAddress_(address),
+                       // kAcceptReusePort 在 fork 之后每个进程创建自己的 listen socket
+                       socketBeforeFork_(strategy == kAcceptReusePort ? -1 : Acceptor::createNonblocking()),
                        processMutexLock_(),
                        isLock_(false),
+                       acceptStats_(),
+                       acceptStatsInterval_(0),
                        processPool_(new ProcessPool(4)),
                        loop_(new EventLoop()),
-                       acceptor_(new Acceptor(loop_, std::move(socketBeforeFork_), address)),
+                       acceptor_(new Acceptor(loop_,
+                                              strategy == kAcceptReusePort ?
+                                                  Socket(Acceptor::createNonblocking()) :
+                                                  std::move(socketBeforeFork_),
+                                              address,
+                                              strategy == kAcceptReusePort)),
                        name_(name),
-                       nextConnectionId_(1) {
+                       nextConnectionId_(1),
+                       started_(false) {
 
     acceptor_->setNewConnectionCallback(
             std::bind(&TcpServer::newConnectionInParent, this, _1, _2));
-
-    loop_->setListenSockfd(acceptor_->getSockfd());
-    loop_->setBeforeEachLoopFunction(std::bind(&TcpServer::lockAcceptor, this));
-    loop_->setAfterEachLoopFunction(std::bind(&TcpServer::unlockAcceptor, this));
 }
 
 TcpServer::~TcpServer() {
 //    std::cout << "TcpServer::~TcpServer [" << name_ << "] destructing" << std::endl;
+    // 进程退出时如果还持有 accept 锁，必须释放，否则其他进程再也无法 accept
+    unlockAcceptor();
+
     for (const auto& connection : connectionMap_) {
         connection.second->connectionDestroyed();
     }
@@ -51,6 +62,15 @@ void TcpServer::start() {
         started_ = true;
         acceptor_->listen();
 //        acceptor_->listenInEpoll();
+        startAccepting();
+
+        if (acceptStatsInterval_ > 0 && processPool_->isParent()) {
+            std::string strategyName = acceptStrategyName(acceptStrategy_);
+            AcceptStats* stats = &acceptStats_;
+            loop_->runEvery(acceptStatsInterval_ * Timer::kMicroSecondsPerSecond, [stats, strategyName]() {
+                stats->report(strategyName);
+            });
+        }
 
         bool running = true;
         while (running) {
@@ -80,6 +100,20 @@ void TcpServer::start() {
                     delete loop_;
                     loop_ = new EventLoop();
                     acceptor_->resetLoop(loop_);
+                    // fork 时父进程可能正持有锁，子进程不能释放父进程的锁
+                    isLock_ = false;
+
+                    if (acceptStrategy_ == kAcceptReusePort) {
+                        // 继承的 listen socket 属于父进程，子进程创建自己的 listen socket
+                        acceptor_.reset(new Acceptor(loop_,
+                                                     Socket(Acceptor::createNonblocking()),
+                                                     listenAddress_,
+                                                     true));
+                        acceptor_->setNewConnectionCallback(
+                                std::bind(&TcpServer::newConnectionInParent, this, _1, _2));
+                        acceptor_->listen();
+                    }
+                    startAccepting();
                 }
             }
         }
@@ -94,6 +128,31 @@ void TcpServer::setMessageCallback(const MessageCallback& cb) {
     messageCallback_ = cb;
 }
 
+void TcpServer::setAcceptStatsInterval(int seconds) {
+    acceptStatsInterval_ = seconds;
+}
+
+void TcpServer::setForkCallback(const ForkCallback& cb) {
+    processPool_->setForkFunction(cb);
+}
+
+AcceptStats& TcpServer::getAcceptStats() {
+    return acceptStats_;
+}
+
+const char* TcpServer::acceptStrategyName(AcceptStrategy strategy) {
+    switch (strategy) {
+        case kAcceptMutex:
+            return "mutex";
+        case kAcceptExclusive:
+            return "exclusive";
+        case kAcceptReusePort:
+            return "reuseport";
+        default:
+            return "unknown";
+    }
+}
+
 TimerId TcpServer::runAt(TimeType runTime, const Timer::TimerCallback& cb) {
     return loop_->runAt(runTime, cb);
 }
@@ -107,6 +166,8 @@ TimerId TcpServer::runEvery(TimeType interval, const Timer::TimerCallback& cb) {
 }
 
 void TcpServer::newConnectionInParent(Socket socket, const InternetAddress& peerAddress) {
+    acceptStats_.recordAccept();
+
     char buf[32];
     snprintf(buf, sizeof(buf), "%d", nextConnectionId_);
     ++nextConnectionId_;
@@ -184,6 +245,25 @@ void TcpServer::reset() {
     loop_ = new EventLoop();
 }
 
+void TcpServer::startAccepting() {
+    acceptStats_.registerProcess(processPool_->index());
+    loop_->setListenSockfd(acceptor_->getSockfd());
+
+    switch (acceptStrategy_) {
+        case kAcceptMutex:
+            // 每次事件循环前尝试获取锁，获取成功才监听 listen sockfd
+            loop_->setBeforeEachLoopFunction(std::bind(&TcpServer::lockAcceptor, this));
+            loop_->setAfterEachLoopFunction(std::bind(&TcpServer::unlockAcceptor, this));
+            break;
+        case kAcceptExclusive:
+            acceptor_->listenInEpollExclusive();
+            break;
+        case kAcceptReusePort:
+            acceptor_->listenInEpoll();
+            break;
+    }
+}
+
 void TcpServer::lockAcceptor() {
     bool locked = processMutexLock_.trylock();
     if (locked) {
@@ -8,6 +8,8 @@
 
 #include "../base/noncopyable.h"
 #include "Socket.h"
+#include "InternetAddress.h"
+#include "AcceptStats.h"
 #include "../base/ProcessMutexLock.h"
 #include "TcpConnection.h"
 #include "Timer.h"
@@ -18,7 +20,6 @@ namespace tinyWS_process2 {
     class EventLoop;
     class Acceptor;
     class ProcessPool;
-    class InternetAddress;
     class TimerId;
 
     // TcpServer 的功能：管理 Acceptor 获得的 TcpConnection。
@@ -31,13 +32,32 @@ namespace tinyWS_process2 {
     class TcpServer {
     public:
         using ProcessInitCallback = std::function<void(EventLoop*)>;
+        // fork 之后的回调函数，isParent 表示当前是否为父进程，index 为当前进程的下标（父进程为 0）
+        using ForkCallback = std::function<void(bool isParent, int index)>;
+
+        // 多个进程如何 accept 新连接（避免惊群）
+        enum AcceptStrategy {
+            // 所有进程共享一个 listen sockfd，每次事件循环前竞争进程间互斥锁，
+            // 只有持有锁的进程把 listen sockfd 加入 epoll，accept 之后释放锁并从 epoll 中移除
+            kAcceptMutex,
+            // 所有进程共享一个 listen sockfd，每个进程都以 EPOLLEXCLUSIVE 方式一直监听，
+            // 由内核保证一个新连接只唤醒一个（或少数几个）进程，不需要锁，也不需要反复 epoll_ctl
+            kAcceptExclusive,
+            // 每个进程在 fork 之后创建自己的 SO_REUSEPORT listen sockfd，
+            // 由内核按照四元组的哈希把新连接分发到各个进程的 accept 队列
+            kAcceptReusePort
+        };
 
     private:
         using ConnectionMap = std::map<std::string, TcpConnectionPtr>;
 
-        Socket socketBeforeFork_; // 用于在进程池 fork 子进程之前，保存 listen sockfd
+        const AcceptStrategy acceptStrategy_;
+        const InternetAddress listenAddress_;
+        Socket socketBeforeFork_; // 用于在进程池 fork 子进程之前，保存 listen sockfd（kAcceptReusePort 不使用）
         ProcessMutexLock processMutexLock_;
         bool isLock_;
+        AcceptStats acceptStats_; // 共享内存，必须在 fork 之前构造
+        int acceptStatsInterval_; // 输出统计报告的周期（秒），0 表示不输出
 
 
         std::unique_ptr<ProcessPool> processPool_;
@@ -56,7 +76,14 @@ namespace tinyWS_process2 {
         ProcessInitCallback threadInitCallback_;             // 线程初始化的回调函数
 
     public:
-        TcpServer(const InternetAddress &address, const std::string &name);
+        /**
+         * 构造函数，会 fork 出子进程，所以 accept 策略必须在构造时确定
+         * @param address 监听地址
+         * @param name 名称
+         * @param strategy accept 策略
+         */
+        TcpServer(const InternetAddress &address, const std::string &name,
+                  AcceptStrategy strategy = kAcceptMutex);
 
         ~TcpServer();
 
@@ -76,6 +103,33 @@ namespace tinyWS_process2 {
          */
         void setMessageCallback(const MessageCallback &cb);
 
+        /**
+         * 设置父进程输出 accept 统计报告的周期，必须在 start() 之前调用
+         * @param seconds 周期（秒），0 表示不输出
+         */
+        void setAcceptStatsInterval(int seconds);
+
+        /**
+         * 设置 fork 之后的回调函数（如把进程绑定到 CPU 上）。
+         * 构造时已经 fork 了子进程，所以设置时立即在当前进程中调用一次；
+         * 之后重新创建的子进程在创建 EventLoop 之前也调用一次。
+         * @param cb 回调函数
+         */
+        void setForkCallback(const ForkCallback &cb);
+
+        /**
+         * 获取 accept 统计，用于上层记录请求数
+         * @return AcceptStats
+         */
+        AcceptStats& getAcceptStats();
+
+        /**
+         * 获取 accept 策略的名称
+         * @param strategy accept 策略
+         * @return 名称
+         */
+        static const char* acceptStrategyName(AcceptStrategy strategy);
+
         TimerId runAt(TimeType runTime, const Timer::TimerCallback& cb);
 
         TimerId runAfter(TimeType delay, const Timer::TimerCallback& cb);
@@ -91,6 +145,12 @@ namespace tinyWS_process2 {
 
         void reset();
 
+        /**
+         * 按照 accept 策略，让当前进程的 EventLoop 开始监听 listen sockfd。
+         * 在 start() 和重新创建子进程之后调用。
+         */
+        void startAccepting();
+
         void lockAcceptor();
 
         void unlockAcceptor();
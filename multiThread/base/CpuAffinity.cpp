@@ -0,0 +1,139 @@
+#include "CpuAffinity.h"
+
+#include <dirent.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+#include <sstream>
+
+using namespace tinyWS_thread;
+
+CpuAffinity::CpuAffinity(const std::string &cpuList)
+    : cpus_(parseCpuList(cpuList)) {
+
+}
+
+bool CpuAffinity::empty() const {
+    return cpus_.empty();
+}
+
+const std::vector<int>& CpuAffinity::cpus() const {
+    return cpus_;
+}
+
+std::string CpuAffinity::bindCurrentThread(int index) const {
+    std::ostringstream oss;
+    if (cpus_.empty()) {
+        oss << "not bound";
+        return oss.str();
+    }
+
+    int cpu = cpus_[static_cast<size_t>(index) % cpus_.size()];
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    // pid 为 0 时只设置调用线程
+    if (::sched_setaffinity(0, sizeof(set), &set) < 0) {
+        oss << "CPU " << cpu << " failed: " << ::strerror(errno);
+        return oss.str();
+    }
+    oss << "CPU " << cpu;
+
+    int node = numaNodeOfCpu(cpu);
+    if (node >= 0) {
+        oss << ", NUMA node " << node;
+        // MPOL_PREFERRED：优先从该节点分配，节点内存不足时再从其他节点分配
+        unsigned long nodeMask = 1UL << node;
+        if (numaNodeCount() > 1 && node < static_cast<int>(sizeof(nodeMask) * 8) &&
+            ::syscall(SYS_set_mempolicy, MPOL_PREFERRED, &nodeMask, sizeof(nodeMask) * 8 + 1) < 0) {
+            oss << " (set_mempolicy failed: " << ::strerror(errno) << ")";
+        }
+    }
+
+    return oss.str();
+}
+
+std::vector<int> CpuAffinity::parseCpuList(const std::string &cpuList) {
+    std::vector<int> cpus;
+    if (cpuList == "auto") {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        if (::sched_getaffinity(0, sizeof(set), &set) == 0) {
+            for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+                if (CPU_ISSET(cpu, &set)) {
+                    cpus.push_back(cpu);
+                }
+            }
+        }
+        return cpus;
+    }
+
+    // 以逗号分隔，每一项是一个 CPU 编号或者一个范围（a-b）
+    std::istringstream iss(cpuList);
+    std::string item;
+    while (std::getline(iss, item, ',')) {
+        char *end = nullptr;
+        long first = ::strtol(item.c_str(), &end, 10);
+        long last = first;
+        if (end == item.c_str()) {
+            return std::vector<int>();
+        }
+        if (*end == '-') {
+            const char *begin = end + 1;
+            last = ::strtol(begin, &end, 10);
+            if (end == begin) {
+                return std::vector<int>();
+            }
+        }
+        if (*end != '\0' || first < 0 || last < first || last >= CPU_SETSIZE) {
+            return std::vector<int>();
+        }
+        for (long cpu = first; cpu <= last; ++cpu) {
+            cpus.push_back(static_cast<int>(cpu));
+        }
+    }
+
+    return cpus;
+}
+
+int CpuAffinity::numaNodeOfCpu(int cpu) {
+    // /sys/devices/system/cpu/cpuN/ 目录下有一个指向所在节点的链接 nodeM
+    std::string path = "/sys/devices/system/cpu/cpu" + std::to_string(cpu);
+    DIR *dir = ::opendir(path.c_str());
+    if (dir == nullptr) {
+        return -1;
+    }
+
+    int node = -1;
+    while (dirent *entry = ::readdir(dir)) {
+        if (::strncmp(entry->d_name, "node", 4) == 0 && entry->d_name[4] >= '0' && entry->d_name[4] <= '9') {
+            node = ::atoi(entry->d_name + 4);
+            break;
+        }
+    }
+    ::closedir(dir);
+
+    return node;
+}
+
+int CpuAffinity::numaNodeCount() {
+    DIR *dir = ::opendir("/sys/devices/system/node");
+    if (dir == nullptr) {
+        return 1;
+    }
+
+    int count = 0;
+    while (dirent *entry = ::readdir(dir)) {
+        if (::strncmp(entry->d_name, "node", 4) == 0 && entry->d_name[4] >= '0' && entry->d_name[4] <= '9') {
+            ++count;
+        }
+    }
+    ::closedir(dir);
+
+    return count > 0 ? count : 1;
+}
@@ -0,0 +1,74 @@
+#ifndef TINYWS_CPUAFFINITY_H
+#define TINYWS_CPUAFFINITY_H
+
+#include <string>
+#include <vector>
+
+#include "noncopyable.h"
+
+namespace tinyWS_thread {
+
+    // CPU 绑定配置：把每个 IO 线程（或工作进程）绑定到一个 CPU 上，
+    // 避免被调度器迁移到其他 CPU 上，丢失 cache 局部性并引起延迟抖动。
+    //
+    // 绑定的同时，把线程的内存分配策略设置为优先使用该 CPU 所在的 NUMA 节点，
+    // 此后该线程首次访问的内存（如 EventLoop 中的缓冲区、对象池）都在本地节点上分配。
+    // 只有一个 NUMA 节点时，不设置内存分配策略。
+    //
+    // 一般在线程初始化回调函数（TcpServer::setThreadInitCallback）中调用 bindCurrentThread()，
+    // 此时 IO 线程还没有开始事件循环。
+    class CpuAffinity : noncopyable {
+    public:
+        /**
+         * 构造函数
+         * @param cpuList CPU 列表，如 "0-3,8,10-11"；"auto" 表示当前进程可以使用的所有 CPU
+         */
+        explicit CpuAffinity(const std::string &cpuList);
+
+        /**
+         * 是否没有可用的 CPU（CPU 列表为空或者格式错误）
+         * @return true / false
+         */
+        bool empty() const;
+
+        /**
+         * 获取 CPU 列表
+         * @return CPU 列表
+         */
+        const std::vector<int>& cpus() const;
+
+        /**
+         * 把调用线程绑定到第 index 个 CPU（超过 CPU 个数时循环使用），
+         * 并优先从该 CPU 所在的 NUMA 节点分配内存
+         * @param index 线程（进程）的下标
+         * @return 绑定结果的描述，用于启动时输出
+         */
+        std::string bindCurrentThread(int index) const;
+
+        /**
+         * 解析 CPU 列表
+         * @param cpuList CPU 列表，如 "0-3,8,10-11"，或者 "auto"
+         * @return CPU 编号，格式错误时返回空列表
+         */
+        static std::vector<int> parseCpuList(const std::string &cpuList);
+
+        /**
+         * 获取 CPU 所在的 NUMA 节点
+         * @param cpu CPU 编号
+         * @return NUMA 节点编号，未知时返回 -1
+         */
+        static int numaNodeOfCpu(int cpu);
+
+        /**
+         * 获取 NUMA 节点的个数
+         * @return NUMA 节点的个数，未知时返回 1
+         */
+        static int numaNodeCount();
+
+    private:
+        std::vector<int> cpus_;     // CPU 列表
+    };
+}
+
+
+#endif //TINYWS_CPUAFFINITY_H
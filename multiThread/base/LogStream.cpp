@@ -3,6 +3,7 @@
 #include <cstdio>
 
 #include <algorithm>
+#include <limits>
 
 using namespace tinyWS_thread;
 
@@ -0,0 +1,98 @@
+#ifndef TINYWS_MPSCQUEUE_H
+#define TINYWS_MPSCQUEUE_H
+
+#include <atomic>
+
+#include "noncopyable.h"
+
+namespace tinyWS_thread {
+
+    // 侵入式的无锁多生产者单消费者（MPSC）队列。
+    // 节点类型 T 必须有 T *next 成员，队列本身不分配内存，也不拥有节点。
+    //
+    // 实现：
+    // 1 生产者使用 CAS 把节点压入链表头部（Treiber stack），可以在任意线程调用 push()；
+    // 2 消费者使用一次原子交换取走整条链表，再反转成 FIFO 顺序，只能在一个线程中调用 popAll()。
+    // 消费者一次取走当前所有节点，与 EventLoop::doPendingFunctors() 原来
+    // "swap 到临时数组再处理"的语义相同：处理期间新加入的节点留到下一批处理。
+    // 因为消费者总是取走整条链表，不会单独弹出节点，所以不存在 ABA 问题。
+    // 同样的原因，pushChain() / takeAll() 可以在任意线程调用，用作节点的无锁空闲链表。
+    template <class T>
+    class MpscQueue : noncopyable {
+    public:
+        MpscQueue() : head_(nullptr) {}
+
+        /**
+         * --- 线程安全 ---
+         * 加入节点
+         * @param node 节点
+         * @return 加入之前队列是否为空
+         */
+        bool push(T *node) {
+            T *oldHead = head_.load(std::memory_order_relaxed);
+            do {
+                node->next = oldHead;
+            } while (!head_.compare_exchange_weak(oldHead, node,
+                                                  std::memory_order_release,
+                                                  std::memory_order_relaxed));
+            return oldHead == nullptr;
+        }
+
+        /**
+         * --- 线程安全 ---
+         * 一次加入一串节点（first 到 last 已经用 next 连接好），只需要一次 CAS
+         * @param first 第一个节点
+         * @param last 最后一个节点
+         */
+        void pushChain(T *first, T *last) {
+            T *oldHead = head_.load(std::memory_order_relaxed);
+            do {
+                last->next = oldHead;
+            } while (!head_.compare_exchange_weak(oldHead, first,
+                                                  std::memory_order_release,
+                                                  std::memory_order_relaxed));
+        }
+
+        /**
+         * --- 线程安全 ---
+         * 取走所有节点，不恢复加入的顺序（用作空闲链表时不需要顺序）
+         * @return 按加入顺序相反排列的链表的头节点，队列为空时返回 nullptr
+         */
+        T* takeAll() {
+            return head_.exchange(nullptr, std::memory_order_acquire);
+        }
+
+        /**
+         * --- 只能在消费者线程中调用 ---
+         * 取走所有节点
+         * @return 按加入顺序排列的链表的头节点，队列为空时返回 nullptr
+         */
+        T* popAll() {
+            T *node = head_.exchange(nullptr, std::memory_order_seq_cst);
+
+            // 反转链表，恢复加入的顺序
+            T *first = nullptr;
+            while (node != nullptr) {
+                T *next = node->next;
+                node->next = first;
+                first = node;
+                node = next;
+            }
+
+            return first;
+        }
+
+        /**
+         * 队列是否为空
+         * @return true / false
+         */
+        bool empty() const {
+            return head_.load(std::memory_order_acquire) == nullptr;
+        }
+
+    private:
+        std::atomic<T*> head_;  // 最后加入的节点
+    };
+}
+
+#endif //TINYWS_MPSCQUEUE_H
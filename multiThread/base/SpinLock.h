@@ -21,12 +21,16 @@ namespace tinyWS_thread {
         SpinLock() : spinlock_{}, holder_(0) {
             // PTHREAD_PROCESS_SHARED：该自旋锁可以在多个进程中的线程之间共享。
             // PTHREAD_PROCESS_PRIVATE: 仅初始化本自旋锁的线程所在的进程内的线程才能够使用该自旋锁。
-            assert(pthread_spin_init(&spinlock_, PTHREAD_PROCESS_PRIVATE) == 0);
+            int ret = pthread_spin_init(&spinlock_, PTHREAD_PROCESS_PRIVATE);
+            assert(ret == 0);
+            (void)ret;
         }
 
         ~SpinLock() {
             assert(holder_ == 0);
-            assert(pthread_spin_destroy(&spinlock_));
+            int ret = pthread_spin_destroy(&spinlock_);
+            assert(ret == 0);
+            (void)ret;
         }
 
         /**
@@ -78,7 +82,7 @@ namespace tinyWS_thread {
     // 防止类似误用：SpinLockGuard(spinlock_)
     // 临时对象不能长时间持有锁，一产生对象又马上被销毁！
     // 正确写法：SpinLockGuard lock(spinlock_)
-    #define MutexLockGuard(x) error "Missing guard object name"
+    #define SpinLockGuard(x) error "Missing guard object name"
 }
 
 
@@ -0,0 +1,122 @@
+#ifndef TINYWS_STRINGPIECE_H
+#define TINYWS_STRINGPIECE_H
+
+#include <cstddef>
+#include <cstring>
+#include <algorithm>
+#include <ostream>
+#include <string>
+
+namespace tinyWS_thread {
+
+    // 字符串的只读视图（指针 + 长度），不拥有数据，也不以 '\0' 结尾，std::string_view（C++ 17）的简单实现。
+    // 参考 muduo 的 StringPiece。
+    // 视图只在数据有效期间有效，需要保存时用 asString() 复制。
+    class StringPiece {
+    public:
+        static const size_t npos = static_cast<size_t>(-1);
+
+        StringPiece() : data_(nullptr), size_(0) {}
+
+        StringPiece(const char *str) : data_(str), size_(::strlen(str)) {}
+
+        StringPiece(const std::string &str) : data_(str.data()), size_(str.size()) {}
+
+        StringPiece(const char *data, size_t size) : data_(data), size_(size) {}
+
+        const char* data() const { return data_; }
+
+        size_t size() const { return size_; }
+
+        bool empty() const { return size_ == 0; }
+
+        const char* begin() const { return data_; }
+
+        const char* end() const { return data_ + size_; }
+
+        char operator[](size_t i) const { return data_[i]; }
+
+        char back() const { return data_[size_ - 1]; }
+
+        /**
+         * 子串
+         * @param pos 起始位置
+         * @param n 长度，超过末尾时截断
+         * @return 子串的视图
+         */
+        StringPiece substr(size_t pos, size_t n = npos) const {
+            pos = std::min(pos, size_);
+            return StringPiece(data_ + pos, std::min(n, size_ - pos));
+        }
+
+        /**
+         * 查找字符
+         * @param c 字符
+         * @param pos 起始位置
+         * @return 位置，没有时为 npos
+         */
+        size_t find(char c, size_t pos = 0) const {
+            if (pos >= size_) {
+                return npos;
+            }
+            const void *p = ::memchr(data_ + pos, c, size_ - pos);
+            return p == nullptr ? npos : static_cast<size_t>(static_cast<const char*>(p) - data_);
+        }
+
+        /**
+         * 查找子串
+         * @param s 子串
+         * @param pos 起始位置
+         * @return 位置，没有时为 npos
+         */
+        size_t find(const StringPiece &s, size_t pos = 0) const {
+            if (pos > size_) {
+                return npos;
+            }
+            const char *p = std::search(data_ + pos, end(), s.begin(), s.end());
+            return p == end() && !s.empty() ? npos : static_cast<size_t>(p - data_);
+        }
+
+        bool startsWith(const StringPiece &s) const {
+            return size_ >= s.size_ && std::equal(s.begin(), s.end(), data_);
+        }
+
+        bool endsWith(const StringPiece &s) const {
+            return size_ >= s.size_ && std::equal(s.begin(), s.end(), end() - s.size_);
+        }
+
+        int compare(const StringPiece &s) const {
+            int r = size_ == 0 || s.size_ == 0 ? 0 : ::memcmp(data_, s.data_, std::min(size_, s.size_));
+            if (r == 0) {
+                r = size_ < s.size_ ? -1 : (size_ > s.size_ ? 1 : 0);
+            }
+            return r;
+        }
+
+        bool operator==(const StringPiece &s) const {
+            return size_ == s.size_ && (size_ == 0 || ::memcmp(data_, s.data_, size_) == 0);
+        }
+
+        bool operator!=(const StringPiece &s) const {
+            return !(*this == s);
+        }
+
+        /**
+         * 复制为 std::string
+         * @return 字符串
+         */
+        std::string asString() const {
+            return std::string(data_, size_);
+        }
+
+    private:
+        const char *data_;  // 数据
+        size_t size_;       // 长度
+    };
+
+    inline std::ostream& operator<<(std::ostream &os, const StringPiece &piece) {
+        return os.write(piece.data(), static_cast<std::streamsize>(piece.size()));
+    }
+}
+
+#endif //TINYWS_STRINGPIECE_H
@@ -0,0 +1,149 @@
+// TcpConnectionPool 的基准测试：统计每个接受的连接在服务端（主线程和 IO 线程）调用 operator new 的次数和每秒接受的连接数。
+//
+// 客户端线程依次建立连接、发送 1 个字节、读回服务端回显的字节、关闭连接，等服务端移除连接之后再建立下一个，
+// 所以统计到的是一个连接从接受到销毁的全部分配。
+// 对照组关闭连接对象池（setConnectionPoolSize(0)），每个连接都新建 TcpConnection，即原来的实现。
+// 每种配置先预热（对象池中已经有空闲对象），再统计。
+//
+// 用法：bench_connection_pool [每种配置的连接数，默认 5000] [端口，默认 19500]
+// 客户端主动关闭连接，TIME_WAIT 留在客户端，连接数过大时可能用完本地端口。
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <thread>
+
+#include "../net/Buffer.h"
+#include "../net/EventLoop.h"
+#include "../net/InternetAddress.h"
+#include "../net/TcpConnection.h"
+#include "../net/TcpConnectionPool.h"
+#include "../net/TcpServer.h"
+
+using namespace tinyWS_thread;
+
+namespace {
+    std::atomic<bool> gMeasuring(false);    // 是否正在统计
+    std::atomic<long> gAllocations(0);      // 统计期间服务端线程调用 operator new 的次数
+    thread_local bool tServerThread = false; // 当前线程是否为服务端线程（主线程和 IO 线程）
+}
+
+void* operator new(size_t size) {
+    if (tServerThread && gMeasuring.load(std::memory_order_relaxed)) {
+        gAllocations.fetch_add(1, std::memory_order_relaxed);
+    }
+    void *p = std::malloc(size == 0 ? 1 : size);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+namespace {
+    /**
+     * 建立一个连接，发送 1 个字节，读回回显的字节之后关闭
+     * @param port 服务端端口
+     * @return 是否成功
+     */
+    bool roundTrip(uint16_t port) {
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(port);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        char byte = 'x';
+        bool ok = ::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0 &&
+                  ::write(fd, &byte, 1) == 1 &&
+                  ::read(fd, &byte, 1) == 1;
+        ::close(fd);
+        return ok;
+    }
+
+    /**
+     * 建立 n 个连接，每个连接在服务端移除之后再建立下一个
+     * @param port 服务端端口
+     * @param n 连接数
+     * @param closed 服务端已经移除的连接数
+     * @return 是否全部成功
+     */
+    bool connectMany(uint16_t port, int n, const std::atomic<long> &closed) {
+        long target = closed.load() + n;
+        for (int i = 0; i < n; ++i) {
+            if (!roundTrip(port)) {
+                return false;
+            }
+            long expected = target - n + i + 1;
+            while (closed.load() < expected) {
+                std::this_thread::yield();
+            }
+        }
+        return true;
+    }
+
+    void run(const char *name, size_t poolSize, int n, uint16_t port) {
+        EventLoop loop;
+        tServerThread = true;
+        TcpServer server(&loop, InternetAddress(port), name);
+        server.setThreadNumber(1);
+        server.setConnectionPoolSize(poolSize);
+        server.setThreadInitCallback([](EventLoop*) { tServerThread = true; });
+
+        std::atomic<long> closed(0);
+        server.setConnectionCallback([&closed](const TcpConnectionPtr &connection) {
+            if (!connection->connected()) {
+                closed.fetch_add(1);
+            }
+        });
+        server.setMessageCallback([](const TcpConnectionPtr &connection, Buffer *buffer, Timer::TimeType) {
+            connection->send(buffer->peek(), buffer->readableBytes());
+            buffer->retrieveAll();
+        });
+        server.start();
+
+        std::thread client([&] {
+            // 等待 listen()，预热
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            bool ok = connectMany(port, n / 5 + 1, closed);
+
+            gAllocations.store(0);
+            gMeasuring.store(true);
+            auto start = std::chrono::steady_clock::now();
+            ok = ok && connectMany(port, n, closed);
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            gMeasuring.store(false);
+
+            if (ok) {
+                TcpConnectionPool::Stats stats = server.connectionPoolStats();
+                std::printf("%-8s connections=%d  %6.2f allocations/connection  %8.0f connections/s  (created %lld, reused %lld)\n",
+                            name, n, static_cast<double>(gAllocations.load()) / n, n / seconds,
+                            static_cast<long long>(stats.created), static_cast<long long>(stats.reused));
+            } else {
+                std::printf("%-8s failed to connect to port %u\n", name, static_cast<unsigned>(port));
+            }
+            loop.quit();
+        });
+        loop.loop();
+        client.join();
+    }
+}
+
+int main(int argc, char *argv[]) {
+    int n = argc > 1 ? std::atoi(argv[1]) : 5000;
+    uint16_t port = static_cast<uint16_t>(argc > 2 ? std::atoi(argv[2]) : 19500);
+
+    run("no pool", 0, n, port);
+    run("pool", TcpConnectionPool::kDefaultMaxIdle, n, port);
+
+    return 0;
+}
@@ -0,0 +1,264 @@
+// level trigger 与 edge trigger 的基准测试：长连接上的 HTTP 请求，统计 IO 线程每个请求调用 epoll_wait（即事件循环被唤醒）、
+// readv 和 write / writev 的次数，以及每秒处理的请求数。
+//
+// 本文件定义了同名的 epoll_wait、readv、write 和 writev，覆盖 libc 中的实现（通过 syscall() 直接调用内核），
+// 只统计 IO 线程在统计期间的调用。
+// 客户端线程建立若干个长连接，每一轮先在每个连接上各发送 depth 个请求（depth > 1 即 pipelining），再依次读完全部响应，
+// 所以服务端一次唤醒可能有多个连接可读、一个连接上可能有多个请求。
+// 请求分两种：没有 Body 的 GET 和带 256 KB Body 的 POST（一次 readv 读不完）。
+// 每种配置先预热，再统计。
+//
+// 用法：bench_edge_trigger [多连接时的轮数，默认 2000，单连接时为 10 倍] [连接数，默认 32] [端口，默认 19600]
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../http/HttpRequest.h"
+#include "../http/HttpResponse.h"
+#include "../http/HttpServer.h"
+#include "../net/EventLoop.h"
+#include "../net/InternetAddress.h"
+
+using namespace tinyWS_thread;
+
+namespace {
+    std::atomic<bool> gMeasuring(false);    // 是否正在统计
+    std::atomic<long> gEpollWaits(0);       // 统计期间 IO 线程调用 epoll_wait 的次数
+    std::atomic<long> gReads(0);            // 统计期间 IO 线程调用 readv 的次数
+    std::atomic<long> gWrites(0);           // 统计期间 IO 线程调用 write / writev 的次数
+    thread_local bool tIoThread = false;    // 当前线程是否为 IO 线程
+
+    inline void record(std::atomic<long> &counter) {
+        if (tIoThread && gMeasuring.load(std::memory_order_relaxed)) {
+            counter.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+}
+
+extern "C" int epoll_wait(int epfd, struct epoll_event *events, int maxevents, int timeout) {
+    record(gEpollWaits);
+    return static_cast<int>(::syscall(SYS_epoll_pwait, epfd, events, maxevents, timeout, nullptr, 0));
+}
+
+extern "C" ssize_t readv(int fd, const struct iovec *iov, int iovcnt) {
+    record(gReads);
+    return ::syscall(SYS_readv, fd, iov, iovcnt);
+}
+
+extern "C" ssize_t write(int fd, const void *buf, size_t count) {
+    record(gWrites);
+    return ::syscall(SYS_write, fd, buf, count);
+}
+
+extern "C" ssize_t writev(int fd, const struct iovec *iov, int iovcnt) {
+    record(gWrites);
+    return ::syscall(SYS_writev, fd, iov, iovcnt);
+}
+
+namespace {
+    const char kGetRequest[] =
+            "GET / HTTP/1.1\r\n"
+            "Host: localhost\r\n"
+            "User-Agent: bench_edge_trigger\r\n"
+            "Accept: */*\r\n"
+            "\r\n";
+
+    const size_t kPostBodySize = 256 * 1024;
+
+    /**
+     * 带 kPostBodySize 字节 Body 的 POST 请求
+     * @return 请求
+     */
+    std::string postRequest() {
+        std::string request = "POST /upload HTTP/1.1\r\n"
+                              "Host: localhost\r\n"
+                              "User-Agent: bench_edge_trigger\r\n"
+                              "Content-Length: " + std::to_string(kPostBodySize) + "\r\n"
+                              "\r\n";
+        request.append(kPostBodySize, 'x');
+        return request;
+    }
+
+    void httpCallback(const HttpRequest&, HttpResponse &response) {
+        response.setStatusCode(HttpResponse::k200OK);
+        response.setStatusMessage("OK");
+        response.setBody("Hello World!");
+    }
+
+    /**
+     * 客户端的一个长连接
+     */
+    struct Client {
+        int fd = -1;
+        std::string input;  // 已经读到、尚未消费的响应数据
+    };
+
+    /**
+     * 建立一个连接
+     * @param port 服务端端口
+     * @return 文件描述符，失败时为 -1
+     */
+    int connectTo(uint16_t port) {
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(port);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+            ::close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    /**
+     * 读完一个响应（响应头之后是 Content-Length 个字节的 Body）
+     * @param client 连接
+     * @return 是否成功
+     */
+    bool readResponse(Client *client) {
+        char buf[4096];
+        while (true) {
+            size_t headerEnd = client->input.find("\r\n\r\n");
+            if (headerEnd != std::string::npos) {
+                size_t length = 0;
+                size_t field = client->input.find("Content-Length: ");
+                if (field != std::string::npos && field < headerEnd) {
+                    length = std::strtoul(client->input.c_str() + field + 16, nullptr, 10);
+                }
+                size_t total = headerEnd + 4 + length;
+                if (client->input.size() >= total) {
+                    client->input.erase(0, total);
+                    return true;
+                }
+            }
+            ssize_t n = ::read(client->fd, buf, sizeof(buf));
+            if (n <= 0) {
+                return false;
+            }
+            client->input.append(buf, static_cast<size_t>(n));
+        }
+    }
+
+    /**
+     * 运行 rounds 轮：每一轮先在每个连接上各发送 depth 个请求，再依次读完全部响应
+     * @param clients 连接
+     * @param request 请求
+     * @param depth 每个连接每一轮的请求数
+     * @param rounds 轮数
+     * @return 是否全部成功
+     */
+    bool exchange(std::vector<Client> &clients, const std::string &request, int depth, int rounds) {
+        std::string batch;
+        for (int i = 0; i < depth; ++i) {
+            batch += request;
+        }
+        for (int r = 0; r < rounds; ++r) {
+            for (Client &client : clients) {
+                if (::write(client.fd, batch.data(), batch.size()) != static_cast<ssize_t>(batch.size())) {
+                    return false;
+                }
+            }
+            for (Client &client : clients) {
+                for (int i = 0; i < depth; ++i) {
+                    if (!readResponse(&client)) {
+                        return false;
+                    }
+                }
+            }
+        }
+        return true;
+    }
+
+    void run(const char *name, bool edgeTriggered, const char *requestName, const std::string &request,
+             int connections, int depth, int rounds, uint16_t port) {
+        EventLoop loop;
+        HttpServer server(&loop, InternetAddress(port), name);
+        server.setThreadNum(1);
+        server.setEdgeTriggered(edgeTriggered);
+        server.setThreadInitCallback([](EventLoop*) { tIoThread = true; });
+        server.setHttpCallback(httpCallback);
+        server.start();
+
+        std::thread client([&] {
+            // 等待 listen()
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            std::vector<Client> clients(static_cast<size_t>(connections));
+            bool ok = true;
+            for (Client &c : clients) {
+                c.fd = connectTo(port);
+                ok = ok && c.fd >= 0;
+            }
+            // 预热
+            ok = ok && exchange(clients, request, depth, rounds / 10 + 1);
+
+            gEpollWaits.store(0);
+            gReads.store(0);
+            gWrites.store(0);
+            gMeasuring.store(true);
+            auto start = std::chrono::steady_clock::now();
+            ok = ok && exchange(clients, request, depth, rounds);
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            gMeasuring.store(false);
+
+            if (ok) {
+                double requests = static_cast<double>(connections) * depth * rounds;
+                std::printf("%-3s %-4s connections=%-3d depth=%-2d  %5.3f epoll_wait/request  %5.3f readv/request  "
+                            "%5.3f write/request  %8.0f requests/s\n",
+                            name, requestName, connections, depth,
+                            static_cast<double>(gEpollWaits.load()) / requests,
+                            static_cast<double>(gReads.load()) / requests,
+                            static_cast<double>(gWrites.load()) / requests,
+                            requests / seconds);
+            } else {
+                std::printf("%-3s failed to talk to port %u\n", name, static_cast<unsigned>(port));
+            }
+            for (Client &c : clients) {
+                if (c.fd >= 0) {
+                    ::close(c.fd);
+                }
+            }
+            loop.quit();
+        });
+        loop.loop();
+        client.join();
+    }
+}
+
+int main(int argc, char *argv[]) {
+    int rounds = argc > 1 ? std::atoi(argv[1]) : 2000;
+    int connections = argc > 2 ? std::atoi(argv[2]) : 32;
+    uint16_t port = static_cast<uint16_t>(argc > 3 ? std::atoi(argv[3]) : 19600);
+
+    // 每种配置使用不同的端口，避免上一个服务端的连接还在 TIME_WAIT
+    struct Workload {
+        const char *name;
+        std::string request;
+        int depth;
+    };
+    const Workload workloads[] = {{"GET", kGetRequest, 1}, {"GET", kGetRequest, 8}, {"POST", postRequest(), 1}};
+    for (const Workload &w : workloads) {
+        // POST 请求大，轮数相应减少
+        int scaled = w.request.size() > kPostBodySize ? rounds / 20 + 1 : rounds;
+        run("LT", false, w.name, w.request, 1, w.depth, scaled * 10, port++);
+        run("ET", true, w.name, w.request, 1, w.depth, scaled * 10, port++);
+        run("LT", false, w.name, w.request, connections, w.depth, scaled, port++);
+        run("ET", true, w.name, w.request, connections, w.depth, scaled, port++);
+    }
+
+    return 0;
+}
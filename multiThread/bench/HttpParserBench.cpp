@@ -0,0 +1,171 @@
+// HttpContext::parseRequest() 的基准测试：解析浏览器、爬虫和 curl 三种典型的请求，
+// 比较 HttpScanner 各实现（标量、SSE4.2、AVX2，只测 CPU 支持的）每个请求的耗时。
+//
+// 每种请求重复 64 次放在一起（pipelining），每一轮追加到输入缓冲区中再逐个解析。
+// 每种配置交替运行多次，取最快的一次，减少其他进程和 CPU 频率变化的影响。
+// 开始之前用随机数据检查各实现的结果相同。
+//
+// 用法：bench_http_parser [每次运行的轮数，默认 20000]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../http/HttpContext.h"
+#include "../http/HttpScanner.h"
+#include "../net/Buffer.h"
+
+using namespace tinyWS_thread;
+
+namespace {
+    // Chrome 请求一个脚本，请求头多而且长（Cookie、User-Agent、sec-ch-ua）
+    const char kBrowserRequest[] =
+            "GET /assets/js/app.bundle.min.js?v=20240101&lang=en-US HTTP/1.1\r\n"
+            "Host: www.example.com\r\n"
+            "Connection: keep-alive\r\n"
+            "sec-ch-ua: \"Chromium\";v=\"122\", \"Not(A:Brand\";v=\"24\", \"Google Chrome\";v=\"122\"\r\n"
+            "sec-ch-ua-mobile: ?0\r\n"
+            "User-Agent: Mozilla/5.0 (Windows NT 10.0; Win64; x64) AppleWebKit/537.36 (KHTML, like Gecko) "
+            "Chrome/122.0.0.0 Safari/537.36\r\n"
+            "sec-ch-ua-platform: \"Windows\"\r\n"
+            "Accept: */*\r\n"
+            "Sec-Fetch-Site: same-origin\r\n"
+            "Sec-Fetch-Mode: no-cors\r\n"
+            "Sec-Fetch-Dest: script\r\n"
+            "Referer: https://www.example.com/products/category/widgets?page=2&sort=price\r\n"
+            "Accept-Encoding: gzip, deflate, br, zstd\r\n"
+            "Accept-Language: en-US,en;q=0.9,de;q=0.8\r\n"
+            "Cookie: _ga=GA1.2.1234567890.1700000000; _gid=GA1.2.987654321.1700000000; "
+            "session=eyJhbGciOiJIUzI1NiIsInR5cCI6IkpXVCJ9.eyJzdWIiOiIxMjM0NTY3ODkwIiwibmFtZSI6IkpvaG4gRG9lIiwiaWF0IjoxNTE2MjM5MDIyfQ; "
+            "theme=dark\r\n"
+            "If-None-Match: \"5f8a3c2e-1a2b\"\r\n"
+            "If-Modified-Since: Tue, 15 Nov 2023 08:12:31 GMT\r\n"
+            "\r\n";
+
+    // Googlebot 请求 robots.txt
+    const char kBotRequest[] =
+            "GET /robots.txt HTTP/1.1\r\n"
+            "Host: www.example.com\r\n"
+            "User-Agent: Mozilla/5.0 (compatible; Googlebot/2.1; +http://www.google.com/bot.html)\r\n"
+            "Accept: */*\r\n"
+            "Accept-Encoding: gzip\r\n"
+            "\r\n";
+
+    // curl 的默认请求
+    const char kCurlRequest[] =
+            "GET / HTTP/1.1\r\n"
+            "Host: localhost:8080\r\n"
+            "User-Agent: curl/8.5.0\r\n"
+            "Accept: */*\r\n"
+            "\r\n";
+
+    const char *kLevelNames[] = {"scalar", "sse4.2", "avx2"};
+
+    /**
+     * 用随机数据检查各实现的结果与标量实现相同
+     * @return 是否相同
+     */
+    bool sameResults() {
+        using Find = const char* (*)(const char*, const char*);
+        const Find finds[] = {HttpScanner::findControl, HttpScanner::findTargetDelimiter, HttpScanner::findNonToken};
+        std::mt19937 random(42);
+        std::vector<char> data;
+        for (int i = 0; i < 100000; ++i) {
+            // 全部随机、全部是小写字母、小写字母中偶尔有随机字节、请求行和请求头中常见的字符
+            static const char kCommon[] = "aAzZ09-_.:?/ \t\r\n\x7f@[`{";
+            data.resize(random() % 100);
+            unsigned mode = random() % 4;
+            for (char &c : data) {
+                if (mode == 3) {
+                    c = kCommon[random() % (sizeof(kCommon) - 1)];
+                } else {
+                    c = mode == 0 || (mode == 2 && random() % 40 == 0) ? static_cast<char>(random()) :
+                        static_cast<char>('a' + random() % 26);
+                }
+            }
+            for (Find find : finds) {
+                HttpScanner::setLevel(HttpScanner::kScalar);
+                const char *expected = find(data.data(), data.data() + data.size());
+                for (int level = HttpScanner::kSse42; level <= HttpScanner::detect(); ++level) {
+                    HttpScanner::setLevel(static_cast<HttpScanner::Level>(level));
+                    if (find(data.data(), data.data() + data.size()) != expected) {
+                        return false;
+                    }
+                }
+            }
+        }
+        return true;
+    }
+
+    /**
+     * 解析 rounds 轮
+     * @param batch 一轮追加的数据
+     * @param requests batch 中的请求数
+     * @param rounds 轮数
+     * @return 每个请求的耗时（纳秒），解析失败时为负数
+     */
+    double parse(const std::string &batch, int requests, int rounds) {
+        HttpContext context;
+        Buffer buffer;
+        auto start = std::chrono::steady_clock::now();
+        for (int r = 0; r < rounds; ++r) {
+            buffer.append(batch.data(), batch.size());
+            while (buffer.readableBytes() > 0) {
+                if (!context.parseRequest(&buffer, 0) || !context.gotAll()) {
+                    return -1;
+                }
+                context.reset(&buffer);
+            }
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return seconds * 1e9 / (static_cast<double>(requests) * rounds);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    int rounds = argc > 1 ? std::atoi(argv[1]) : 20000;
+    const int kRequestsPerBatch = 64;
+    const int kRuns = 5;
+
+    HttpScanner::Level supported = HttpScanner::detect();
+    std::printf("default level: %s\n", kLevelNames[HttpScanner::level()]);
+    if (!sameResults()) {
+        std::printf("HttpScanner implementations disagree\n");
+        return 1;
+    }
+
+    const char *names[] = {"browser", "bot", "curl"};
+    const std::string requests[] = {kBrowserRequest, kBotRequest, kCurlRequest};
+    for (int i = 0; i < 3; ++i) {
+        std::string batch;
+        for (int j = 0; j < kRequestsPerBatch; ++j) {
+            batch += requests[i];
+        }
+
+        std::vector<double> best(static_cast<size_t>(supported) + 1, 0);
+        for (int run = 0; run < kRuns; ++run) {
+            for (int level = HttpScanner::kScalar; level <= supported; ++level) {
+                HttpScanner::setLevel(static_cast<HttpScanner::Level>(level));
+                double ns = parse(batch, kRequestsPerBatch, rounds);
+                if (ns < 0) {
+                    std::printf("failed to parse the %s request\n", names[i]);
+                    return 1;
+                }
+                if (run == 0 || ns < best[level]) {
+                    best[level] = ns;
+                }
+            }
+        }
+
+        for (int level = HttpScanner::kScalar; level <= supported; ++level) {
+            std::printf("%-8s %4zu bytes/request  %-7s %7.1f ns/request  %5.2f GB/s\n",
+                        names[i], requests[i].size(), kLevelNames[level], best[level],
+                        static_cast<double>(requests[i].size()) / best[level]);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,177 @@
+// EventLoop::queueInLoop() 的竞争基准测试：多个生产者线程同时向一个 IO 线程投递 pending functor，
+// 统计吞吐量和每次 queueInLoop() 的内存分配次数。
+//
+// 对照组 LockedQueue 是原来的实现：mutex + std::vector<Functor>，每次投递都写 eventfd，
+// IO 线程被唤醒后 swap 出所有 functor 再调用。
+//
+// 用法：bench_pending_functor [每个生产者投递的个数，默认 200000]
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
+
+#include "../base/CountDownLatch.h"
+#include "../net/EventLoop.h"
+#include "../net/EventLoopThread.h"
+
+using namespace tinyWS_thread;
+
+namespace {
+    std::atomic<long> gAllocations(0);  // 生产者线程在投递期间调用 operator new 的次数
+    thread_local bool tCounting = false; // 当前线程是否正在投递
+}
+
+void* operator new(size_t size) {
+    if (tCounting) {
+        gAllocations.fetch_add(1, std::memory_order_relaxed);
+    }
+    void *p = std::malloc(size == 0 ? 1 : size);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+namespace {
+    using Functor = std::function<void()>;
+
+    // 原来的 pending functor 队列
+    class LockedQueue {
+    public:
+        LockedQueue() : wakeupFd_(::eventfd(0, EFD_CLOEXEC)), quit_(false), thread_([this] { loop(); }) {}
+
+        ~LockedQueue() {
+            queueInLoop([this] { quit_ = true; });
+            thread_.join();
+            ::close(wakeupFd_);
+        }
+
+        void queueInLoop(Functor &&cb) {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                pendingFunctors_.push_back(std::move(cb));
+            }
+            uint64_t one = 1;
+            ssize_t n = ::write(wakeupFd_, &one, sizeof(one));
+            (void) n;
+        }
+
+    private:
+        int wakeupFd_;
+        bool quit_;
+        std::mutex mutex_;
+        std::vector<Functor> pendingFunctors_;
+        std::thread thread_;
+
+        void loop() {
+            std::vector<Functor> functors;
+            while (!quit_) {
+                uint64_t value;
+                ssize_t n = ::read(wakeupFd_, &value, sizeof(value));
+                (void) n;
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    functors.swap(pendingFunctors_);
+                }
+                for (const Functor &functor : functors) {
+                    functor();
+                }
+                functors.clear();
+            }
+        }
+    };
+
+    // 一轮测试的状态，functor 只捕获它的指针，可以放进 std::function 内部的存储中，
+    // 所以统计到的分配只来自队列本身
+    struct Round {
+        long total;         // 投递的总数
+        long executed;      // 已经执行的个数，只在 IO 线程中访问
+        CountDownLatch done;
+
+        explicit Round(long n) : total(n), executed(0), done(1) {}
+    };
+
+    /**
+     * 用 producers 个线程各投递 perProducer 个 functor，等待全部执行完。
+     * 生产者线程在两轮之间不退出（节点池的线程局部缓存属于线程），第一轮用于预热，只输出第二轮的结果。
+     * @param name 名字
+     * @param queueInLoop 投递函数
+     * @param producers 生产者线程数
+     * @param perProducer 每个生产者投递的个数
+     */
+    template <class QueueInLoop>
+    void run(const char *name, QueueInLoop queueInLoop, int producers, int perProducer) {
+        const int kRounds = 2;
+        std::vector<std::unique_ptr<Round>> rounds;
+        std::vector<std::unique_ptr<CountDownLatch>> starts;
+        for (int i = 0; i < kRounds; ++i) {
+            rounds.emplace_back(new Round(static_cast<long>(producers) * perProducer));
+            starts.emplace_back(new CountDownLatch(1));
+        }
+
+        std::vector<std::thread> threads;
+        for (int i = 0; i < producers; ++i) {
+            threads.emplace_back([&] {
+                for (int r = 0; r < kRounds; ++r) {
+                    Round *round = rounds[r].get();
+                    starts[r]->wait();
+                    tCounting = true;
+                    for (int j = 0; j < perProducer; ++j) {
+                        queueInLoop([round] {
+                            if (++round->executed == round->total) {
+                                round->done.countDown();
+                            }
+                        });
+                    }
+                    tCounting = false;
+                }
+            });
+        }
+
+        for (int r = 0; r < kRounds; ++r) {
+            long allocationsBefore = gAllocations.load();
+            auto start = std::chrono::steady_clock::now();
+            starts[r]->countDown();
+            rounds[r]->done.wait();
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            double allocations = static_cast<double>(gAllocations.load() - allocationsBefore) / rounds[r]->total;
+            if (r == kRounds - 1) {
+                std::printf("%-12s producers=%-3d %8.2f M functors/s  %5.2f allocations/functor\n",
+                            name, producers, rounds[r]->total / seconds / 1e6, allocations);
+            }
+        }
+
+        for (auto &thread : threads) {
+            thread.join();
+        }
+    }
+}
+
+int main(int argc, char *argv[]) {
+    int perProducer = argc > 1 ? std::atoi(argv[1]) : 200000;
+
+    EventLoopThread loopThread;
+    EventLoop *loop = loopThread.startThread();
+    LockedQueue locked;
+
+    for (int producers : {1, 2, 4, 8, 16}) {
+        run("mutex+vector", [&](Functor &&cb) { locked.queueInLoop(std::move(cb)); }, producers, perProducer);
+        run("EventLoop", [&](Functor &&cb) { loop->queueInLoop(std::move(cb)); }, producers, perProducer);
+    }
+
+    return 0;
+}
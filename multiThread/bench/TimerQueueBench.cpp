@@ -0,0 +1,224 @@
+// TimerQueue 的基准测试：N 个（默认 100 万）定时器的添加、注销和到期处理，
+// 比较分层时间轮（TimerQueue）和原来基于 std::set 的实现（SetTimerQueue，按原来的代码复制，
+// 在同一个 EventLoop 中用自己的 timerfd）。
+//
+// 1 添加：到期时间在 [1 秒, 60 秒) 内随机分布（如每个连接的空闲超时）；
+// 2 注销：注销上面添加的所有定时器；
+// 3 到期：添加到期时间在 1 秒内均匀分布的定时器（开始时间留出足够的添加时间），运行事件循环直到全部到期，
+//   统计事件循环消耗的 CPU 时间和回调相对于到期时间的平均延迟。
+// 每种实现在单独的子进程中运行，分别统计内存峰值（ru_maxrss）。
+//
+// 用法：bench_timer_queue [定时器个数，默认 1000000]
+
+#include <sys/resource.h>
+#include <sys/timerfd.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <random>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "../net/Channel.h"
+#include "../net/EventLoop.h"
+#include "../net/Timer.h"
+#include "../net/TimerId.h"
+
+using namespace tinyWS_thread;
+
+namespace {
+    using TimeType = Timer::TimeType;
+
+    // 原来的定时器：每个定时器一个 shared_ptr，TimerId 是 weak_ptr
+    struct SetTimer {
+        Timer::TimerCallback callback;
+        TimeType expiration;
+        int64_t sequence;
+    };
+
+    // 原来的 TimerQueue：timers_ 按到期时间排序，activeTimers_ 按定时器排序（用于注销），
+    // 最早的到期时间改变时调用 timerfd_settime()。只保留了这里用到的一次性定时器的部分。
+    class SetTimerQueue {
+    public:
+        using TimerPtr = std::shared_ptr<SetTimer>;
+
+        explicit SetTimerQueue(EventLoop *loop)
+            : timerfd_(::timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC)),
+              channel_(loop, timerfd_),
+              sequence_(0) {
+            channel_.setReadCallback(std::bind(&SetTimerQueue::handleRead, this));
+            channel_.enableReading();
+        }
+
+        ~SetTimerQueue() {
+            channel_.disableAll();
+            channel_.remove();
+            ::close(timerfd_);
+        }
+
+        std::weak_ptr<SetTimer> addTimer(const Timer::TimerCallback &cb, TimeType timeout) {
+            TimerPtr timer(new SetTimer{cb, timeout, ++sequence_});
+            bool earliest = timers_.empty() || timeout < timers_.begin()->first;
+            timers_.insert(Entry(timeout, timer));
+            activeTimers_.insert(ActiveTimer(timer, timer->sequence));
+            if (earliest) {
+                resetTimerfd(timeout);
+            }
+            return timer;
+        }
+
+        void cancel(const std::weak_ptr<SetTimer> &timerId) {
+            TimerPtr timer = timerId.lock();
+            if (!timer) {
+                return;
+            }
+            auto it = activeTimers_.find(ActiveTimer(timer, timer->sequence));
+            if (it != activeTimers_.end()) {
+                timers_.erase(Entry(timer->expiration, timer));
+                activeTimers_.erase(it);
+            }
+        }
+
+    private:
+        using Entry = std::pair<TimeType, TimerPtr>;
+        using ActiveTimer = std::pair<TimerPtr, int64_t>;
+
+        int timerfd_;
+        Channel channel_;
+        int64_t sequence_;
+        std::set<Entry> timers_;
+        std::set<ActiveTimer> activeTimers_;
+
+        void resetTimerfd(TimeType when) {
+            TimeType microseconds = std::max<TimeType>(when - Timer::now(), 100);
+            itimerspec value{};
+            value.it_value.tv_sec = static_cast<time_t>(microseconds / Timer::kMicroSecondsPerSecond);
+            value.it_value.tv_nsec = static_cast<long>((microseconds % Timer::kMicroSecondsPerSecond) * 1000);
+            ::timerfd_settime(timerfd_, 0, &value, nullptr);
+        }
+
+        void handleRead() {
+            uint64_t howmany;
+            ssize_t n = ::read(timerfd_, &howmany, sizeof(howmany));
+            (void) n;
+
+            TimeType now = Timer::now();
+            auto end = timers_.lower_bound(Entry(now, TimerPtr()));
+            std::vector<Entry> expired(timers_.begin(), end);
+            timers_.erase(timers_.begin(), end);
+            for (const Entry &entry : expired) {
+                activeTimers_.erase(ActiveTimer(entry.second, entry.second->sequence));
+            }
+            for (const Entry &entry : expired) {
+                entry.second->callback();
+            }
+            if (!timers_.empty()) {
+                resetTimerfd(timers_.begin()->first);
+            }
+        }
+    };
+
+    // TimerQueue（通过 EventLoop 的接口）
+    struct WheelAdapter {
+        EventLoop *loop;
+
+        TimerId addTimer(const Timer::TimerCallback &cb, TimeType timeout) {
+            return loop->runAt(timeout, cb);
+        }
+
+        void cancel(const TimerId &timerId) {
+            loop->cancle(timerId);
+        }
+    };
+
+    double elapsedMs(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // 进程消耗的 CPU 时间（用户态 + 内核态，毫秒）
+    double cpuMs() {
+        rusage usage{};
+        ::getrusage(RUSAGE_SELF, &usage);
+        return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1e3 +
+               (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e3;
+    }
+
+    template <class Queue>
+    void run(const char *name, EventLoop *loop, Queue &queue, int n) {
+        std::mt19937_64 random(42);
+        std::uniform_int_distribution<TimeType> idle(Timer::kMicroSecondsPerSecond, 60 * Timer::kMicroSecondsPerSecond);
+
+        // 1 添加
+        using TimerIdType = decltype(queue.addTimer(Timer::TimerCallback(), 0));
+        std::vector<TimerIdType> ids;
+        ids.reserve(static_cast<size_t>(n));
+        TimeType base = Timer::now();
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < n; ++i) {
+            ids.push_back(queue.addTimer([] {}, base + idle(random)));
+        }
+        double addMs = elapsedMs(start);
+
+        // 2 注销
+        start = std::chrono::steady_clock::now();
+        for (const auto &id : ids) {
+            queue.cancel(id);
+        }
+        double cancelMs = elapsedMs(start);
+        ids.clear();
+
+        // 3 到期
+        int fired = 0;
+        TimeType totalDelay = 0;
+        base = Timer::now() + static_cast<TimeType>(addMs * 2000) + 100 * 1000;
+        std::uniform_int_distribution<TimeType> spread(0, Timer::kMicroSecondsPerSecond - 1);
+        for (int i = 0; i < n; ++i) {
+            TimeType when = base + spread(random);
+            queue.addTimer([&fired, &totalDelay, loop, when, n] {
+                totalDelay += Timer::now() - when;
+                if (++fired == n) {
+                    loop->quit();
+                }
+            }, when);
+        }
+        double cpuStart = cpuMs();
+        loop->loop();
+        double expireMs = cpuMs() - cpuStart;
+
+        rusage usage{};
+        ::getrusage(RUSAGE_SELF, &usage);
+        std::printf("%-8s n=%d  add %7.1f ns/timer  cancel %7.1f ns/timer  expire %7.1f ms CPU (lateness %6.1f us)  maxrss %6ld MB\n",
+                    name, n, addMs * 1e6 / n, cancelMs * 1e6 / n, expireMs,
+                    static_cast<double>(totalDelay) / n, usage.ru_maxrss / 1024);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    int n = argc > 1 ? std::atoi(argv[1]) : 1000000;
+
+    for (int implementation = 0; implementation < 2; ++implementation) {
+        std::fflush(stdout);
+        pid_t pid = ::fork();
+        if (pid == 0) {
+            EventLoop loop;
+            if (implementation == 0) {
+                SetTimerQueue queue(&loop);
+                run("std::set", &loop, queue, n);
+            } else {
+                WheelAdapter queue{&loop};
+                run("wheel", &loop, queue, n);
+            }
+            std::fflush(stdout);
+            ::_exit(0);
+        }
+        ::waitpid(pid, nullptr, 0);
+    }
+
+    return 0;
+}
@@ -0,0 +1,138 @@
+#include "ChunkedWriter.h"
+
+#include <cassert>
+#include <cstdio>
+
+#include "../net/Buffer.h"
+#include "../net/EventLoop.h"
+#include "../net/TcpConnection.h"
+
+using namespace tinyWS_thread;
+
+const size_t ChunkedWriter::kDefaultHighWaterMark;
+
+ChunkedWriter::ChunkedWriter(const TcpConnectionPtr &connection, const Producer &producer)
+    : loop_(connection->getLoop()),
+      connection_(connection),
+      current_(nullptr),
+      producer_(producer),
+      paused_(false),
+      waitingForDrain_(false),
+      scheduled_(false),
+      finished_(false) {
+
+}
+
+void ChunkedWriter::setFinishCallback(const FinishCallback &cb) {
+    finishCallback_ = cb;
+}
+
+void ChunkedWriter::setPauseCallback(const PauseCallback &cb) {
+    pauseCallback_ = cb;
+}
+
+void ChunkedWriter::start() {
+    schedule();
+}
+
+void ChunkedWriter::write(const char *data, size_t len) {
+    assert(current_ != nullptr);
+    if (current_ == nullptr || len == 0) {
+        return;
+    }
+    // chunk：十六进制长度 CRLF 数据 CRLF
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%zx\r\n", len);
+    Buffer *output = current_->outputBuffer();
+    output->append(buf);
+    output->append(data, len);
+    output->append("\r\n");
+}
+
+void ChunkedWriter::write(const std::string &data) {
+    write(data.data(), data.size());
+}
+
+void ChunkedWriter::pause() {
+    setPaused(true);
+}
+
+void ChunkedWriter::resume() {
+    setPaused(false);
+    schedule();
+}
+
+void ChunkedWriter::waitForDrain() {
+    waitingForDrain_ = true;
+}
+
+void ChunkedWriter::drained() {
+    waitingForDrain_ = false;
+    schedule();
+}
+
+void ChunkedWriter::cancel() {
+    finished_ = true;
+    producer_ = Producer();
+    finishCallback_ = FinishCallback();
+    pauseCallback_ = PauseCallback();
+}
+
+bool ChunkedWriter::finished() const {
+    return finished_;
+}
+
+void ChunkedWriter::schedule() {
+    if (!scheduled_ && !finished_ && !paused_ && !waitingForDrain_) {
+        scheduled_ = true;
+        loop_->queueInLoop(std::bind(&ChunkedWriter::pump, shared_from_this()));
+    }
+}
+
+void ChunkedWriter::pump() {
+    loop_->assertInLoopThread();
+    scheduled_ = false;
+    if (finished_ || paused_ || waitingForDrain_) {
+        return;
+    }
+    TcpConnectionPtr connection = connection_.lock();
+    if (!connection || !connection->connected()) {
+        cancel();
+        return;
+    }
+
+    current_ = connection.get();
+    bool more = producer_(*this);
+    current_ = nullptr;
+    if (!more) {
+        // 最后一个 chunk（没有 trailer）
+        connection->outputBuffer()->append("0\r\n\r\n");
+        finished_ = true;
+    }
+
+    // 输出队列达到高水位时，sendOutputBuffer() 会在下一次调用 pump() 之前调用 waitForDrain()
+    connection->sendOutputBuffer();
+    if (finished_) {
+        FinishCallback cb;
+        cb.swap(finishCallback_);
+        producer_ = Producer();
+        if (cb) {
+            cb(connection);
+        }
+    } else {
+        schedule();
+    }
+}
+
+void ChunkedWriter::setPaused(bool paused) {
+    if (paused_ == paused) {
+        return;
+    }
+    paused_ = paused;
+    if (!finished_ && pauseCallback_) {
+        TcpConnectionPtr connection = connection_.lock();
+        if (connection) {
+            pauseCallback_(connection, paused);
+        }
+    }
+}
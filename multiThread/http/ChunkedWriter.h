@@ -0,0 +1,135 @@
+#ifndef TINYWS_CHUNKEDWRITER_H
+#define TINYWS_CHUNKEDWRITER_H
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "../base/noncopyable.h"
+#include "../net/TcpConnection.h"
+
+namespace tinyWS_thread {
+    class EventLoop;
+
+    // 以 Transfer-Encoding: chunked 流式发送 Response Body，每个流式响应一个，只在连接所属 IO 线程中使用。
+    //
+    // 每次事件循环调用一次 Producer，Producer 用 write() 写入的数据编码成 chunk 直接追加到连接的输出缓冲区，
+    // 调用之后立即发送，并在下一次事件循环继续调用，直到 Producer 返回 false（发送最后一个 chunk）。
+    // 每次只调用一次 Producer，同一个 IO 线程的其他连接不会被一个大的响应饿死。
+    //
+    // 背压：连接的输出队列达到高水位时（TcpConnection 的高水位回调函数），暂停调用 Producer，
+    // 输出队列发送完之后（写完成回调函数）再继续，所以客户端读得再慢，输出队列也只比高水位多一次 Producer 写入的数据。
+    class ChunkedWriter : noncopyable,
+                          public std::enable_shared_from_this<ChunkedWriter> {
+    public:
+        // 生成 Body 的回调函数的类型：用 writer.write() 写入一部分数据，返回是否还有数据（false 表示 Body 结束）
+        using Producer = std::function<bool(ChunkedWriter &writer)>;
+
+        // 最后一个 chunk 放入输出队列之后的回调函数的类型
+        using FinishCallback = std::function<void(const TcpConnectionPtr&)>;
+
+        // pause() / resume() 改变暂停状态时的回调函数的类型，paused 为是否暂停
+        using PauseCallback = std::function<void(const TcpConnectionPtr&, bool paused)>;
+
+        // 默认的高水位（输出队列中还没有发送的字节数）
+        static const size_t kDefaultHighWaterMark = 64 * 1024;
+
+        /**
+         * 构造函数
+         * @param connection 连接，ChunkedWriter 只保存 weak_ptr
+         * @param producer 生成 Body 的回调函数
+         */
+        ChunkedWriter(const TcpConnectionPtr &connection, const Producer &producer);
+
+        /**
+         * 设置最后一个 chunk 放入输出队列之后的回调函数（如关闭连接、处理下一个请求）
+         * @param cb 回调函数
+         */
+        void setFinishCallback(const FinishCallback &cb);
+
+        /**
+         * 设置 pause() / resume() 改变暂停状态时的回调函数（如暂停期间的连接期限由应用而不是客户端决定）
+         * @param cb 回调函数
+         */
+        void setPauseCallback(const PauseCallback &cb);
+
+        /**
+         * 开始调用 Producer（在下一次处理 pending functor 时）
+         */
+        void start();
+
+        /**
+         * 写入一个 chunk，只能在 Producer 中调用，长度为 0 时不做任何事（长度为 0 的 chunk 表示 Body 结束）
+         * @param data 数据
+         * @param len 长度
+         */
+        void write(const char *data, size_t len);
+
+        // 同上
+        void write(const std::string &data);
+
+        /**
+         * 暂停调用 Producer（如数据还没有准备好），之后用 resume() 继续，避免 Producer 没有数据时空转。
+         * 需要在 IO 线程中调用（其他线程用 EventLoop::runInLoop()）。
+         */
+        void pause();
+
+        /**
+         * 继续调用 Producer，与 pause() 对应。
+         * 需要在 IO 线程中调用（其他线程用 EventLoop::runInLoop()）。
+         */
+        void resume();
+
+        /**
+         * 输出队列达到高水位（TcpConnection 的高水位回调函数中调用），暂停调用 Producer，直到 drained()
+         */
+        void waitForDrain();
+
+        /**
+         * 输出队列已经发送完（TcpConnection 的写完成回调函数中调用），继续调用 Producer
+         */
+        void drained();
+
+        /**
+         * 连接断开时调用，之后不再调用 Producer 和 FinishCallback
+         */
+        void cancel();
+
+        /**
+         * 是否已经结束（最后一个 chunk 已经放入输出队列，或者已经取消）
+         * @return true / false
+         */
+        bool finished() const;
+
+    private:
+        EventLoop *loop_;                           // 连接所属 EventLoop
+        std::weak_ptr<TcpConnection> connection_;   // 连接
+        TcpConnection *current_;                    // 正在调用 Producer 的连接，write() 写入它的输出缓冲区
+        Producer producer_;                         // 生成 Body 的回调函数
+        FinishCallback finishCallback_;             // 结束时的回调函数
+        PauseCallback pauseCallback_;               // 改变暂停状态时的回调函数
+        bool paused_;                               // 是否被 pause() 暂停
+        bool waitingForDrain_;                      // 是否在等待输出队列发送完
+        bool scheduled_;                            // 是否已经在 pending functor 中等待调用 pump()
+        bool finished_;                             // 是否已经结束
+
+        /**
+         * 在下一次处理 pending functor 时调用 pump()（已经在等待时不重复）
+         */
+        void schedule();
+
+        /**
+         * 调用一次 Producer 并发送，没有暂停时继续 schedule()
+         */
+        void pump();
+
+        /**
+         * 暂停状态改变，调用 PauseCallback
+         * @param paused 是否暂停
+         */
+        void setPaused(bool paused);
+    };
+}
+
+#endif //TINYWS_CHUNKEDWRITER_H
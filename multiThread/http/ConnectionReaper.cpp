@@ -0,0 +1,173 @@
+#include "ConnectionReaper.h"
+
+#include <cassert>
+
+#include "../net/EventLoop.h"
+#include "../net/TimerId.h"
+#include "../net/TcpConnection.h"
+#include "HttpContext.h"
+
+using namespace tinyWS_thread;
+
+ConnectionReaper::ConnectionReaper(EventLoop *loop,
+                                   Timer::TimeType idleTimeout,
+                                   Timer::TimeType readingTimeout)
+    : loop_(loop),
+      idleTimeout_(idleTimeout),
+      readingTimeout_(readingTimeout),
+      writingTimeout_(idleTimeout > 0 ? idleTimeout : readingTimeout) {
+
+}
+
+void ConnectionReaper::start() {
+    if (idleTimeout_ <= 0 && readingTimeout_ <= 0) {
+        return;
+    }
+
+    // 定时器使用弱引用，ConnectionReaper 销毁后，定时器回调函数什么都不做
+    std::weak_ptr<ConnectionReaper> weakReaper(shared_from_this());
+    loop_->runEvery(kSweepInterval, [weakReaper]() {
+        auto reaper = weakReaper.lock();
+        if (reaper) {
+            reaper->sweep();
+        }
+    });
+}
+
+void ConnectionReaper::setIdle(const TcpConnectionPtr &connection, HttpContext *context, Timer::TimeType now) {
+    loop_->assertInLoopThread();
+    waitForOutput(connection, context, now);
+}
+
+void ConnectionReaper::setReading(const TcpConnectionPtr &connection, HttpContext *context, Timer::TimeType now) {
+    loop_->assertInLoopThread();
+    Position *position = context->reaperPosition();
+    // 已经在读请求，不延长期限，否则客户端每次只发一个字节就能一直占用连接
+    if (position->list == kReading) {
+        return;
+    }
+
+    if (readingTimeout_ > 0) {
+        moveTo(connection, position, kReading, now + readingTimeout_);
+    } else {
+        remove(context);
+    }
+}
+
+void ConnectionReaper::extendReading(const TcpConnectionPtr &connection, HttpContext *context, Timer::TimeType now) {
+    loop_->assertInLoopThread();
+    Position *position = context->reaperPosition();
+    if (position->list == kReading) {
+        moveTo(connection, position, kReading, now + readingTimeout_);
+    }
+}
+
+void ConnectionReaper::setClosing(const TcpConnectionPtr &connection, HttpContext *context, Timer::TimeType now) {
+    loop_->assertInLoopThread();
+    waitForOutput(connection, context, now);
+}
+
+void ConnectionReaper::remove(HttpContext *context) {
+    loop_->assertInLoopThread();
+    Position *position = context->reaperPosition();
+    if (position->list != kNone) {
+        entries(position->list).erase(position->entry);
+        position->list = kNone;
+    }
+}
+
+void ConnectionReaper::moveTo(const TcpConnectionPtr &connection, Position *position,
+                              ListType type, Timer::TimeType deadline) {
+    EntryList &to = entries(type);
+    if (position->list == kNone) {
+        position->entry = to.insert(to.end(), Entry{connection, deadline, 0});
+    } else {
+        // 同一个链表内移动，或者在两个链表间移动，都只需要修改指针，不会申请内存
+        to.splice(to.end(), entries(position->list), position->entry);
+        position->entry->deadline = deadline;
+    }
+    position->list = type;
+}
+
+void ConnectionReaper::waitForOutput(const TcpConnectionPtr &connection, HttpContext *context, Timer::TimeType now) {
+    Position *position = context->reaperPosition();
+    if (connection->outputPending()) {
+        // 还在发送响应，空闲的期限从发送完才开始计算，否则慢速下载的大文件会被截断
+        moveTo(connection, position, kWriting, now + writingTimeout_);
+        position->entry->bytesSent = connection->bytesSent();
+    } else if (connection->connected()) {
+        if (idleTimeout_ > 0) {
+            moveTo(connection, position, kIdle, now + idleTimeout_);
+        } else {
+            remove(context);
+        }
+    } else {
+        // 正在关闭的连接已经发送完，写端已经关闭，等待对端关闭连接
+        if (readingTimeout_ > 0) {
+            moveTo(connection, position, kReading, now + readingTimeout_);
+        } else {
+            remove(context);
+        }
+    }
+}
+
+ConnectionReaper::EntryList& ConnectionReaper::entries(ListType type) {
+    assert(type != kNone);
+    switch (type) {
+        case kIdle:
+            return idleList_;
+        case kReading:
+            return readingList_;
+        default:
+            return writingList_;
+    }
+}
+
+void ConnectionReaper::sweep() {
+    loop_->assertInLoopThread();
+    Timer::TimeType now = Timer::now();
+    sweepWriting(now);
+    sweepList(idleList_, now);
+    sweepList(readingList_, now);
+}
+
+void ConnectionReaper::sweepWriting(Timer::TimeType now) {
+    // 不能只检查链表头部：发送完的连接要尽快进入空闲状态。
+    // 延长期限的连接被移到链表末尾，会再被检查一次，此时期限未到，不做任何事。
+    auto it = writingList_.begin();
+    while (it != writingList_.end()) {
+        auto current = it++;
+        TcpConnectionPtr connection = current->connection.lock();
+        if (!connection) {
+            writingList_.erase(current);
+            continue;
+        }
+
+        auto context = tinyWS_thread::any_cast<HttpContext>(connection->getMutableContext());
+        if (!connection->outputPending()) {
+            waitForOutput(connection, context, now);
+        } else if (current->deadline <= now) {
+            if (connection->bytesSent() != current->bytesSent) {
+                // 客户端还在读，只是读得慢，重新计算期限
+                waitForOutput(connection, context, now);
+            } else {
+                remove(context);
+                connection->forceClose();
+            }
+        }
+    }
+}
+
+void ConnectionReaper::sweepList(EntryList &list, Timer::TimeType now) {
+    // 链表按期限升序排列，遇到第一个未超时的连接即可停止
+    while (!list.empty() && list.front().deadline <= now) {
+        TcpConnectionPtr connection = list.front().connection.lock();
+        if (connection) {
+            // 先移出链表，连接断开时（HttpServer::onConnection）再调用 remove() 不会重复删除
+            remove(tinyWS_thread::any_cast<HttpContext>(connection->getMutableContext()));
+            connection->forceClose();
+        } else {
+            list.pop_front();
+        }
+    }
+}
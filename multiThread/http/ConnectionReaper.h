@@ -0,0 +1,172 @@
+#ifndef TINYWS_CONNECTIONREAPER_H
+#define TINYWS_CONNECTIONREAPER_H
+
+#include <cstdint>
+#include <list>
+#include <memory>
+
+#include "../base/noncopyable.h"
+#include "../net/Timer.h"
+#include "../net/CallBack.h"
+
+namespace tinyWS_thread {
+    class EventLoop;
+    class HttpContext;
+
+    // 回收超时的 HTTP 连接，每个 IO 线程（EventLoop）一个，只在所属 IO 线程中使用，无须加锁。
+    //
+    // 连接处于三种状态之一：
+    // 1 空闲（idle）：keep-alive 连接等待下一个请求，超过 keep-alive 超时时间则关闭；
+    // 2 读请求（reading）：从连接建立或者收到请求的第一个字节开始，
+    //   必须在请求头超时时间内读完整个请求，否则关闭（防止 slowloris 攻击）。
+    //   收到后续字节时不会延长期限。
+    // 3 发送响应（writing）：响应已经处理完，但是输出队列还没有发送完（如慢速下载大文件），
+    //   期限是两次发送有进展之间的最长时间（keep-alive 超时时间），只要客户端还在读就不会关闭。
+    //   输出队列发送完之后才进入空闲状态，开始计算空闲的期限；
+    //   正在关闭（Connection: close）的连接则进入读请求状态，等待对端关闭，超时后强制关闭。
+    //
+    // 同一状态的超时时间都相同，所以每个状态用一个链表保存，新的期限总是加到链表末尾，
+    // 链表按期限升序排列。状态切换和刷新期限只需要 splice 一个节点，O(1)，不必为每个连接添加定时器。
+    // 每秒用一个定时器（runEvery）从链表头部检查超时的连接，所以超时的精度为 1 秒。
+    // 发送响应的连接（慢速客户端，通常很少）每秒全部检查一次输出队列是否已经发送完。
+    class ConnectionReaper : noncopyable,
+                             public std::enable_shared_from_this<ConnectionReaper> {
+    public:
+        // 连接所在的链表
+        enum ListType {
+            kNone,      // 不在任何链表中
+            kIdle,      // 空闲链表
+            kReading,   // 读请求链表
+            kWriting    // 发送响应链表
+        };
+
+        // 链表节点
+        struct Entry {
+            std::weak_ptr<TcpConnection> connection;    // 连接，连接可能已被销毁，所以使用弱引用
+            Timer::TimeType deadline;                   // 期限
+            uint64_t bytesSent;                         // 发送响应状态：上次计算期限时连接已经发送的字节数
+        };
+
+        using EntryList = std::list<Entry>;
+
+        // 连接在 ConnectionReaper 中的位置，保存在 HttpContext 中
+        struct Position {
+            Position() : list(kNone) {}
+
+            ListType list;                              // 所在链表
+            EntryList::iterator entry;                  // 链表中的节点
+        };
+
+        /**
+         * 构造函数
+         * @param loop 所属 EventLoop
+         * @param idleTimeout keep-alive 空闲超时时间（微秒），0 表示不限制
+         * @param readingTimeout 读请求超时时间（微秒），0 表示不限制
+         */
+        ConnectionReaper(EventLoop *loop, Timer::TimeType idleTimeout, Timer::TimeType readingTimeout);
+
+        /**
+         * 启动定期检查的定时器
+         */
+        void start();
+
+        /**
+         * 连接进入空闲状态，重新计算期限。
+         * 输出队列中还有数据时先进入发送响应状态，发送完之后才进入空闲状态。
+         * @param connection 连接
+         * @param context 连接的 HttpContext
+         * @param now 当前时间
+         */
+        void setIdle(const TcpConnectionPtr &connection, HttpContext *context, Timer::TimeType now);
+
+        /**
+         * 连接开始读请求。如果已经处于读请求状态，则不改变期限。
+         * @param connection 连接
+         * @param context 连接的 HttpContext
+         * @param now 当前时间
+         */
+        void setReading(const TcpConnectionPtr &connection, HttpContext *context, Timer::TimeType now);
+
+        /**
+         * 正在读请求的连接收到了 Body 数据，重新计算期限（读 Body 时期限是两次收到数据之间的最长时间），
+         * 大的 Body 可以超过读请求的超时时间，但是客户端长时间不发送数据时仍然会被关闭。
+         * 不处于读请求状态时不做任何事。
+         * @param connection 连接
+         * @param context 连接的 HttpContext
+         * @param now 当前时间
+         */
+        void extendReading(const TcpConnectionPtr &connection, HttpContext *context, Timer::TimeType now);
+
+        /**
+         * 正在关闭（已经调用 TcpConnection::shutdown()）的连接：输出队列发送完之前处于发送响应状态，
+         * 发送完之后进入读请求状态，等待对端关闭连接，超时后强制关闭
+         * @param connection 连接
+         * @param context 连接的 HttpContext
+         * @param now 当前时间
+         */
+        void setClosing(const TcpConnectionPtr &connection, HttpContext *context, Timer::TimeType now);
+
+        /**
+         * 不再跟踪连接（连接断开时调用）
+         * @param context 连接的 HttpContext
+         */
+        void remove(HttpContext *context);
+
+    private:
+        static const Timer::TimeType kSweepInterval = Timer::kMicroSecondsPerSecond;  // 检查的周期
+
+        EventLoop *loop_;                   // 所属 EventLoop
+        const Timer::TimeType idleTimeout_; // keep-alive 空闲超时时间
+        const Timer::TimeType readingTimeout_; // 读请求超时时间
+        const Timer::TimeType writingTimeout_; // 发送响应时两次发送有进展之间的最长时间
+        EntryList idleList_;                // 空闲链表
+        EntryList readingList_;             // 读请求链表
+        EntryList writingList_;             // 发送响应链表
+
+        /**
+         * 把连接移动到 list 的末尾，并设置期限
+         * @param connection 连接
+         * @param position 连接的位置
+         * @param type 目标链表
+         * @param deadline 期限
+         */
+        void moveTo(const TcpConnectionPtr &connection, Position *position,
+                    ListType type, Timer::TimeType deadline);
+
+        /**
+         * 获取链表
+         * @param type 链表类型
+         * @return 链表
+         */
+        EntryList& entries(ListType type);
+
+        /**
+         * 输出队列还没有发送完的连接进入发送响应状态，否则进入空闲状态（正在关闭的连接进入读请求状态）
+         * @param connection 连接
+         * @param context 连接的 HttpContext
+         * @param now 当前时间
+         */
+        void waitForOutput(const TcpConnectionPtr &connection, HttpContext *context, Timer::TimeType now);
+
+        /**
+         * 关闭所有超时的连接
+         */
+        void sweep();
+
+        /**
+         * 检查发送响应链表中的所有连接：发送完的连接进入空闲状态（正在关闭的连接进入读请求状态），
+         * 超时的连接有发送进展则延长期限，否则关闭
+         * @param now 当前时间
+         */
+        void sweepWriting(Timer::TimeType now);
+
+        /**
+         * 关闭链表中所有超时的连接
+         * @param list 链表
+         * @param now 当前时间
+         */
+        void sweepList(EntryList &list, Timer::TimeType now);
+    };
+}
+
+#endif //TINYWS_CONNECTIONREAPER_H
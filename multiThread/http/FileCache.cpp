@@ -0,0 +1,347 @@
+#include "FileCache.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <cassert>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#include "../base/Logger.h"
+#include "../net/EventLoop.h"
+#include "../net/Channel.h"
+
+using namespace tinyWS_thread;
+
+namespace {
+    // 文件被修改、替换（rename 到该路径）、删除，或者目录本身被删除、移动时，缓存项失效
+    const uint32_t kWatchMask = IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE | IN_MOVED_FROM | IN_MOVED_TO |
+                                IN_DELETE | IN_DELETE_SELF | IN_MOVE_SELF;
+
+    // 扩展名 -> Content-Type
+    struct ContentType {
+        const char *extension;
+        const char *type;
+    };
+
+    const ContentType kContentTypes[] = {
+            {"html", "text/html; charset=utf-8"},
+            {"htm", "text/html; charset=utf-8"},
+            {"css", "text/css; charset=utf-8"},
+            {"js", "application/javascript; charset=utf-8"},
+            {"json", "application/json"},
+            {"txt", "text/plain; charset=utf-8"},
+            {"xml", "application/xml"},
+            {"svg", "image/svg+xml"},
+            {"png", "image/png"},
+            {"jpg", "image/jpeg"},
+            {"jpeg", "image/jpeg"},
+            {"gif", "image/gif"},
+            {"webp", "image/webp"},
+            {"ico", "image/x-icon"},
+            {"wasm", "application/wasm"},
+            {"pdf", "application/pdf"},
+            {"woff", "font/woff"},
+            {"woff2", "font/woff2"},
+            {"mp4", "video/mp4"},
+            {"gz", "application/gzip"},
+    };
+
+    // 预压缩文件的后缀和 Content-Encoding
+    struct Sidecar {
+        const char *suffix;
+        const char *contentEncoding;
+    };
+
+    const Sidecar kSidecars[] = {
+            {".br", "br"},
+            {".gz", "gzip"},
+    };
+
+    /**
+     * 路径所在的目录
+     * @param path 路径（相对于根目录）
+     * @return 目录，根目录为空字符串
+     */
+    std::string directoryOf(const std::string &path) {
+        std::string::size_type slash = path.rfind('/');
+        return slash == std::string::npos ? std::string() : path.substr(0, slash);
+    }
+
+    /**
+     * 目录下的路径
+     * @param directory 目录，根目录为空字符串
+     * @param name 文件名
+     * @return 路径
+     */
+    std::string join(const std::string &directory, const char *name) {
+        return directory.empty() ? std::string(name) : directory + "/" + name;
+    }
+
+    /**
+     * 由文件大小和最后修改时间生成强 ETag，文件内容变化时两者至少有一个会变化
+     * @param size 文件大小
+     * @param modifyTime 最后修改时间
+     * @return ETag（带引号）
+     */
+    std::string makeETag(size_t size, const timespec &modifyTime) {
+        char buf[64];
+        snprintf(buf, sizeof(buf), "\"%zx-%llx.%lx\"", size,
+                 static_cast<unsigned long long>(modifyTime.tv_sec),
+                 static_cast<unsigned long>(modifyTime.tv_nsec));
+        return buf;
+    }
+
+    /**
+     * 格式化 HTTP-date（RFC 7231 的 IMF-fixdate），如 Sun, 06 Nov 1994 08:49:37 GMT
+     * @param time 时间
+     * @return HTTP-date
+     */
+    std::string formatHttpDate(time_t time) {
+        struct tm tm{};
+        ::gmtime_r(&time, &tm);
+        char buf[64];
+        strftime(buf, sizeof(buf), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+        return buf;
+    }
+}
+
+FileCache::FileCache(EventLoop *loop, const std::string &root, size_t capacity)
+    : loop_(loop),
+      root_(root),
+      capacity_(capacity),
+      rootFd_(-1),
+      inotifyFd_(-1) {
+
+}
+
+FileCache::~FileCache() {
+    // 应该已经在 IO 线程中调用 stop()
+    assert(!inotifyChannel_);
+    if (inotifyFd_ >= 0) {
+        ::close(inotifyFd_);
+    }
+    if (rootFd_ >= 0) {
+        ::close(rootFd_);
+    }
+}
+
+bool FileCache::start() {
+    loop_->assertInLoopThread();
+    rootFd_ = ::open(root_.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (rootFd_ < 0) {
+        debug(LogLevel::ERROR) << "FileCache::start - cannot open " << root_ << ": " << ::strerror(errno) << std::endl;
+        return false;
+    }
+
+    inotifyFd_ = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFd_ < 0) {
+        // 没有 inotify 时不能发现文件的变化，不使用缓存
+        debug(LogLevel::WARN) << "FileCache::start - inotify_init1: " << ::strerror(errno)
+                              << ", file cache disabled" << std::endl;
+        return true;
+    }
+    inotifyChannel_.reset(new Channel(loop_, inotifyFd_));
+    inotifyChannel_->setReadCallback(std::bind(&FileCache::handleRead, this));
+    inotifyChannel_->enableReading();
+    return true;
+}
+
+void FileCache::stop() {
+    loop_->assertInLoopThread();
+    if (inotifyChannel_) {
+        inotifyChannel_->disableAll();
+        inotifyChannel_->remove();
+        inotifyChannel_.reset();
+    }
+    lru_.clear();
+    entries_.clear();
+}
+
+FileCache::EntryPtr FileCache::lookup(const std::string &path) {
+    loop_->assertInLoopThread();
+    auto it = entries_.find(path);
+    if (it != entries_.end()) {
+        // 命中，移到最前面
+        lru_.splice(lru_.begin(), lru_, it->second);
+        return *it->second;
+    }
+
+    if (rootFd_ < 0) {
+        return nullptr;
+    }
+
+    // 先监视目录再打开文件，打开之后的变化都能收到通知
+    bool cache = cacheable();
+    if (cache) {
+        watchDirectory(directoryOf(path));
+    }
+
+    std::shared_ptr<Entry> entry = open(path);
+    if (!entry) {
+        return nullptr;
+    }
+    entry->brotli = openSidecar(*entry, ".br", "br");
+    entry->gzip = openSidecar(*entry, ".gz", "gzip");
+    if (!cache) {
+        return entry;
+    }
+
+    lru_.push_front(entry);
+    entries_[path] = lru_.begin();
+    if (entries_.size() > capacity_) {
+        // 淘汰最久没有使用的文件，正在发送的文件描述符由输出队列持有，发送完才关闭
+        entries_.erase(lru_.back()->path);
+        lru_.pop_back();
+    }
+    return entry;
+}
+
+std::shared_ptr<FileCache::Entry> FileCache::open(const std::string &path) {
+    int fd = ::openat(rootFd_, path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return nullptr;
+    }
+    auto file = std::make_shared<FileHandle>(fd);
+    struct stat fileStat{};
+    if (::fstat(fd, &fileStat) < 0 || !S_ISREG(fileStat.st_mode)) {
+        return nullptr;
+    }
+
+    auto entry = std::make_shared<Entry>();
+    entry->path = path;
+    entry->file = file;
+    entry->size = static_cast<size_t>(fileStat.st_size);
+    entry->modifyTime = fileStat.st_mtim;
+    entry->contentType = contentTypeOf(path);
+    entry->etag = makeETag(entry->size, entry->modifyTime);
+    entry->lastModified = formatHttpDate(entry->modifyTime.tv_sec);
+    entry->contentEncoding = nullptr;
+    return entry;
+}
+
+FileCache::EntryPtr FileCache::openSidecar(const Entry &original, const char *suffix, const char *contentEncoding) {
+    std::shared_ptr<Entry> sidecar = open(original.path + suffix);
+    // 比原文件旧的预压缩文件可能是旧内容压缩的，不使用
+    if (!sidecar || sidecar->modifyTime.tv_sec < original.modifyTime.tv_sec ||
+        (sidecar->modifyTime.tv_sec == original.modifyTime.tv_sec &&
+         sidecar->modifyTime.tv_nsec < original.modifyTime.tv_nsec)) {
+        return nullptr;
+    }
+    // 同一资源的不同表示，强 ETag 必须不同
+    sidecar->contentType = original.contentType;
+    sidecar->contentEncoding = contentEncoding;
+    sidecar->etag.insert(sidecar->etag.size() - 1, std::string("-") + contentEncoding);
+    return sidecar;
+}
+
+bool FileCache::cacheable() const {
+    return inotifyFd_ >= 0 && capacity_ > 0;
+}
+
+size_t FileCache::size() const {
+    return entries_.size();
+}
+
+const char* FileCache::contentTypeOf(const std::string &path) {
+    std::string::size_type dot = path.rfind('.');
+    if (dot != std::string::npos && path.find('/', dot) == std::string::npos) {
+        const char *extension = path.c_str() + dot + 1;
+        for (const auto &contentType : kContentTypes) {
+            if (::strcasecmp(extension, contentType.extension) == 0) {
+                return contentType.type;
+            }
+        }
+    }
+    return "application/octet-stream";
+}
+
+void FileCache::watchDirectory(const std::string &directory) {
+    if (watchedDirectories_.find(directory) != watchedDirectories_.end()) {
+        return;
+    }
+
+    std::string fullPath = directory.empty() ? root_ : root_ + "/" + directory;
+    int wd = ::inotify_add_watch(inotifyFd_, fullPath.c_str(), kWatchMask);
+    if (wd < 0) {
+        return;
+    }
+    // 同一目录的不同写法（如 a/../b）可能得到同一个 watch，以最后一次为准
+    auto it = watches_.find(wd);
+    if (it != watches_.end()) {
+        watchedDirectories_.erase(it->second);
+    }
+    watches_[wd] = directory;
+    watchedDirectories_[directory] = wd;
+}
+
+void FileCache::handleRead() {
+    loop_->assertInLoopThread();
+    alignas(inotify_event) char buf[4096];
+    ssize_t n;
+    while ((n = ::read(inotifyFd_, buf, sizeof(buf))) > 0) {
+        for (char *p = buf; p < buf + n; ) {
+            auto *event = reinterpret_cast<inotify_event*>(p);
+            p += sizeof(inotify_event) + event->len;
+
+            if (event->mask & IN_Q_OVERFLOW) {
+                // 事件丢失，清空整个缓存
+                lru_.clear();
+                entries_.clear();
+                continue;
+            }
+
+            auto it = watches_.find(event->wd);
+            if (it == watches_.end()) {
+                continue;
+            }
+            const std::string &directory = it->second;
+            if (event->len > 0) {
+                std::string path = join(directory, event->name);
+                invalidate(path);
+                if (event->mask & IN_ISDIR) {
+                    invalidateDirectory(path);
+                }
+            }
+            if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED)) {
+                // 目录被删除或者移动，之后该路径可能是另一个目录，下次查找时重新监视
+                invalidateDirectory(directory);
+                if (event->mask & IN_MOVE_SELF) {
+                    ::inotify_rm_watch(inotifyFd_, event->wd);
+                }
+                watchedDirectories_.erase(directory);
+                watches_.erase(it);
+            }
+        }
+    }
+}
+
+void FileCache::invalidate(const std::string &path) {
+    auto it = entries_.find(path);
+    if (it != entries_.end()) {
+        lru_.erase(it->second);
+        entries_.erase(it);
+    }
+
+    // 预压缩文件被创建、修改或者删除，原文件的缓存项也要失效
+    for (const auto &sidecar : kSidecars) {
+        size_t length = ::strlen(sidecar.suffix);
+        if (path.size() > length && path.compare(path.size() - length, length, sidecar.suffix) == 0) {
+            invalidate(path.substr(0, path.size() - length));
+        }
+    }
+}
+
+void FileCache::invalidateDirectory(const std::string &directory) {
+    std::string prefix = directory.empty() ? directory : directory + "/";
+    for (auto it = lru_.begin(); it != lru_.end(); ) {
+        if ((*it)->path.compare(0, prefix.size(), prefix) == 0) {
+            entries_.erase((*it)->path);
+            it = lru_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
@@ -0,0 +1,166 @@
+#ifndef TINYWS_FILECACHE_H
+#define TINYWS_FILECACHE_H
+
+#include <sys/types.h>
+
+#include <ctime>
+#include <list>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include "../base/noncopyable.h"
+#include "../net/FileHandle.h"
+
+namespace tinyWS_thread {
+    class EventLoop;
+    class Channel;
+
+    // 静态文件的缓存，每个 IO 线程（EventLoop）一个，只在所属 IO 线程中使用，无须加锁。
+    //
+    // 缓存打开的文件描述符和 fstat(2) 的结果，按 LRU 淘汰，最多缓存 capacity 个文件，
+    // 命中时不需要 open(2) / stat(2) 等系统调用。
+    // 文件描述符由 FileHandle 共享，被淘汰时如果还在发送（输出队列中的文件段），则等发送完再关闭。
+    //
+    // 缓存的文件所在的目录用 inotify 监视，inotify 的文件描述符注册到 EventLoop 中，
+    // 文件被修改、替换、删除时，立即删除对应的缓存项，下一次请求重新打开文件。
+    //
+    // 打开文件时同时查找同一目录下预压缩的 file.br / file.gz（不比原文件旧），作为缓存项的一部分一起缓存，
+    // 预压缩文件变化时，原文件的缓存项也失效。
+    class FileCache : noncopyable {
+    public:
+        static const size_t kDefaultCapacity = 1024;
+
+        struct Entry;
+        using EntryPtr = std::shared_ptr<const Entry>;
+
+        // 缓存项，只读
+        struct Entry {
+            std::string path;           // 相对于根目录的路径
+            FileHandlePtr file;         // 打开的文件
+            size_t size;                // 文件大小
+            timespec modifyTime;        // 最后修改时间
+            const char *contentType;    // Content-Type（按扩展名）
+            std::string etag;           // 强 ETag（由大小和最后修改时间生成，带引号）
+            std::string lastModified;   // Last-Modified（HTTP-date）
+            const char *contentEncoding;// 预压缩文件的 Content-Encoding（"br" / "gzip"），原文件为 nullptr
+            EntryPtr brotli;            // 预压缩的 .br 文件，没有时为空
+            EntryPtr gzip;              // 预压缩的 .gz 文件，没有时为空
+
+            /**
+             * 响应是否因 Accept-Encoding 而不同（有预压缩文件，或者本身是预压缩文件），需要带上 Vary
+             * @return true / false
+             */
+            bool varyByEncoding() const {
+                return contentEncoding != nullptr || brotli || gzip;
+            }
+        };
+
+        /**
+         * 构造函数
+         * @param loop 所属 EventLoop
+         * @param root 根目录
+         * @param capacity 最多缓存的文件数
+         */
+        FileCache(EventLoop *loop, const std::string &root, size_t capacity);
+
+        ~FileCache();
+
+        /**
+         * --- 只能在 IO 线程中调用 ---
+         * 打开根目录和 inotify，并把 inotify 注册到 EventLoop 中
+         * @return 是否成功（根目录不存在时失败）
+         */
+        bool start();
+
+        /**
+         * --- 只能在 IO 线程中调用 ---
+         * 从 EventLoop 中移除 inotify，清空缓存
+         */
+        void stop();
+
+        /**
+         * --- 只能在 IO 线程中调用 ---
+         * 查找文件，没有缓存时打开文件并放入缓存
+         * @param path 相对于根目录的路径（不以 / 开头，不包含 ..）
+         * @return 缓存项，文件不存在或者不是普通文件时返回 nullptr
+         */
+        EntryPtr lookup(const std::string &path);
+
+        /**
+         * 是否缓存文件：有 inotify（能发现文件的变化）并且容量不为 0，start() 之后有效。
+         * 不缓存时每次 lookup() 都重新打开文件
+         * @return true / false
+         */
+        bool cacheable() const;
+
+        /**
+         * 缓存的文件数
+         * @return 文件数
+         */
+        size_t size() const;
+
+        /**
+         * 按扩展名获取 Content-Type
+         * @param path 路径
+         * @return Content-Type，未知的扩展名返回 application/octet-stream
+         */
+        static const char* contentTypeOf(const std::string &path);
+
+    private:
+        using EntryList = std::list<EntryPtr>;
+
+        EventLoop *loop_;                                       // 所属 EventLoop
+        const std::string root_;                                // 根目录
+        const size_t capacity_;                                 // 最多缓存的文件数
+        int rootFd_;                                            // 根目录的文件描述符，用于 openat(2)
+        int inotifyFd_;                                         // inotify 的文件描述符
+        std::unique_ptr<Channel> inotifyChannel_;               // inotify 的 Channel
+        EntryList lru_;                                         // 缓存项，最近使用的在前面
+        std::unordered_map<std::string, EntryList::iterator> entries_; // 路径 -> 缓存项
+        std::map<int, std::string> watches_;                    // inotify watch -> 目录（相对于根目录，根目录为空字符串）
+        std::map<std::string, int> watchedDirectories_;         // 目录 -> inotify watch
+
+        /**
+         * 打开文件并获取文件信息（不查找预压缩文件，不放入缓存）
+         * @param path 相对于根目录的路径
+         * @return 缓存项，文件不存在或者不是普通文件时返回 nullptr
+         */
+        std::shared_ptr<Entry> open(const std::string &path);
+
+        /**
+         * 打开预压缩文件
+         * @param original 原文件
+         * @param suffix 预压缩文件的后缀（".br" / ".gz"）
+         * @param contentEncoding Content-Encoding
+         * @return 预压缩文件，不存在或者比原文件旧时返回 nullptr
+         */
+        EntryPtr openSidecar(const Entry &original, const char *suffix, const char *contentEncoding);
+
+        /**
+         * 监视文件所在的目录（已经监视则不做任何事）
+         * @param directory 目录（相对于根目录）
+         */
+        void watchDirectory(const std::string &directory);
+
+        /**
+         * 读取 inotify 事件，删除变化的文件的缓存项
+         */
+        void handleRead();
+
+        /**
+         * 删除缓存项，路径是预压缩文件时同时删除原文件的缓存项
+         * @param path 路径
+         */
+        void invalidate(const std::string &path);
+
+        /**
+         * 删除目录下的所有缓存项
+         * @param directory 目录
+         */
+        void invalidateDirectory(const std::string &directory);
+    };
+}
+
+#endif //TINYWS_FILECACHE_H
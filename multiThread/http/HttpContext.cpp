@@ -1,12 +1,118 @@
 #include "HttpContext.h"
 
 #include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <limits>
 
+#include "HttpScanner.h"
 #include "../net/Buffer.h"
 
 using namespace tinyWS_thread;
 
-HttpContext::HttpContext() : state_(kExpectRequestLine) {
+namespace {
+    // chunk 大小行（包括扩展）的最大长度，超过时视为格式错误，防止一直缓存没有 CRLF 的数据
+    const size_t kMaxChunkSizeLine = 1024;
+
+    // trailer 中一行的最大长度，超过时视为格式错误（trailer 被忽略，不需要更长）
+    const size_t kMaxTrailerLine = 8 * 1024;
+
+    // 行的查找结果
+    enum LineStatus {
+        kLineComplete,      // 完整的一行
+        kLineIncomplete,    // 还没有收到行尾
+        kLineInvalid        // 有非法字符
+    };
+
+    /**
+     * 查找行尾的 CRLF，同时检查行中没有除 HTAB 之外的控制字符（包括单独的 CR、LF 和 NUL）
+     * @param begin 起始指针
+     * @param end 缓冲区可读数据的末尾指针
+     * @param crlf 完整时为 CRLF 的指针
+     * @return 查找结果
+     */
+    LineStatus findLine(const char *begin, const char *end, const char **crlf) {
+        const char *control = HttpScanner::findControl(begin, end);
+        if (control == end || (*control == '\r' && control + 1 == end)) {
+            return kLineIncomplete;
+        }
+        if (*control == '\r' && control[1] == '\n') {
+            *crlf = control;
+            return kLineComplete;
+        }
+        return kLineInvalid;
+    }
+
+    /**
+     * 所有 Content-Length 请求头的值是否相同。
+     * 索引中只有最后一个同名的请求头，如果不检查，前后端按不同的 Content-Length 划分请求，可以用于请求走私。
+     * @param request 请求
+     * @param value 最后一个 Content-Length 的值
+     * @return true / false
+     */
+    bool consistentContentLength(const HttpRequest &request, const StringPiece &value) {
+        for (size_t i = 0; i < request.headerCount(); ++i) {
+            if (request.headerId(i) == HttpHeader::kContentLength && request.headerValue(i) != value) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * 所有 Transfer-Encoding 请求头按顺序合并成的编码列表，是否以 chunked 结尾且 chunked 只出现一次，
+     * 否则无法确定 Body 的长度（RFC 7230 3.3.1、3.3.3）
+     * @param request 请求
+     * @return true / false
+     */
+    bool endsWithSingleChunked(const HttpRequest &request) {
+        int chunkedCount = 0;
+        bool lastIsChunked = false;
+        for (size_t i = 0; i < request.headerCount(); ++i) {
+            if (request.headerId(i) != HttpHeader::kTransferEncoding) {
+                continue;
+            }
+            StringPiece value = request.headerValue(i);
+            size_t begin = 0;
+            while (begin <= value.size()) {
+                size_t comma = value.find(',', begin);
+                if (comma == StringPiece::npos) {
+                    comma = value.size();
+                }
+                StringPiece coding = value.substr(begin, comma - begin);
+                while (!coding.empty() && (coding[0] == ' ' || coding[0] == '\t')) {
+                    coding = coding.substr(1);
+                }
+                while (!coding.empty() && (coding.back() == ' ' || coding.back() == '\t')) {
+                    coding = coding.substr(0, coding.size() - 1);
+                }
+                // 空的列表元素忽略
+                if (!coding.empty()) {
+                    lastIsChunked = HttpHeader::equalsIgnoreCase(coding, "chunked");
+                    if (lastIsChunked) {
+                        ++chunkedCount;
+                    }
+                }
+                begin = comma + 1;
+            }
+        }
+        return chunkedCount == 1 && lastIsChunked;
+    }
+}
+
+const size_t HttpContext::kDefaultMaxBodySize;
+
+HttpContext::HttpContext()
+    : state_(kExpectRequestLine),
+      error_(kNoError),
+      headerBytes_(0),
+      bodyRemaining_(0),
+      bodyReceived_(0),
+      expectContinue_(false),
+      reaper_(nullptr),
+      requestCount_(0),
+      bodyCallback_(nullptr),
+      maxBodySize_(kDefaultMaxBodySize) {
 
 }
 
@@ -17,61 +123,171 @@ bool HttpContext::parseRequest(Buffer *buffer, Timer::TimeType receiveTime) {
         if (state_ == kExpectRequestLine) {
             // 解析请求行
 
-            const char *crlf = buffer->findCRLF(); // 查找"r\n"
-            if (crlf) {
+            const char *crlf = nullptr;
+            LineStatus status = findLine(buffer->peek(), buffer->beginWrite(), &crlf); // 查找"\r\n"
+            if (status == kLineComplete) {
                 // 查找成功，当前请求行完整
+                request_.setBase(buffer->peek());
                 isOk = processRequestLine(buffer->peek(), crlf);
 
                 if (isOk) {
                     // 行解析成功
                     request_.setReceiveTime(receiveTime);
-                    // 更新 Buffer
-                    buffer->retrieveUntil(crlf + 2);
+                    // 请求行留在缓冲区中（HttpRequest 只记录偏移），reset() 时再移除
+                    headerBytes_ = static_cast<size_t>(crlf + 2 - buffer->peek());
                     // 行解析成功，下一步是解析请求头
                     state_ = kExpectHeader;
                 } else {
                     // 请求行解析失败
+                    error_ = kBadRequest;
                     hasMore = false;
                 }
             } else {
-                // 请求行不完整
+                // 请求行不完整，或者有非法字符
+                if (status == kLineInvalid) {
+                    error_ = kBadRequest;
+                    isOk = false;
+                }
                 hasMore = false;
             }
         } else if (state_ == kExpectHeader) {
             // 解析请求头
 
-            const char *crlf = buffer->findCRLF(); // 查找"r\n"
-            if (crlf) {
+            // 缓冲区中的数据可能已经移动（扩容或者移到缓冲区的开头），重新设置请求的起始位置
+            request_.setBase(buffer->peek());
+            const char *start = buffer->peek() + headerBytes_;
+            const char *crlf = nullptr;
+            LineStatus status = findLine(start, buffer->beginWrite(), &crlf); // 查找"\r\n"
+            if (status == kLineComplete) {
                 // 查找成功，当前有一行完整的数据
-                const char *colon = std::find(buffer->peek(), crlf, ':'); // 查找":"
-                if (colon != crlf) {
-                    request_.addHeader(buffer->peek(), colon, crlf);
+                bool headersEnd = start == crlf;
+                // 名字必须是 token，并且与 ":" 之间不能有空白（RFC 7230 3.2.4），否则可能用于请求走私
+                const char *colon = headersEnd ? crlf : HttpScanner::findNonToken(start, crlf); // 查找":"
+                if (!headersEnd && (colon == start || *colon != ':')) {
+                    isOk = fail(kBadRequest);
+                    hasMore = false;
+                } else if (!headersEnd) {
+                    request_.addHeader(start, colon, crlf);
+                    headerBytes_ = static_cast<size_t>(crlf + 2 - buffer->peek());
                 } else {
-                    // 空行（"r\n"），请求头结束
+                    headerBytes_ = static_cast<size_t>(crlf + 2 - buffer->peek());
+                    // 空行（"r\n"），请求头结束，确定是否有 Body
+                    isOk = processHeadersEnd();
+                    if (isOk && state_ != kGotAll) {
+                        // 有 Body：Body 数据交给 BodyCallback 之后就要从缓冲区中移除，
+                        // 请求行和请求头不能再留在缓冲区中，先复制到 HttpRequest 中
+                        request_.materialize();
+                        buffer->retrieve(headerBytes_);
+                        headerBytes_ = 0;
+                    }
+                    hasMore = isOk && state_ != kGotAll;
+                }
+            } else {
+                if (status == kLineInvalid) {
+                    isOk = fail(kBadRequest);
+                }
+                hasMore = false;
+            }
+        } else if (state_ == kExpectBody || state_ == kExpectChunkData) {
+            // 解析 Body：把缓冲区中的数据直接交给 BodyCallback
+            consumeBody(buffer);
+            if (bodyRemaining_ > 0) {
+                // 数据不完整
+                hasMore = false;
+            } else {
+                state_ = state_ == kExpectBody ? kGotAll : kExpectChunkEnd;
+                hasMore = state_ != kGotAll;
+            }
+        } else if (state_ == kExpectChunkSize) {
+            const char *crlf = buffer->findCRLF();
+            if (crlf) {
+                isOk = processChunkSize(buffer->peek(), crlf);
+                buffer->retrieveUntil(crlf + 2);
+                hasMore = isOk;
+            } else {
+                if (buffer->readableBytes() > kMaxChunkSizeLine) {
+                    isOk = fail(kBadRequest);
+                }
+                hasMore = false;
+            }
+        } else if (state_ == kExpectChunkEnd) {
+            // chunk 数据之后必须是 CRLF
+            if (buffer->readableBytes() < 2) {
+                hasMore = false;
+            } else if (buffer->peek()[0] == '\r' && buffer->peek()[1] == '\n') {
+                buffer->retrieve(2);
+                state_ = kExpectChunkSize;
+            } else {
+                isOk = fail(kBadRequest);
+                hasMore = false;
+            }
+        } else if (state_ == kExpectTrailer) {
+            // 忽略 trailer，直到空行。与请求头一样检查控制字符，并限制行的长度，防止一直缓存没有 CRLF 的数据
+            const char *crlf = nullptr;
+            LineStatus status = findLine(buffer->peek(), buffer->beginWrite(), &crlf);
+            if (status == kLineComplete && static_cast<size_t>(crlf - buffer->peek()) <= kMaxTrailerLine) {
+                bool trailerEnd = crlf == buffer->peek();
+                buffer->retrieveUntil(crlf + 2);
+                if (trailerEnd) {
                     state_ = kGotAll;
                     hasMore = false;
                 }
-                // 更新 Buffer
-                buffer->retrieveUntil(crlf + 2);
             } else {
+                if (status != kLineIncomplete || buffer->readableBytes() > kMaxTrailerLine) {
+                    isOk = fail(kBadRequest);
+                }
                 hasMore = false;
             }
-        } else if (state_ == kExpectBody) {
-            // TODO
+        } else {
+            // kGotAll：之后的数据属于下一个请求
+            hasMore = false;
         }
     }
 
     return isOk;
 }
 
+HttpContext::ParseError HttpContext::error() const {
+    return error_;
+}
+
+bool HttpContext::started() const {
+    return state_ != kExpectRequestLine;
+}
+
+bool HttpContext::readingBody() const {
+    // 不包括 trailer：trailer 与请求头一样受读请求超时时间的限制
+    return state_ == kExpectBody || state_ == kExpectChunkSize || state_ == kExpectChunkData ||
+           state_ == kExpectChunkEnd;
+}
+
+bool HttpContext::takeExpectContinue() {
+    bool expectContinue = expectContinue_;
+    expectContinue_ = false;
+    return expectContinue;
+}
+
+void HttpContext::setBodyCallback(const BodyCallback *cb) {
+    bodyCallback_ = cb;
+}
+
+void HttpContext::setMaxBodySize(size_t maxBodySize) {
+    maxBodySize_ = maxBodySize;
+}
+
 bool HttpContext::gotAll() const {
     return state_ == kGotAll;
 }
 
-void HttpContext::reset() {
+void HttpContext::reset(Buffer *buffer) {
+    buffer->retrieve(headerBytes_);
     state_ = kExpectRequestLine;
-    HttpRequest dummy;
-    request_.swap(dummy);
+    error_ = kNoError;
+    headerBytes_ = 0;
+    bodyRemaining_ = 0;
+    bodyReceived_ = 0;
+    expectContinue_ = false;
+    request_.reset();
 }
 
 const HttpRequest& HttpContext::request() const {
@@ -82,28 +298,160 @@ HttpRequest& HttpContext::request() {
     return request_;
 }
 
-bool HttpContext::processRequestLine(const char *start, const char *end) {
-    bool isSucceed = false;
-
-    // 请求方法 路径 HTTP/版本
-    const char *space = std::find(start, end, ' ');
-    if (space != end && request_.setMethod(start, space)) {
-        start = space + 1;
-        space = std::find(start, end, ' ');
-        if (space != end) {
-            const char *question = std::find(start, space, '?');
-            if (question != space) {
-                request_.setPath(start, question);
-                request_.setQuery(question, space);
-            } else {
-                request_.setPath(start, space);
+void HttpContext::setReaper(ConnectionReaper *reaper) {
+    reaper_ = reaper;
+}
+
+ConnectionReaper* HttpContext::reaper() const {
+    return reaper_;
+}
+
+ConnectionReaper::Position* HttpContext::reaperPosition() {
+    return &reaperPosition_;
+}
+
+int HttpContext::incrementRequestCount() {
+    return ++requestCount_;
+}
+
+void HttpContext::setStream(const std::shared_ptr<ChunkedWriter> &stream) {
+    stream_ = stream;
+}
+
+const std::shared_ptr<ChunkedWriter>& HttpContext::stream() const {
+    return stream_;
+}
+
+bool HttpContext::processHeadersEnd() {
+    StringPiece transferEncoding;
+    StringPiece contentLength;
+    bool hasTransferEncoding = request_.findHeader(HttpHeader::kTransferEncoding, &transferEncoding);
+    bool hasContentLength = request_.findHeader(HttpHeader::kContentLength, &contentLength);
+    if (hasTransferEncoding) {
+        // 同时有 Transfer-Encoding 和 Content-Length 的请求可能用于请求走私，拒绝；
+        // 所有 Transfer-Encoding 的最后一个编码必须是 chunked
+        if (hasContentLength || !endsWithSingleChunked(request_)) {
+            return fail(kBadRequest);
+        }
+        state_ = kExpectChunkSize;
+    } else if (hasContentLength) {
+        // 有多个不同的 Content-Length 时拒绝（RFC 7230 3.3.3）
+        if (!consistentContentLength(request_, contentLength)) {
+            return fail(kBadRequest);
+        }
+        // 最多 19 位十进制数，不会溢出
+        if (contentLength.empty() || contentLength.size() > 19) {
+            return fail(kBadRequest);
+        }
+        bodyRemaining_ = 0;
+        for (char c : contentLength) {
+            if (c < '0' || c > '9') {
+                return fail(kBadRequest);
             }
+            bodyRemaining_ = bodyRemaining_ * 10 + static_cast<size_t>(c - '0');
+        }
+        if (maxBodySize_ > 0 && bodyRemaining_ > maxBodySize_) {
+            return fail(kBodyTooLarge);
         }
+        state_ = bodyRemaining_ > 0 ? kExpectBody : kGotAll;
+    } else {
+        // 没有 Body
+        state_ = kGotAll;
+    }
 
-        start = space + 1;
-        // 8个字节：HTTP/1.1
-        isSucceed = end - start == 8 && std::equal(start, end, "HTTP/1.1");
+    if (state_ != kGotAll) {
+        StringPiece expect;
+        expectContinue_ = request_.findHeader(HttpHeader::kExpect, &expect) &&
+                          HttpHeader::equalsIgnoreCase(expect, "100-continue");
     }
+    return true;
+}
+
+bool HttpContext::processChunkSize(const char *start, const char *end) {
+    // chunk-size [; chunk-ext] CRLF，chunk-size 为十六进制
+    size_t size = 0;
+    const char *p = start;
+    for (; p < end && ::isxdigit(static_cast<unsigned char>(*p)); ++p) {
+        if (size > (std::numeric_limits<size_t>::max() >> 4)) {
+            return fail(kBadRequest);
+        }
+        int c = ::tolower(static_cast<unsigned char>(*p));
+        size = (size << 4) | static_cast<size_t>(c <= '9' ? c - '0' : c - 'a' + 10);
+    }
+    if (p == start || (p < end && *p != ';' && *p != ' ' && *p != '\t')) {
+        return fail(kBadRequest);
+    }
+
+    if (size == 0) {
+        // 最后一个 chunk
+        state_ = kExpectTrailer;
+        return true;
+    }
+    if (maxBodySize_ > 0 && (size > maxBodySize_ || bodyReceived_ > maxBodySize_ - size)) {
+        return fail(kBodyTooLarge);
+    }
+    bodyRemaining_ = size;
+    state_ = kExpectChunkData;
+    return true;
+}
+
+void HttpContext::consumeBody(Buffer *buffer) {
+    size_t n = std::min(bodyRemaining_, buffer->readableBytes());
+    if (n == 0) {
+        return;
+    }
+    if (bodyCallback_ != nullptr && *bodyCallback_) {
+        (*bodyCallback_)(request_, buffer->peek(), n);
+    }
+    buffer->retrieve(n);
+    bodyRemaining_ -= n;
+    bodyReceived_ += n;
+}
 
-    return isSucceed;
+bool HttpContext::fail(ParseError error) {
+    error_ = error;
+    return false;
+}
+
+bool HttpContext::processRequestLine(const char *start, const char *end) {
+    // 请求方法 SP 请求目标 SP HTTP/1.1，请求方法是 token，请求目标中不能有空格和控制字符，
+    // 请求行已经由 findLine() 检查过，没有除 HTAB 之外的控制字符
+
+    // 请求方法
+    const char *space = HttpScanner::findNonToken(start, end);
+    if (space == end || *space != ' ' || !request_.setMethod(start, space)) {
+        return false;
+    }
+
+    // 8个字节：HTTP/1.1，请求目标至少 1 个字节
+    start = space + 1;
+    if (end - start < 10) {
+        return false;
+    }
+    const char *version = end - 8;
+    const char *targetEnd = version - 1;
+    if (*targetEnd != ' ' || !std::equal(version, end, "HTTP/1.1")) {
+        return false;
+    }
+
+    // 请求目标：路径 [? 查询字符串]
+    const char *delimiter = HttpScanner::findTargetDelimiter(start, targetEnd);
+    if (delimiter == targetEnd) {
+        request_.setPath(start, targetEnd);
+        return true;
+    }
+    if (*delimiter != '?' || delimiter == start) {
+        return false;
+    }
+    const char *question = delimiter;
+    do {
+        // 查询字符串中可以有 '?'
+        delimiter = HttpScanner::findTargetDelimiter(delimiter + 1, targetEnd);
+    } while (delimiter != targetEnd && *delimiter == '?');
+    if (delimiter != targetEnd) {
+        return false;
+    }
+    request_.setPath(start, question);
+    request_.setQuery(question, targetEnd);
+    return true;
 }
@@ -1,41 +1,111 @@
 #ifndef TINYWS_HTTPCONTEXT_H
 #define TINYWS_HTTPCONTEXT_H
 
+#include <cstddef>
+#include <functional>
+#include <memory>
+
 #include "HttpRequest.h"
+#include "ConnectionReaper.h"
 #include "../net/Timer.h"
 
 namespace tinyWS_thread {
     class Buffer;
+    class ChunkedWriter;
 
+    // 解析一个连接上的请求（请求行、请求头和 Body），每个连接一个。
+    //
+    // 请求行和请求头在解析时不从缓冲区中移除，HttpRequest 只记录它们在缓冲区中的偏移，不复制，
+    // 请求处理完之后由 reset() 移除；有 Body 时，在开始接收 Body 之前复制到 HttpRequest 中（HttpRequest::materialize()）。
+    //
+    // Body 按 Content-Length 或者 Transfer-Encoding: chunked 解析，不保存在 HttpRequest 中：
+    // 每收到一段 Body 数据，就用输入缓冲区中的这段数据（指针 + 长度，不复制）调用 BodyCallback，
+    // 调用后数据立即从缓冲区中移除，所以无论 Body 多大，占用的内存都不超过输入缓冲区的大小。
     class HttpContext {
     public:
+        // 收到一段 Body 数据时的回调函数的类型，data 指向输入缓冲区，只在回调函数中有效
+        using BodyCallback = std::function<void(const HttpRequest&, const char *data, size_t len)>;
+
+        static const size_t kDefaultMaxBodySize = 1024 * 1024;
+
         // 解析状态
         enum HttpRequestParseState {
             kExpectRequestLine, // 解析行
             kExpectHeader,      // 解析请求头
-            kExpectBody,        // 解析 Body
+            kExpectBody,        // 解析 Body（Content-Length）
+            kExpectChunkSize,   // 解析 chunk 的大小行
+            kExpectChunkData,   // 解析 chunk 的数据
+            kExpectChunkEnd,    // 解析 chunk 数据之后的 CRLF
+            kExpectTrailer,     // 解析最后一个 chunk 之后的 trailer（忽略）
             kGotAll             // 解析完成
         };
 
+        // 解析失败的原因
+        enum ParseError {
+            kNoError,           // 没有出错
+            kBadRequest,        // 格式错误，返回 400
+            kBodyTooLarge       // Body 超过上限，返回 413
+        };
+
         HttpContext();
 
         /**
          * 解析 Buffer 的数据，并将相应的信息添加到 HttpRequest 中，最后返回是否解析成功。
+         * 解析到 Body 时调用 BodyCallback，最多解析到一个请求结束为止（gotAll()），之后的数据留在缓冲区中。
          * @param buffer 缓冲区
          * @param receiveTime 连接接收时间
-         * @return 是否解析成功
+         * @return 是否解析成功，失败的原因见 error()
          */
         bool parseRequest(Buffer *buffer, Timer::TimeType receiveTime);
 
+        /**
+         * 获取解析失败的原因
+         * @return 原因
+         */
+        ParseError error() const;
+
+        /**
+         * 是否已经收到当前请求的部分数据（还没有解析完成）
+         * @return true / false
+         */
+        bool started() const;
+
+        /**
+         * 是否正在接收 Body（不包括最后一个 chunk 之后的 trailer）
+         * @return true / false
+         */
+        bool readingBody() const;
+
+        /**
+         * 请求头中有 "Expect: 100-continue" 并且需要接收 Body 时，需要先回复 100 Continue，
+         * 返回是否需要回复，并清除该标志（每个请求只回复一次）
+         * @return true / false
+         */
+        bool takeExpectContinue();
+
+        /**
+         * 设置收到一段 Body 数据时的回调函数，不设置时丢弃 Body
+         * @param cb 回调函数，由调用者保证比 HttpContext 活得长
+         */
+        void setBodyCallback(const BodyCallback *cb);
+
+        /**
+         * 设置 Body 的最大字节数，Content-Length 超过或者 chunked 的总长度超过时解析失败（kBodyTooLarge）
+         * @param maxBodySize 字节数，0 表示不限制，默认为 kDefaultMaxBodySize
+         */
+        void setMaxBodySize(size_t maxBodySize);
+
         /*
          * 是否解析完成
          */
         bool gotAll() const;
 
         /**
-         * 重置解析状态为 kExpectRequestLine，清空 HttpRequest
+         * 重置解析状态为 kExpectRequestLine，清空 HttpRequest 和 Body 的解析状态，
+         * 并从缓冲区中移除已经处理完的请求的请求行和请求头（HttpRequest 的视图指向它们，所以处理完之后才移除）
+         * @param buffer 缓冲区，与 parseRequest() 的相同
          */
-        void reset();
+        void reset(Buffer *buffer);
 
         /**
          * 获取  HttpRequest
@@ -46,9 +116,85 @@ namespace tinyWS_thread {
         // 同上
         HttpRequest& request();
 
+        /**
+         * 设置连接所属 IO 线程的 ConnectionReaper
+         * @param reaper ConnectionReaper，nullptr 表示不回收超时连接
+         */
+        void setReaper(ConnectionReaper *reaper);
+
+        /**
+         * 获取连接所属 IO 线程的 ConnectionReaper
+         * @return ConnectionReaper
+         */
+        ConnectionReaper* reaper() const;
+
+        /**
+         * 获取连接在 ConnectionReaper 中的位置
+         * @return 位置
+         */
+        ConnectionReaper::Position* reaperPosition();
+
+        /**
+         * 连接已处理的请求数加一
+         * @return 加一后的请求数
+         */
+        int incrementRequestCount();
+
+        /**
+         * 设置连接正在发送的流式响应
+         * @param stream ChunkedWriter，nullptr 表示没有
+         */
+        void setStream(const std::shared_ptr<ChunkedWriter> &stream);
+
+        /**
+         * 获取连接正在发送的流式响应，发送期间不处理之后的请求（数据留在输入缓冲区中）
+         * @return ChunkedWriter，没有时为空
+         */
+        const std::shared_ptr<ChunkedWriter>& stream() const;
+
     private:
         HttpRequestParseState state_;   // 当前解析状态
         HttpRequest request_;           // 请求
+        ParseError error_;              // 解析失败的原因
+        size_t headerBytes_;            // 缓冲区开头属于当前请求的请求行和请求头（已解析、还没有移除）的字节数
+        size_t bodyRemaining_;          // Content-Length / 当前 chunk 还没有收到的字节数
+        size_t bodyReceived_;           // 已经收到的 Body 字节数
+        bool expectContinue_;           // 是否需要回复 100 Continue
+
+        // 以下成员属于连接，reset() 不会重置
+        ConnectionReaper *reaper_;                  // 连接所属 IO 线程的 ConnectionReaper
+        ConnectionReaper::Position reaperPosition_; // 连接在 ConnectionReaper 中的位置
+        int requestCount_;                          // 连接已处理的请求数
+        const BodyCallback *bodyCallback_;          // 收到 Body 数据时的回调函数
+        size_t maxBodySize_;                        // Body 的最大字节数
+        std::shared_ptr<ChunkedWriter> stream_;     // 正在发送的流式响应
+
+        /**
+         * 请求头解析完成后，按 Transfer-Encoding / Content-Length 确定 Body 的解析方式
+         * @return 是否成功
+         */
+        bool processHeadersEnd();
+
+        /**
+         * 解析 chunk 的大小行
+         * @param start 起始指针
+         * @param end 末尾指针（CRLF 的位置）
+         * @return 是否成功
+         */
+        bool processChunkSize(const char *start, const char *end);
+
+        /**
+         * 把缓冲区中最多 bodyRemaining_ 个字节作为 Body 数据交给 BodyCallback，并从缓冲区中移除
+         * @param buffer 缓冲区
+         */
+        void consumeBody(Buffer *buffer);
+
+        /**
+         * 设置解析失败的原因
+         * @param error 原因
+         * @return false
+         */
+        bool fail(ParseError error);
 
         /**
          * 解析行
@@ -0,0 +1,126 @@
+#include "HttpHeader.h"
+
+#include <strings.h> // strncasecmp
+
+using namespace tinyWS_thread;
+
+namespace {
+    // 完美哈希表的大小（2 的幂）
+    constexpr size_t kTableSize = 128;
+
+    // 常用头部的名字，与 HttpHeader::Id 的顺序相同
+    constexpr const char* kNames[] = {
+            "Accept",
+            "Accept-Encoding",
+            "Accept-Language",
+            "Accept-Ranges",
+            "Authorization",
+            "Cache-Control",
+            "Connection",
+            "Content-Encoding",
+            "Content-Length",
+            "Content-Range",
+            "Content-Type",
+            "Cookie",
+            "Date",
+            "ETag",
+            "Expect",
+            "Expires",
+            "Host",
+            "If-Match",
+            "If-Modified-Since",
+            "If-None-Match",
+            "If-Range",
+            "If-Unmodified-Since",
+            "Keep-Alive",
+            "Last-Modified",
+            "Location",
+            "Origin",
+            "Range",
+            "Referer",
+            "Server",
+            "Set-Cookie",
+            "Transfer-Encoding",
+            "Upgrade",
+            "User-Agent",
+            "Vary"
+    };
+
+    static_assert(sizeof(kNames) / sizeof(kNames[0]) == HttpHeader::kWellKnownCount,
+                  "kNames must match HttpHeader::Id");
+
+    constexpr size_t length(const char *s) {
+        return *s == '\0' ? 0 : 1 + length(s + 1);
+    }
+
+    // 字母转为小写（其他字符也会改变，但只用于计算哈希值，最后仍然比较名字）
+    constexpr size_t lower(char c) {
+        return static_cast<unsigned char>(c) | 0x20u;
+    }
+
+    /**
+     * 名字的哈希值：由长度和首、中、尾三个字符（不区分大小写）计算，
+     * 系数是对 kNames 搜索得到的，保证常用头部没有冲突（见下面的 static_assert）
+     * @param s 名字
+     * @param n 长度，大于 0
+     * @return 哈希值，小于 kTableSize
+     */
+    constexpr size_t hash(const char *s, size_t n) {
+        return (n * 2 + lower(s[0]) + (lower(s[n / 2]) << 4) + lower(s[n - 1])) & (kTableSize - 1);
+    }
+
+    constexpr size_t nameHash(size_t id) {
+        return hash(kNames[id], length(kNames[id]));
+    }
+
+    // id 及之后的名字的哈希值都不等于 h
+    constexpr bool hashUnused(size_t h, size_t id) {
+        return id == HttpHeader::kWellKnownCount || (nameHash(id) != h && hashUnused(h, id + 1));
+    }
+
+    // id 及之后的名字的哈希值两两不同
+    constexpr bool perfect(size_t id) {
+        return id == HttpHeader::kWellKnownCount || (hashUnused(nameHash(id), id + 1) && perfect(id + 1));
+    }
+
+    static_assert(perfect(0), "hash() has collisions among well-known header names, adjust its coefficients");
+
+    // 哈希值为 h 的常用头部，没有时为 kUnknown
+    constexpr unsigned char slot(size_t h, size_t id) {
+        return id == HttpHeader::kWellKnownCount ? static_cast<unsigned char>(HttpHeader::kUnknown)
+                                                 : (nameHash(id) == h ? static_cast<unsigned char>(id)
+                                                                      : slot(h, id + 1));
+    }
+
+#define TINYWS_SLOT4(h) slot(h, 0), slot(h + 1, 0), slot(h + 2, 0), slot(h + 3, 0)
+#define TINYWS_SLOT16(h) TINYWS_SLOT4(h), TINYWS_SLOT4(h + 4), TINYWS_SLOT4(h + 8), TINYWS_SLOT4(h + 12)
+#define TINYWS_SLOT64(h) TINYWS_SLOT16(h), TINYWS_SLOT16(h + 16), TINYWS_SLOT16(h + 32), TINYWS_SLOT16(h + 48)
+
+    // 哈希值到 Id 的映射，在编译期生成
+    constexpr unsigned char kSlots[kTableSize] = {
+            TINYWS_SLOT64(0), TINYWS_SLOT64(64)
+    };
+
+#undef TINYWS_SLOT64
+#undef TINYWS_SLOT16
+#undef TINYWS_SLOT4
+}
+
+HttpHeader::Id HttpHeader::lookup(const StringPiece &name) {
+    if (name.empty()) {
+        return kUnknown;
+    }
+    Id id = static_cast<Id>(kSlots[hash(name.data(), name.size())]);
+    if (id != kUnknown && equalsIgnoreCase(name, kNames[id])) {
+        return id;
+    }
+    return kUnknown;
+}
+
+const char* HttpHeader::name(Id id) {
+    return id < kWellKnownCount ? kNames[id] : "";
+}
+
+bool HttpHeader::equalsIgnoreCase(const StringPiece &a, const StringPiece &b) {
+    return a.size() == b.size() && (a.empty() || ::strncasecmp(a.data(), b.data(), a.size()) == 0);
+}
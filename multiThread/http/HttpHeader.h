@@ -0,0 +1,125 @@
+#ifndef TINYWS_HTTPHEADER_H
+#define TINYWS_HTTPHEADER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "../base/StringPiece.h"
+
+namespace tinyWS_thread {
+    // 常用的 HTTP 头部（请求头和响应头）。
+    //
+    // 每个常用头部有一个 Id，名字到 Id 的映射是编译期生成的完美哈希表（不区分大小写），
+    // HttpRequest 和 HttpResponse 用 Index 按 Id 直接找到头部在扁平数组中的位置（O(1)），
+    // 其他头部按顺序比较名字（不区分大小写）。
+    class HttpHeader {
+    public:
+        // 常用头部的 Id，与 kNames 的顺序相同
+        enum Id {
+            kAccept,
+            kAcceptEncoding,
+            kAcceptLanguage,
+            kAcceptRanges,
+            kAuthorization,
+            kCacheControl,
+            kConnection,
+            kContentEncoding,
+            kContentLength,
+            kContentRange,
+            kContentType,
+            kCookie,
+            kDate,
+            kETag,
+            kExpect,
+            kExpires,
+            kHost,
+            kIfMatch,
+            kIfModifiedSince,
+            kIfNoneMatch,
+            kIfRange,
+            kIfUnmodifiedSince,
+            kKeepAlive,
+            kLastModified,
+            kLocation,
+            kOrigin,
+            kRange,
+            kReferer,
+            kServer,
+            kSetCookie,
+            kTransferEncoding,
+            kUpgrade,
+            kUserAgent,
+            kVary,
+            kWellKnownCount,                // 常用头部的个数
+            kUnknown = kWellKnownCount      // 不是常用头部
+        };
+
+        // 常用头部在扁平数组中的位置，每个 Id 记录最后一个同名头部的位置
+        class Index {
+        public:
+            Index() {
+                clear();
+            }
+
+            /**
+             * 清空
+             */
+            void clear() {
+                ::memset(positions_, 0, sizeof(positions_));
+            }
+
+            /**
+             * 记录头部的位置（同名的头部以最后一个为准）
+             * @param id Id，为 kUnknown 时不做任何事
+             * @param position 位置
+             */
+            void set(Id id, size_t position) {
+                if (id != kUnknown) {
+                    positions_[id] = static_cast<uint32_t>(position + 1);
+                }
+            }
+
+            /**
+             * 查找头部的位置
+             * @param id Id
+             * @param position 位置
+             * @return 是否存在
+             */
+            bool find(Id id, size_t *position) const {
+                if (id == kUnknown || positions_[id] == 0) {
+                    return false;
+                }
+                *position = positions_[id] - 1;
+                return true;
+            }
+
+        private:
+            uint32_t positions_[kWellKnownCount];   // 位置 + 1，0 表示不存在
+        };
+
+        /**
+         * 查找名字对应的 Id（不区分大小写）
+         * @param name 名字
+         * @return Id，不是常用头部时为 kUnknown
+         */
+        static Id lookup(const StringPiece &name);
+
+        /**
+         * 获取常用头部的名字（标准的大小写）
+         * @param id Id，不能是 kUnknown
+         * @return 名字
+         */
+        static const char* name(Id id);
+
+        /**
+         * 比较两个名字是否相同（不区分大小写）
+         * @param a 名字
+         * @param b 名字
+         * @return true / false
+         */
+        static bool equalsIgnoreCase(const StringPiece &a, const StringPiece &b);
+    };
+}
+
+#endif //TINYWS_HTTPHEADER_H
@@ -0,0 +1,146 @@
+#include "HttpRange.h"
+
+#include <algorithm>
+#include <cctype>
+#include <limits>
+
+using namespace tinyWS_thread;
+
+const size_t HttpRange::kMaxRanges;
+
+namespace {
+    /**
+     * 跳过空白字符
+     * @param p 当前位置
+     * @param end 结束位置
+     * @return 第一个非空白字符的位置
+     */
+    const char* skipSpaces(const char *p, const char *end) {
+        while (p < end && (*p == ' ' || *p == '\t')) {
+            ++p;
+        }
+        return p;
+    }
+
+    /**
+     * 解析十进制整数
+     * @param p 当前位置，解析成功后指向数字之后的位置
+     * @param end 结束位置
+     * @param value 整数
+     * @return 是否至少有一位数字且没有溢出
+     */
+    bool parseNumber(const char **p, const char *end, size_t *value) {
+        const char *begin = *p;
+        size_t result = 0;
+        while (*p < end && ::isdigit(static_cast<unsigned char>(**p))) {
+            size_t digit = static_cast<size_t>(**p - '0');
+            if (result > (std::numeric_limits<size_t>::max() - digit) / 10) {
+                return false;
+            }
+            result = result * 10 + digit;
+            ++*p;
+        }
+        *value = result;
+        return *p > begin;
+    }
+}
+
+HttpRange::Result HttpRange::parse(const StringPiece &value, size_t size, std::vector<ByteRange> *ranges) {
+    ranges->clear();
+    const char *p = value.begin();
+    const char *end = value.end();
+    p = skipSpaces(p, end);
+    if (!StringPiece(p, static_cast<size_t>(end - p)).startsWith("bytes=")) {
+        return kInvalid;
+    }
+    p += 6;
+
+    size_t count = 0;
+    while (true) {
+        p = skipSpaces(p, end);
+        if (p < end && *p == ',') {
+            // 空的列表元素
+            ++p;
+            continue;
+        }
+        if (p == end) {
+            break;
+        }
+
+        if (++count > kMaxRanges) {
+            ranges->clear();
+            return kInvalid;
+        }
+
+        size_t first = 0;
+        size_t last = 0;
+        if (*p == '-') {
+            // 后缀区间：最后 N 个字节
+            ++p;
+            size_t suffix;
+            if (!parseNumber(&p, end, &suffix)) {
+                ranges->clear();
+                return kInvalid;
+            }
+            if (suffix > 0 && size > 0) {
+                first = suffix >= size ? 0 : size - suffix;
+                ranges->push_back({first, size - 1});
+            }
+        } else {
+            if (!parseNumber(&p, end, &first) || p == end || *p != '-') {
+                ranges->clear();
+                return kInvalid;
+            }
+            ++p;
+            bool hasLast = parseNumber(&p, end, &last);
+            if (hasLast && last < first) {
+                ranges->clear();
+                return kInvalid;
+            }
+            if (first < size) {
+                ranges->push_back({first, hasLast && last < size ? last : size - 1});
+            }
+        }
+
+        p = skipSpaces(p, end);
+        if (p < end && *p != ',') {
+            ranges->clear();
+            return kInvalid;
+        }
+    }
+
+    if (count == 0) {
+        return kInvalid;
+    }
+    if (ranges->size() > 1 && coalesce(ranges) == size) {
+        // 合并之后是整个文件，直接返回 200，不必使用 multipart/byteranges
+        ranges->clear();
+        return kInvalid;
+    }
+    return ranges->empty() ? kUnsatisfiable : kSatisfiable;
+}
+
+size_t HttpRange::coalesce(std::vector<ByteRange> *ranges) {
+    std::sort(ranges->begin(), ranges->end(), [](const ByteRange &a, const ByteRange &b) {
+        return a.first < b.first;
+    });
+
+    // 与前一个区间重叠或者相邻时，合并到前一个区间
+    size_t merged = 0;
+    for (size_t i = 1; i < ranges->size(); ++i) {
+        ByteRange &previous = (*ranges)[merged];
+        const ByteRange &current = (*ranges)[i];
+        if (current.first <= previous.last + 1) {
+            previous.last = std::max(previous.last, current.last);
+        } else {
+            (*ranges)[++merged] = current;
+        }
+    }
+    ranges->resize(merged + 1);
+
+    size_t bytes = 0;
+    for (const auto &range : *ranges) {
+        bytes += range.length();
+    }
+    return bytes;
+}
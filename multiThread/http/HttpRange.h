@@ -0,0 +1,58 @@
+#ifndef TINYWS_HTTPRANGE_H
+#define TINYWS_HTTPRANGE_H
+
+#include <cstddef>
+#include <vector>
+
+#include "../base/StringPiece.h"
+
+namespace tinyWS_thread {
+
+    // Range 请求头（RFC 7233）的解析，只支持 bytes 单位
+    class HttpRange {
+    public:
+        // 一个字节区间 [first, last]
+        struct ByteRange {
+            size_t first;   // 第一个字节的位置
+            size_t last;    // 最后一个字节的位置（包含）
+
+            /**
+             * 区间的长度
+             * @return 字节数
+             */
+            size_t length() const {
+                return last - first + 1;
+            }
+        };
+
+        // 解析结果
+        enum Result {
+            kInvalid,           // 语法错误、不是 bytes 单位、区间太多或者多个区间合并后是整个文件，忽略 Range，返回整个文件
+            kUnsatisfiable,     // 没有可以满足的区间，返回 416
+            kSatisfiable        // 至少有一个可以满足的区间，返回 206
+        };
+
+        static const size_t kMaxRanges = 16; // 最多支持的区间数，防止用大量的小区间放大响应
+
+        /**
+         * 解析 Range 请求头，如 "bytes=0-499, 500-, -100"
+         * @param value Range 请求头的值
+         * @param size 文件大小
+         * 多个区间时，重叠或者相邻的区间合并为一个，并按位置排序（RFC 7233 4.1），
+         * 防止用重叠的区间（如 16 个 "0-"）把响应放大为文件的很多倍。
+         * @param ranges 可以满足的区间（已限制在文件大小之内，合并且排序）
+         * @return 解析结果
+         */
+        static Result parse(const StringPiece &value, size_t size, std::vector<ByteRange> *ranges);
+
+    private:
+        /**
+         * 按起始位置排序，合并重叠或者相邻的区间
+         * @param ranges 区间，不能为空
+         * @return 合并之后的总字节数
+         */
+        static size_t coalesce(std::vector<ByteRange> *ranges);
+    };
+}
+
+#endif //TINYWS_HTTPRANGE_H
@@ -1,22 +1,80 @@
 #include "HttpRequest.h"
 
 #include <cassert>
-#include <cctype>
-
 #include <algorithm>
 
 using namespace tinyWS_thread;
 
+namespace {
+    // 可选的空白（OWS，RFC 7230 3.2.3）：空格和 HTAB。
+    // 请求头中的其他控制字符已经在查找行尾时被拒绝（HttpScanner::findControl()），不需要 ::isspace()（与 locale 有关的函数调用）
+    inline bool isOptionalWhitespace(char c) {
+        return c == ' ' || c == '\t';
+    }
+}
+
 HttpRequest::HttpRequest()
     : method_(kInvalid),
+      base_(nullptr),
+      extent_(0),
+      path_{0, 0},
+      query_{0, 0},
       receiveTime_(0) {
 
 }
 
+HttpRequest::HttpRequest(const HttpRequest &that)
+    : method_(that.method_),
+      base_(that.base_),
+      extent_(that.extent_),
+      path_(that.path_),
+      query_(that.query_),
+      receiveTime_(that.receiveTime_),
+      headers_(that.headers_),
+      headerIndex_(that.headerIndex_),
+      storage_(that.storage_) {
+    // 已经 materialize() 的请求指向自己的存储
+    if (that.base_ != nullptr && that.base_ == that.storage_.data()) {
+        base_ = storage_.data();
+    }
+}
+
+HttpRequest& HttpRequest::operator=(const HttpRequest &that) {
+    if (this != &that) {
+        HttpRequest copy(that);
+        swap(copy);
+    }
+    return *this;
+}
+
+void HttpRequest::setBase(const char *base) {
+    base_ = base;
+}
+
+void HttpRequest::materialize() {
+    if (base_ == nullptr || base_ == storage_.data()) {
+        return;
+    }
+    storage_.assign(base_, extent_);
+    base_ = storage_.data();
+}
+
+void HttpRequest::reset() {
+    method_ = kInvalid;
+    base_ = nullptr;
+    extent_ = 0;
+    path_ = {0, 0};
+    query_ = {0, 0};
+    receiveTime_ = 0;
+    headers_.clear();
+    headerIndex_.clear();
+    storage_.clear();
+}
+
 bool HttpRequest::setMethod(const char *start, const char *end) {
     assert(method_ == kInvalid);
 
-    std::string m(start, end);
+    StringPiece m(start, static_cast<size_t>(end - start));
     if (m == "GET") {
         method_ = kGet;
     } else if (m == "POST") {
@@ -64,19 +122,19 @@ const char* HttpRequest::methodString() const {
 }
 
 void HttpRequest::setPath(const char *start, const char *end) {
-    path_.assign(start, end);
+    path_ = makeSpan(start, end);
 }
 
-const std::string& HttpRequest::path() const {
-    return path_;
+StringPiece HttpRequest::path() const {
+    return piece(path_);
 }
 
 void HttpRequest::setQuery(const char *start, const char *end) {
-    query_.assign(start, end);
+    query_ = makeSpan(start, end);
 }
 
-const std::string& HttpRequest::query() const {
-    return query_;
+StringPiece HttpRequest::query() const {
+    return piece(query_);
 }
 
 void HttpRequest::setReceiveTime(Timer::TimeType time) {
@@ -88,38 +146,103 @@ Timer::TimeType HttpRequest::receiveTime() const {
 }
 
 void HttpRequest::addHeader(const char *start, const char *colon, const char *end) {
-    std::string field(start, colon);
+    const char *field = start;
+    const char *fieldEnd = colon;
     ++colon;
     // 跳过空格
-    while (colon < end && ::isspace(*colon)) {
+    while (colon < end && isOptionalWhitespace(*colon)) {
         ++colon;
     }
 
-    std::string value(colon, end);
-    while (!value.empty() && isspace(value[value.size() - 1])) {
-        value.resize(value.size() - 1);
+    const char *valueEnd = end;
+    while (valueEnd > colon && isOptionalWhitespace(valueEnd[-1])) {
+        --valueEnd;
     }
-    headers_[field] = value;
+    HttpHeader::Id id = HttpHeader::lookup(StringPiece(field, static_cast<size_t>(fieldEnd - field)));
+    headerIndex_.set(id, headers_.size());
+    headers_.push_back({makeSpan(field, fieldEnd), makeSpan(colon, valueEnd), id});
 }
 
-std::string HttpRequest::getHeader(const std::string &field) const {
-    std::string value;
-    auto it = headers_.find(field);
-    if (it != headers_.end()) {
-        value = it->second;
-    }
+StringPiece HttpRequest::getHeader(const StringPiece &field) const {
+    StringPiece value;
+    findHeader(field, &value);
+    return value;
+}
 
+StringPiece HttpRequest::getHeader(HttpHeader::Id id) const {
+    StringPiece value;
+    findHeader(id, &value);
     return value;
 }
 
-const std::map<std::string, std::string>& HttpRequest::headers() const {
-    return headers_;
+bool HttpRequest::findHeader(const StringPiece &field, StringPiece *value) const {
+    HttpHeader::Id id = HttpHeader::lookup(field);
+    if (id != HttpHeader::kUnknown) {
+        return findHeader(id, value);
+    }
+    // 不常用的请求头，从后往前比较名字
+    for (auto it = headers_.rbegin(); it != headers_.rend(); ++it) {
+        if (it->id == HttpHeader::kUnknown && HttpHeader::equalsIgnoreCase(piece(it->name), field)) {
+            *value = piece(it->value);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool HttpRequest::findHeader(HttpHeader::Id id, StringPiece *value) const {
+    size_t position;
+    if (!headerIndex_.find(id, &position)) {
+        return false;
+    }
+    *value = piece(headers_[position].value);
+    return true;
+}
+
+size_t HttpRequest::headerCount() const {
+    return headers_.size();
+}
+
+StringPiece HttpRequest::headerName(size_t i) const {
+    return piece(headers_[i].name);
+}
+
+StringPiece HttpRequest::headerValue(size_t i) const {
+    return piece(headers_[i].value);
+}
+
+HttpHeader::Id HttpRequest::headerId(size_t i) const {
+    return headers_[i].id;
 }
 
 void HttpRequest::swap(HttpRequest &that) {
+    // materialize() 之后 base_ 指向 storage_ 的数据，交换 std::string 时数据不一定跟着移动（短字符串优化），需要重新指向
+    bool materialized = base_ != nullptr && base_ == storage_.data();
+    bool thatMaterialized = that.base_ != nullptr && that.base_ == that.storage_.data();
     std::swap(method_, that.method_);
-    path_.swap(that.path_);
-    query_.swap(that.query_);
+    std::swap(base_, that.base_);
+    std::swap(extent_, that.extent_);
+    std::swap(path_, that.path_);
+    std::swap(query_, that.query_);
     std::swap(receiveTime_, that.receiveTime_);
     headers_.swap(that.headers_);
+    std::swap(headerIndex_, that.headerIndex_);
+    storage_.swap(that.storage_);
+    if (thatMaterialized) {
+        base_ = storage_.data();
+    }
+    if (materialized) {
+        that.base_ = that.storage_.data();
+    }
+}
+
+HttpRequest::Span HttpRequest::makeSpan(const char *start, const char *end) {
+    assert(base_ != nullptr && base_ <= start && start <= end);
+    Span span{static_cast<size_t>(start - base_), static_cast<size_t>(end - start)};
+    extent_ = std::max(extent_, span.offset + span.length);
+    return span;
+}
+
+StringPiece HttpRequest::piece(const Span &span) const {
+    return span.length == 0 ? StringPiece() : StringPiece(base_ + span.offset, span.length);
 }
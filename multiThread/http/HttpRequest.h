@@ -1,13 +1,23 @@
 #ifndef TINYWS_HTTPREQUEST_H
 #define TINYWS_HTTPREQUEST_H
 
+#include <cstddef>
 #include <string>
-#include <map>
+#include <vector>
 
+#include "../base/StringPiece.h"
 #include "../net/Timer.h"
+#include "HttpHeader.h"
 
 namespace tinyWS_thread {
     // 用于保存请求相关的信息：请求方法、请求路径、查询字段、接收请求的时间、请求头
+    //
+    // 请求路径、查询字段和请求头不复制，只记录相对于请求起始位置（base）的偏移和长度，
+    // base 在解析期间和 HttpCallback 中指向连接的输入缓冲区，所以解析一个普通的 GET 请求不需要分配内存
+    // （保存请求头的数组在连接的多个请求之间复用）。
+    // 请求头的名字不区分大小写，常用的请求头（HttpHeader::Id）用 HttpHeader::Index 直接定位（O(1)）。
+    // 视图只在 HttpCallback（和 BodyCallback）中有效，需要保存时用 StringPiece::asString() 复制，
+    // 或者用 materialize() 把请求行和请求头复制到 HttpRequest 自己的存储中。
     class HttpRequest {
     public:
         // 请求方法
@@ -17,6 +27,27 @@ namespace tinyWS_thread {
 
         HttpRequest();
 
+        HttpRequest(const HttpRequest &that);
+
+        HttpRequest& operator=(const HttpRequest &that);
+
+        /**
+         * 设置请求的起始位置，之后 setPath() 等函数的指针都在其之后。
+         * 缓冲区中的数据移动（如扩容）之后，需要用新的起始位置重新设置，已经记录的偏移不变。
+         * @param base 起始位置
+         */
+        void setBase(const char *base);
+
+        /**
+         * 把请求行和请求头复制到 HttpRequest 自己的存储中，之后视图不再依赖输入缓冲区
+         */
+        void materialize();
+
+        /**
+         * 清空请求（保留保存请求头的数组的容量，供下一个请求复用）
+         */
+        void reset();
+
         /**
          * 设置请求方法，并返回请求方法是否有效。
          * @param start 请求方法字符串的起始指针
@@ -46,9 +77,9 @@ namespace tinyWS_thread {
 
         /**
          * 获取请求路径
-         * @return 请求路径字符串
+         * @return 请求路径的视图
          */
-        const std::string& path() const;
+        StringPiece path() const;
 
         /**
          * 设置查询字段
@@ -59,9 +90,9 @@ namespace tinyWS_thread {
 
         /**
          * 获取查询字段
-         * @return 查询字段字符串
+         * @return 查询字段的视图（包括 ?）
          */
-        const std::string& query() const;
+        StringPiece query() const;
 
         /**
          * 设置请求接收时间
@@ -84,27 +115,99 @@ namespace tinyWS_thread {
         void addHeader(const char *start, const char *colon, const char *end);
 
         /**
-         * 获取特定请求头字段的值
+         * 获取特定请求头字段的值（不复制，名字不区分大小写），同名的请求头有多个时返回最后一个
          * @param field 名字
-         * @return 值
+         * @return 值的视图，不存在时为空
+         */
+        StringPiece getHeader(const StringPiece &field) const;
+
+        // 同上，常用的请求头
+        StringPiece getHeader(HttpHeader::Id id) const;
+
+        /**
+         * 查找请求头（不复制，名字不区分大小写），同名的请求头有多个时返回最后一个
+         * @param field 名字
+         * @param value 值的视图
+         * @return 是否存在
+         */
+        bool findHeader(const StringPiece &field, StringPiece *value) const;
+
+        /**
+         * 查找常用的请求头（O(1)），同名的请求头有多个时返回最后一个
+         * @param id 请求头的 Id
+         * @param value 值的视图
+         * @return 是否存在
          */
-        std::string getHeader(const std::string &field) const;
+        bool findHeader(HttpHeader::Id id, StringPiece *value) const;
 
         /**
-         * 获取所有请求头
-         * @return 请求头映射 <key, value>
+         * 获取请求头的个数
+         * @return 个数
          */
-        const std::map<std::string, std::string>& headers() const;
+        size_t headerCount() const;
+
+        /**
+         * 获取第 i 个请求头的名字
+         * @param i 下标，小于 headerCount()
+         * @return 名字的视图
+         */
+        StringPiece headerName(size_t i) const;
+
+        /**
+         * 获取第 i 个请求头的值
+         * @param i 下标，小于 headerCount()
+         * @return 值的视图
+         */
+        StringPiece headerValue(size_t i) const;
+
+        /**
+         * 获取第 i 个请求头的 Id
+         * @param i 下标，小于 headerCount()
+         * @return Id，不是常用的请求头时为 HttpHeader::kUnknown
+         */
+        HttpHeader::Id headerId(size_t i) const;
 
         // 交换
         void swap(HttpRequest &that);
 
     private:
+        // 相对于 base_ 的区域
+        struct Span {
+            size_t offset;  // 偏移
+            size_t length;  // 长度
+        };
+
+        // 请求头
+        struct Header {
+            Span name;          // 名字
+            Span value;         // 值
+            HttpHeader::Id id;  // 常用请求头的 Id，其他请求头为 HttpHeader::kUnknown
+        };
+
         Method method_;                                 // 请求方法
-        std::string path_;                              // 请求路径
-        std::string query_;                             // 查询字段
+        const char *base_;                              // 请求的起始位置（输入缓冲区或者 storage_）
+        size_t extent_;                                 // 视图覆盖的字节数（从 base_ 开始）
+        Span path_;                                     // 请求路径
+        Span query_;                                    // 查询字段
         Timer::TimeType receiveTime_;                   // 请求接收时间
-        std::map<std::string, std::string> headers_;    // 请求头映射 <key, value>
+        std::vector<Header> headers_;                   // 请求头，按出现的顺序
+        HttpHeader::Index headerIndex_;                 // 常用请求头在 headers_ 中的位置
+        std::string storage_;                           // materialize() 之后的请求行和请求头
+
+        /**
+         * 记录 [start, end) 相对于 base_ 的区域
+         * @param start 起始指针
+         * @param end 末尾指针
+         * @return 区域
+         */
+        Span makeSpan(const char *start, const char *end);
+
+        /**
+         * 获取区域的视图
+         * @param span 区域
+         * @return 视图
+         */
+        StringPiece piece(const Span &span) const;
     };
 }
 
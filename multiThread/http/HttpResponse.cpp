@@ -1,6 +1,8 @@
 #include "HttpResponse.h"
 
 #include <cstdio>
+#include <cstring>
+#include <utility>
 
 #include "../net/Buffer.h"
 
@@ -8,7 +10,7 @@ using namespace tinyWS_thread;
 
 HttpResponse::HttpResponse(bool close)
     : statusCode_(kUnknown),
-      closeConnection_(close){
+      closeConnection_(close) {
 
 }
 
@@ -29,20 +31,77 @@ bool HttpResponse::closeConnection() const {
 }
 
 void HttpResponse::setContentType(const std::string &contentType) {
-    addHeader("Content-Type", contentType);
+    addHeader(HttpHeader::kContentType, contentType);
 }
 
 void HttpResponse::addHeader(const std::string &key, const std::string &value) {
-    headers_[key] = value;
+    HttpHeader::Id id = HttpHeader::lookup(key);
+    if (id != HttpHeader::kUnknown) {
+        addHeader(id, value);
+        return;
+    }
+    for (auto &header : headers_) {
+        if (header.id == HttpHeader::kUnknown && HttpHeader::equalsIgnoreCase(header.name, key)) {
+            header.value = value;
+            return;
+        }
+    }
+    headers_.push_back({HttpHeader::kUnknown, key, value});
+}
+
+void HttpResponse::addHeader(HttpHeader::Id id, const std::string &value) {
+    size_t position;
+    if (headerIndex_.find(id, &position)) {
+        headers_[position].value = value;
+        return;
+    }
+    headerIndex_.set(id, headers_.size());
+    headers_.push_back({id, std::string(), value});
 }
 
 void HttpResponse::setBody(const std::string &body) {
     body_ = body;
 }
 
-void HttpResponse::appendToBuffer(Buffer *output) const {
+void HttpResponse::setBody(std::string &&body) {
+    body_ = std::move(body);
+}
+
+void HttpResponse::setFileBody(const FileHandlePtr &file, off_t offset, size_t length) {
+    body_.clear();
+    file_ = file;
+    fileRegions_.clear();
+    if (length > 0) {
+        fileRegions_.push_back({std::string(), offset, length});
+    }
+}
+
+void HttpResponse::addFileRegion(const std::string &prefix, off_t offset, size_t length) {
+    fileRegions_.push_back({prefix, offset, length});
+}
+
+void HttpResponse::setChunkedBody(const ChunkedWriter::Producer &producer) {
+    body_.clear();
+    file_.reset();
+    fileRegions_.clear();
+    chunkedProducer_ = producer;
+}
+
+const ChunkedWriter::Producer& HttpResponse::chunkedProducer() const {
+    return chunkedProducer_;
+}
+
+const FileHandlePtr& HttpResponse::file() const {
+    return file_;
+}
+
+const std::vector<HttpResponse::FileRegion>& HttpResponse::fileRegions() const {
+    return fileRegions_;
+}
+
+void HttpResponse::appendToBuffer(Buffer *output, bool headOnly) const {
     // 响应行：请求方法 路径 HTTP/版本
-    char buf[32];
+    char buf[64];
     snprintf(buf, sizeof(buf), "HTTP/1.1 %d ", statusCode_);
 
     output->append(buf);
@@ -50,22 +109,44 @@ void HttpResponse::appendToBuffer(Buffer *output) const {
     output->append("\r\n");
 
     // 添加响应头
+    if (statusCode_ == k304NotModified) {
+        // 304 没有 Body
+    } else if (chunkedProducer_) {
+        // 流式 Body 的长度事先未知
+        output->append("Transfer-Encoding: chunked\r\n");
+    } else {
+        size_t contentLength = body_.size();
+        if (file_) {
+            contentLength = 0;
+            for (const auto &region : fileRegions_) {
+                contentLength += region.prefix.size() + region.length;
+            }
+        }
+        snprintf(buf, sizeof(buf), "Content-Length: %zu\r\n", contentLength);
+        output->append(buf);
+    }
     if (closeConnection_) {
         // 关闭连接
         output->append("Connection: close\r\n");
     } else {
-        snprintf(buf, sizeof(buf), "Content-Length: %zd\r\n", body_.size());
-        output->append(buf);
         output->append("Connection: Keep-Alive\r\n");
     }
 
     for (const auto &header : headers_) {
-        output->append(header.first);
+        if (header.id != HttpHeader::kUnknown) {
+            const char *name = HttpHeader::name(header.id);
+            output->append(name, ::strlen(name));
+        } else {
+            output->append(header.name);
+        }
         output->append(": ");
-        output->append(header.second);
+        output->append(header.value);
         output->append("\r\n");
     }
 
     output->append("\r\n");
-    output->append(body_);
+    if (!headOnly) {
+        // HEAD 的响应没有 Body，否则 keep-alive 连接上的下一个响应会错位
+        output->append(body_);
+    }
 }
@@ -1,8 +1,14 @@
 #ifndef TINYWS_HTTPRESPONSE_H
 #define TINYWS_HTTPRESPONSE_H
 
-#include <map>
+#include <sys/types.h>
+
 #include <string>
+#include <vector>
+
+#include "../net/FileHandle.h"
+#include "ChunkedWriter.h"
+#include "HttpHeader.h"
 
 namespace tinyWS_thread {
     class Buffer;
@@ -13,9 +19,19 @@ namespace tinyWS_thread {
         enum HttpStatusCode {
             kUnknown,
             k200OK = 200,
+            k206PartialContent = 206,
             k301MovedPermanently = 301,
+            k304NotModified = 304,
             k400BadRequest  = 400,
-            k404NotFound = 404
+            k404NotFound = 404,
+            k416RangeNotSatisfiable = 416
+        };
+
+        // 作为 Response Body 的文件区域，prefix 在区域之前发送（如 multipart/byteranges 每个部分的分隔符和头部）
+        struct FileRegion {
+            std::string prefix; // 区域之前的数据
+            off_t offset;       // 区域在文件中的起始位置
+            size_t length;      // 区域的长度，可以为 0（只发送 prefix）
         };
 
         /**
@@ -55,12 +71,19 @@ namespace tinyWS_thread {
         void setContentType(const std::string &contentType);
 
         /**
-         * 添加响应头
+         * 添加响应头，已经有同名（不区分大小写）的响应头时替换它的值
          * @param key
          * @param value
          */
         void addHeader(const std::string &key, const std::string & value);
 
+        /**
+         * 添加常用的响应头（按 Id 直接定位，不需要比较名字），已经有时替换它的值
+         * @param id 响应头的 Id
+         * @param value
+         */
+        void addHeader(HttpHeader::Id id, const std::string &value);
+
         /**
          * 设置 Response Body
          * @param body Response Body 字符串
@@ -68,17 +91,81 @@ namespace tinyWS_thread {
         void setBody(const std::string &body);
 
         /**
-         * 将响应数据（包括响应头和 Body）添加到 Buffer 中
+         * 设置 Response Body，不复制数据
+         * @param body Response Body 字符串，调用后内容不确定
+         */
+        void setBody(std::string &&body);
+
+        /**
+         * 设置文件区域作为 Response Body，由 HttpServer 用 sendfile(2) 发送，不读入内存
+         * @param file 文件
+         * @param offset 区域在文件中的起始位置
+         * @param length 区域的长度
+         */
+        void setFileBody(const FileHandlePtr &file, off_t offset, size_t length);
+
+        /**
+         * 在作为 Response Body 的文件区域之后再添加一个区域（用于 multipart/byteranges），
+         * 第一次调用前需要先调用 setFileBody() 设置文件，或者直接用 setFileBody(file, 0, 0) 开始
+         * @param prefix 区域之前的数据
+         * @param offset 区域在文件中的起始位置
+         * @param length 区域的长度
+         */
+        void addFileRegion(const std::string &prefix, off_t offset, size_t length);
+
+        /**
+         * 设置流式的 Response Body：响应头带 Transfer-Encoding: chunked（没有 Content-Length），
+         * 发送响应头之后由 HttpServer 用 ChunkedWriter 反复调用 producer 生成 Body，输出队列达到高水位时暂停。
+         * 用于事先不知道长度或者太大不适合放在内存中的 Body。
+         * @param producer 生成 Body 的回调函数，见 ChunkedWriter::Producer
+         */
+        void setChunkedBody(const ChunkedWriter::Producer &producer);
+
+        /**
+         * 获取生成流式 Response Body 的回调函数，不是流式 Body 时为空
+         * @return 回调函数
+         */
+        const ChunkedWriter::Producer& chunkedProducer() const;
+
+        /**
+         * 获取作为 Response Body 的文件，没有时返回 nullptr
+         * @return 文件
+         */
+        const FileHandlePtr& file() const;
+
+        /**
+         * 获取作为 Response Body 的文件区域
+         * @return 文件区域，按发送顺序
+         */
+        const std::vector<FileRegion>& fileRegions() const;
+
+        /**
+         * 将响应数据（包括响应头和 Body）添加到 Buffer 中。
+         * Body 为文件时只添加响应头，文件区域（及其 prefix）由调用者按顺序发送。
+         * 流式 Body 时只添加响应头（带 Transfer-Encoding: chunked）。
+         * 状态码为 304 时没有 Content-Length。
          * @param output 数据指针
+         * @param headOnly 是否只添加响应头（HEAD 请求），Content-Length 仍然是完整 Body 的长度
          */
-        void appendToBuffer(Buffer *output) const;
+        void appendToBuffer(Buffer *output, bool headOnly = false) const;
 
     private:
-        std::map<std::string, std::string> headers_;    // 响应头映射 <key, value>
+        // 响应头
+        struct Header {
+            HttpHeader::Id id;  // 常用响应头的 Id，其他响应头为 HttpHeader::kUnknown
+            std::string name;   // 名字（常用响应头为空，使用 HttpHeader::name()）
+            std::string value;  // 值
+        };
+
+        std::vector<Header> headers_;                   // 响应头，按添加的顺序
+        HttpHeader::Index headerIndex_;                 // 常用响应头在 headers_ 中的位置
         HttpStatusCode statusCode_;                     // 状态码
         std::string statusMessage_;                     // 状态信息
         bool closeConnection_;                          // 是否将 Connection 字段设置为 close
         std::string body_;                              // Response Body
+        FileHandlePtr file_;                            // 作为 Response Body 的文件（为空时使用 body_）
+        std::vector<FileRegion> fileRegions_;           // 作为 Response Body 的文件区域
+        ChunkedWriter::Producer chunkedProducer_;       // 生成流式 Response Body 的回调函数
     };
 }
 
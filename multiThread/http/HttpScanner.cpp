@@ -0,0 +1,376 @@
+#include "HttpScanner.h"
+
+#include <cstdint>
+#include <cstring>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define TINYWS_SCANNER_X86 1
+#include <immintrin.h>
+#else
+#define TINYWS_SCANNER_X86 0
+#endif
+
+using namespace tinyWS_thread;
+
+namespace {
+    // 字符的类别（位），一个字符可以属于多个类别
+    enum CharClass {
+        kControl = 1,           // 除 HTAB 之外的控制字符
+        kTargetDelimiter = 2,   // 请求目标的分隔符：'?'、空格、控制字符
+        kNonToken = 4           // 不是 tchar
+    };
+
+    // tchar = "!" / "#" / "$" / "%" / "&" / "'" / "*" / "+" / "-" / "." / "^" / "_" / "`" / "|" / "~" / DIGIT / ALPHA
+    constexpr bool isTokenChar(unsigned c) {
+        return (c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') ||
+               c == '!' || c == '#' || c == '$' || c == '%' || c == '&' || c == '\'' || c == '*' || c == '+' ||
+               c == '-' || c == '.' || c == '^' || c == '_' || c == '`' || c == '|' || c == '~';
+    }
+
+    constexpr unsigned char charClass(unsigned c) {
+        return static_cast<unsigned char>(((c < 0x20 && c != '\t') || c == 0x7f ? kControl : 0) |
+                                          (c <= 0x20 || c == '?' || c == 0x7f ? kTargetDelimiter : 0) |
+                                          (isTokenChar(c) ? 0 : kNonToken));
+    }
+
+#define TINYWS_CLASS4(c) charClass(c), charClass(c + 1), charClass(c + 2), charClass(c + 3)
+#define TINYWS_CLASS16(c) TINYWS_CLASS4(c), TINYWS_CLASS4(c + 4), TINYWS_CLASS4(c + 8), TINYWS_CLASS4(c + 12)
+#define TINYWS_CLASS64(c) TINYWS_CLASS16(c), TINYWS_CLASS16(c + 16), TINYWS_CLASS16(c + 32), TINYWS_CLASS16(c + 48)
+
+    // 每个字符的类别，在编译期生成
+    constexpr unsigned char kClasses[256] = {
+            TINYWS_CLASS64(0), TINYWS_CLASS64(64), TINYWS_CLASS64(128), TINYWS_CLASS64(192)
+    };
+
+#undef TINYWS_CLASS64
+#undef TINYWS_CLASS16
+#undef TINYWS_CLASS4
+
+    /**
+     * 查表实现：逐个字节查找第一个属于 charClass 的字符
+     * @param begin 起始指针
+     * @param end 末尾指针
+     * @return 字符的指针，没有时为 end
+     */
+    template <unsigned char charClass>
+    const char* scanTable(const char *begin, const char *end) {
+        while (begin < end && (kClasses[static_cast<unsigned char>(*begin)] & charClass) == 0) {
+            ++begin;
+        }
+        return begin;
+    }
+
+    // 标量实现每次检查 8 个字节（SWAR）：用整数运算找出 8 个字节中可能属于类别的字节（候选字节），只对第一个候选字节查表。
+    // 请求头的值（Cookie、User-Agent 等）占了请求的大部分，都由 findControl() 扫描。
+
+    const uint64_t kOnes = 0x0101010101010101ULL;
+    const uint64_t kLows = 0x7f7f7f7f7f7f7f7fULL;
+    const uint64_t kHighs = 0x8080808080808080ULL;
+
+    // 小于 n（n <= 0x80）的字节的最高位为 1。最低的为 1 的字节是准确的，更高的字节可能因为借位而误报
+    inline uint64_t bytesLess(uint64_t word, unsigned n) {
+        return (word - kOnes * n) & ~word & kHighs;
+    }
+
+    // 等于 c 的字节的最高位为 1（同上）
+    inline uint64_t bytesEqual(uint64_t word, unsigned c) {
+        return bytesLess(word ^ (kOnes * c), 1);
+    }
+
+    // 等于 c 的字节的最高位为 1，每个字节都是准确的（字节之间没有进位）
+    inline uint64_t bytesEqualExact(uint64_t word, unsigned c) {
+        uint64_t v = word ^ (kOnes * c);
+        return ~(((v & kLows) + kLows) | v) & kHighs;
+    }
+
+    // findControl() 的候选字节：小于 0x20 或者是 DEL，包括 HTAB（查表时排除）
+    struct ControlCandidates {
+        static uint64_t get(uint64_t word) {
+            return bytesLess(word, 0x20) | bytesEqual(word, 0x7f);
+        }
+    };
+
+    // findTargetDelimiter() 的候选字节：不大于 0x20、'?'、DEL
+    struct TargetDelimiterCandidates {
+        static uint64_t get(uint64_t word) {
+            return bytesLess(word, 0x21) | bytesEqual(word, '?') | bytesEqual(word, 0x7f);
+        }
+    };
+
+    // findNonToken() 的候选字节：除字母和 '-' 之外的字节（头部名字通常只由它们组成，其他 tchar 查表时排除）
+    struct NonTokenCandidates {
+        static uint64_t get(uint64_t word) {
+            // 转为小写并清除最高位，每个字节加上常数时不会向更高的字节进位
+            uint64_t lower = (word | kOnes * 0x20) & kLows;
+            uint64_t atLeastA = (lower + kOnes * (0x80 - 'a')) & kHighs;
+            uint64_t aboveZ = (lower + kOnes * (0x80 - 'z' - 1)) & kHighs;
+            uint64_t letter = atLeastA & ~aboveZ & ~word;
+            return ~(letter | bytesEqualExact(word, '-')) & kHighs;
+        }
+    };
+
+    /**
+     * 标量实现：查找第一个属于 charClass 的字符。
+     * 每次读取 16 个字节（两个 8 个字节的字），最低的候选字节就是第一个（小端）；
+     * 剩下不足 16 个字节时每次读取 8 个字节，不足 8 个字节时读取最后 8 个字节（与已经检查过的字节重叠）。
+     * @param begin 起始指针
+     * @param end 末尾指针
+     * @return 字符的指针，没有时为 end
+     */
+    template <unsigned char charClass, class Candidates>
+    const char* scanScalar(const char *begin, const char *end) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        while (end - begin >= 8) {
+            uint64_t words[2];
+            const char *found;
+            if (end - begin >= 16) {
+                std::memcpy(words, begin, sizeof(words));
+                uint64_t first = Candidates::get(words[0]);
+                uint64_t second = Candidates::get(words[1]);
+                if ((first | second) == 0) {
+                    begin += 16;
+                    continue;
+                }
+                found = first != 0 ? begin + __builtin_ctzll(first) / 8 : begin + 8 + __builtin_ctzll(second) / 8;
+            } else {
+                std::memcpy(words, begin, sizeof(words[0]));
+                uint64_t candidates = Candidates::get(words[0]);
+                if (candidates == 0) {
+                    if (end - begin == 8) {
+                        return end;
+                    }
+                    begin = end - 8;
+                    continue;
+                }
+                found = begin + __builtin_ctzll(candidates) / 8;
+            }
+            if ((kClasses[static_cast<unsigned char>(*found)] & charClass) != 0) {
+                return found;
+            }
+            // 不属于类别的候选字节（如 HTAB），从下一个字节继续
+            begin = found + 1;
+        }
+#endif
+        return scanTable<charClass>(begin, end);
+    }
+
+    const char* findControlScalar(const char *begin, const char *end) {
+        return scanScalar<kControl, ControlCandidates>(begin, end);
+    }
+
+    const char* findTargetDelimiterScalar(const char *begin, const char *end) {
+        return scanScalar<kTargetDelimiter, TargetDelimiterCandidates>(begin, end);
+    }
+
+    const char* findNonTokenScalar(const char *begin, const char *end) {
+        return scanScalar<kNonToken, NonTokenCandidates>(begin, end);
+    }
+
+#if TINYWS_SCANNER_X86
+    // 向量实现判断 tchar 的方法：tchar 的高 4 位只能是 2 ~ 7，
+    // kTokenLow[低 4 位] 的第 n 位表示高 4 位为 n 的字符是否为 tchar，kTokenHigh[高 4 位] 为 1 << 高 4 位（高 4 位不小于 8 时为 0），
+    // 两次查表（pshufb）的结果按位与，不为 0 时是 tchar。
+
+    constexpr unsigned tokenBits(unsigned low, unsigned high) {
+        return high == 8 ? 0 : ((isTokenChar(high << 4 | low) ? 1u << high : 0) | tokenBits(low, high + 1));
+    }
+
+#define TINYWS_TOKEN4(low) static_cast<char>(tokenBits(low, 0)), static_cast<char>(tokenBits(low + 1, 0)), \
+                           static_cast<char>(tokenBits(low + 2, 0)), static_cast<char>(tokenBits(low + 3, 0))
+
+    alignas(16) constexpr char kTokenLow[16] = {
+            TINYWS_TOKEN4(0), TINYWS_TOKEN4(4), TINYWS_TOKEN4(8), TINYWS_TOKEN4(12)
+    };
+
+#undef TINYWS_TOKEN4
+
+    alignas(16) constexpr char kTokenHigh[16] = {
+            1, 2, 4, 8, 16, 32, 64, static_cast<char>(128), 0, 0, 0, 0, 0, 0, 0, 0
+    };
+
+    // SSE4.2 的 pcmpestri 按范围匹配（每两个字节是一个闭区间）
+    alignas(16) constexpr char kControlRanges[16] = {
+            '\x00', '\x08', '\x0a', '\x1f', '\x7f', '\x7f'
+    };
+    alignas(16) constexpr char kTargetRanges[16] = {
+            '\x00', '\x20', '?', '?', '\x7f', '\x7f'
+    };
+
+    /**
+     * SSE4.2 实现：查找第一个属于 ranges 中任意一个区间的字符
+     * @param ranges 区间
+     * @param length ranges 的有效字节数
+     */
+    template <unsigned char charClass, class Candidates>
+    __attribute__((target("sse4.2")))
+    const char* scanRangesSse42(const char *begin, const char *end, const char *ranges, int length) {
+        const __m128i r = _mm_load_si128(reinterpret_cast<const __m128i*>(ranges));
+        for (; end - begin >= 16; begin += 16) {
+            __m128i data = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+            int index = _mm_cmpestri(r, length, data, 16,
+                                     _SIDD_UBYTE_OPS | _SIDD_CMP_RANGES | _SIDD_LEAST_SIGNIFICANT);
+            if (index != 16) {
+                return begin + index;
+            }
+        }
+        return scanScalar<charClass, Candidates>(begin, end);
+    }
+
+    __attribute__((target("sse4.2")))
+    const char* findControlSse42(const char *begin, const char *end) {
+        return scanRangesSse42<kControl, ControlCandidates>(begin, end, kControlRanges, 6);
+    }
+
+    __attribute__((target("sse4.2")))
+    const char* findTargetDelimiterSse42(const char *begin, const char *end) {
+        return scanRangesSse42<kTargetDelimiter, TargetDelimiterCandidates>(begin, end, kTargetRanges, 6);
+    }
+
+    // tchar 有 9 个区间，超过了 pcmpestri 的 8 个，用 pshufb 查表
+    __attribute__((target("sse4.2")))
+    const char* findNonTokenSse42(const char *begin, const char *end) {
+        const __m128i low = _mm_load_si128(reinterpret_cast<const __m128i*>(kTokenLow));
+        const __m128i high = _mm_load_si128(reinterpret_cast<const __m128i*>(kTokenHigh));
+        const __m128i mask = _mm_set1_epi8(0x0f);
+        for (; end - begin >= 16; begin += 16) {
+            __m128i data = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+            // 最高位为 1 的字节（>= 0x80）pshufb 的结果为 0，不是 tchar
+            __m128i bits = _mm_and_si128(_mm_shuffle_epi8(low, data),
+                                         _mm_shuffle_epi8(high, _mm_and_si128(_mm_srli_epi16(data, 4), mask)));
+            int nonToken = _mm_movemask_epi8(_mm_cmpeq_epi8(bits, _mm_setzero_si128()));
+            if (nonToken != 0) {
+                return begin + __builtin_ctz(static_cast<unsigned>(nonToken));
+            }
+        }
+        return findNonTokenScalar(begin, end);
+    }
+
+    // 不足 kAvx2MinLength 个字节时 AVX2 的循环最多执行一次，直接使用 SSE4.2 实现（此时还没有使用 ymm 寄存器，不需要 vzeroupper）。
+    // AVX2 实现剩下不足 32 个字节时，也用 SSE4.2 实现处理。
+    // SSE4.2 实现是非 VEX 编码的指令，使用过 ymm 寄存器之后调用之前必须清除 ymm 寄存器的高 128 位（vzeroupper），
+    // 否则每条 SSE 指令都有 AVX-SSE 切换的开销（GCC 尾调用时不会自动插入）。
+    const long kAvx2MinLength = 64;
+
+    __attribute__((target("avx2")))
+    const char* findControlAvx2(const char *begin, const char *end) {
+        if (end - begin < kAvx2MinLength) {
+            return findControlSse42(begin, end);
+        }
+        const __m256i unit = _mm256_set1_epi8(0x1f);
+        const __m256i tab = _mm256_set1_epi8('\t');
+        const __m256i del = _mm256_set1_epi8(0x7f);
+        for (; end - begin >= 32; begin += 32) {
+            __m256i data = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(begin));
+            // data <= 0x1f（无符号）且不是 HTAB，或者是 DEL
+            __m256i control = _mm256_cmpeq_epi8(_mm256_min_epu8(data, unit), data);
+            control = _mm256_andnot_si256(_mm256_cmpeq_epi8(data, tab), control);
+            control = _mm256_or_si256(control, _mm256_cmpeq_epi8(data, del));
+            unsigned found = static_cast<unsigned>(_mm256_movemask_epi8(control));
+            if (found != 0) {
+                return begin + __builtin_ctz(found);
+            }
+        }
+        _mm256_zeroupper();
+        return findControlSse42(begin, end);
+    }
+
+    __attribute__((target("avx2")))
+    const char* findTargetDelimiterAvx2(const char *begin, const char *end) {
+        if (end - begin < kAvx2MinLength) {
+            return findTargetDelimiterSse42(begin, end);
+        }
+        const __m256i space = _mm256_set1_epi8(0x20);
+        const __m256i question = _mm256_set1_epi8('?');
+        const __m256i del = _mm256_set1_epi8(0x7f);
+        for (; end - begin >= 32; begin += 32) {
+            __m256i data = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(begin));
+            // data <= 0x20（无符号），或者是 '?'、DEL
+            __m256i delimiter = _mm256_cmpeq_epi8(_mm256_min_epu8(data, space), data);
+            delimiter = _mm256_or_si256(delimiter, _mm256_cmpeq_epi8(data, question));
+            delimiter = _mm256_or_si256(delimiter, _mm256_cmpeq_epi8(data, del));
+            unsigned found = static_cast<unsigned>(_mm256_movemask_epi8(delimiter));
+            if (found != 0) {
+                return begin + __builtin_ctz(found);
+            }
+        }
+        _mm256_zeroupper();
+        return findTargetDelimiterSse42(begin, end);
+    }
+
+    __attribute__((target("avx2")))
+    const char* findNonTokenAvx2(const char *begin, const char *end) {
+        if (end - begin < kAvx2MinLength) {
+            return findNonTokenSse42(begin, end);
+        }
+        // pshufb 在每 128 位内查表，两半使用同一张表
+        const __m256i low = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(kTokenLow)));
+        const __m256i high = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(kTokenHigh)));
+        const __m256i mask = _mm256_set1_epi8(0x0f);
+        for (; end - begin >= 32; begin += 32) {
+            __m256i data = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(begin));
+            __m256i bits = _mm256_and_si256(_mm256_shuffle_epi8(low, data),
+                                            _mm256_shuffle_epi8(high, _mm256_and_si256(_mm256_srli_epi16(data, 4), mask)));
+            unsigned nonToken = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(bits, _mm256_setzero_si256())));
+            if (nonToken != 0) {
+                return begin + __builtin_ctz(nonToken);
+            }
+        }
+        _mm256_zeroupper();
+        return findNonTokenSse42(begin, end);
+    }
+#endif
+
+    // 一种实现的扫描函数
+    struct Scanner {
+        const char* (*findControl)(const char*, const char*);
+        const char* (*findTargetDelimiter)(const char*, const char*);
+        const char* (*findNonToken)(const char*, const char*);
+    };
+
+    // 按 HttpScanner::Level 排列，不是 x86 时只有标量实现
+    const Scanner kScanners[] = {
+            {findControlScalar, findTargetDelimiterScalar, findNonTokenScalar},
+#if TINYWS_SCANNER_X86
+            {findControlSse42, findTargetDelimiterSse42, findNonTokenSse42},
+            {findControlAvx2, findTargetDelimiterAvx2, findNonTokenAvx2}
+#endif
+    };
+
+    HttpScanner::Level gLevel = HttpScanner::detect();     // 正在使用的实现
+}
+
+const char* HttpScanner::findControl(const char *begin, const char *end) {
+    return kScanners[gLevel].findControl(begin, end);
+}
+
+const char* HttpScanner::findTargetDelimiter(const char *begin, const char *end) {
+    return kScanners[gLevel].findTargetDelimiter(begin, end);
+}
+
+const char* HttpScanner::findNonToken(const char *begin, const char *end) {
+    return kScanners[gLevel].findNonToken(begin, end);
+}
+
+HttpScanner::Level HttpScanner::level() {
+    return gLevel;
+}
+
+HttpScanner::Level HttpScanner::detect() {
+#if TINYWS_SCANNER_X86
+    // 可能在其他全局变量初始化时调用，先初始化 CPU 信息
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return kAvx2;
+    }
+    if (__builtin_cpu_supports("sse4.2")) {
+        return kSse42;
+    }
+#endif
+    return kScalar;
+}
+
+HttpScanner::Level HttpScanner::setLevel(Level level) {
+    Level supported = detect();
+    gLevel = level > supported ? supported : level;
+    return gLevel;
+}
@@ -0,0 +1,65 @@
+#ifndef TINYWS_HTTPSCANNER_H
+#define TINYWS_HTTPSCANNER_H
+
+namespace tinyWS_thread {
+    // 请求行和请求头的字符扫描：查找分隔符，同时检查字符是否合法（RFC 7230）。
+    //
+    // 有标量（每次 8 个字节）、SSE4.2（每次 16 个字节）和 AVX2（每次 32 个字节）三种实现，结果完全相同，
+    // 第一次使用之前按 CPU 支持的指令集选择最快的一种（运行时分派），编译时不需要 -msse4.2 / -mavx2。
+    // 向量实现每次读取完整的 16 / 32 个字节，剩下不足一次的字节由标量实现处理，所以不会读取 [begin, end) 之外的数据。
+    class HttpScanner {
+    public:
+        // 实现（指令集）
+        enum Level {
+            kScalar,    // 标量，整数运算（SWAR）和查表
+            kSse42,     // SSE4.2
+            kAvx2       // AVX2
+        };
+
+        /**
+         * 查找第一个除 HTAB 之外的控制字符（0x00 ~ 0x1f、0x7f），用于查找行尾（"\r\n"）并检查行中没有非法字符
+         * @param begin 起始指针
+         * @param end 末尾指针
+         * @return 控制字符的指针，没有时为 end
+         */
+        static const char* findControl(const char *begin, const char *end);
+
+        /**
+         * 查找请求目标（路径和查询字符串）的第一个分隔符：'?'、空格、控制字符
+         * @param begin 起始指针
+         * @param end 末尾指针
+         * @return 分隔符的指针，没有时为 end
+         */
+        static const char* findTargetDelimiter(const char *begin, const char *end);
+
+        /**
+         * 查找第一个不是 token 字符（tchar，请求方法和头部名字由 tchar 组成）的字符
+         * @param begin 起始指针
+         * @param end 末尾指针
+         * @return 字符的指针，没有时为 end
+         */
+        static const char* findNonToken(const char *begin, const char *end);
+
+        /**
+         * 获取正在使用的实现
+         * @return 实现
+         */
+        static Level level();
+
+        /**
+         * CPU 支持的最快的实现
+         * @return 实现
+         */
+        static Level detect();
+
+        /**
+         * 指定使用的实现（如比较各实现的性能），超过 detect() 时使用 detect()。
+         * 只能在启动时（还没有开始解析请求时）调用。
+         * @param level 实现
+         * @return 实际使用的实现
+         */
+        static Level setLevel(Level level);
+    };
+}
+
+#endif //TINYWS_HTTPSCANNER_H
@@ -1,21 +1,268 @@
 #include "HttpServer.h"
 
+#include <strings.h> // strncasecmp
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <random>
+
+#include "../net/EventLoop.h"
+#include "ChunkedWriter.h"
+#include "ConnectionReaper.h"
 #include "HttpContext.h"
+#include "HttpRange.h"
 #include "HttpRequest.h"
 #include "HttpResponse.h"
 
 using namespace std::placeholders;
 using namespace tinyWS_thread;
 
+const size_t HttpServer::kMaxStreamingInput;
+
+namespace {
+    /**
+     * 请求是否有某个请求头
+     * @param httpRequest 请求
+     * @param id 请求头的 Id
+     * @return true / false
+     */
+    bool hasHeader(const HttpRequest &httpRequest, HttpHeader::Id id) {
+        StringPiece value;
+        return httpRequest.findHeader(id, &value);
+    }
+
+    /**
+     * 解析 HTTP-date（只支持 IMF-fixdate，如 Sun, 06 Nov 1994 08:49:37 GMT）
+     * @param value 字符串
+     * @param time 时间
+     * @return 是否解析成功
+     */
+    bool parseHttpDate(const StringPiece &value, time_t *time) {
+        // strptime() 需要以 '\0' 结尾的字符串，IMF-fixdate 固定为 29 个字符
+        char buf[64];
+        if (value.size() >= sizeof(buf)) {
+            return false;
+        }
+        ::memcpy(buf, value.data(), value.size());
+        buf[value.size()] = '\0';
+
+        struct tm tm{};
+        const char *end = ::strptime(buf, "%a, %d %b %Y %H:%M:%S GMT", &tm);
+        if (end == nullptr || *end != '\0') {
+            return false;
+        }
+        *time = ::timegm(&tm);
+        return true;
+    }
+
+    /**
+     * 跳过 [p, end) 开头的空白字符
+     * @param p 起始位置
+     * @param end 结束位置
+     * @return 第一个非空白字符的位置
+     */
+    const char* skipSpaces(const char *p, const char *end) {
+        while (p < end && (*p == ' ' || *p == '\t')) {
+            ++p;
+        }
+        return p;
+    }
+
+    /**
+     * If-None-Match 中是否有与 etag 匹配的实体标签（弱比较，RFC 7232 2.3.2）
+     * @param value If-None-Match 的值，如 "a", W/"b" 或者 *
+     * @param etag 文件的 ETag
+     * @return true / false
+     */
+    bool etagListMatches(const StringPiece &value, const std::string &etag) {
+        const char *p = value.begin();
+        const char *end = value.end();
+        while (p < end) {
+            while (p < end && (*p == ' ' || *p == '\t' || *p == ',')) {
+                ++p;
+            }
+            if (p == end) {
+                break;
+            }
+            if (*p == '*') {
+                return true;
+            }
+            if (StringPiece(p, static_cast<size_t>(end - p)).startsWith("W/")) {
+                p += 2;
+            }
+            const char *comma = std::find(p, end, ',');
+            const char *tagEnd = comma;
+            while (tagEnd > p && (tagEnd[-1] == ' ' || tagEnd[-1] == '\t')) {
+                --tagEnd;
+            }
+            if (StringPiece(p, static_cast<size_t>(tagEnd - p)) == etag) {
+                return true;
+            }
+            p = comma;
+        }
+        return false;
+    }
+
+    /**
+     * 文件是否没有修改：If-None-Match 优先，没有 If-None-Match 时使用 If-Modified-Since（RFC 7232 6）
+     * @param httpRequest 请求
+     * @param entry 文件
+     * @return 是否可以返回 304
+     */
+    bool notModified(const HttpRequest &httpRequest, const FileCache::Entry &entry) {
+        StringPiece ifNoneMatch;
+        if (httpRequest.findHeader(HttpHeader::kIfNoneMatch, &ifNoneMatch)) {
+            return etagListMatches(ifNoneMatch, entry.etag);
+        }
+        StringPiece ifModifiedSince;
+        time_t since;
+        return httpRequest.findHeader(HttpHeader::kIfModifiedSince, &ifModifiedSince) &&
+               parseHttpDate(ifModifiedSince, &since) &&
+               entry.modifyTime.tv_sec <= since;
+    }
+
+    /**
+     * If-Range 是否与文件匹配（不匹配时忽略 Range，返回整个文件）：
+     * 实体标签使用强比较，日期必须与 Last-Modified 相同（RFC 7233 3.2）
+     * @param httpRequest 请求
+     * @param entry 文件
+     * @return true / false
+     */
+    bool ifRangeMatches(const HttpRequest &httpRequest, const FileCache::Entry &entry) {
+        StringPiece ifRange;
+        if (!httpRequest.findHeader(HttpHeader::kIfRange, &ifRange)) {
+            return true;
+        }
+        if (!ifRange.empty() && (ifRange[0] == '"' || ifRange.startsWith("W/"))) {
+            return ifRange == entry.etag;
+        }
+        time_t date;
+        return parseHttpDate(ifRange, &date) && date == entry.modifyTime.tv_sec;
+    }
+
+    /**
+     * Accept-Encoding 是否接受某种编码：编码或者 * 出现在列表中且 q 不为 0，编码本身的 q 优先于 *
+     * @param acceptEncoding Accept-Encoding 的值，如 "gzip, deflate, br;q=0.8"
+     * @param coding 编码（小写）
+     * @return true / false
+     */
+    bool acceptsEncoding(const StringPiece &acceptEncoding, const char *coding) {
+        size_t codingLength = ::strlen(coding);
+        int wildcard = -1;  // * 是否接受，-1 表示没有出现
+        const char *p = acceptEncoding.begin();
+        const char *end = acceptEncoding.end();
+        while (p < end) {
+            const char *itemEnd = std::find(p, end, ',');
+            const char *begin = skipSpaces(p, itemEnd);
+            const char *tokenEnd = begin;
+            while (tokenEnd < itemEnd && *tokenEnd != ' ' && *tokenEnd != '\t' && *tokenEnd != ';') {
+                ++tokenEnd;
+            }
+            if (begin < itemEnd) {
+                // q=0（包括 0.0、0.00 等）表示不接受：qvalue 中有非 0 的数字才接受
+                bool accepted = true;
+                StringPiece parameters(tokenEnd, static_cast<size_t>(itemEnd - tokenEnd));
+                size_t q = parameters.find("q=");
+                if (q != StringPiece::npos) {
+                    accepted = false;
+                    for (const char *digit = parameters.begin() + q + 2;
+                         digit < itemEnd && (::isdigit(static_cast<unsigned char>(*digit)) || *digit == '.');
+                         ++digit) {
+                        accepted = accepted || (*digit >= '1' && *digit <= '9');
+                    }
+                }
+                size_t tokenLength = static_cast<size_t>(tokenEnd - begin);
+                if (tokenLength == codingLength && ::strncasecmp(begin, coding, codingLength) == 0) {
+                    return accepted;
+                }
+                if (tokenLength == 1 && *begin == '*') {
+                    wildcard = accepted ? 1 : 0;
+                }
+            }
+            p = itemEnd == end ? end : itemEnd + 1;
+        }
+        return wildcard == 1;
+    }
+
+    /**
+     * 按 Accept-Encoding 选择文件的表示：优先 br，其次 gzip，都不接受或者没有预压缩文件时为原文件
+     * @param httpRequest 请求
+     * @param entry 原文件
+     * @return 选择的文件
+     */
+    FileCache::EntryPtr selectEncoding(const HttpRequest &httpRequest, const FileCache::EntryPtr &entry) {
+        if (!entry->brotli && !entry->gzip) {
+            return entry;
+        }
+        StringPiece acceptEncoding;
+        if (!httpRequest.findHeader(HttpHeader::kAcceptEncoding, &acceptEncoding)) {
+            return entry;
+        }
+        if (entry->brotli && acceptsEncoding(acceptEncoding, "br")) {
+            return entry->brotli;
+        }
+        if (entry->gzip && acceptsEncoding(acceptEncoding, "gzip")) {
+            return entry->gzip;
+        }
+        return entry;
+    }
+
+    /**
+     * 生成 multipart/byteranges 的分隔符，每个 IO 线程一个随机数生成器
+     * @return 分隔符
+     */
+    std::string makeBoundary() {
+        static thread_local std::mt19937_64 generator{std::random_device()()};
+        char buf[32];
+        snprintf(buf, sizeof(buf), "%016llx", static_cast<unsigned long long>(generator()));
+        return buf;
+    }
+
+    /**
+     * Content-Range 的值
+     * @param range 区间
+     * @param size 文件大小
+     * @return 如 bytes 0-499/1234
+     */
+    std::string contentRange(const HttpRange::ByteRange &range, size_t size) {
+        char buf[96];
+        snprintf(buf, sizeof(buf), "bytes %zu-%zu/%zu", range.first, range.last, size);
+        return buf;
+    }
+}
+
 HttpServer::HttpServer(EventLoop *loop,
                        const InternetAddress &listenAddress,
                        const std::string &name)
                        : tcpServer_(loop, listenAddress, name),
-                         httpCallback_() {
+                         httpCallback_(),
+                         maxBodySize_(HttpContext::kDefaultMaxBodySize),
+                         streamHighWaterMark_(ChunkedWriter::kDefaultHighWaterMark),
+                         keepAliveTimeout_(60),
+                         requestHeaderTimeout_(20),
+                         maxRequestsPerConnection_(0),
+                         fileCacheCapacity_(FileCache::kDefaultCapacity),
+                         responseCacheSize_(ResponseCache::kDefaultMaxBytes),
+                         responseCacheMaxObjectSize_(ResponseCache::kDefaultMaxObjectSize) {
     tcpServer_.setConnectionCallback(
             std::bind(&HttpServer::onConnection, this, _1));
     tcpServer_.setMessageCallback(
             std::bind(&HttpServer::onMessage, this, _1, _2, _3));
+    tcpServer_.setThreadInitCallback(
+            std::bind(&HttpServer::onThreadInit, this, _1));
+}
+
+HttpServer::~HttpServer() {
+    // 文件缓存的 inotify Channel 属于 IO 线程，要在 IO 线程中移除
+    for (const auto &item : staticFiles_) {
+        std::shared_ptr<FileCache> cache = item.second.files;
+        item.first->runInLoop([cache]() {
+            cache->stop();
+        });
+    }
 }
 
 EventLoop* HttpServer::getLoop() const {
@@ -26,63 +273,504 @@ void HttpServer::setHttpCallback(const HttpCallback &cb) {
     httpCallback_ = cb;
 }
 
+void HttpServer::setBodyCallback(const BodyCallback &cb) {
+    bodyCallback_ = cb;
+}
+
+void HttpServer::setMaxBodySize(size_t maxBodySize) {
+    maxBodySize_ = maxBodySize;
+}
+
+void HttpServer::setStreamHighWaterMark(size_t highWaterMark) {
+    streamHighWaterMark_ = highWaterMark;
+}
+
 void HttpServer::setThreadNum(int threadsNum) {
     tcpServer_.setThreadNumber(threadsNum);
 }
 
+void HttpServer::setEdgeTriggered(bool on) {
+    tcpServer_.setEdgeTriggered(on);
+}
+
+void HttpServer::setLoopPlacementPolicy(EventLoopThreadPool::Policy policy) {
+    tcpServer_.setLoopPlacementPolicy(policy);
+}
+
+void HttpServer::setReusePort(bool on) {
+    tcpServer_.setReusePort(on);
+}
+
+void HttpServer::setReusePortCpuSteering(bool on) {
+    tcpServer_.setReusePortCpuSteering(on);
+}
+
+void HttpServer::setMaxAcceptsPerWakeup(int maxAccepts) {
+    tcpServer_.setMaxAcceptsPerWakeup(maxAccepts);
+}
+
+void HttpServer::setConnectionPoolSize(size_t maxIdle) {
+    tcpServer_.setConnectionPoolSize(maxIdle);
+}
+
+TcpConnectionPool::Stats HttpServer::connectionPoolStats() const {
+    return tcpServer_.connectionPoolStats();
+}
+
+Acceptor::Stats HttpServer::acceptorStats() const {
+    return tcpServer_.acceptorStats();
+}
+
+std::vector<EventLoopStats::Snapshot> HttpServer::loopStats() const {
+    return tcpServer_.loopStats();
+}
+
+void HttpServer::setKeepAliveTimeout(int seconds) {
+    keepAliveTimeout_ = seconds;
+}
+
+void HttpServer::setRequestHeaderTimeout(int seconds) {
+    requestHeaderTimeout_ = seconds;
+}
+
+void HttpServer::setMaxRequestsPerConnection(int maxRequests) {
+    maxRequestsPerConnection_ = maxRequests;
+}
+
+void HttpServer::setDocumentRoot(const std::string &root) {
+    documentRoot_ = root;
+}
+
+void HttpServer::setFileCacheCapacity(size_t capacity) {
+    fileCacheCapacity_ = capacity;
+}
+
+void HttpServer::setResponseCacheSize(size_t maxBytes) {
+    responseCacheSize_ = maxBytes;
+}
+
+void HttpServer::setResponseCacheMaxObjectSize(size_t maxObjectSize) {
+    responseCacheMaxObjectSize_ = maxObjectSize;
+}
+
+ResponseCache::Stats HttpServer::responseCacheStats() const {
+    ResponseCache::Stats total;
+    for (const auto &item : staticFiles_) {
+        if (item.second.responses) {
+            ResponseCache::Stats stats = item.second.responses->stats();
+            total.hits += stats.hits;
+            total.misses += stats.misses;
+            total.evictions += stats.evictions;
+            total.bytes += stats.bytes;
+        }
+    }
+    return total;
+}
+
+void HttpServer::setThreadInitCallback(const TcpServer::ThreadInitCallback &cb) {
+    threadInitCallback_ = cb;
+}
+
 void HttpServer::start() {
     tcpServer_.start();
 }
 
+void HttpServer::onThreadInit(EventLoop *loop) {
+    // 先调用用户的回调函数（绑定 CPU 和 NUMA 节点），之后 ConnectionReaper 的内存就在本地节点上分配
+    if (threadInitCallback_) {
+        threadInitCallback_(loop);
+    }
+
+    if (!documentRoot_.empty()) {
+        StaticFiles staticFiles;
+        staticFiles.files = std::make_shared<FileCache>(loop, documentRoot_, fileCacheCapacity_);
+        staticFiles.files->start();
+        // FileCache 不缓存时每次请求都重新打开文件，响应缓存没有意义，直接用 sendfile 发送
+        if (responseCacheSize_ > 0 && staticFiles.files->cacheable()) {
+            staticFiles.responses = std::make_shared<ResponseCache>(loop, responseCacheSize_,
+                                                                    responseCacheMaxObjectSize_);
+        }
+        staticFiles_[loop] = staticFiles;
+    }
+
+    if (keepAliveTimeout_ <= 0 && requestHeaderTimeout_ <= 0) {
+        return;
+    }
+
+    auto reaper = std::make_shared<ConnectionReaper>(
+            loop,
+            static_cast<Timer::TimeType>(keepAliveTimeout_) * Timer::kMicroSecondsPerSecond,
+            static_cast<Timer::TimeType>(requestHeaderTimeout_) * Timer::kMicroSecondsPerSecond);
+    reaper->start();
+    reapers_[loop] = reaper;
+}
+
 void HttpServer::onConnection(const TcpConnectionPtr &connection) {
     if (connection->connected()) {
         connection->setContext(HttpContext());
+        auto context = tinyWS_thread::any_cast<HttpContext>(connection->getMutableContext());
+        context->setBodyCallback(&bodyCallback_);
+        context->setMaxBodySize(maxBodySize_);
+
+        auto it = reapers_.find(connection->getLoop());
+        if (it != reapers_.end()) {
+            // 连接建立后就开始计算读请求的期限，防止连接后什么都不发送
+            context->setReaper(it->second.get());
+            it->second->setReading(connection, context, Timer::now());
+        }
+    } else {
+        auto context = tinyWS_thread::any_cast<HttpContext>(connection->getMutableContext());
+        if (context->reaper() != nullptr) {
+            context->reaper()->remove(context);
+        }
+        if (context->stream()) {
+            // 连接对象可能被复用，取消之后不再调用 Producer
+            context->stream()->cancel();
+            context->setStream(nullptr);
+        }
     }
 }
 
 void HttpServer::onMessage(const TcpConnectionPtr &connection, Buffer *buffer,
                            Timer::TimeType receiveTime) {
     auto context = tinyWS_thread::any_cast<HttpContext>(connection->getMutableContext());
-    if (!context->parseRequest(buffer, receiveTime)) {
-        // 404
-        connection->send("HTTP/1.1 400 Bad Request\r\n\r\n");
-        connection->shutdown();
+    if (context->stream()) {
+        // 正在发送流式响应，之后的请求留在输入缓冲区中，等流式响应结束后处理（onStreamFinished()）。
+        // 缓存的数据太多时停止读 socket，否则客户端可以在流式响应期间一直发送，输入缓冲区没有上限。
+        if (buffer->readableBytes() >= kMaxStreamingInput) {
+            connection->stopRead();
+        }
+        return;
+    }
+    handleRequests(connection, context, buffer, receiveTime);
+}
+
+void HttpServer::handleRequests(const TcpConnectionPtr &connection, HttpContext *context,
+                                Buffer *buffer, Timer::TimeType receiveTime) {
+    ConnectionReaper *reaper = context->reaper();
+    if (reaper != nullptr) {
+        // 收到请求的第一个字节，开始计算读请求的期限（已经在读请求则不变）
+        reaper->setReading(connection, context, receiveTime);
     }
 
-    // 解析失败 跟 解析完成 互斥
+    // 支持流水线（pipelining）：依次处理缓冲区中所有完整的请求，响应都追加到输出队列中，
+    // 处理完之后只发送一次（一次 writev(2)），而不是每个响应发送一次。
+    // 解析失败、需要关闭连接或者开始流式响应时，不再处理之后的请求。
+    bool handled = false;
+    bool closeConnection = false;
+    while (connection->connected()) {
+        bool parsed = context->parseRequest(buffer, receiveTime);
+        if (context->takeExpectContinue()) {
+            // 客户端等待 100 Continue 之后才发送 Body
+            connection->outputBuffer()->append("HTTP/1.1 100 Continue\r\n\r\n");
+        }
+        if (!parsed) {
+            if (context->error() == HttpContext::kBodyTooLarge) {
+                connection->outputBuffer()->append("HTTP/1.1 413 Payload Too Large\r\n\r\n");
+            } else {
+                connection->outputBuffer()->append("HTTP/1.1 400 Bad Request\r\n\r\n");
+            }
+            closeConnection = true;
+            break;
+        }
+        if (!context->gotAll()) {
+            // 请求不完整，等待更多的数据
+            break;
+        }
 
-    if (context->gotAll()) {
         // 解析完成，响应请求
-        onRequest(connection, context->request());
-        // 重置 HttpContext
-        context->reset();
+        int requestCount = context->incrementRequestCount();
+        bool lastRequest = maxRequestsPerConnection_ > 0 && requestCount >= maxRequestsPerConnection_;
+        closeConnection = onRequest(connection, context->request(), lastRequest);
+        handled = true;
+        // 重置 HttpContext，请求行和请求头在这之后才从缓冲区中移除
+        context->reset(buffer);
+        if (closeConnection || context->stream()) {
+            break;
+        }
+    }
+
+    connection->sendOutputBuffer();
+    // 如果需要关闭连接，但是数据还没发送完，连接也会在数据发完才会关闭：
+    // 没有发送完时 Channel 会关注写事件（Channel::isWriting() 返回 true），
+    // TcpConnection::shutdown() 只有当 Channel 不处在写数据状态才会关闭写端，否则不做任何操作，
+    // 剩余的数据在 TcpConnection::handleWrite() 中发送完之后，再关闭写端。
+    // 所以 shutdown() 必须在 sendOutputBuffer() 之后调用，否则输出队列中的数据不会再发送。
+    if (closeConnection) {
+        connection->shutdown();
+    }
+
+    // 连接没有关闭，则进入空闲状态（响应还没有发送完时，发送完才开始计算空闲的期限）；
+    // 如果缓冲区中还有下一个请求的数据（或者已经在解析下一个请求），则直接开始读请求。
+    // 正在关闭的连接按发送进展计算期限，发送完之后如果对端一直不关闭连接，超时后强制关闭。
+    // 正在发送流式响应的连接留在读请求链表中，每次输出队列发送完时重新计算期限（onWriteComplete()），
+    // 客户端长时间不读数据时关闭连接。
+    if (reaper != nullptr && closeConnection && !connection->disconnected()) {
+        reaper->setClosing(connection, context, receiveTime);
+    } else if (reaper != nullptr && connection->connected()) {
+        if (handled) {
+            reaper->setIdle(connection, context, receiveTime);
+            if (buffer->readableBytes() > 0 || context->started() || context->stream()) {
+                reaper->setReading(connection, context, receiveTime);
+            }
+        }
+        if (context->readingBody()) {
+            // 正在接收 Body，收到数据就重新计算期限，大的 Body 不受读请求超时时间的限制
+            reaper->extendReading(connection, context, receiveTime);
+        }
     }
 }
 
-void HttpServer::onRequest(const TcpConnectionPtr &connection,
-                           const HttpRequest &httpRequest) {
-    const std::string &connectionStr = httpRequest.getHeader("Connection");
-    bool isClose = connectionStr == "close";
-    HttpResponse response(isClose);
+bool HttpServer::onRequest(const TcpConnectionPtr &connection,
+                           const HttpRequest &httpRequest,
+                           bool lastRequest) {
+    StringPiece connectionValue;
+    bool isClose = lastRequest ||
+                   (httpRequest.findHeader(HttpHeader::kConnection, &connectionValue) &&
+                    HttpHeader::equalsIgnoreCase(connectionValue, "close"));
+
+    FileLookupResult fileResult = kNotStaticFile;
+    FileCache::EntryPtr file;
+    auto it = staticFiles_.find(connection->getLoop());
+    if (it != staticFiles_.end()) {
+        fileResult = lookupFile(it->second.files.get(), httpRequest, &file);
+        if (fileResult == kFileFound) {
+            file = selectEncoding(httpRequest, file);
+        }
+        if (fileResult == kFileFound && httpRequest.method() == HttpRequest::kGet &&
+            it->second.responses && connection->connected() &&
+            !hasHeader(httpRequest, HttpHeader::kRange) &&
+            !hasHeader(httpRequest, HttpHeader::kIfNoneMatch) &&
+            !hasHeader(httpRequest, HttpHeader::kIfModifiedSince)) {
+            // 没有条件请求头和 Range 的小文件直接发送缓存的完整响应，不构造 HttpResponse，多个连接共享同一份数据
+            ResponseCache::ResponsePtr cached = it->second.responses->lookup(file, isClose);
+            if (cached) {
+                connection->appendSharedToOutput(cached);
+                return isClose;
+            }
+        }
+    }
 
-    if (httpCallback_) {
+    HttpResponse response(isClose);
+    if (fileResult != kNotStaticFile) {
+        setFileResponse(fileResult, file, httpRequest, response);
+    } else if (httpCallback_) {
         httpCallback_(httpRequest, response);
     }
 
-    Buffer buffer;
-    response.appendToBuffer(&buffer);
-    connection->send(buffer.toString());
-    // 如果 isClose 为 true，即将要关闭连接，但是数据还没发送完，连接也会在数据发完才会关闭。
-    //  在 TcpConnection::handleWrite() 和
-    // TcpConnection::send() 只调用了一次 write(2)而不会反复调用直至它返回 EAGAIN，
-    // 因为如果第一次 write(2) 没有能够将数据发送完，第二次调用 write(2) 几乎肯定会将数据发送完，并返回 EAGAIN。
-    // 那么第二次调用 write(2) 会发生在连接关闭之前吗？
-    // 会。
-    // 第一次如果没有将数据发送完，会令 Channel 关注写事件（此时调用 Channel::isWriting() 会返回 true，表示 Channel 处在写数据状态）。
-    // 当写事件到来时，调用 TcpConnection::handleWrite()，其中会第二次调用 write(2) 将数据发送完。
-    // 而 TcpConnection::shutdown() 只有当对应的 CHannel 不处在写数据状态才会关闭连接，而当对应 Channel 处在写数据状态，则不做任何操作。
-    // 所以，数据肯定能发送完，在关闭连接。
-    if (response.closeConnection()) {
+    // 直接把响应序列化到连接的输出缓冲区中，由 onMessage() 在处理完所有请求之后发送，
+    // 响应的每个字节只复制一次（从 HttpResponse 到输出缓冲区）。
+    // 连接已经在关闭（如之前的请求出错）时不再发送，与 TcpConnection::send() 相同。
+    if (connection->connected()) {
+        bool head = httpRequest.method() == HttpRequest::kHead;
+        response.appendToBuffer(connection->outputBuffer(), head);
+        if (response.file() && !head) {
+            // 响应头已在输出队列中，文件区域（multipart/byteranges 时每个区域之前有分隔符）紧随其后用 sendfile(2) 发送
+            for (const auto &region : response.fileRegions()) {
+                if (!region.prefix.empty()) {
+                    connection->outputBuffer()->append(region.prefix);
+                }
+                connection->appendFileToOutput(response.file(), region.offset, region.length);
+            }
+        } else if (response.chunkedProducer() && !head) {
+            // 响应头已在输出队列中，Body 由 ChunkedWriter 在之后的事件循环中生成，连接在响应结束后才关闭
+            startStream(connection, response.chunkedProducer(), response.closeConnection());
+            return false;
+        }
+    }
+    return response.closeConnection();
+}
+
+void HttpServer::startStream(const TcpConnectionPtr &connection,
+                             const ChunkedWriter::Producer &producer,
+                             bool closeConnection) {
+    auto context = tinyWS_thread::any_cast<HttpContext>(connection->getMutableContext());
+    auto stream = std::make_shared<ChunkedWriter>(connection, producer);
+    stream->setFinishCallback(
+            std::bind(&HttpServer::onStreamFinished, this, _1, closeConnection));
+    stream->setPauseCallback(
+            std::bind(&HttpServer::onStreamPaused, this, _1, _2));
+    context->setStream(stream);
+
+    // 只有流式响应期间才需要这两个回调函数，避免普通连接每次发送完都调用写完成回调函数
+    connection->setHighWaterMarkCallback(
+            std::bind(&HttpServer::onHighWaterMark, this, _1), streamHighWaterMark_);
+    connection->setWriteCompleteCallback(
+            std::bind(&HttpServer::onWriteComplete, this, _1));
+    // 第一次调用 Producer 在 pending functor 中，此时响应头已经由 handleRequests() 发送
+    stream->start();
+}
+
+void HttpServer::onStreamFinished(const TcpConnectionPtr &connection, bool closeConnection) {
+    auto context = tinyWS_thread::any_cast<HttpContext>(connection->getMutableContext());
+    context->setStream(nullptr);
+    connection->setHighWaterMarkCallback(HighWaterMarkCallback(), streamHighWaterMark_);
+    connection->setWriteCompleteCallback(WriteCompleteCallback());
+    // 流式响应期间可能因为缓存的输入太多而停止了读
+    connection->startRead();
+
+    Timer::TimeType now = Timer::now();
+    ConnectionReaper *reaper = context->reaper();
+    if (closeConnection) {
+        // 最后一个 chunk 已经在输出队列中，发送完之后关闭写端
         connection->shutdown();
+        if (reaper != nullptr) {
+            reaper->setClosing(connection, context, now);
+        }
+        return;
+    }
+
+    if (reaper != nullptr) {
+        reaper->setIdle(connection, context, now);
+    }
+    // 继续处理流式响应期间收到的请求
+    Buffer *buffer = connection->inputBuffer();
+    if (buffer->readableBytes() > 0) {
+        handleRequests(connection, context, buffer, now);
+    }
+}
+
+void HttpServer::onStreamPaused(const TcpConnectionPtr &connection, bool paused) {
+    auto context = tinyWS_thread::any_cast<HttpContext>(connection->getMutableContext());
+    ConnectionReaper *reaper = context->reaper();
+    if (reaper == nullptr || !connection->connected()) {
+        return;
+    }
+
+    Timer::TimeType now = Timer::now();
+    if (paused) {
+        // 输出队列还没有发送完时，发送完之后才开始计算空闲的期限
+        reaper->setIdle(connection, context, now);
+    } else {
+        reaper->setReading(connection, context, now);
+    }
+}
+
+void HttpServer::onHighWaterMark(const TcpConnectionPtr &connection) {
+    auto context = tinyWS_thread::any_cast<HttpContext>(connection->getMutableContext());
+    if (context->stream()) {
+        context->stream()->waitForDrain();
+    }
+}
+
+void HttpServer::onWriteComplete(const TcpConnectionPtr &connection) {
+    auto context = tinyWS_thread::any_cast<HttpContext>(connection->getMutableContext());
+    if (context->stream()) {
+        if (context->reaper() != nullptr) {
+            context->reaper()->extendReading(connection, context, Timer::now());
+        }
+        context->stream()->drained();
+    }
+}
+
+HttpServer::FileLookupResult HttpServer::lookupFile(FileCache *files,
+                                                    const HttpRequest &httpRequest,
+                                                    FileCache::EntryPtr *entry) {
+    if (httpRequest.method() != HttpRequest::kGet && httpRequest.method() != HttpRequest::kHead) {
+        return kNotStaticFile;
+    }
+
+    // 路径必须以 / 开头，且不能包含 .. 路径段，防止访问根目录之外的文件
+    StringPiece path = httpRequest.path();
+    if (path.empty() || path[0] != '/' || path.find('\0') != StringPiece::npos ||
+        path.find("/../") != StringPiece::npos || path.endsWith("/..")) {
+        return kBadPath;
+    }
+
+    size_t begin = 0;
+    while (begin < path.size() && path[begin] == '/') {
+        ++begin;
+    }
+    std::string relativePath(path.data() + begin, path.size() - begin);
+    if (relativePath.empty() || relativePath.back() == '/') {
+        relativePath += "index.html";
+    }
+
+    *entry = files->lookup(relativePath);
+    return *entry ? kFileFound : kFileNotFound;
+}
+
+void HttpServer::setFileResponse(FileLookupResult result,
+                                 const FileCache::EntryPtr &entry,
+                                 const HttpRequest &httpRequest,
+                                 HttpResponse &response) {
+    switch (result) {
+        case kBadPath:
+            response.setStatusCode(HttpResponse::k400BadRequest);
+            response.setStatusMessage("Bad Request");
+            response.setCloseConnection(true);
+            return;
+        case kFileNotFound:
+            response.setStatusCode(HttpResponse::k404NotFound);
+            response.setStatusMessage("Not Found");
+            response.setBody("Not Found");
+            return;
+        case kFileFound:
+            break;
+        default:
+            return;
+    }
+
+    // 与 ResponseCache::build() 的响应头相同
+    response.addHeader(HttpHeader::kETag, entry->etag);
+    response.addHeader(HttpHeader::kLastModified, entry->lastModified);
+    response.addHeader(HttpHeader::kAcceptRanges, "bytes");
+    if (entry->contentEncoding != nullptr) {
+        response.addHeader(HttpHeader::kContentEncoding, entry->contentEncoding);
+    }
+    if (entry->varyByEncoding()) {
+        response.addHeader(HttpHeader::kVary, "Accept-Encoding");
+    }
+
+    if (notModified(httpRequest, *entry)) {
+        response.setStatusCode(HttpResponse::k304NotModified);
+        response.setStatusMessage("Not Modified");
+        return;
+    }
+
+    // 只有 GET 请求处理 Range（RFC 7233 3.1）
+    StringPiece range;
+    std::vector<HttpRange::ByteRange> ranges;
+    HttpRange::Result rangeResult = HttpRange::kInvalid;
+    if (httpRequest.method() == HttpRequest::kGet && httpRequest.findHeader(HttpHeader::kRange, &range) &&
+        ifRangeMatches(httpRequest, *entry)) {
+        rangeResult = HttpRange::parse(range, entry->size, &ranges);
+    }
+
+    if (rangeResult == HttpRange::kUnsatisfiable) {
+        response.setStatusCode(HttpResponse::k416RangeNotSatisfiable);
+        response.setStatusMessage("Range Not Satisfiable");
+        char buf[64];
+        snprintf(buf, sizeof(buf), "bytes */%zu", entry->size);
+        response.addHeader(HttpHeader::kContentRange, buf);
+        return;
+    }
+
+    if (rangeResult != HttpRange::kSatisfiable) {
+        response.setStatusCode(HttpResponse::k200OK);
+        response.setStatusMessage("OK");
+        response.setContentType(entry->contentType);
+        response.setFileBody(entry->file, 0, entry->size);
+        return;
+    }
+
+    response.setStatusCode(HttpResponse::k206PartialContent);
+    response.setStatusMessage("Partial Content");
+    if (ranges.size() == 1) {
+        response.setContentType(entry->contentType);
+        response.addHeader(HttpHeader::kContentRange, contentRange(ranges[0], entry->size));
+        response.setFileBody(entry->file, static_cast<off_t>(ranges[0].first), ranges[0].length());
+        return;
+    }
+
+    // 多个区间：multipart/byteranges，每个部分的分隔符和头部在内存中，区间本身用 sendfile(2) 发送
+    std::string boundary = makeBoundary();
+    response.setContentType("multipart/byteranges; boundary=" + boundary);
+    response.setFileBody(entry->file, 0, 0);
+    for (const auto &byteRange : ranges) {
+        std::string prefix = "\r\n--" + boundary + "\r\nContent-Type: " + entry->contentType +
+                             "\r\nContent-Range: " + contentRange(byteRange, entry->size) + "\r\n\r\n";
+        response.addFileRegion(prefix, static_cast<off_t>(byteRange.first), byteRange.length());
     }
+    response.addFileRegion("\r\n--" + boundary + "--\r\n", 0, 0);
 }
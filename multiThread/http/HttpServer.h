@@ -2,23 +2,34 @@
 #define TINYWS_HTTPSERVER_H
 
 #include <functional>
+#include <map>
+#include <memory>
 #include <string>
+#include <vector>
 
 #include "../base/noncopyable.h"
 #include "../net/TcpServer.h"
 #include "../net/TcpConnection.h"
 #include "../net/Timer.h"
+#include "ChunkedWriter.h"
+#include "FileCache.h"
+#include "HttpContext.h"
+#include "ResponseCache.h"
 
 namespace tinyWS_thread{
     class Buffer;
     class HttpRequest;
     class HttpResponse;
+    class ConnectionReaper;
 
     class HttpServer : noncopyable {
     public:
         // HTTP 请求到来时的回调函数的类型
         using HttpCallback = std::function<void(const HttpRequest&, HttpResponse&)>;
 
+        // 收到一段请求 Body 时的回调函数的类型，见 HttpContext::BodyCallback
+        using BodyCallback = HttpContext::BodyCallback;
+
         /**
          * 构造函数
          * @param loop 所属 EventLoop
@@ -29,6 +40,8 @@ namespace tinyWS_thread{
                    const InternetAddress& listenAddress,
                    const std::string &name);
 
+        ~HttpServer();
+
         /**
          * 获取所属 EventLoop
          * @return EventLoop
@@ -41,19 +54,212 @@ namespace tinyWS_thread{
          */
         void setHttpCallback(const HttpCallback &cb);
 
+        /**
+         * 设置收到请求 Body 时的回调函数：Body（Content-Length 或者 chunked 解码后）每收到一段就调用一次，
+         * 数据直接指向连接的输入缓冲区（不复制，只在回调函数中有效），所有 Body 数据都在该请求的 HttpCallback 之前。
+         * 不设置时丢弃 Body。
+         * 需要在 start() 之前调用。
+         * @param cb 回调函数
+         */
+        void setBodyCallback(const BodyCallback &cb);
+
+        /**
+         * 设置请求 Body 的最大字节数，超过时返回 413 并关闭连接。
+         * 需要在 start() 之前调用。
+         * @param maxBodySize 字节数，0 表示不限制，默认为 HttpContext::kDefaultMaxBodySize
+         */
+        void setMaxBodySize(size_t maxBodySize);
+
+        /**
+         * 设置流式响应（HttpResponse::setChunkedBody()）的高水位：连接的输出队列中还没有发送的数据达到该字节数时，
+         * 暂停调用 Producer，输出队列发送完之后再继续。
+         * 需要在 start() 之前调用。
+         * @param highWaterMark 字节数，默认为 ChunkedWriter::kDefaultHighWaterMark
+         */
+        void setStreamHighWaterMark(size_t highWaterMark);
+
         /**
          * 设置 IO 线程数
          * @param threadsNum 线程数
          */
         void setThreadNum(int threadsNum);
 
+        /**
+         * 设置连接是否使用 edge trigger
+         * @param on true / false
+         */
+        void setEdgeTriggered(bool on);
+
+        /**
+         * 设置为新连接选择 IO 线程的策略，见 TcpServer::setLoopPlacementPolicy()
+         * @param policy 策略
+         */
+        void setLoopPlacementPolicy(EventLoopThreadPool::Policy policy);
+
+        /**
+         * 设置是否使用 SO_REUSEPORT 模式（每个 IO 线程有自己的监听 socket），见 TcpServer::setReusePort()
+         * @param on true / false
+         */
+        void setReusePort(bool on);
+
+        /**
+         * 设置 SO_REUSEPORT 模式下是否按 CPU 选择监听 socket，见 TcpServer::setReusePortCpuSteering()
+         * @param on true / false
+         */
+        void setReusePortCpuSteering(bool on);
+
+        /**
+         * 设置 listen socket 每次可读时最多 accept 的连接数，见 TcpServer::setMaxAcceptsPerWakeup()
+         * @param maxAccepts 连接数，至少为 1
+         */
+        void setMaxAcceptsPerWakeup(int maxAccepts);
+
+        /**
+         * 设置每个 IO 线程的连接对象池最多保留的空闲连接对象数，见 TcpServer::setConnectionPoolSize()
+         * @param maxIdle 空闲连接对象数，为 0 时不复用连接对象
+         */
+        void setConnectionPoolSize(size_t maxIdle);
+
+        /**
+         * 获取连接对象池的统计数据，见 TcpServer::connectionPoolStats()
+         * @return 统计数据
+         */
+        TcpConnectionPool::Stats connectionPoolStats() const;
+
+        /**
+         * 获取 accept 的统计数据，见 TcpServer::acceptorStats()
+         * @return 统计数据
+         */
+        Acceptor::Stats acceptorStats() const;
+
+        /**
+         * 获取每个 IO 线程 EventLoop 的运行时统计，见 TcpServer::loopStats()
+         * @return 快照列表
+         */
+        std::vector<EventLoopStats::Snapshot> loopStats() const;
+
+        /**
+         * 设置 keep-alive 连接的空闲超时时间，超时后关闭连接。
+         * 需要在 start() 之前调用。
+         * @param seconds 秒，0 表示不限制，默认为 60 秒
+         */
+        void setKeepAliveTimeout(int seconds);
+
+        /**
+         * 设置读请求的超时时间：从连接建立或者收到请求的第一个字节开始，
+         * 必须在该时间内收到完整的请求，否则关闭连接。
+         * 需要在 start() 之前调用。
+         * @param seconds 秒，0 表示不限制，默认为 20 秒
+         */
+        void setRequestHeaderTimeout(int seconds);
+
+        /**
+         * 设置每个连接最多处理的请求数，达到后在响应中带上 "Connection: close" 并关闭连接。
+         * @param maxRequests 请求数，0 表示不限制，默认为 0
+         */
+        void setMaxRequestsPerConnection(int maxRequests);
+
+        /**
+         * 设置静态文件的根目录。设置后，GET / HEAD 请求由 HttpServer 直接返回根目录下的文件（用 sendfile(2) 发送），
+         * 文件不存在时返回 404，其他请求方法仍然交给 HttpCallback 处理。
+         * 响应带有强 ETag 和 Last-Modified，支持条件请求（304）和单个 / 多个区间的 Range 请求（206）。
+         * 请求的 Accept-Encoding 接受 br / gzip，并且存在预压缩的 file.br / file.gz 时，返回预压缩文件（带 Content-Encoding 和 Vary）。
+         * 路径以 / 结尾时返回该目录下的 index.html。
+         * 需要在 start() 之前调用。
+         * @param root 根目录，为空时不提供静态文件
+         */
+        void setDocumentRoot(const std::string &root);
+
+        /**
+         * 设置每个 IO 线程的静态文件缓存（打开的文件描述符和 stat 结果）最多缓存的文件数，
+         * 默认为 FileCache::kDefaultCapacity，0 表示不缓存（每次请求都打开文件）。
+         * 需要在 start() 之前调用。
+         * @param capacity 文件数
+         */
+        void setFileCacheCapacity(size_t capacity);
+
+        /**
+         * 设置每个 IO 线程的响应缓存的总字节数上限。小的静态文件（见 setResponseCacheMaxObjectSize()）的 GET 请求
+         * 直接发送缓存的完整响应（响应行、响应头和 Body），不构造 HttpResponse，也不调用 sendfile(2)，
+         * 文件变化时（FileCache 发现）下一次请求重新读取文件。
+         * 默认为 ResponseCache::kDefaultMaxBytes，0 表示不缓存响应。
+         * 需要在 start() 之前调用。
+         * @param maxBytes 字节数
+         */
+        void setResponseCacheSize(size_t maxBytes);
+
+        /**
+         * 设置响应缓存的单个文件大小上限，更大的文件用 sendfile(2) 发送。
+         * 默认为 ResponseCache::kDefaultMaxObjectSize。
+         * 需要在 start() 之前调用。
+         * @param maxObjectSize 字节数
+         */
+        void setResponseCacheMaxObjectSize(size_t maxObjectSize);
+
+        /**
+         * 获取所有 IO 线程的响应缓存的统计数据（总和）
+         * @return 统计数据
+         */
+        ResponseCache::Stats responseCacheStats() const;
+
+        /**
+         * 设置 IO 线程初始化的回调函数（如绑定 CPU），在 IO 线程开始事件循环之前调用，
+         * 并且在创建该线程的 ConnectionReaper 之前调用。
+         * 需要在 start() 之前调用。
+         * @param cb 回调函数
+         */
+        void setThreadInitCallback(const TcpServer::ThreadInitCallback &cb);
+
         /**
          * 启动 TcpServer
          */
         void start();
     private:
+        // 流式响应期间输入缓冲区最多缓存的字节数（之后的请求），超过时停止读 socket，直到流式响应结束
+        static const size_t kMaxStreamingInput = 64 * 1024;
+
+        using ReaperMap = std::map<EventLoop*, std::shared_ptr<ConnectionReaper>>;
+
+        // 每个 IO 线程的静态文件缓存和响应缓存
+        struct StaticFiles {
+            std::shared_ptr<FileCache> files;           // 文件缓存
+            std::shared_ptr<ResponseCache> responses;   // 响应缓存，不缓存响应时为空
+        };
+
+        using StaticFilesMap = std::map<EventLoop*, StaticFiles>;
+
+        // 查找静态文件的结果
+        enum FileLookupResult {
+            kNotStaticFile,     // 不是静态文件请求（交给 HttpCallback 处理）
+            kBadPath,           // 路径不合法
+            kFileNotFound,      // 文件不存在
+            kFileFound          // 找到文件
+        };
+
+        // 每个 IO 线程的 ConnectionReaper，在 IO 线程初始化时创建。
+        // 定义在 tcpServer_ 之前，保证比 IO 线程活得长。
+        // 只在 start() 期间写入（IO 线程依次创建），之后只读，所以无须加锁。
+        ReaperMap reapers_;
+        StaticFilesMap staticFiles_; // 每个 IO 线程的静态文件缓存和响应缓存，与 reapers_ 相同
         TcpServer tcpServer_;       // TcpServer
         HttpCallback httpCallback_; // HTTP 请求到来时的回调函数
+        BodyCallback bodyCallback_; // 收到请求 Body 时的回调函数
+        size_t maxBodySize_;        // 请求 Body 的最大字节数
+        size_t streamHighWaterMark_; // 流式响应的高水位
+        int keepAliveTimeout_;      // keep-alive 空闲超时时间（秒）
+        int requestHeaderTimeout_;  // 读请求超时时间（秒）
+        int maxRequestsPerConnection_; // 每个连接最多处理的请求数
+        TcpServer::ThreadInitCallback threadInitCallback_; // 用户设置的 IO 线程初始化的回调函数
+        std::string documentRoot_;  // 静态文件的根目录
+        size_t fileCacheCapacity_;  // 每个 IO 线程最多缓存的文件数
+        size_t responseCacheSize_;  // 每个 IO 线程的响应缓存的总字节数上限
+        size_t responseCacheMaxObjectSize_; // 响应缓存的单个文件大小上限
+
+        /**
+         * IO 线程初始化时，调用用户设置的回调函数，再创建该线程的 ConnectionReaper
+         * @param loop IO 线程的 EventLoop
+         */
+        void onThreadInit(EventLoop *loop);
 
         /**
          * 连接建立后，将 HttpContext 传给 TcpConnection。
@@ -62,7 +268,7 @@ namespace tinyWS_thread{
         void onConnection(const TcpConnectionPtr &connection);
 
         /**
-         * 请求到来后，解析请求，响应请求。
+         * 请求到来后，解析并响应缓冲区中所有完整的请求（正在发送流式响应时，等响应结束再处理）。
          * @param connection
          * @param buffer
          * @param receiveTime
@@ -70,13 +276,90 @@ namespace tinyWS_thread{
         void onMessage(const TcpConnectionPtr &connection,
                        Buffer *buffer,
                        Timer::TimeType receiveTime);
+
+        /**
+         * 解析并响应缓冲区中所有完整的请求（流水线），所有响应追加到输出队列之后只发送一次。
+         * 遇到流式响应时停止，之后的请求在流式响应结束后处理。
+         * @param connection TcpConnectionPtr
+         * @param context 连接的 HttpContext
+         * @param buffer 输入缓冲区
+         * @param receiveTime 收到数据的时间
+         */
+        void handleRequests(const TcpConnectionPtr &connection,
+                            HttpContext *context,
+                            Buffer *buffer,
+                            Timer::TimeType receiveTime);
+
         /**
-         * 当解析完一条请求信息后，响应请求。
+         * 当解析完一条请求信息后，响应请求：把响应追加到连接的输出队列中，不发送（由 handleRequests() 发送）。
+         * 流式响应只追加响应头，并开始流式响应（HttpContext::stream()）。
          * @param connection TcpConnectionPtr
          * @param httpRequest
+         * @param lastRequest 是否为连接的最后一个请求（达到最大请求数）
+         * @return 是否需要立即关闭连接（流式响应在结束后才关闭，返回 false）
+         */
+        bool onRequest(const TcpConnectionPtr &connection,
+                       const HttpRequest &httpRequest,
+                       bool lastRequest);
+
+        /**
+         * 响应头已经追加到输出队列之后，开始发送流式响应：设置连接的高水位和写完成回调函数，由 ChunkedWriter 生成 Body
+         * @param connection TcpConnectionPtr
+         * @param producer 生成 Body 的回调函数
+         * @param closeConnection 响应结束后是否关闭连接
+         */
+        void startStream(const TcpConnectionPtr &connection,
+                         const ChunkedWriter::Producer &producer,
+                         bool closeConnection);
+
+        /**
+         * 流式响应的最后一个 chunk 已经放入输出队列：关闭连接，或者继续处理输入缓冲区中之后的请求
+         * @param connection TcpConnectionPtr
+         * @param closeConnection 是否关闭连接
+         */
+        void onStreamFinished(const TcpConnectionPtr &connection, bool closeConnection);
+
+        /**
+         * 流式响应被 Producer 暂停或者继续：暂停期间等待的是应用而不是客户端，
+         * 连接不受读请求超时时间的限制，按空闲连接计算期限（keep-alive 超时时间）；继续时重新开始计算读请求的期限
+         * @param connection TcpConnectionPtr
+         * @param paused 是否暂停
+         */
+        void onStreamPaused(const TcpConnectionPtr &connection, bool paused);
+
+        /**
+         * 连接的输出队列达到高水位，暂停流式响应
+         * @param connection TcpConnectionPtr
+         */
+        void onHighWaterMark(const TcpConnectionPtr &connection);
+
+        /**
+         * 连接的输出队列已经发送完，继续流式响应，并重新计算连接的期限
+         * @param connection TcpConnectionPtr
+         */
+        void onWriteComplete(const TcpConnectionPtr &connection);
+
+        /**
+         * 查找 GET / HEAD 请求的静态文件
+         * @param files 连接所属 IO 线程的文件缓存
+         * @param httpRequest 请求
+         * @param entry 找到的文件
+         * @return 查找结果
+         */
+        static FileLookupResult lookupFile(FileCache *files, const HttpRequest &httpRequest, FileCache::EntryPtr *entry);
+
+        /**
+         * 按静态文件的查找结果设置响应：找到文件时带上 ETag 和 Last-Modified，
+         * 处理条件请求（If-None-Match / If-Modified-Since，返回 304）和 Range 请求（返回 206 / 416）
+         * @param result 查找结果（不是 kNotStaticFile）
+         * @param entry 找到的文件
+         * @param httpRequest 请求
+         * @param response 响应
          */
-        void onRequest(const TcpConnectionPtr &connection,
-                       const HttpRequest &httpRequest);
+        static void setFileResponse(FileLookupResult result,
+                                    const FileCache::EntryPtr &entry,
+                                    const HttpRequest &httpRequest,
+                                    HttpResponse &response);
     };
 }
 
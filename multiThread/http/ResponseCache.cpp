@@ -0,0 +1,128 @@
+#include "ResponseCache.h"
+
+#include <unistd.h> // pread
+
+#include "../net/EventLoop.h"
+#include "../net/Buffer.h"
+#include "HttpResponse.h"
+
+using namespace tinyWS_thread;
+
+const size_t ResponseCache::kDefaultMaxBytes;
+const size_t ResponseCache::kDefaultMaxObjectSize;
+
+ResponseCache::ResponseCache(EventLoop *loop, size_t maxBytes, size_t maxObjectSize)
+    : loop_(loop),
+      maxBytes_(maxBytes),
+      maxObjectSize_(maxObjectSize < maxBytes ? maxObjectSize : maxBytes),
+      totalBytes_(0) {
+
+}
+
+ResponseCache::ResponsePtr ResponseCache::lookup(const FileCache::EntryPtr &file, bool closeConnection) {
+    loop_->assertInLoopThread();
+    if (file->size > maxObjectSize_) {
+        return nullptr;
+    }
+
+    int variant = closeConnection ? 1 : 0;
+    const std::string key = keyOf(*file);
+    auto it = items_.find(key);
+    if (it != items_.end()) {
+        Item &item = *it->second;
+        if (item.etag == file->etag && item.varyByEncoding == file->varyByEncoding()) {
+            lru_.splice(lru_.begin(), lru_, it->second);
+            if (item.responses[variant]) {
+                hits_.increment();
+                return item.responses[variant];
+            }
+        } else {
+            // 文件已经变化，丢弃旧的响应
+            totalBytes_ -= item.bytes;
+            lru_.erase(it->second);
+            items_.erase(it);
+            it = items_.end();
+        }
+    }
+
+    misses_.increment();
+    ResponsePtr response = build(*file, closeConnection);
+    if (!response) {
+        return nullptr;
+    }
+
+    if (it == items_.end()) {
+        lru_.push_front(Item());
+        Item &item = lru_.front();
+        item.key = key;
+        item.etag = file->etag;
+        item.varyByEncoding = file->varyByEncoding();
+        item.bytes = 0;
+        it = items_.emplace(key, lru_.begin()).first;
+    }
+    Item &item = *it->second;
+    item.responses[variant] = response;
+    item.bytes += response->size();
+    totalBytes_ += response->size();
+    evict();
+    bytes_.getAndSet(static_cast<int64_t>(totalBytes_));
+
+    return response;
+}
+
+ResponseCache::Stats ResponseCache::stats() {
+    Stats stats;
+    stats.hits = hits_.get();
+    stats.misses = misses_.get();
+    stats.evictions = evictions_.get();
+    stats.bytes = bytes_.get();
+    return stats;
+}
+
+std::string ResponseCache::keyOf(const FileCache::Entry &file) {
+    // 预压缩文件与直接请求该文件（如 /app.js.gz）的响应不同
+    return file.contentEncoding == nullptr ? file.path : file.path + '\n' + file.contentEncoding;
+}
+
+ResponseCache::ResponsePtr ResponseCache::build(const FileCache::Entry &file, bool closeConnection) {
+    std::string body(file.size, '\0');
+    size_t read = 0;
+    while (read < file.size) {
+        ssize_t n = ::pread(file.file->fd(), &body[read], file.size - read, static_cast<off_t>(read));
+        if (n <= 0) {
+            // 文件被截断，由调用者按普通文件处理
+            return nullptr;
+        }
+        read += static_cast<size_t>(n);
+    }
+
+    // 与不使用缓存时的响应相同（包括响应头的顺序）
+    HttpResponse response(closeConnection);
+    response.setStatusCode(HttpResponse::k200OK);
+    response.setStatusMessage("OK");
+    response.addHeader(HttpHeader::kETag, file.etag);
+    response.addHeader(HttpHeader::kLastModified, file.lastModified);
+    response.addHeader(HttpHeader::kAcceptRanges, "bytes");
+    if (file.contentEncoding != nullptr) {
+        response.addHeader(HttpHeader::kContentEncoding, file.contentEncoding);
+    }
+    if (file.varyByEncoding()) {
+        response.addHeader(HttpHeader::kVary, "Accept-Encoding");
+    }
+    response.setContentType(file.contentType);
+    response.setBody(std::move(body));
+
+    Buffer buffer;
+    response.appendToBuffer(&buffer);
+    return std::make_shared<const std::string>(buffer.retrieveAllAsString());
+}
+
+void ResponseCache::evict() {
+    while (totalBytes_ > maxBytes_ && !lru_.empty()) {
+        const Item &item = lru_.back();
+        totalBytes_ -= item.bytes;
+        items_.erase(item.key);
+        lru_.pop_back();
+        evictions_.increment();
+    }
+}
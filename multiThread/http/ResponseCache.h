@@ -0,0 +1,113 @@
+#ifndef TINYWS_RESPONSECACHE_H
+#define TINYWS_RESPONSECACHE_H
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include "../base/noncopyable.h"
+#include "../base/Atomic.h"
+#include "FileCache.h"
+
+namespace tinyWS_thread {
+    class EventLoop;
+
+    // 小的热点静态文件的完整响应缓存，每个 IO 线程（EventLoop）一个，只在所属 IO 线程中使用。
+    //
+    // 缓存的是序列化好的响应（响应行、响应头和 Body 在同一个只读的字符串中），
+    // 命中时直接用 TcpConnection::send(shared_ptr<const std::string>) 发送，
+    // 不需要构造 HttpResponse、序列化响应头，也不需要复制 Body。
+    //
+    // 缓存项记录生成时文件的 ETag（由大小和最后修改时间生成）。FileCache 发现文件变化（inotify）后会重新打开文件，
+    // ETag 不同时缓存项失效，下一次请求重新读取文件；文件没有变化时，即使 FileCache 生成了新的 Entry，缓存项仍然有效。
+    // FileCache 不能缓存文件（没有 inotify 或者容量为 0）时不使用本缓存（HttpServer::onThreadInit()）。
+    // 按 LRU 淘汰，缓存的总字节数不超过 maxBytes，超过 maxObjectSize 的文件不缓存（用 sendfile 发送）。
+    class ResponseCache : noncopyable {
+    public:
+        static const size_t kDefaultMaxBytes = 16 * 1024 * 1024;
+        static const size_t kDefaultMaxObjectSize = 64 * 1024;
+
+        using ResponsePtr = std::shared_ptr<const std::string>;
+
+        // 统计数据
+        struct Stats {
+            Stats() : hits(0), misses(0), evictions(0), bytes(0) {}
+
+            int64_t hits;           // 命中的请求数
+            int64_t misses;         // 没有命中（或者文件已变化），重新生成响应的请求数
+            int64_t evictions;      // 因为超过字节数上限而淘汰的缓存项数
+            int64_t bytes;          // 当前缓存的字节数
+        };
+
+        /**
+         * 构造函数
+         * @param loop 所属 EventLoop
+         * @param maxBytes 缓存的总字节数上限，为 0 时不缓存
+         * @param maxObjectSize 缓存的单个文件大小上限
+         */
+        ResponseCache(EventLoop *loop, size_t maxBytes, size_t maxObjectSize);
+
+        /**
+         * --- 只能在 IO 线程中调用 ---
+         * 获取文件的 200 响应，没有缓存时读取文件并生成
+         * @param file 文件（FileCache 的缓存项）
+         * @param closeConnection 响应头中的 Connection 是否为 close
+         * @return 序列化好的响应，文件太大或者读取失败时返回 nullptr
+         */
+        ResponsePtr lookup(const FileCache::EntryPtr &file, bool closeConnection);
+
+        /**
+         * --- 线程安全 ---
+         * 获取统计数据
+         * @return 统计数据
+         */
+        Stats stats();
+
+    private:
+        // 缓存项，keep-alive 和 close 两种响应在需要时分别生成
+        struct Item {
+            std::string key;                                // 见 keyOf()
+            std::string etag;                               // 生成响应时文件的 ETag
+            bool varyByEncoding;                            // 生成响应时是否有预压缩文件（响应头 Vary）
+            ResponsePtr responses[2];                       // [0] keep-alive，[1] close
+            size_t bytes;                                   // 响应的总字节数
+        };
+
+        using ItemList = std::list<Item>;
+
+        EventLoop *loop_;                                           // 所属 EventLoop
+        const size_t maxBytes_;                                     // 缓存的总字节数上限
+        const size_t maxObjectSize_;                                // 缓存的单个文件大小上限
+        size_t totalBytes_;                                         // 当前缓存的字节数
+        ItemList lru_;                                              // 缓存项，最近使用的在前面
+        std::unordered_map<std::string, ItemList::iterator> items_; // 见 keyOf() -> 缓存项
+        AtomicInt64 hits_;                                          // 见 Stats
+        AtomicInt64 misses_;
+        AtomicInt64 evictions_;
+        AtomicInt64 bytes_;
+
+        /**
+         * 缓存项的键：文件路径，预压缩文件再加上 Content-Encoding
+         * @param file 文件
+         * @return 键
+         */
+        static std::string keyOf(const FileCache::Entry &file);
+
+        /**
+         * 读取文件，生成序列化好的响应
+         * @param file 文件
+         * @param closeConnection 响应头中的 Connection 是否为 close
+         * @return 响应，读取失败时返回 nullptr
+         */
+        static ResponsePtr build(const FileCache::Entry &file, bool closeConnection);
+
+        /**
+         * 淘汰最久没有使用的缓存项，直到总字节数不超过上限
+         */
+        void evict();
+    };
+}
+
+#endif //TINYWS_RESPONSECACHE_H
@@ -1,8 +1,9 @@
 #include <unistd.h>
 #include <fcntl.h>
-#include <sys/stat.h>   // struct stat
-#include <sys/mman.h>   // mmap()、munmap()
 
+#include <cstring>
+
+#include <algorithm>
 #include <functional>
 #include <iostream>
 
@@ -11,9 +12,13 @@
 #include "net/TcpConnection.h"
 #include "net/TcpServer.h"
 #include "http/HttpServer.h"
+#include "http/HttpContext.h"
 #include "http/HttpRequest.h"
 #include "http/HttpResponse.h"
+#include "http/FileCache.h"
+#include "http/ResponseCache.h"
 #include "base/Logger.h"
+#include "base/CpuAffinity.h"
 #include "net/TimerId.h"
 
 using namespace std::placeholders;
@@ -23,17 +28,107 @@ void test_runEvery();
 void httpCallback(const HttpRequest &request, HttpResponse &response);
 void set404NotFound(HttpResponse &response);
 
+// 用法：tinyWS_thread [线程数] [端口] [选项...]
+// 选项：
+//   --et        连接使用 edge trigger（默认为 level trigger）
+//   --io-uring  使用 io_uring 作为 Poller 后端（默认为 epoll），等同于设置环境变量 TINYWS_POLLER=io_uring
+//   --placement=rr|least|p2c|hash  为新连接选择 IO 线程的策略（默认为 rr）：轮流、连接数最少、
+//                                  随机两个中负载较低的、按客户端 IP 一致性哈希
+//   --reuseport 每个 IO 线程有自己的 SO_REUSEPORT 监听 socket，连接的接受、建立和断开都在同一个 IO 线程中完成
+//   --cpu-steering  与 --reuseport 一起使用，按照收到连接的 CPU 选择监听 socket（SO_INCOMING_CPU / BPF）
+//   --keep-alive-timeout=秒    keep-alive 连接的空闲超时时间，0 表示不限制（默认为 60）
+//   --header-timeout=秒        读请求的超时时间，0 表示不限制（默认为 20）
+//   --max-requests=数量        每个连接最多处理的请求数，0 表示不限制（默认为 0）
+//   --cpu-affinity=auto|CPU列表  把 IO 线程依次绑定到 CPU 上（如 0-3,8），auto 表示所有可用的 CPU，
+//                              并优先从 CPU 所在的 NUMA 节点分配内存，启动时输出绑定结果
+//   --accept-batch=数量        listen socket 每次可读时最多 accept 的连接数（默认为 16）
+//   --accept-stats=秒          每隔若干秒输出 accept 的统计数据（每次可读平均 accept 的连接数、丢弃的连接数）
+//                              、连接对象池的统计数据（新建、复用、丢弃的连接对象数）
+//                              和响应缓存的统计数据（命中、未命中、淘汰数和缓存的字节数）
+//   --root=目录               提供该目录下的静态文件（如 multiThread/web），GET / HEAD 请求用 sendfile 发送文件，
+//                              每个 IO 线程缓存打开的文件描述符和 stat 结果（inotify 发现文件变化时失效）
+//   --file-cache=数量          每个 IO 线程最多缓存的文件数，0 表示不缓存（默认为 1024）
+//   --response-cache=字节数    每个 IO 线程缓存的完整响应（小文件的响应行、响应头和 Body）的总字节数上限，
+//                              0 表示不缓存响应（默认为 16MB）
+//   --response-cache-object=字节数  缓存响应的文件大小上限，更大的文件用 sendfile 发送（默认为 64KB）
+//   --max-body=字节数          请求 Body 的最大字节数，超过时返回 413，0 表示不限制（默认为 1MB）
+//   --connection-pool=数量     每个 IO 线程最多保留的空闲连接对象数，0 表示不复用连接对象（默认为 1024）
+//   --loop-stats=秒            每隔若干秒输出每个 IO 线程这段时间的运行时统计（poll、处理事件、处理 pending functor
+//                              的时间分布，活跃 Channel 数、pending functor 队列长度和定时器延迟）
 int main(int argc, char* argv[]) {
 //     debug() << "pid = " << ::getpid() << ", tid = " << Thread::gettid() << std::endl;
 
     int threadNums = 0;
     int port = 19123;
+    bool edgeTriggered = false;
+    EventLoopThreadPool::Policy placement = EventLoopThreadPool::kRoundRobin;
+    bool reusePort = false;
+    bool cpuSteering = false;
+    int keepAliveTimeout = 60;
+    int headerTimeout = 20;
+    int maxRequests = 0;
+    int acceptBatch = Acceptor::kDefaultMaxAcceptsPerWakeup;
+    int acceptStatsInterval = 0;
+    int loopStatsInterval = 0;
+    int connectionPoolSize = static_cast<int>(TcpConnectionPool::kDefaultMaxIdle);
+    std::string documentRoot;
+    int fileCacheCapacity = static_cast<int>(FileCache::kDefaultCapacity);
+    long responseCacheSize = static_cast<long>(ResponseCache::kDefaultMaxBytes);
+    long responseCacheMaxObjectSize = static_cast<long>(ResponseCache::kDefaultMaxObjectSize);
+    long maxBodySize = static_cast<long>(HttpContext::kDefaultMaxBodySize);
+    std::string cpuAffinity;
     if (argc > 1) {
         threadNums = ::atoi(argv[1]);
     }
     if (argc > 2) {
         port = ::atoi(argv[2]);
     }
+    for (int i = 3; i < argc; ++i) {
+        if (::strcmp(argv[i], "--et") == 0) {
+            edgeTriggered = true;
+        } else if (::strcmp(argv[i], "--io-uring") == 0) {
+            // 必须在创建 EventLoop 之前设置
+            ::setenv("TINYWS_POLLER", "io_uring", 1);
+        } else if (::strcmp(argv[i], "--placement=rr") == 0) {
+            placement = EventLoopThreadPool::kRoundRobin;
+        } else if (::strcmp(argv[i], "--placement=least") == 0) {
+            placement = EventLoopThreadPool::kLeastConnections;
+        } else if (::strcmp(argv[i], "--placement=p2c") == 0) {
+            placement = EventLoopThreadPool::kPowerOfTwoChoices;
+        } else if (::strcmp(argv[i], "--placement=hash") == 0) {
+            placement = EventLoopThreadPool::kConsistentHash;
+        } else if (::strcmp(argv[i], "--reuseport") == 0) {
+            reusePort = true;
+        } else if (::strcmp(argv[i], "--cpu-steering") == 0) {
+            cpuSteering = true;
+        } else if (::strncmp(argv[i], "--keep-alive-timeout=", 21) == 0) {
+            keepAliveTimeout = ::atoi(argv[i] + 21);
+        } else if (::strncmp(argv[i], "--header-timeout=", 17) == 0) {
+            headerTimeout = ::atoi(argv[i] + 17);
+        } else if (::strncmp(argv[i], "--max-requests=", 15) == 0) {
+            maxRequests = ::atoi(argv[i] + 15);
+        } else if (::strncmp(argv[i], "--accept-batch=", 15) == 0) {
+            acceptBatch = std::max(1, ::atoi(argv[i] + 15));
+        } else if (::strncmp(argv[i], "--cpu-affinity=", 15) == 0) {
+            cpuAffinity = argv[i] + 15;
+        } else if (::strncmp(argv[i], "--accept-stats=", 15) == 0) {
+            acceptStatsInterval = ::atoi(argv[i] + 15);
+        } else if (::strncmp(argv[i], "--loop-stats=", 13) == 0) {
+            loopStatsInterval = ::atoi(argv[i] + 13);
+        } else if (::strncmp(argv[i], "--root=", 7) == 0) {
+            documentRoot = argv[i] + 7;
+        } else if (::strncmp(argv[i], "--file-cache=", 13) == 0) {
+            fileCacheCapacity = std::max(0, ::atoi(argv[i] + 13));
+        } else if (::strncmp(argv[i], "--response-cache=", 17) == 0) {
+            responseCacheSize = std::max(0L, ::atol(argv[i] + 17));
+        } else if (::strncmp(argv[i], "--response-cache-object=", 24) == 0) {
+            responseCacheMaxObjectSize = std::max(0L, ::atol(argv[i] + 24));
+        } else if (::strncmp(argv[i], "--max-body=", 11) == 0) {
+            maxBodySize = std::max(0L, ::atol(argv[i] + 11));
+        } else if (::strncmp(argv[i], "--connection-pool=", 18) == 0) {
+            connectionPoolSize = std::max(0, ::atoi(argv[i] + 18));
+        }
+    }
 
     EventLoop loop;
     InternetAddress listenAddress(port);
@@ -43,7 +138,71 @@ int main(int argc, char* argv[]) {
 //    loop.runEvery(2 * 1000 * 1000, std::bind(&test_runEvery));
 
     server.setThreadNum(threadNums);
+    server.setEdgeTriggered(edgeTriggered);
+    server.setLoopPlacementPolicy(placement);
+    server.setReusePort(reusePort);
+    server.setReusePortCpuSteering(cpuSteering);
+    server.setKeepAliveTimeout(keepAliveTimeout);
+    server.setRequestHeaderTimeout(headerTimeout);
+    server.setMaxRequestsPerConnection(maxRequests);
+    server.setMaxAcceptsPerWakeup(acceptBatch);
+    server.setConnectionPoolSize(static_cast<size_t>(connectionPoolSize));
+    server.setDocumentRoot(documentRoot);
+    server.setFileCacheCapacity(static_cast<size_t>(fileCacheCapacity));
+    server.setResponseCacheSize(static_cast<size_t>(responseCacheSize));
+    server.setResponseCacheMaxObjectSize(static_cast<size_t>(responseCacheMaxObjectSize));
+    server.setMaxBodySize(static_cast<size_t>(maxBodySize));
+
+    // IO 线程依次创建，线程初始化的回调函数依次在各个 IO 线程中调用，所以 loopIndex 不需要加锁
+    CpuAffinity affinity(cpuAffinity);
+    int loopIndex = 0;
+    if (!cpuAffinity.empty()) {
+        if (affinity.empty()) {
+            debug(LogLevel::WARN) << "invalid --cpu-affinity: " << cpuAffinity << std::endl;
+        } else {
+            server.setThreadInitCallback([&affinity, &loopIndex](EventLoop*) {
+                int index = loopIndex++;
+                debug(LogLevel::INFO) << "IO thread " << index << " (tid " << Thread::gettid() << "): "
+                                      << affinity.bindCurrentThread(index) << std::endl;
+            });
+        }
+    }
     server.start();
+    if (acceptStatsInterval > 0) {
+        loop.runEvery(acceptStatsInterval * Timer::kMicroSecondsPerSecond, [&server]() {
+            Acceptor::Stats stats = server.acceptorStats();
+            double perWakeup = stats.wakeups > 0 ? static_cast<double>(stats.accepted) / stats.wakeups : 0.0;
+            debug(LogLevel::INFO) << "accept stats: wakeups " << stats.wakeups
+                                  << ", accepted " << stats.accepted
+                                  << ", accepts per wakeup " << perWakeup
+                                  << ", full batches " << stats.fullBatches
+                                  << ", dropped " << stats.dropped << std::endl;
+            TcpConnectionPool::Stats poolStats = server.connectionPoolStats();
+            debug(LogLevel::INFO) << "connection pool stats: created " << poolStats.created
+                                  << ", reused " << poolStats.reused
+                                  << ", discarded " << poolStats.discarded << std::endl;
+            ResponseCache::Stats cacheStats = server.responseCacheStats();
+            debug(LogLevel::INFO) << "response cache stats: hits " << cacheStats.hits
+                                  << ", misses " << cacheStats.misses
+                                  << ", evictions " << cacheStats.evictions
+                                  << ", bytes " << cacheStats.bytes << std::endl;
+        });
+    }
+    // 只在主线程的定时器中访问 lastLoopStats，不需要加锁
+    std::vector<EventLoopStats::Snapshot> lastLoopStats;
+    if (loopStatsInterval > 0) {
+        loop.runEvery(loopStatsInterval * Timer::kMicroSecondsPerSecond, [&server, &lastLoopStats]() {
+            std::vector<EventLoopStats::Snapshot> current = server.loopStats();
+            for (size_t i = 0; i < current.size(); ++i) {
+                EventLoopStats::Snapshot interval = current[i];
+                if (i < lastLoopStats.size()) {
+                    interval.subtract(lastLoopStats[i]);
+                }
+                debug(LogLevel::INFO) << "loop " << i << ": " << interval.toString() << std::endl;
+            }
+            lastLoopStats.swap(current);
+        });
+    }
     server.setHttpCallback(std::bind(&httpCallback, _1, _2));
     loop.loop();
 
@@ -55,53 +214,15 @@ void test_runEvery() {
 }
 
 void httpCallback(const HttpRequest& request, HttpResponse& response) {
-//    debug() << "httpCallback() " << std::endl;
-//
-//    const std::string &path = request.path();
-//    const std::string prefix = "/tmp/tmp.epZ6PWHYhj/web";
-//    std::string filename;
-//    if (path  == "/") {
-//        filename = prefix + "/index.html";
-//        response.setContentType("text/html");
-//    } else if (path == "/favicon.ico") {
-//        filename = prefix + "/favicon.ico";
-//        response.setContentType("image/x-icon");
-//    }
-//
-//    // 使用 mmap 读取文件
-//    struct stat fileBuffer{};
-//    int fd;
-//    if (filename.empty() || stat(filename.c_str(), &fileBuffer) < 0
-//        || (fd = ::open(filename.c_str(), O_RDONLY, 0)) < 0) {
-//
-//        set404NotFound(response);
-//        return;
-//    }
-//
-//    void *mmapResult = ::mmap(nullptr,
-//            static_cast<size_t>(fileBuffer.st_size),
-//            PROT_READ, MAP_PRIVATE, fd, 0);
-//    close(fd); // 已经映射完成，可以关闭文件描述符。
-//
-//    if (mmapResult == (void*)-1) {
-//        munmap(mmapResult, static_cast<size_t>(fileBuffer.st_size));
-//        set404NotFound(response);
-//        return;
-//    }
-//
-//    char *srcAddress = static_cast<char*>(mmapResult);
-//    // 添加数据到 Response Body
-//    response.setBody(std::string(srcAddress, srcAddress + fileBuffer.st_size));
-//    munmap(mmapResult, static_cast<size_t>(fileBuffer.st_size));
-
+    // 静态文件由 HttpServer 处理（--root），这里只处理其他请求
     response.setBody("Hello World!"); // for pressure test
 
 //    std::cout << "Hello World!" << std::endl;
 
     response.setStatusCode(HttpResponse::k200OK);
     response.setStatusMessage("OK");
-    response.addHeader("server", "tinyWS");
-    response.addHeader("User-Agent", request.getHeader("User-Agent"));
+    response.addHeader(HttpHeader::kServer, "tinyWS");
+    response.addHeader(HttpHeader::kUserAgent, request.getHeader(HttpHeader::kUserAgent).asString());
 }
 
 void set404NotFound(HttpResponse& response) {
@@ -1,7 +1,11 @@
 #include "Acceptor.h"
 
+#include <fcntl.h>
+#include <unistd.h>
 #include <netinet/in.h>
 #include <sys/socket.h>
+#include <cassert>
+#include <cerrno>
 
 #include <functional>
 #include <utility>
@@ -12,26 +16,48 @@
 
 using namespace tinyWS_thread;
 
-Acceptor::Acceptor(EventLoop *loop, const InternetAddress &listenAddress)
+Acceptor::Acceptor(EventLoop *loop, const InternetAddress &listenAddress, bool reusePort)
     : loop_(loop),
       acceptSocket_(createNonblocking()),
       acceptChannel_(loop_, acceptSocket_.fd()),
-      isListening_(false) {
+      isListening_(false),
+      idleFd_(::open("/dev/null", O_RDONLY | O_CLOEXEC)),
+      maxAcceptsPerWakeup_(kDefaultMaxAcceptsPerWakeup) {
     // 设置端口复用、绑定地址、设置"读"回调函数
     acceptSocket_.setReuseAddr(true);
+    if (reusePort) {
+        acceptSocket_.setReusePort(true);
+    }
     acceptSocket_.bindAddress(listenAddress);
-    acceptChannel_.setReadCallback(std::bind(&Acceptor::hadleRead, this));
+    acceptChannel_.setReadCallback(std::bind(&Acceptor::handleRead, this));
 }
 
 Acceptor::~Acceptor() {
     acceptChannel_.disableAll();
     acceptChannel_.remove();
+    if (idleFd_ >= 0) {
+        ::close(idleFd_);
+    }
 }
 
 void Acceptor::setNewConnectionCallback(const NewConnectionCallback &cb) {
     newConnectionCallback_ = cb;
 }
 
+void Acceptor::setMaxAcceptsPerWakeup(int maxAccepts) {
+    assert(maxAccepts >= 1);
+    maxAcceptsPerWakeup_ = maxAccepts;
+}
+
+Acceptor::Stats Acceptor::stats() {
+    Stats stats;
+    stats.wakeups = wakeups_.get();
+    stats.accepted = accepted_.get();
+    stats.dropped = dropped_.get();
+    stats.fullBatches = fullBatches_.get();
+    return stats;
+}
+
 bool Acceptor::isListening() const {
     return isListening_;
 }
@@ -43,6 +69,18 @@ void Acceptor::listen() {
     acceptChannel_.enableReading();
 }
 
+EventLoop* Acceptor::getLoop() const {
+    return loop_;
+}
+
+bool Acceptor::setIncomingCpu(int cpu) {
+    return acceptSocket_.setIncomingCpu(cpu);
+}
+
+bool Acceptor::attachReusePortCpuFilter(int groupSize) {
+    return acceptSocket_.attachReusePortCpuFilter(groupSize);
+}
+
 int Acceptor::createNonblocking() {
     int sockfd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_TCP);
     if (sockfd < 0) {
@@ -51,29 +89,69 @@ int Acceptor::createNonblocking() {
     return sockfd;
 }
 
-void Acceptor::hadleRead() {
+void Acceptor::handleRead() {
     loop_->assertInLoopThread();
-    InternetAddress peerAddress;
-    // 每次只 accept 一次
-    Socket connectionSocket(acceptSocket_.accept(&peerAddress));
-    if (connectionSocket.fd() >= 0) {
-        if (newConnectionCallback_) {
-            // 移动 Socket，保证资源的安全释放
-            newConnectionCallback_(std::move(connectionSocket), peerAddress);
+    wakeups_.increment();
+
+    // 一次可读事件 accept 多个连接，减少短连接风暴时 epoll_wait 的次数。
+    // 设置上限，避免一直 accept 而饿死已建立的连接；没有 accept 完的连接，下一次事件循环还会触发可读事件（水平触发）。
+    int accepted = 0;
+    int dropped = 0;
+    int i = 0;
+    for (; i < maxAcceptsPerWakeup_; ++i) {
+        InternetAddress peerAddress;
+        Socket connectionSocket(acceptSocket_.accept(&peerAddress));
+        if (connectionSocket.fd() >= 0) {
+            ++accepted;
+            if (newConnectionCallback_) {
+                // 移动 Socket，保证资源的安全释放
+                newConnectionCallback_(std::move(connectionSocket), peerAddress);
+            }
+            continue;
+        }
+
+        int savedErrno = errno;
+        if (savedErrno == EMFILE || savedErrno == ENFILE) {
+            // 文件描述符用完，连接还在 accept 队列中，listen socket 一直可读，
+            // 如果不处理，IO 线程会一直被唤醒而空转。丢弃连接，让客户端尽快得知失败。
+            if (dropConnection()) {
+                ++dropped;
+                continue;
+            }
+            break;
+        } else if (savedErrno == ECONNABORTED || savedErrno == EINTR ||
+                   savedErrno == EPROTO || savedErrno == EPERM) {
+            // 只是当前连接失败，继续 accept 下一个连接
+            continue;
+        } else {
+            // EAGAIN：accept 队列已经空了；其他错误已在 Socket::accept() 中记录
+            break;
         }
     }
 
-    // 一直 accept 到 EAGAIN 为止。这样需要多一次系统调用。
-    // TODO 测试新能
-//    while (auto sockfd = acceptSocket_.accept(&peerAddress)) {
-//        if (sockfd < 0) {
-//            return;
-//        }
-//
-//        Socket connectionSocket(sockfd);
-//        if (newConnectionCallback_) {
-//            newConnectionCallback_(std::move(connectionSocket), peerAddress);
-//        }
-//    }
+    accepted_.add(accepted);
+    if (dropped > 0) {
+        dropped_.add(dropped);
+        debug(LogLevel::WARN) << "Acceptor::handleRead() too many open files, dropped "
+                              << dropped << " connections" << std::endl;
+    }
+    if (i == maxAcceptsPerWakeup_) {
+        fullBatches_.increment();
+    }
 }
 
+bool Acceptor::dropConnection() {
+    if (idleFd_ < 0) {
+        return false;
+    }
+
+    // 关闭预留的文件描述符，腾出一个位置，accept 后马上关闭，再重新预留
+    ::close(idleFd_);
+    int sockfd = ::accept(acceptSocket_.fd(), nullptr, nullptr);
+    if (sockfd >= 0) {
+        ::close(sockfd);
+    }
+    idleFd_ = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
+
+    return sockfd >= 0;
+}
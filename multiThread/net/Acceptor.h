@@ -4,6 +4,7 @@
 #include <functional>
 
 #include "../base/noncopyable.h"
+#include "../base/Atomic.h"
 #include "Channel.h"
 #include "Socket.h"
 
@@ -18,12 +19,25 @@ namespace tinyWS_thread {
         // 新连接到来时的回调函数的类型
         using NewConnectionCallback = std::function<void(Socket, const InternetAddress&)>;
 
+        // accept 的统计数据
+        struct Stats {
+            Stats() : wakeups(0), accepted(0), dropped(0), fullBatches(0) {}
+
+            int64_t wakeups;        // listen socket 可读的次数
+            int64_t accepted;       // accept 的连接数，accepted / wakeups 即每次可读平均 accept 的连接数
+            int64_t dropped;        // 文件描述符用完时丢弃的连接数
+            int64_t fullBatches;    // 一次 accept 的连接数达到上限的次数，经常达到上限说明上限太小
+        };
+
+        static const int kDefaultMaxAcceptsPerWakeup = 16;
+
         /**
          * 构造函数
          * @param loop 所属 EventLoop
          * @param listenAddress 监听的地址
+         * @param reusePort 是否设置 SO_REUSEPORT，每个 IO 线程一个 Acceptor 时使用
          */
-        Acceptor(EventLoop *loop, const InternetAddress &listenAddress);
+        Acceptor(EventLoop *loop, const InternetAddress &listenAddress, bool reusePort = false);
 
         ~Acceptor();
 
@@ -33,6 +47,19 @@ namespace tinyWS_thread {
          */
         void setNewConnectionCallback(const NewConnectionCallback &cb);
 
+        /**
+         * 设置 listen socket 每次可读时最多 accept 的连接数
+         * @param maxAccepts 连接数，至少为 1
+         */
+        void setMaxAcceptsPerWakeup(int maxAccepts);
+
+        /**
+         * ---线程安全---
+         * 获取 accept 的统计数据
+         * @return 统计数据
+         */
+        Stats stats();
+
         /**
          * 是否处于监听状态
          * @return true / false
@@ -44,6 +71,27 @@ namespace tinyWS_thread {
          */
         void listen();
 
+        /**
+         * 获取所属 EventLoop
+         * @return EventLoop
+         */
+        EventLoop* getLoop() const;
+
+        /**
+         * 设置监听 socket 的 SO_INCOMING_CPU，需要在 listen() 之前调用
+         * @param cpu CPU 编号
+         * @return 是否设置成功
+         */
+        bool setIncomingCpu(int cpu);
+
+        /**
+         * 给监听 socket 所在的 SO_REUSEPORT 组添加按 CPU 选择 socket 的 BPF 程序，
+         * 需要在组中所有 socket 都调用 listen() 之后调用
+         * @param groupSize 组中监听 socket 的数量
+         * @return 是否设置成功
+         */
+        bool attachReusePortCpuFilter(int groupSize);
+
         /**
          * 创建无阻塞的 socket
          * @return socket
@@ -56,11 +104,24 @@ namespace tinyWS_thread {
         Channel acceptChannel_;                         // 用于观察 acceptSocket_ 的 readable 事件
         NewConnectionCallback newConnectionCallback_;   // 新连接到来时的回调函数
         bool isListening_;                              // 是否处于监听状态
+        int idleFd_;                                    // 预留的文件描述符，文件描述符用完时用于丢弃连接
+        int maxAcceptsPerWakeup_;                       // 每次可读时最多 accept 的连接数
+        AtomicInt64 wakeups_;                           // 见 Stats
+        AtomicInt64 accepted_;
+        AtomicInt64 dropped_;
+        AtomicInt64 fullBatches_;
+
+        /**
+         * 读数据，获取新连接对应的 socket fd，并调用新连接到来时的回调函数，通知用户有新的连接。
+         * 每次最多 accept maxAcceptsPerWakeup_ 个连接。
+         */
+        void handleRead();
 
         /**
-         * 读数据，获取新连接对应的 socket fd，并调用新连接到来时的回调函数，停止用户有新的连接。
+         * 文件描述符用完（EMFILE / ENFILE）时，用预留的文件描述符 accept 一个连接并马上关闭
+         * @return 是否丢弃了连接
          */
-        void hadleRead();
+        bool dropConnection();
     };
 }
 
@@ -232,6 +232,10 @@ void Buffer::shrink(size_t reserve) {
     swap(temp);
 }
 
+size_t Buffer::internalCapacity() const {
+    return buffer_.capacity();
+}
+
 void Buffer::hasWritten(size_t len) {
     writerIndex_ += len;
 }
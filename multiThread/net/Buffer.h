@@ -267,6 +267,12 @@ namespace tinyWS_thread {
          */
         void shrink(size_t reserve);
 
+        /**
+         * 缓冲区占用的内存大小（包括 prependable 区域）
+         * @return 字节数
+         */
+        size_t internalCapacity() const;
+
         /**
          * 从 fd 读取数据到缓冲区。
          * @param fd 文件描述符，通常情况下是 socket fd
@@ -20,6 +20,7 @@ Channel::Channel(EventLoop *loop, int fdArg)
       fd_(fdArg),
       events_(0),
       revents_(0),
+      edgeTriggered_(false),
       statusInEpoll_(-1),
       eventHandling_(false),
       addedToLoop_(false),
@@ -75,7 +76,8 @@ int Channel::fd() const {
 }
 
 int Channel::getEvents() const {
-    return events_;
+    // EPOLLET 不属于用户关心的事件，只在向 Epoll 注册时附加上
+    return edgeTriggered_ ? (events_ | EPOLLET) : events_;
 }
 
 void Channel::setRevents(int revt) {
@@ -86,11 +88,20 @@ bool Channel::isNoneEvent() const {
     return events_ == kNoneEvent;
 }
 
+bool Channel::addedToLoop() const {
+    return addedToLoop_;
+}
+
 void Channel::enableReading() {
     events_ |= kReadEvent;
     update();
 }
 
+void Channel::disableReading() {
+    events_ &= ~kReadEvent;
+    update();
+}
+
 void Channel::enableWriting() {
     events_ |= kWriteEvent;
     update();
@@ -106,10 +117,22 @@ void Channel::disableAll() {
     update();
 }
 
+void Channel::setEdgeTriggered(bool on) {
+    edgeTriggered_ = on;
+}
+
+bool Channel::isEdgeTriggered() const {
+    return edgeTriggered_;
+}
+
 bool Channel::isWriting() const {
     return static_cast<bool>(events_ & kWriteEvent);
 }
 
+bool Channel::isReading() const {
+    return static_cast<bool>(events_ & kReadEvent);
+}
+
 int Channel::getStatusInEpoll() {
     return statusInEpoll_;
 }
@@ -128,6 +151,18 @@ void Channel::remove() {
     loop_->removeChannel(this);
 }
 
+void Channel::reset(int fd) {
+    assert(!eventHandling_);
+    assert(!addedToLoop_);
+    fd_ = fd;
+    events_ = kNoneEvent;
+    revents_ = kNoneEvent;
+    edgeTriggered_ = false;
+    statusInEpoll_ = -1;
+    tie_.reset();
+    tied_ = false;
+}
+
 std::string Channel::reventsToString() const {
     return eventsToString(fd_, revents_);
 }
@@ -206,6 +241,9 @@ std::string Channel::eventsToString(int fd, int event) const {
     if (event & EPOLLERR) {
         oss << "ERR ";
     }
+    if (event & EPOLLET) {
+        oss << "ET ";
+    }
 
     return oss.str();
 }
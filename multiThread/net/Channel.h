@@ -86,11 +86,22 @@ namespace tinyWS_thread {
          */
         bool isNoneEvent() const;
 
+        /**
+         * 是否已经添加到 EventLoop（Poller）中，remove() 之后为 false
+         * @return true / false
+         */
+        bool addedToLoop() const;
+
         /**
          * 设置可读
          */
         void enableReading();
 
+        /**
+         * 设置不可读
+         */
+        void disableReading();
+
         /**
          * 设置可写
          */
@@ -109,12 +120,32 @@ namespace tinyWS_thread {
          */
         void disableAll();
 
+        /**
+         * 设置是否使用 edge trigger
+         * 只影响之后向 Epoll 注册的事件，需要在 enableReading() 之前调用。
+         * 使用 edge trigger 时，事件回调函数必须一直读 / 写到 EAGAIN 为止，否则会丢失事件。
+         * @param on true / false
+         */
+        void setEdgeTriggered(bool on);
+
+        /**
+         * 是否使用 edge trigger
+         * @return true / false
+         */
+        bool isEdgeTriggered() const;
+
         /**
          * 是否正在写数据
          * @return true / false
          */
         bool isWriting() const;
 
+        /**
+         * 是否关注读事件
+         * @return true / false
+         */
+        bool isReading() const;
+
         /**
          * 返回 statusInEpoll_，即 Channel 在 Epoll 中的状态
          * @return statusInEpoll_ Channel 在 Epoll 中的状态
@@ -138,6 +169,14 @@ namespace tinyWS_thread {
          */
         void remove();
 
+        /**
+         * 复用 Channel（见 TcpConnectionPool），改为负责另一个文件描述符，
+         * 并清除事件、Epoll 状态和绑定的对象，保留回调函数。
+         * 调用前必须已经从 EventLoop 中移除。
+         * @param fd 新的文件描述符
+         */
+        void reset(int fd);
+
         // for debug
         std::string reventsToString() const;
 
@@ -152,6 +191,7 @@ namespace tinyWS_thread {
         int fd_;                            // 负责的文件描述符
         int events_;                        // IO事件，由用户设置。bit pattern
         int revents_;                       // 目前活动事件，由 EventLoop / Epoll 设置。bit pattern
+        bool edgeTriggered_;                // 是否使用 edge trigger（EPOLLET），默认为 level trigger
 
         // 给 Epoll 使用，表示 Channel 的状态（全新、已添加、已删除），
         // 因为 Channel 并不会使用到该状态值，并不关心改状态值的类型和值，
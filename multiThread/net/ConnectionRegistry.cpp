@@ -0,0 +1,72 @@
+#include "ConnectionRegistry.h"
+
+#include <cassert>
+
+using namespace tinyWS_thread;
+
+ConnectionRegistry::ConnectionRegistry(int loopIndex)
+    : loopIndex_(static_cast<uint64_t>(loopIndex)),
+      nextSequence_(0),
+      size_(0) {
+
+    assert(loopIndex >= 0 && loopIndex < (1 << 16));
+}
+
+uint64_t ConnectionRegistry::allocateId() {
+    uint32_t slot;
+    if (freeSlots_.empty()) {
+        assert(slots_.size() <= kSlotMask);
+        slot = static_cast<uint32_t>(slots_.size());
+        slots_.push_back(Slot{0, nullptr});
+    } else {
+        slot = freeSlots_.back();
+        freeSlots_.pop_back();
+    }
+
+    uint64_t sequence = nextSequence_++ & kSequenceMask;
+    uint64_t id = (loopIndex_ << (kSlotBits + kSequenceBits)) | (sequence << kSlotBits) | slot;
+    slots_[slot].id = id;
+    return id;
+}
+
+void ConnectionRegistry::add(uint64_t id, const TcpConnectionPtr &connection) {
+    Slot &slot = slots_[id & kSlotMask];
+    assert(slot.id == id && !slot.connection);
+    slot.connection = connection;
+    ++size_;
+}
+
+bool ConnectionRegistry::remove(uint64_t id) {
+    uint64_t index = id & kSlotMask;
+    if (index >= slots_.size() || slots_[index].id != id || !slots_[index].connection) {
+        return false;
+    }
+
+    slots_[index].id = 0;
+    slots_[index].connection.reset();
+    freeSlots_.push_back(static_cast<uint32_t>(index));
+    --size_;
+    return true;
+}
+
+size_t ConnectionRegistry::size() const {
+    return size_;
+}
+
+std::vector<TcpConnectionPtr> ConnectionRegistry::releaseAll() {
+    std::vector<TcpConnectionPtr> connections;
+    connections.reserve(size_);
+    for (auto &slot : slots_) {
+        if (slot.connection) {
+            connections.push_back(std::move(slot.connection));
+        }
+    }
+    slots_.clear();
+    freeSlots_.clear();
+    size_ = 0;
+    return connections;
+}
+
+int ConnectionRegistry::loopIndexOf(uint64_t id) {
+    return static_cast<int>(id >> (kSlotBits + kSequenceBits));
+}
@@ -0,0 +1,86 @@
+#ifndef TINYWS_CONNECTIONREGISTRY_H
+#define TINYWS_CONNECTIONREGISTRY_H
+
+#include <cstdint>
+#include <vector>
+
+#include "../base/noncopyable.h"
+#include "TcpConnection.h"
+
+namespace tinyWS_thread {
+
+    // 每个 IO 线程一个的连接表，只在所属 IO 线程中访问，不需要加锁。
+    //
+    // 连接 ID 为 64 位整数：
+    // 高 16 位为 IO 线程的下标，中间 24 位为该 IO 线程分配 ID 的序号（回绕），低 24 位为连接在表中的槽下标。
+    // 槽下标直接由 ID 得到，所以添加、删除都是 O(1)，且不需要哈希和字符串比较。
+    // 空闲的槽放在空闲列表中复用，连接表是一个连续的数组。
+    class ConnectionRegistry : noncopyable {
+    public:
+        /**
+         * 构造函数
+         * @param loopIndex IO 线程的下标
+         */
+        explicit ConnectionRegistry(int loopIndex);
+
+        /**
+         * 分配一个空闲的槽，返回新连接的 ID，之后调用 add() 放入连接
+         * @return 连接 ID
+         */
+        uint64_t allocateId();
+
+        /**
+         * 把连接放入 allocateId() 分配的槽中
+         * @param id 连接 ID
+         * @param connection 连接
+         */
+        void add(uint64_t id, const TcpConnectionPtr &connection);
+
+        /**
+         * 删除连接，槽放回空闲列表
+         * @param id 连接 ID
+         * @return 是否删除成功（ID 不存在时返回 false）
+         */
+        bool remove(uint64_t id);
+
+        /**
+         * 连接数
+         * @return 连接数
+         */
+        size_t size() const;
+
+        /**
+         * 取出所有的连接，并清空连接表
+         * @return 连接列表
+         */
+        std::vector<TcpConnectionPtr> releaseAll();
+
+        /**
+         * 连接 ID 所属 IO 线程的下标
+         * @param id 连接 ID
+         * @return IO 线程的下标
+         */
+        static int loopIndexOf(uint64_t id);
+
+    private:
+        static const int kSlotBits = 24;
+        static const int kSequenceBits = 24;
+        static const uint64_t kSlotMask = (1ULL << kSlotBits) - 1;
+        static const uint64_t kSequenceMask = (1ULL << kSequenceBits) - 1;
+
+        // 槽：连接和它的 ID（用于检查删除的是不是同一个连接）
+        struct Slot {
+            uint64_t id;
+            TcpConnectionPtr connection;
+        };
+
+        const uint64_t loopIndex_;          // IO 线程的下标
+        uint64_t nextSequence_;             // 下一个 ID 的序号
+        std::vector<Slot> slots_;           // 连接表
+        std::vector<uint32_t> freeSlots_;   // 空闲的槽下标
+        size_t size_;                       // 连接数
+    };
+}
+
+
+#endif //TINYWS_CONNECTIONREGISTRY_H
@@ -20,7 +20,7 @@ const int kAdded = 1;
 const int kDeleted = 2;
 
 Epoll::Epoll(EventLoop *loop)
-    : ownerLoop_(loop),
+    : Poller(loop),
       epollfd_(epoll_create1(EPOLL_CLOEXEC)),
       events_(kInitEventListSize) {
 
@@ -113,11 +113,11 @@ bool Epoll::hasChannel(tinyWS_thread::Channel *channel) {
     return it != channels_.end() && it->second == channel;
 }
 
-void Epoll::assertInLoopThread() {
-    ownerLoop_->assertInLoopThread();
+const char* Epoll::name() const {
+    return "epoll";
 }
 
-void Epoll::fillActiveChannels(int eventNums, Epoll::ChannelList *activeChannels) const {
+void Epoll::fillActiveChannels(int eventNums, ChannelList *activeChannels) const {
     assert((size_t) eventNums <= events_.size());
 
     for (int i = 0; i < eventNums; ++i) {
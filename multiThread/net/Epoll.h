@@ -8,7 +8,7 @@
 #include <string>
 #include <memory>
 
-#include "../base/noncopyable.h"
+#include "Poller.h"
 #include "Timer.h"
 
 namespace tinyWS_thread {
@@ -21,17 +21,14 @@ namespace tinyWS_thread {
     //   当有事件发生时，将"活跃"的 Channel 填充到 activeChannel 中，
     //   供 EventLoop 处理相应的事件，即调用 Channel::handleEvent()。
     //
-    // Epoll 是 EventLoop 对象的间接成员，
-    // 只供 owner EventLoop 在 IO 线程调用，因此无须加锁。
-    // 其生命周期与 EVentLoop 一样长。
+    // Epoll 是 Poller 的默认实现。
     //
-    // Epoll 采用的是 level trigger。
-    class Epoll : noncopyable {
+    // Epoll 默认采用的是 level trigger，
+    // Channel 可以通过 Channel::setEdgeTriggered() 改为 edge trigger。
+    class Epoll : public Poller {
     public:
-        using ChannelList = std::vector<Channel*>;  // Channel 列表类型
-
         explicit Epoll(EventLoop *loop);
-        ~Epoll();
+        ~Epoll() override;
 
         /**
          * --- 只能在 IO 线程中调用 ---
@@ -40,21 +37,21 @@ namespace tinyWS_thread {
          * @param activeChannels "活动"的 Channel
          * @return 响应时间
          */
-        Timer::TimeType poll(int timeoutMs, ChannelList *activeChannels);
+        Timer::TimeType poll(int timeoutMs, ChannelList *activeChannels) override;
 
         /**
          * --- 只能在 IO 线程中调用 ---
          * 更新 Channel
          * @param channel
          */
-        void updateChannel(Channel *channel);
+        void updateChannel(Channel *channel) override;
 
         /**
          * --- 只能在 IO 线程中调用 ---
          * 移除 Channel
          * @param channel
          */
-        void removeChannel(Channel *channel);
+        void removeChannel(Channel *channel) override;
 
         /**
          * --- 只能在 IO 线程中调用 ---
@@ -62,13 +59,9 @@ namespace tinyWS_thread {
          * @param channel Channel
          * @return true / false
          */
-        bool hasChannel(Channel *channel);
+        bool hasChannel(Channel *channel) override;
 
-        /**
-         * 断言
-         * 判断该调用线程是否为 IO 线程
-         */
-        void assertInLoopThread();
+        const char* name() const override;
 
     private:
         using EventList = std::vector<epoll_event>; // epoll 事件列表类型
@@ -76,7 +69,6 @@ namespace tinyWS_thread {
 
         static const int kInitEventListSize = 16;   // 事件数组（EventList）的默认大小
 
-        EventLoop *ownerLoop_;                      // 所属事件循环
         int epollfd_;                               // epoll 文件描述符
         EventList events_;                          // 活动的文件描述符列表
         ChannelMap channels_;                       // <活动文件描述符, Channel> 映射
@@ -9,7 +9,7 @@
 #include "../base/Logger.h"
 #include "../base/Thread.h"
 #include "Channel.h"
-#include "Epoll.h"
+#include "Poller.h"
 #include "TimerQueue.h"
 #include "TimerId.h"
 
@@ -18,7 +18,10 @@ using namespace tinyWS_thread;
 // __thread 关键字可将变量声明为线程局部变量
 __thread EventLoop *t_loopInThisThread = nullptr; // IO 线程
 
-const int kEpollTimeMs = 10000;
+const int kPollTimeMs = 10000;
+
+// 统计忙碌时间占比的周期（微秒）
+const Timer::TimeType kBusyWindow = 100 * 1000;
 
 int createEventfd() {
     int evfd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
@@ -30,15 +33,83 @@ int createEventfd() {
     return evfd;
 }
 
+// PendingFunctor 节点池，避免每次 queueInLoop() 都 new 一个节点、doPendingFunctors() 再 delete。
+//
+// IO 线程处理完一批节点之后，整批放回全局的空闲链表（一次 CAS）；
+// 生产者线程的线程局部缓存为空时，一次取走全局空闲链表中的所有节点（一次原子交换），之后从缓存中分配，不需要同步。
+// 全局空闲链表只有整批放入和整批取走两种操作，没有 ABA 问题。
+// 稳定运行时节点只在 IO 线程和生产者线程之间循环，节点数等于同时在队列中的 pending functor 数的峰值。
+class EventLoop::FunctorPool {
+public:
+    /**
+     * --- 线程安全 ---
+     * 分配节点
+     * @param cb pending functor
+     * @return 节点
+     */
+    static PendingFunctor* allocate(Functor &&cb) {
+        Cache &cache = cache_;
+        if (cache.head == nullptr) {
+            cache.head = free_.takeAll();
+        }
+        PendingFunctor *node = cache.head;
+        if (node == nullptr) {
+            return new PendingFunctor{std::move(cb), nullptr};
+        }
+        cache.head = node->next;
+        node->functor = std::move(cb);
+        node->next = nullptr;
+        return node;
+    }
+
+    /**
+     * --- 线程安全 ---
+     * 整批放回节点（functor 已经清空）
+     * @param first 第一个节点
+     * @param last 最后一个节点，first 到 last 已经用 next 连接好
+     */
+    static void release(PendingFunctor *first, PendingFunctor *last) {
+        free_.pushChain(first, last);
+    }
+
+private:
+    // 线程局部缓存，线程退出时释放其中的节点
+    struct Cache {
+        PendingFunctor *head = nullptr;
+
+        ~Cache() {
+            while (head != nullptr) {
+                PendingFunctor *next = head->next;
+                delete head;
+                head = next;
+            }
+        }
+    };
+
+    // 全局空闲链表。进程退出时其他线程可能还在使用，所以不释放其中的节点
+    static MpscQueue<PendingFunctor> free_;
+    static thread_local Cache cache_;
+};
+
+MpscQueue<EventLoop::PendingFunctor> EventLoop::FunctorPool::free_;
+thread_local EventLoop::FunctorPool::Cache EventLoop::FunctorPool::cache_;
+
 EventLoop::EventLoop()
     : looping_(false),
       quit_(false),
       callingPendingFuntors_(false),
       threadId_(Thread::gettid()),
-      epoll_(new Epoll(this)),
+      poller_(Poller::newDefaultPoller(this)),
       timerQueue_(new TimerQueue(this)),
       wakeupFd_(createEventfd()),
-      wakeupChannel_(new Channel(this, wakeupFd_)) {
+      wakeupChannel_(new Channel(this, wakeupFd_)),
+      wakeupPending_(false),
+      connectionCount_(0),
+      pendingFunctorCount_(0),
+      busyPermille_(0),
+      busyUpdateTime_(0),
+      busyTime_(0),
+      busyWindowStart_(Timer::now()) {
 
 //    debug() << "EventLoop created "
 //            << this << " in thread "
@@ -66,6 +137,14 @@ EventLoop::~EventLoop() {
     wakeupChannel_->remove();
     ::close(wakeupFd_);
 
+    // 释放没有执行的 pending functor
+    PendingFunctor *node = pendingFunctors_.popAll();
+    while (node != nullptr) {
+        PendingFunctor *next = node->next;
+        delete node;
+        node = next;
+    }
+
     t_loopInThisThread = nullptr;
 }
 
@@ -89,13 +168,27 @@ void EventLoop::loop() {
 
 //    debug() << "EventLoop " << this << "start looping" << std::endl;
 
+    // 除了 poll 返回的 receiveTime，每次事件循环只在分发完事件之后读一次时钟，
+    // 执行了 pending functor 时才再读一次（没有 functor 时执行时间为 0，不必读）。
+    // 上一次循环结束的时刻就是这一次 poll 开始的时刻，不用单独读。
+    Timer::TimeType pollStart = Timer::now();
     while (!quit_) {
         activeChannels_.clear(); // 清空 Channel 列表，以获取新的 Channel 列表
-        auto receiveTime = epoll_->poll(kEpollTimeMs, &activeChannels_); // 阻塞，等待事件的"到来"
+        auto receiveTime = poller_->poll(kPollTimeMs, &activeChannels_); // 阻塞，等待事件的"到来"
         for (const auto &channel : activeChannels_) {
             channel->handleEvent(receiveTime);
         }
-        doPendingFunctors();
+        Timer::TimeType dispatchEnd = Timer::now();
+        int functors = doPendingFunctors();
+        Timer::TimeType now = functors > 0 ? Timer::now() : dispatchEnd;
+
+        updateBusyTime(receiveTime, now);
+        stats_.recordIteration(static_cast<uint64_t>(receiveTime - pollStart),
+                               static_cast<uint64_t>(dispatchEnd - receiveTime),
+                               static_cast<uint64_t>(now - dispatchEnd),
+                               activeChannels_.size(),
+                               static_cast<uint64_t>(functors));
+        pollStart = now;
     }
 
 //    debug() << "EVentLoop " << this << " stop looping" << std::endl;
@@ -126,26 +219,44 @@ void EventLoop::runInLoop(const Functor &cb) {
     }
 }
 
-void EventLoop::queueInLoop(const Functor &cb) {
-    {
-        MutexLockGuard lock(mutex_);
-        pendingFunctors_.push_back(cb);
+void EventLoop::runInLoop(Functor &&cb) {
+    if (isInLoopThread()) {
+        cb();
+    } else {
+        queueInLoop(std::move(cb));
     }
+}
+
+void EventLoop::queueInLoop(const Functor &cb) {
+    queueInLoop(Functor(cb));
+}
+
+void EventLoop::queueInLoop(Functor &&cb) {
+    // 先增加计数再加入队列，保证计数不会小于 0
+    pendingFunctorCount_.fetch_add(1, std::memory_order_relaxed);
+    // 无锁加入队列，不再需要 mutex_
+    pendingFunctors_.push(FunctorPool::allocate(std::move(cb)));
 
     // 有两种情况需要唤醒 IO 线程：
     // 1. 在非 IO 线程调用 EventLoop::queueInLoop()；
     // 2. 在 IO 线程调用 EventLoop::queueInLoop()，但此时正在调用 EventLoop::doPendingFunctors()。
     //    实质上，EventLoop::queueInLoop() 就是在其中一个 pending functor 中被调用了。
     //    根据 EventLoop::doPendingFunctors() 的实现，doPendingFunctors() 函数被调用时，
-    //    为了缩小临界区，会将 pendingFunctors_ 数组 swap 到一个临时数组中，再处理。
+    //    会一次取走队列中的所有 pending functor，再处理。
     //    那此时加入队列的函数是不会在此次处理 pending functor 中被调用。
     //    所以，为了尽快调用该 cb 函数，则需要调用 EventLoop::wakeup()，在下次循环中立即唤醒 IO 线程。
     //
     // 总结，只有在 IO 线程的事件回调函数中调用 EventLoop::queueInLoop()
     // 才无须调用 EventLoop::wakeup() 唤醒 IO 线程。因为在事件回调处理完之后，
     // 会调用 doPendingFunctors() 函数，处理 pending functor，该 cb  函数也会被调用。
+    //
+    // 如果 wakeupPending_ 已经为 true，说明已经有线程写过 wakeupFd_，
+    // 而 IO 线程还没开始处理 pending functor（doPendingFunctors() 会先清除标志，再取走队列），
+    // 此次加入的 cb 一定会在那次处理中被调用，所以无须再写 wakeupFd_。
     if (!isInLoopThread() || callingPendingFuntors_) {
-        wakeup();
+        if (!wakeupPending_.exchange(true)) {
+            wakeup();
+        }
     }
 }
 
@@ -179,20 +290,52 @@ void EventLoop::updateChannel(Channel *channel) {
     assert(channel->ownerLoop() == this);
     assertInLoopThread();
 
-    epoll_->updateChannel(channel);
+    poller_->updateChannel(channel);
 }
 
 void EventLoop::removeChannel(Channel *channel) {
     assert(channel->ownerLoop() == this);
     assertInLoopThread();
 
-    epoll_->removeChannel(channel);
+    poller_->removeChannel(channel);
 }
 
 bool EventLoop::hasChannel(tinyWS_thread::Channel *channel) {
     assert(channel->ownerLoop() == this);
     assertInLoopThread();
-    return epoll_->hasChannel(channel);
+    return poller_->hasChannel(channel);
+}
+
+void EventLoop::addConnectionCount(int delta) {
+    connectionCount_.fetch_add(delta, std::memory_order_relaxed);
+}
+
+int EventLoop::connectionCount() const {
+    return connectionCount_.load(std::memory_order_relaxed);
+}
+
+int EventLoop::pendingFunctorCount() const {
+    return pendingFunctorCount_.load(std::memory_order_relaxed);
+}
+
+int EventLoop::busyPermille() const {
+    // 超过两个统计周期没有更新，说明 IO 线程一直阻塞在 poll 中
+    if (Timer::now() - busyUpdateTime_.load(std::memory_order_relaxed) > 2 * kBusyWindow) {
+        return 0;
+    }
+    return busyPermille_.load(std::memory_order_relaxed);
+}
+
+EventLoopStats::Snapshot EventLoop::stats() const {
+    EventLoopStats::Snapshot snapshot = stats_.snapshot();
+    snapshot.pendingQueueDepth = pendingFunctorCount();
+    snapshot.connections = connectionCount();
+    snapshot.busyPermille = busyPermille();
+    return snapshot;
+}
+
+void EventLoop::recordTimerLag(Timer::TimeType lag) {
+    stats_.recordTimerLag(lag > 0 ? static_cast<uint64_t>(lag) : 0);
 }
 
 EventLoop* EventLoop::getEventLoopOfCurrentThread() {
@@ -216,21 +359,43 @@ void EventLoop::handleRead() {
     }
 }
 
-void EventLoop::doPendingFunctors() {
-    std::vector<Functor> functors;
+void EventLoop::updateBusyTime(Timer::TimeType busyStart, Timer::TimeType now) {
+    busyTime_ += now - busyStart;
+
+    Timer::TimeType elapsed = now - busyWindowStart_;
+    if (elapsed >= kBusyWindow) {
+        busyPermille_.store(static_cast<int>(busyTime_ * 1000 / elapsed), std::memory_order_relaxed);
+        busyUpdateTime_.store(now, std::memory_order_relaxed);
+        busyTime_ = 0;
+        busyWindowStart_ = now;
+    }
+}
+
+int EventLoop::doPendingFunctors() {
     callingPendingFuntors_ = true;
 
-    // 将 pendingFunctors_ swap 到临时 functors，再处理 pending functor，
-    // 这样可以缩短临界区，同时清空 pendingFunctors_。
-    {
-        MutexLockGuard lock(mutex_);
-        functors.swap(pendingFunctors_);
+    // 先清除唤醒标志，再取走队列中所有的 pending functor。
+    // 顺序不能反过来：生产者先加入队列，再检查标志。
+    // 如果生产者看到的标志为 true（因此没有写 wakeupFd_），那么它加入的节点一定能被下面的 popAll() 取走。
+    wakeupPending_.store(false);
+    PendingFunctor *first = pendingFunctors_.popAll();
+    PendingFunctor *last = nullptr;
+    int count = 0;
+    for (PendingFunctor *node = first; node != nullptr; node = node->next) {
+        node->functor();
+        // 立即释放 functor 捕获的对象（如 TcpConnectionPtr），节点之后放回节点池
+        node->functor = nullptr;
+        last = node;
+        ++count;
     }
-    for (const auto &functor : functors) {
-        functor();
+    if (count > 0) {
+        FunctorPool::release(first, last);
+        pendingFunctorCount_.fetch_sub(count, std::memory_order_relaxed);
     }
 
     callingPendingFuntors_ = false;
+
+    return count;
 }
 
 void EventLoop::printActiveChannels() const {
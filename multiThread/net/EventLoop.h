@@ -6,14 +6,16 @@
 #include <vector>
 #include <memory>
 #include <functional>
+#include <atomic>
 
 #include "../base/noncopyable.h"
-#include "../base/MutexLock.h"
+#include "../base/MpscQueue.h"
 #include "Timer.h"
+#include "EventLoopStats.h"
 
 namespace tinyWS_thread {
     class Channel;
-    class Epoll;
+    class Poller;
     class TimerQueue;
     class TimerId;
 
@@ -67,6 +69,9 @@ namespace tinyWS_thread {
          */
         void runInLoop(const Functor &cb);
 
+        // 同上，移动回调函数，避免拷贝其绑定的参数
+        void runInLoop(Functor &&cb);
+
         /**
          * --- 安全线程 ---
          * 将回调函数放到队列中，并在必要时唤醒 IO 线程。
@@ -75,6 +80,9 @@ namespace tinyWS_thread {
          */
         void queueInLoop(const Functor &cb);
 
+        // 同上，移动回调函数，避免拷贝其绑定的参数
+        void queueInLoop(Functor &&cb);
+
         /**
          * --- 安全线程 ---
          * 在指定时间调用 cb
@@ -116,9 +124,9 @@ namespace tinyWS_thread {
         void wakeup();
 
 
-         // EVentLoop 不关心 Epoll 如何管理 Channel 列表，
-         // 所以在 updateChannel 内部直接调用 Epoll::updateChannel
-         // 在 removeChannel 内部直接调用 Epoll::removeChannel
+         // EVentLoop 不关心 Poller 如何管理 Channel 列表，
+         // 所以在 updateChannel 内部直接调用 Poller::updateChannel
+         // 在 removeChannel 内部直接调用 Poller::removeChannel
 
         /**
          * 更新 channel
@@ -134,12 +142,59 @@ namespace tinyWS_thread {
 
         /**
          * --- 只能在 IO 线程中调用 ---
-         * channel 是否被 Epoll 监听中。
+         * channel 是否被 Poller 监听中。
          * @param channel Channel
          * @return true / false
          */
         bool hasChannel(Channel *channel);
 
+        // 以下为 EventLoop 的负载，供 EventLoopThreadPool 选择 EventLoop。
+        // 都是原子变量，读写只需要一次原子操作，不需要加锁。
+
+        /**
+         * --- 线程安全 ---
+         * 修改 EventLoop 上的连接数（由 TcpServer 在连接建立和断开时调用）
+         * @param delta 变化量
+         */
+        void addConnectionCount(int delta);
+
+        /**
+         * --- 线程安全 ---
+         * 获取 EventLoop 上的连接数
+         * @return 连接数
+         */
+        int connectionCount() const;
+
+        /**
+         * --- 线程安全 ---
+         * 获取队列中还没有执行的 pending functor 数
+         * @return pending functor 数
+         */
+        int pendingFunctorCount() const;
+
+        /**
+         * --- 线程安全 ---
+         * 获取最近一个统计周期内，IO 线程处理事件和 pending functor 的时间占比。
+         * IO 线程长时间阻塞在 poll 中时，统计周期不会结束，此时认为 IO 线程空闲，返回 0。
+         * @return 千分比，0 ~ 1000
+         */
+        int busyPermille() const;
+
+        /**
+         * --- 线程安全 ---
+         * 获取运行时统计的快照：poll、处理事件、处理 pending functor 的时间，
+         * 每次的活跃 Channel 数、pending functor 数和定时器的延迟
+         * @return 快照
+         */
+        EventLoopStats::Snapshot stats() const;
+
+        /**
+         * 内部使用（TimerQueue）
+         * 记录一个到期定时器的延迟
+         * @param lag 实际执行时间与到期时间之差
+         */
+        void recordTimerLag(Timer::TimeType lag);
+
         /**
          * 获取线程的事件循环
          * @return EventLoop 对象
@@ -149,17 +204,37 @@ namespace tinyWS_thread {
     private:
         using ChannelList = std::vector<Channel*>;  // Channel 列表类型
 
+        // pending functor 队列的节点
+        struct PendingFunctor {
+            Functor functor;
+            PendingFunctor *next;
+        };
+
+        // PendingFunctor 节点池，所有 EventLoop 共用，见 EventLoop.cpp
+        class FunctorPool;
+
         bool looping_;                              // 是否在事件循环中
         bool quit_;                                 // 是否退出事件循环
         bool callingPendingFuntors_;                // 是否正在处理 pending functor
         const pid_t threadId_;                      // EventLoop 所属线程ID
-        std::unique_ptr<Epoll> epoll_;              // Epoll 对象指针
+        std::unique_ptr<Poller> poller_;            // Poller 对象指针（Epoll / IoUringPoller）
         std::unique_ptr<TimerQueue> timerQueue_;    // 定时器队列
         int wakeupFd_;                              // 用于唤醒 IO 线程的文件描述符
         std::unique_ptr<Channel> wakeupChannel_;    // 不需要像内部类 TimerQueue 一样暴露给客户端，不需共享所有权
         ChannelList activeChannels_;                // "活跃"的 Channel，表示有时间需要处理
-        MutexLock mutex_;                           // 互斥量对象
-        std::vector<Functor> pendingFunctors_;      // 需要在 IO 线程执行的"任务"（函数）
+        MpscQueue<PendingFunctor> pendingFunctors_; // 需要在 IO 线程执行的"任务"（函数），无锁队列
+
+        // 是否已经有未处理的唤醒（已写入 wakeupFd_，但 IO 线程还没开始处理 pending functor）。
+        // 多个线程在此期间调用 queueInLoop()，只有第一个会写 wakeupFd_。
+        std::atomic<bool> wakeupPending_;
+
+        std::atomic<int> connectionCount_;          // 连接数
+        std::atomic<int> pendingFunctorCount_;      // 队列中还没有执行的 pending functor 数
+        std::atomic<int> busyPermille_;             // 最近一个统计周期内的忙碌时间占比（千分比）
+        std::atomic<int64_t> busyUpdateTime_;       // busyPermille_ 的更新时刻
+        Timer::TimeType busyTime_;                  // 当前统计周期内累计的忙碌时间，只在 IO 线程中访问
+        Timer::TimeType busyWindowStart_;           // 当前统计周期的开始时刻，只在 IO 线程中访问
+        EventLoopStats stats_;                      // 运行时统计，只在 IO 线程中写
 
         /**
          * 如果不在 IO 线程中调用此函数，则打印 IO 线程信息
@@ -174,8 +249,16 @@ namespace tinyWS_thread {
 
         /**
          * 调用 pending functor
+         * @return 调用的 pending functor 数
+         */
+        int doPendingFunctors();
+
+        /**
+         * 累计忙碌时间，统计周期结束时更新 busyPermille_
+         * @param busyStart 本次事件循环开始忙碌的时刻（poll 返回的时刻）
+         * @param now 当前时刻
          */
-        void doPendingFunctors();
+        void updateBusyTime(Timer::TimeType busyStart, Timer::TimeType now);
 
         /**
          * 打印"活跃"的 Channel 的信息
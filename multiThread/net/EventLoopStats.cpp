@@ -0,0 +1,221 @@
+#include "EventLoopStats.h"
+
+#include <cstdio>
+
+using namespace tinyWS_thread;
+
+namespace {
+    /**
+     * 值所在的桶
+     * @param value 值
+     * @return 桶下标
+     */
+    int bucketOf(uint64_t value) {
+        if (value == 0) {
+            return 0;
+        }
+        // 64 - 前导 0 的个数，即 value 的二进制位数
+        int bits = 64 - __builtin_clzll(value);
+        return bits < Histogram::kBuckets ? bits : Histogram::kBuckets - 1;
+    }
+
+    /**
+     * 单写者递增：只有一个线程写，原子的读和写即可，不需要 lock 前缀的读-改-写
+     */
+    void add(std::atomic<uint64_t> &counter, uint64_t value) {
+        counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+}
+
+Histogram::Snapshot::Snapshot()
+    : buckets(),
+      count(0),
+      sum(0),
+      max(0) {
+
+}
+
+void Histogram::Snapshot::merge(const Snapshot &other) {
+    for (int i = 0; i < kBuckets; ++i) {
+        buckets[i] += other.buckets[i];
+    }
+    count += other.count;
+    sum += other.sum;
+    if (other.max > max) {
+        max = other.max;
+    }
+}
+
+void Histogram::Snapshot::subtract(const Snapshot &earlier) {
+    for (int i = 0; i < kBuckets; ++i) {
+        buckets[i] -= earlier.buckets[i];
+    }
+    count -= earlier.count;
+    sum -= earlier.sum;
+}
+
+double Histogram::Snapshot::mean() const {
+    return count > 0 ? static_cast<double>(sum) / count : 0.0;
+}
+
+uint64_t Histogram::Snapshot::percentile(double percentile) const {
+    if (count == 0) {
+        return 0;
+    }
+
+    uint64_t rank = static_cast<uint64_t>(percentile / 100.0 * count);
+    if (rank >= count) {
+        rank = count - 1;
+    }
+    uint64_t seen = 0;
+    for (int i = 0; i < kBuckets; ++i) {
+        seen += buckets[i];
+        if (seen > rank) {
+            // 第 i 个桶的上界为 2^i - 1
+            uint64_t upper = (1ULL << i) - 1;
+            return upper < max ? upper : max;
+        }
+    }
+    return max;
+}
+
+Histogram::Histogram()
+    : count_(0),
+      sum_(0),
+      max_(0) {
+
+    for (auto &bucket : buckets_) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+}
+
+void Histogram::record(uint64_t value) {
+    add(buckets_[bucketOf(value)], 1);
+    add(count_, 1);
+    add(sum_, value);
+    if (value > max_.load(std::memory_order_relaxed)) {
+        max_.store(value, std::memory_order_relaxed);
+    }
+}
+
+Histogram::Snapshot Histogram::snapshot() const {
+    Snapshot snapshot;
+    for (int i = 0; i < kBuckets; ++i) {
+        snapshot.buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+    }
+    snapshot.count = count_.load(std::memory_order_relaxed);
+    snapshot.sum = sum_.load(std::memory_order_relaxed);
+    snapshot.max = max_.load(std::memory_order_relaxed);
+    return snapshot;
+}
+
+EventLoopStats::Snapshot::Snapshot()
+    : iterations(0),
+      pollTime(0),
+      dispatchTime(0),
+      pendingFunctorTime(0),
+      pendingFunctors(0),
+      pendingQueueDepth(0),
+      connections(0),
+      busyPermille(0) {
+
+}
+
+void EventLoopStats::Snapshot::merge(const Snapshot &other) {
+    iterations += other.iterations;
+    pollTime += other.pollTime;
+    dispatchTime += other.dispatchTime;
+    pendingFunctorTime += other.pendingFunctorTime;
+    pendingFunctors += other.pendingFunctors;
+    pendingQueueDepth += other.pendingQueueDepth;
+    connections += other.connections;
+    // 合并后的忙碌时间占比取最大值，用于发现饱和的 EventLoop
+    if (other.busyPermille > busyPermille) {
+        busyPermille = other.busyPermille;
+    }
+
+    pollHistogram.merge(other.pollHistogram);
+    dispatchHistogram.merge(other.dispatchHistogram);
+    pendingHistogram.merge(other.pendingHistogram);
+    activeChannels.merge(other.activeChannels);
+    pendingQueueDepths.merge(other.pendingQueueDepths);
+    timerLag.merge(other.timerLag);
+}
+
+void EventLoopStats::Snapshot::subtract(const Snapshot &earlier) {
+    iterations -= earlier.iterations;
+    pollTime -= earlier.pollTime;
+    dispatchTime -= earlier.dispatchTime;
+    pendingFunctorTime -= earlier.pendingFunctorTime;
+    pendingFunctors -= earlier.pendingFunctors;
+
+    pollHistogram.subtract(earlier.pollHistogram);
+    dispatchHistogram.subtract(earlier.dispatchHistogram);
+    pendingHistogram.subtract(earlier.pendingHistogram);
+    activeChannels.subtract(earlier.activeChannels);
+    pendingQueueDepths.subtract(earlier.pendingQueueDepths);
+    timerLag.subtract(earlier.timerLag);
+}
+
+std::string EventLoopStats::Snapshot::toString() const {
+    char buf[512];
+    snprintf(buf, sizeof(buf),
+             "iterations=%llu busy=%d.%d%% conns=%d queue=%d "
+             "poll(us) p50=%llu p99=%llu | dispatch(us) p50=%llu p99=%llu max=%llu | "
+             "functors(us) p50=%llu p99=%llu max=%llu | active p99=%llu max=%llu | "
+             "batch p99=%llu max=%llu | timers=%llu lag(us) p99=%llu max=%llu",
+             static_cast<unsigned long long>(iterations),
+             busyPermille / 10, busyPermille % 10,
+             connections, pendingQueueDepth,
+             static_cast<unsigned long long>(pollHistogram.percentile(50)),
+             static_cast<unsigned long long>(pollHistogram.percentile(99)),
+             static_cast<unsigned long long>(dispatchHistogram.percentile(50)),
+             static_cast<unsigned long long>(dispatchHistogram.percentile(99)),
+             static_cast<unsigned long long>(dispatchHistogram.max),
+             static_cast<unsigned long long>(pendingHistogram.percentile(50)),
+             static_cast<unsigned long long>(pendingHistogram.percentile(99)),
+             static_cast<unsigned long long>(pendingHistogram.max),
+             static_cast<unsigned long long>(activeChannels.percentile(99)),
+             static_cast<unsigned long long>(activeChannels.max),
+             static_cast<unsigned long long>(pendingQueueDepths.percentile(99)),
+             static_cast<unsigned long long>(pendingQueueDepths.max),
+             static_cast<unsigned long long>(timerLag.count),
+             static_cast<unsigned long long>(timerLag.percentile(99)),
+             static_cast<unsigned long long>(timerLag.max));
+    return buf;
+}
+
+EventLoopStats::EventLoopStats() = default;
+
+void EventLoopStats::recordIteration(uint64_t pollTime,
+                                     uint64_t dispatchTime,
+                                     uint64_t pendingFunctorTime,
+                                     uint64_t activeChannels,
+                                     uint64_t pendingFunctors) {
+    pollHistogram_.record(pollTime);
+    dispatchHistogram_.record(dispatchTime);
+    pendingHistogram_.record(pendingFunctorTime);
+    activeChannels_.record(activeChannels);
+    pendingQueueDepths_.record(pendingFunctors);
+}
+
+void EventLoopStats::recordTimerLag(uint64_t lag) {
+    timerLag_.record(lag);
+}
+
+EventLoopStats::Snapshot EventLoopStats::snapshot() const {
+    Snapshot snapshot;
+    snapshot.pollHistogram = pollHistogram_.snapshot();
+    snapshot.dispatchHistogram = dispatchHistogram_.snapshot();
+    snapshot.pendingHistogram = pendingHistogram_.snapshot();
+    snapshot.activeChannels = activeChannels_.snapshot();
+    snapshot.pendingQueueDepths = pendingQueueDepths_.snapshot();
+    snapshot.timerLag = timerLag_.snapshot();
+
+    snapshot.iterations = snapshot.pollHistogram.count;
+    snapshot.pollTime = snapshot.pollHistogram.sum;
+    snapshot.dispatchTime = snapshot.dispatchHistogram.sum;
+    snapshot.pendingFunctorTime = snapshot.pendingHistogram.sum;
+    snapshot.pendingFunctors = snapshot.pendingQueueDepths.sum;
+    return snapshot;
+}
@@ -0,0 +1,165 @@
+#ifndef TINYWS_EVENTLOOPSTATS_H
+#define TINYWS_EVENTLOOPSTATS_H
+
+#include <cstdint>
+#include <atomic>
+#include <string>
+
+#include "../base/noncopyable.h"
+
+namespace tinyWS_thread {
+
+    // 无锁直方图，按 2 的幂分桶：
+    // 第 0 个桶只统计 0，第 i 个桶统计 [2^(i-1), 2^i) 的值，最后一个桶统计所有更大的值。
+    //
+    // 只有一个线程（IO 线程）写，所以写入时只需要原子的读和写（不需要原子的读-改-写），
+    // 其他线程随时可以读取，读到的各个桶之间可能相差几次记录，统计用途可以接受。
+    class Histogram : noncopyable {
+    public:
+        static const int kBuckets = 32;
+
+        // 直方图的快照，可以合并多个快照
+        struct Snapshot {
+            uint64_t buckets[kBuckets];     // 每个桶的计数
+            uint64_t count;                 // 总计数
+            uint64_t sum;                   // 总和
+            uint64_t max;                   // 最大值
+
+            Snapshot();
+
+            /**
+             * 合并另一个快照
+             * @param other 快照
+             */
+            void merge(const Snapshot &other);
+
+            /**
+             * 减去较早的快照，得到两次快照之间的记录（最大值仍为总的最大值）
+             * @param earlier 较早的快照
+             */
+            void subtract(const Snapshot &earlier);
+
+            /**
+             * 平均值
+             * @return 平均值，没有记录时返回 0
+             */
+            double mean() const;
+
+            /**
+             * 估计百分位数，返回所在桶的上界（不超过最大值）
+             * @param percentile 百分位，0 ~ 100
+             * @return 百分位数，没有记录时返回 0
+             */
+            uint64_t percentile(double percentile) const;
+        };
+
+        Histogram();
+
+        /**
+         * --- 只能在一个线程中调用 ---
+         * 记录一个值
+         * @param value 值
+         */
+        void record(uint64_t value);
+
+        /**
+         * --- 线程安全 ---
+         * 获取快照
+         * @return 快照
+         */
+        Snapshot snapshot() const;
+
+    private:
+        std::atomic<uint64_t> buckets_[kBuckets];
+        std::atomic<uint64_t> count_;
+        std::atomic<uint64_t> sum_;
+        std::atomic<uint64_t> max_;
+    };
+
+    // EventLoop 的运行时统计，每个 EventLoop 一个，只在 IO 线程中写，任意线程可以读。
+    // 时间的单位都是微秒。
+    class EventLoopStats : noncopyable {
+    public:
+        // 统计的快照，可以合并多个 EventLoop 的快照
+        struct Snapshot {
+            uint64_t iterations;                // 事件循环的次数
+            uint64_t pollTime;                  // 阻塞在 poll 中的总时间
+            uint64_t dispatchTime;              // 处理 Channel 事件的总时间
+            uint64_t pendingFunctorTime;        // 处理 pending functor 的总时间
+            uint64_t pendingFunctors;           // 处理的 pending functor 总数
+            int pendingQueueDepth;              // 当前队列中还没有执行的 pending functor 数
+            int connections;                    // 当前的连接数
+            int busyPermille;                   // 最近一个统计周期的忙碌时间占比（千分比）
+
+            Histogram::Snapshot pollHistogram;          // 每次 poll 的时间
+            Histogram::Snapshot dispatchHistogram;      // 每次处理 Channel 事件的时间
+            Histogram::Snapshot pendingHistogram;       // 每次处理 pending functor 的时间
+            Histogram::Snapshot activeChannels;         // 每次 poll 返回的活跃 Channel 数
+            Histogram::Snapshot pendingQueueDepths;     // 每次取出的 pending functor 数
+            Histogram::Snapshot timerLag;               // 定时器实际执行时间与到期时间之差（计数即到期的定时器数）
+
+            Snapshot();
+
+            /**
+             * 合并另一个 EventLoop 的快照
+             * @param other 快照
+             */
+            void merge(const Snapshot &other);
+
+            /**
+             * 减去同一个 EventLoop 较早的快照，得到两次快照之间的统计，用于定期输出
+             * @param earlier 较早的快照
+             */
+            void subtract(const Snapshot &earlier);
+
+            /**
+             * 输出一行摘要，用于日志
+             * @return 摘要
+             */
+            std::string toString() const;
+        };
+
+        EventLoopStats();
+
+        /**
+         * --- 只能在 IO 线程中调用 ---
+         * 记录一次事件循环
+         * @param pollTime poll 的时间
+         * @param dispatchTime 处理 Channel 事件的时间
+         * @param pendingFunctorTime 处理 pending functor 的时间
+         * @param activeChannels 活跃 Channel 数
+         * @param pendingFunctors 处理的 pending functor 数
+         */
+        void recordIteration(uint64_t pollTime,
+                             uint64_t dispatchTime,
+                             uint64_t pendingFunctorTime,
+                             uint64_t activeChannels,
+                             uint64_t pendingFunctors);
+
+        /**
+         * --- 只能在 IO 线程中调用 ---
+         * 记录一个到期定时器的延迟
+         * @param lag 实际执行时间与到期时间之差
+         */
+        void recordTimerLag(uint64_t lag);
+
+        /**
+         * --- 线程安全 ---
+         * 获取快照。pendingQueueDepth、connections 和 busyPermille 由 EventLoop 填写。
+         * @return 快照
+         */
+        Snapshot snapshot() const;
+
+    private:
+        // 总次数和总时间由直方图的计数和总和得到，不再单独计数
+        Histogram pollHistogram_;
+        Histogram dispatchHistogram_;
+        Histogram pendingHistogram_;
+        Histogram activeChannels_;
+        Histogram pendingQueueDepths_;
+        Histogram timerLag_;
+    };
+}
+
+
+#endif //TINYWS_EVENTLOOPSTATS_H
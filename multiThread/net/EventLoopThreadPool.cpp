@@ -2,17 +2,38 @@
 
 #include <cassert>
 
+#include <algorithm>
+
 #include "EventLoop.h"
 #include "EventLoopThread.h"
+#include "InternetAddress.h"
 #include "../base/MutexLock.h"
 
 using namespace tinyWS_thread;
 
+namespace {
+    /**
+     * 32 位整数的哈希函数（MurmurHash3 的 fmix32），使相近的输入分散到整个哈希空间
+     * @param h 输入
+     * @return 哈希值
+     */
+    uint32_t hash32(uint32_t h) {
+        h ^= h >> 16;
+        h *= 0x85ebca6b;
+        h ^= h >> 13;
+        h *= 0xc2b2ae35;
+        h ^= h >> 16;
+        return h;
+    }
+}
+
 EventLoopThreadPool::EventLoopThreadPool(EventLoop *baseLoop)
     : baseLoop_(baseLoop),
       started_(false),
       numThreads_(0),
-      next_(0) {
+      next_(0),
+      policy_(kRoundRobin),
+      randomState_(2463534242u) {
 
 }
 
@@ -41,6 +62,15 @@ void EventLoopThreadPool::start(const EventLoopThreadPool::EventLoopThreadPoolCa
     if (numThreads_ == 0 && cb) {
         cb(baseLoop_);
     }
+
+    if (policy_ == kConsistentHash) {
+        buildHashRing();
+    }
+}
+
+void EventLoopThreadPool::setPolicy(Policy policy) {
+    assert(!started_);
+    policy_ = policy;
 }
 
 EventLoop* EventLoopThreadPool::getNextLoop() {
@@ -59,4 +89,110 @@ EventLoop* EventLoopThreadPool::getNextLoop() {
     }
 
     return loop;
-}
\ No newline at end of file
+}
+
+EventLoop* EventLoopThreadPool::getNextLoop(const InternetAddress &peerAddress) {
+    int index = getNextLoopIndex(peerAddress);
+    return loops_.empty() ? baseLoop_ : loops_[index];
+}
+
+int EventLoopThreadPool::getNextLoopIndex(const InternetAddress &peerAddress) {
+    baseLoop_->assertInLoopThread();
+    if (loops_.size() <= 1) {
+        return 0;
+    }
+
+    switch (policy_) {
+        case kLeastConnections: {
+            int index = 0;
+            int minConnections = loops_[0]->connectionCount();
+            for (size_t i = 1; i < loops_.size(); ++i) {
+                int connections = loops_[i]->connectionCount();
+                if (connections < minConnections) {
+                    minConnections = connections;
+                    index = static_cast<int>(i);
+                }
+            }
+            return index;
+        }
+        case kPowerOfTwoChoices: {
+            // 只比较两个随机的 EventLoop，比遍历所有 EventLoop 代价低，
+            // 又能避免同时挑中负载最低的 EventLoop 导致其瞬间过载
+            auto n = static_cast<uint32_t>(loops_.size());
+            uint32_t first = nextRandom() % n;
+            uint32_t second = nextRandom() % (n - 1);
+            if (second >= first) {
+                ++second;
+            }
+            return load(loops_[second]) < load(loops_[first]) ? static_cast<int>(second) : static_cast<int>(first);
+        }
+        case kConsistentHash: {
+            // 只用 IP，同一客户端的连接（端口不同）分配到同一个 EventLoop
+            uint32_t h = hash32(peerAddress.ipNetEnd());
+            auto it = std::lower_bound(hashRing_.begin(), hashRing_.end(),
+                                       std::make_pair(h, 0));
+            if (it == hashRing_.end()) {
+                it = hashRing_.begin();
+            }
+            return it->second;
+        }
+        case kRoundRobin:
+        default: {
+            int index = next_;
+            ++next_;
+            if (static_cast<decltype(loops_.size())>(next_) >= loops_.size()) {
+                next_ = 0;
+            }
+            return index;
+        }
+    }
+}
+
+std::vector<EventLoop*> EventLoopThreadPool::getAllLoops() const {
+    assert(started_);
+    if (loops_.empty()) {
+        return std::vector<EventLoop*>(1, baseLoop_);
+    } else {
+        return loops_;
+    }
+}
+
+std::vector<EventLoopStats::Snapshot> EventLoopThreadPool::getAllStats() const {
+    std::vector<EventLoopStats::Snapshot> stats;
+    for (auto loop : getAllLoops()) {
+        stats.push_back(loop->stats());
+    }
+    return stats;
+}
+
+EventLoopStats::Snapshot EventLoopThreadPool::getTotalStats() const {
+    EventLoopStats::Snapshot total;
+    for (auto loop : getAllLoops()) {
+        total.merge(loop->stats());
+    }
+    return total;
+}
+
+int EventLoopThreadPool::load(EventLoop *loop) {
+    int connections = loop->connectionCount();
+    return connections + loop->pendingFunctorCount() + connections * loop->busyPermille() / 1000;
+}
+
+uint32_t EventLoopThreadPool::nextRandom() {
+    randomState_ ^= randomState_ << 13;
+    randomState_ ^= randomState_ >> 17;
+    randomState_ ^= randomState_ << 5;
+    return randomState_;
+}
+
+void EventLoopThreadPool::buildHashRing() {
+    // 每个 EventLoop 在环上有多个虚拟节点，使各个 EventLoop 分到的哈希空间大致相等
+    hashRing_.clear();
+    for (size_t i = 0; i < loops_.size(); ++i) {
+        for (int j = 0; j < kVirtualNodesPerLoop; ++j) {
+            uint32_t key = static_cast<uint32_t>(i) << 16 | static_cast<uint32_t>(j);
+            hashRing_.emplace_back(hash32(key ^ 0x9e3779b9), static_cast<int>(i));
+        }
+    }
+    std::sort(hashRing_.begin(), hashRing_.end());
+}
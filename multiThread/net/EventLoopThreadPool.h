@@ -1,15 +1,19 @@
 #ifndef TINYWS_EVENTLOOPTHREADPOOL_H
 #define TINYWS_EVENTLOOPTHREADPOOL_H
 
+#include <cstdint>
 #include <memory>
 #include <vector>
+#include <utility>
 #include <functional>
 
 #include "../base/noncopyable.h"
+#include "EventLoopStats.h"
 
 namespace tinyWS_thread {
     class EventLoop;
     class EventLoopThread;
+    class InternetAddress;
 
     // 用 one loop per thead 思想实现的多线程 TcpServer 的关键步骤：
     // 在创建 TcpConnection 是从 event loop pool 里选一个 EventLoop 来使用。
@@ -17,11 +21,20 @@ namespace tinyWS_thread {
     // 而新连接会使用 event loop pool 来执行 IO 操作。
     // 而单线程 TcpServer 的所有工作都在 TcpServer 所属的 EventLoop 做。
     //
-    // 当前选择 EventLoop 的策略是 Round-robin。
+    // 选择 EventLoop 的策略见 Policy，默认为 Round-robin。
+    // 负载相关的策略读取 EventLoop 通过原子变量发布的负载（连接数、pending functor 数、忙碌时间占比），不需要加锁。
     class EventLoopThreadPool : noncopyable {
     public:
         using EventLoopThreadPoolCallback = std::function<void(EventLoop*)>; // 线程池回调函数类型
 
+        // 选择 EventLoop 的策略
+        enum Policy {
+            kRoundRobin,            // 轮流选择
+            kLeastConnections,      // 选择连接数最少的 EventLoop
+            kPowerOfTwoChoices,     // 随机选两个 EventLoop，选择负载较低的那个，见 load()
+            kConsistentHash         // 按客户端 IP 做一致性哈希，同一客户端的连接总是分配到同一个 EventLoop
+        };
+
         /**
          * 构造函数
          * @param baseLoop 主 EventLoop
@@ -43,18 +56,83 @@ namespace tinyWS_thread {
         void start(const EventLoopThreadPoolCallback &cb = EventLoopThreadPoolCallback());
 
         /**
-         * 获取 EventLoop
+         * 设置选择 EventLoop 的策略，需要在 start() 之前调用
+         * @param policy 策略
+         */
+        void setPolicy(Policy policy);
+
+        /**
+         * 按照 Round-robin 策略获取 EventLoop
          * @return  EventLoop
          */
         EventLoop *getNextLoop();
 
+        /**
+         * 按照设置的策略，为新连接获取 EventLoop
+         * @param peerAddress 新连接的客户端地址（一致性哈希使用）
+         * @return EventLoop
+         */
+        EventLoop *getNextLoop(const InternetAddress &peerAddress);
+
+        /**
+         * 同 getNextLoop(const InternetAddress&)，返回 EventLoop 在 getAllLoops() 中的下标
+         * @param peerAddress 新连接的客户端地址（一致性哈希使用）
+         * @return 下标
+         */
+        int getNextLoopIndex(const InternetAddress &peerAddress);
+
+        /**
+         * 获取所有 IO 线程的 EventLoop，线程池为空时返回主 EventLoop
+         * @return EventLoop 列表，按创建顺序排列
+         */
+        std::vector<EventLoop*> getAllLoops() const;
+
+        /**
+         * --- 线程安全 ---
+         * 获取每个 IO 线程 EventLoop 的运行时统计，start() 之后调用
+         * @return 快照列表，与 getAllLoops() 的顺序一致
+         */
+        std::vector<EventLoopStats::Snapshot> getAllStats() const;
+
+        /**
+         * --- 线程安全 ---
+         * 获取所有 IO 线程 EventLoop 合并后的运行时统计，start() 之后调用。
+         * 忙碌时间占比为各个 EventLoop 中的最大值。
+         * @return 快照
+         */
+        EventLoopStats::Snapshot getTotalStats() const;
+
     private:
         EventLoop *baseLoop_;                                       // 主 EventLoop
         bool started_;                                              // 线程池是否启动
         int numThreads_;                                            // 线程数
         int next_;                                                  // 用于获取下一线程
+        Policy policy_;                                             // 选择 EventLoop 的策略
+        uint32_t randomState_;                                      // 随机数状态（kPowerOfTwoChoices）
         std::vector<std::unique_ptr<EventLoopThread> > threads_;    // 线程列表
         std::vector<EventLoop*> loops_;                             // EventLoop 列表
+        std::vector<std::pair<uint32_t, int>> hashRing_;            // 一致性哈希环：<哈希值，loops_ 的下标>，按哈希值排序
+
+        static const int kVirtualNodesPerLoop = 64;                 // 一致性哈希中每个 EventLoop 的虚拟节点数
+
+        /**
+         * 计算 EventLoop 的负载：连接数 + pending functor 数，再按忙碌时间占比放大连接数。
+         * 忙碌时间占比为 100% 时，每个连接算作两个。
+         * @param loop EventLoop
+         * @return 负载
+         */
+        static int load(EventLoop *loop);
+
+        /**
+         * 生成随机数（xorshift），只在主线程中调用
+         * @return 随机数
+         */
+        uint32_t nextRandom();
+
+        /**
+         * 创建一致性哈希环
+         */
+        void buildHashRing();
     };
 }
 
@@ -0,0 +1,19 @@
+#include "FileHandle.h"
+
+#include <unistd.h> // close
+
+using namespace tinyWS_thread;
+
+FileHandle::FileHandle(int fd) : fd_(fd) {
+
+}
+
+FileHandle::~FileHandle() {
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+}
+
+int FileHandle::fd() const {
+    return fd_;
+}
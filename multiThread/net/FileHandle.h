@@ -0,0 +1,37 @@
+#ifndef TINYWS_FILEHANDLE_H
+#define TINYWS_FILEHANDLE_H
+
+#include <memory>
+
+#include "../base/noncopyable.h"
+
+namespace tinyWS_thread {
+
+    // 只读打开的文件描述符，析构时关闭。
+    // 用 shared_ptr 共享：输出队列中正在发送的文件段持有它，
+    // 即使文件缓存已经淘汰了该文件，文件描述符也要等发送完才关闭。
+    class FileHandle : noncopyable {
+    public:
+        /**
+         * 构造函数
+         * @param fd 文件描述符，由 FileHandle 负责关闭
+         */
+        explicit FileHandle(int fd);
+
+        ~FileHandle();
+
+        /**
+         * 获取文件描述符
+         * @return 文件描述符
+         */
+        int fd() const;
+
+    private:
+        const int fd_;  // 文件描述符
+    };
+
+    using FileHandlePtr = std::shared_ptr<FileHandle>;
+}
+
+
+#endif //TINYWS_FILEHANDLE_H
@@ -0,0 +1,354 @@
+#include "IoUringPoller.h"
+
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <csignal>  // _NSIG
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+
+#include <algorithm>
+
+#include "../base/Logger.h"
+#include "Channel.h"
+
+using namespace tinyWS_thread;
+
+namespace {
+    // POLL_REMOVE 请求的 user_data，其 CQE 直接忽略
+    const uint64_t kCancelUserData = UINT64_MAX;
+
+    int ioUringSetup(unsigned entries, io_uring_params *params) {
+        return static_cast<int>(::syscall(__NR_io_uring_setup, entries, params));
+    }
+
+    int ioUringEnter(int ringfd, unsigned toSubmit, unsigned minComplete,
+                     unsigned flags, const void *arg, size_t argSize) {
+        return static_cast<int>(::syscall(__NR_io_uring_enter, ringfd, toSubmit, minComplete,
+                                          flags, arg, argSize));
+    }
+}
+
+IoUringPoller::IoUringPoller(EventLoop *loop)
+    : Poller(loop),
+      ringfd_(-1),
+      features_(0),
+      sqRing_(MAP_FAILED),
+      sqRingSize_(0),
+      sqHead_(nullptr),
+      sqTail_(nullptr),
+      sqMask_(nullptr),
+      sqEntries_(nullptr),
+      sqArray_(nullptr),
+      sqes_(static_cast<io_uring_sqe*>(MAP_FAILED)),
+      sqesSize_(0),
+      toSubmit_(0),
+      cqRing_(MAP_FAILED),
+      cqRingSize_(0),
+      cqHead_(nullptr),
+      cqTail_(nullptr),
+      cqMask_(nullptr),
+      cqes_(nullptr) {
+
+    io_uring_params params{};
+    int ringfd = ioUringSetup(kRingEntries, &params);
+    if (ringfd < 0) {
+        debug(LogLevel::WARN) << "io_uring_setup errno = " << errno << std::endl;
+        return;
+    }
+
+    // 依赖的特性：
+    // IORING_FEAT_NODROP：CQ 满了也不会丢弃 CQE，否则 one-shot poll 的完成事件丢失后再也不会重新提交；
+    // IORING_FEAT_EXT_ARG：io_uring_enter(2) 可以直接带超时时间等待。
+    features_ = params.features;
+    if (!(features_ & IORING_FEAT_NODROP) || !(features_ & IORING_FEAT_EXT_ARG)) {
+        ::close(ringfd);
+        return;
+    }
+
+    sqRingSize_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cqRingSize_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    if (features_ & IORING_FEAT_SINGLE_MMAP) {
+        // SQ 和 CQ 共用一次 mmap
+        sqRingSize_ = std::max(sqRingSize_, cqRingSize_);
+        cqRingSize_ = sqRingSize_;
+    }
+
+    sqRing_ = ::mmap(nullptr, sqRingSize_, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_POPULATE, ringfd, IORING_OFF_SQ_RING);
+    if (sqRing_ == MAP_FAILED) {
+        debug(LogLevel::ERROR) << "IoUringPoller mmap sq ring" << std::endl;
+        ::close(ringfd);
+        return;
+    }
+    if (features_ & IORING_FEAT_SINGLE_MMAP) {
+        cqRing_ = sqRing_;
+    } else {
+        cqRing_ = ::mmap(nullptr, cqRingSize_, PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_POPULATE, ringfd, IORING_OFF_CQ_RING);
+        if (cqRing_ == MAP_FAILED) {
+            debug(LogLevel::ERROR) << "IoUringPoller mmap cq ring" << std::endl;
+            ::close(ringfd);
+            return;
+        }
+    }
+    sqesSize_ = params.sq_entries * sizeof(io_uring_sqe);
+    sqes_ = static_cast<io_uring_sqe*>(::mmap(nullptr, sqesSize_, PROT_READ | PROT_WRITE,
+                                              MAP_SHARED | MAP_POPULATE, ringfd, IORING_OFF_SQES));
+    if (sqes_ == MAP_FAILED) {
+        debug(LogLevel::ERROR) << "IoUringPoller mmap sqes" << std::endl;
+        ::close(ringfd);
+        return;
+    }
+
+    char *sq = static_cast<char*>(sqRing_);
+    sqHead_ = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    sqTail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sqMask_ = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sqEntries_ = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_entries);
+    sqArray_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+
+    char *cq = static_cast<char*>(cqRing_);
+    cqHead_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cqTail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cqMask_ = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+    ringfd_ = ringfd;
+}
+
+IoUringPoller::~IoUringPoller() {
+    if (sqes_ != MAP_FAILED) {
+        ::munmap(sqes_, sqesSize_);
+    }
+    if (cqRing_ != MAP_FAILED && cqRing_ != sqRing_) {
+        ::munmap(cqRing_, cqRingSize_);
+    }
+    if (sqRing_ != MAP_FAILED) {
+        ::munmap(sqRing_, sqRingSize_);
+    }
+    if (ringfd_ >= 0) {
+        ::close(ringfd_);
+    }
+}
+
+bool IoUringPoller::isValid() const {
+    return ringfd_ >= 0;
+}
+
+Timer::TimeType IoUringPoller::poll(int timeoutMs, ChannelList *activeChannels) {
+    // 上一轮触发过的 one-shot poll 需要重新提交。
+    // 如果 Channel 在事件回调中已经通过 updateChannel() 重新提交，或者已经被移除，则跳过。
+    for (int fd : rearmFds_) {
+        Registration &reg = registrations_[fd];
+        if (reg.channel != nullptr && reg.armedEvents == 0 && !reg.channel->isNoneEvent()) {
+            armPoll(fd, reg, static_cast<uint32_t>(reg.channel->getEvents()));
+        }
+    }
+    rearmFds_.clear();
+
+    // 提交本轮所有的 SQE，并等待至少一个 CQE，只需一次系统调用。
+    int ret = enter(1, timeoutMs);
+    Timer::TimeType now = Timer::now();
+    if (ret < 0 && errno != ETIME && errno != EINTR) {
+        debug(LogLevel::ERROR) << "IoUringPoller::poll() errno = " << errno << std::endl;
+    }
+
+    reapCompletions(activeChannels);
+
+    return now; // 返回 io_uring_enter return 的时刻
+}
+
+void IoUringPoller::updateChannel(Channel *channel) {
+    assertInLoopThread();
+
+    int fd = channel->fd();
+    Registration &reg = registration(fd);
+    assert(reg.channel == nullptr || reg.channel == channel);
+    reg.channel = channel;
+
+    if (channel->isNoneEvent()) {
+        // Channel 没有关心的事件，则取消已提交的 poll
+        if (reg.armedEvents != 0) {
+            cancelPoll(fd, reg);
+        }
+        return;
+    }
+
+    auto events = static_cast<uint32_t>(channel->getEvents());
+    if (reg.armedEvents == events) {
+        return;
+    }
+    if (reg.armedEvents != 0) {
+        // 关心的事件改变了，先取消旧的 poll，再提交新的 poll，两者在同一批次中提交
+        cancelPoll(fd, reg);
+    }
+    armPoll(fd, reg, events);
+}
+
+void IoUringPoller::removeChannel(Channel *channel) {
+    assertInLoopThread();
+
+    int fd = channel->fd();
+    Registration &reg = registration(fd);
+    assert(reg.channel == channel);
+    if (reg.armedEvents != 0) {
+        cancelPoll(fd, reg);
+    }
+    reg.channel = nullptr;
+    reg.revents = 0;
+    reg.active = false;
+}
+
+bool IoUringPoller::hasChannel(Channel *channel) {
+    assertInLoopThread();
+    int fd = channel->fd();
+    return fd >= 0
+           && static_cast<size_t>(fd) < registrations_.size()
+           && registrations_[fd].channel == channel;
+}
+
+const char* IoUringPoller::name() const {
+    return "io_uring";
+}
+
+IoUringPoller::Registration& IoUringPoller::registration(int fd) {
+    assert(fd >= 0);
+    if (static_cast<size_t>(fd) >= registrations_.size()) {
+        registrations_.resize(std::max(static_cast<size_t>(fd) + 1, registrations_.size() * 2),
+                              Registration{nullptr, 0, 0, 0, false});
+    }
+    return registrations_[fd];
+}
+
+void IoUringPoller::armPoll(int fd, Registration &reg, uint32_t events) {
+    ++reg.generation;
+    reg.armedEvents = events;
+
+    io_uring_sqe sqe{};
+    sqe.opcode = IORING_OP_POLL_ADD;
+    sqe.fd = fd;
+    // poll 的事件与 epoll 的事件（EPOLLIN、EPOLLOUT 等）数值相同，但 EPOLLET 对 poll 无意义
+    sqe.poll32_events = events & ~static_cast<uint32_t>(EPOLLET);
+    if (events & EPOLLET) {
+        sqe.len = IORING_POLL_ADD_MULTI;
+    }
+    sqe.user_data = makeUserData(fd, reg.generation);
+    queueSqe(sqe);
+}
+
+void IoUringPoller::cancelPoll(int fd, Registration &reg) {
+    io_uring_sqe sqe{};
+    sqe.opcode = IORING_OP_POLL_REMOVE;
+    sqe.fd = -1;
+    sqe.addr = makeUserData(fd, reg.generation);
+    sqe.user_data = kCancelUserData;
+    queueSqe(sqe);
+
+    // 增加注册代数，被取消的 poll 在取消之前产生的 CQE 都会被丢弃
+    ++reg.generation;
+    reg.armedEvents = 0;
+}
+
+void IoUringPoller::queueSqe(const io_uring_sqe &sqe) {
+    unsigned tail = *sqTail_;
+    if (tail - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE) >= *sqEntries_) {
+        // SQ 已满，先提交，不等待
+        enter(0, 0);
+    }
+    assert(tail - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE) < *sqEntries_);
+
+    unsigned index = tail & *sqMask_;
+    sqes_[index] = sqe;
+    sqArray_[index] = index;
+    // 写完 SQE 之后，才能更新 tail，内核看到新的 tail 时，SQE 已经完整
+    __atomic_store_n(sqTail_, tail + 1, __ATOMIC_RELEASE);
+    ++toSubmit_;
+}
+
+int IoUringPoller::enter(unsigned waitNr, int timeoutMs) {
+    int ret;
+    if (waitNr > 0) {
+        __kernel_timespec ts{};
+        ts.tv_sec = timeoutMs / 1000;
+        ts.tv_nsec = static_cast<long long>(timeoutMs % 1000) * 1000 * 1000;
+        io_uring_getevents_arg arg{};
+        arg.sigmask = 0;
+        arg.sigmask_sz = _NSIG / 8;
+        arg.ts = reinterpret_cast<uint64_t>(&ts);
+        ret = ioUringEnter(ringfd_, toSubmit_, waitNr,
+                           IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof(arg));
+    } else {
+        ret = ioUringEnter(ringfd_, toSubmit_, 0, 0, nullptr, 0);
+    }
+
+    // 返回值为内核消费的 SQE 数量
+    if (ret > 0) {
+        toSubmit_ -= std::min(toSubmit_, static_cast<unsigned>(ret));
+    }
+
+    return ret;
+}
+
+void IoUringPoller::reapCompletions(ChannelList *activeChannels) {
+    size_t first = activeChannels->size();
+    unsigned head = *cqHead_;
+    unsigned tail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+
+    for (; head != tail; ++head) {
+        const io_uring_cqe &cqe = cqes_[head & *cqMask_];
+        if (cqe.user_data == kCancelUserData) {
+            continue;
+        }
+
+        auto fd = static_cast<int>(cqe.user_data >> 32);
+        auto generation = static_cast<uint32_t>(cqe.user_data);
+        if (static_cast<size_t>(fd) >= registrations_.size()) {
+            continue;
+        }
+        Registration &reg = registrations_[fd];
+        if (reg.channel == nullptr || reg.generation != generation) {
+            // 过期的 CQE：Channel 已被移除，或者 poll 已被取消
+            continue;
+        }
+
+        // 没有 IORING_CQE_F_MORE 标志，表示该 poll 请求已经结束（one-shot poll 触发，或者 multishot poll 被内核终止），
+        // 需要在下一轮 poll() 中重新提交
+        if (!(cqe.flags & IORING_CQE_F_MORE)) {
+            reg.armedEvents = 0;
+            rearmFds_.push_back(fd);
+        }
+
+        if (cqe.res < 0) {
+            if (cqe.res == -ECANCELED) {
+                continue;
+            }
+            reg.revents |= EPOLLERR;
+        } else {
+            reg.revents |= static_cast<uint32_t>(cqe.res);
+        }
+
+        // 同一个 Channel 可能在一批 CQE 中出现多次（multishot poll），只加入一次
+        if (!reg.active) {
+            reg.active = true;
+            activeChannels->push_back(reg.channel);
+        }
+    }
+
+    // 更新 head，告诉内核这些 CQE 已经处理
+    __atomic_store_n(cqHead_, head, __ATOMIC_RELEASE);
+
+    for (size_t i = first; i < activeChannels->size(); ++i) {
+        Channel *channel = (*activeChannels)[i];
+        Registration &reg = registrations_[channel->fd()];
+        channel->setRevents(static_cast<int>(reg.revents)); // 设置"到来"的事件
+        reg.revents = 0;
+        reg.active = false;
+    }
+}
+
+uint64_t IoUringPoller::makeUserData(int fd, uint32_t generation) {
+    return (static_cast<uint64_t>(fd) << 32) | generation;
+}
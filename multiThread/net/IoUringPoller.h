@@ -0,0 +1,143 @@
+#ifndef TINYWS_IOURINGPOLLER_H
+#define TINYWS_IOURINGPOLLER_H
+
+#include <linux/io_uring.h>
+
+#include <cstddef>
+#include <cstdint>
+
+#include <vector>
+
+#include "Poller.h"
+#include "Timer.h"
+
+namespace tinyWS_thread {
+    class Channel;
+    class EventLoop;
+
+    // 基于 io_uring(7) 的 Poller 实现，通过 TINYWS_POLLER=io_uring 启用。
+    //
+    // 与 Epoll 相比：
+    // 1 updateChannel() / removeChannel() 不再调用 epoll_ctl(2)，而是把 POLL_ADD / POLL_REMOVE 写入提交队列（SQ），
+    //   在 poll() 中与"等待事件"一起，通过一次 io_uring_enter(2) 批量提交；
+    // 2 level trigger 的 Channel 使用单次（one-shot）poll，事件处理完后在下一次 poll() 中重新提交，
+    //   提交时内核会重新检查就绪状态，所以语义与 epoll 的 level trigger 相同；
+    // 3 edge trigger 的 Channel 使用 multishot poll（IORING_POLL_ADD_MULTI），
+    //   一次提交可以产生多个完成事件（CQE），无须重新提交，
+    //   edge trigger 的 TcpConnection 会一直读 / 写到 EAGAIN 为止，所以不会丢失事件。
+    //
+    // 为了识别过期的 CQE（例如 Channel 已被移除，或者关心的事件已改变），
+    // user_data 由文件描述符和该文件描述符的注册代数（generation）组成。
+    class IoUringPoller : public Poller {
+    public:
+        explicit IoUringPoller(EventLoop *loop);
+
+        ~IoUringPoller() override;
+
+        /**
+         * io_uring 是否初始化成功（内核版本过低、被 seccomp 禁用等情况会失败）
+         * @return true / false
+         */
+        bool isValid() const;
+
+        Timer::TimeType poll(int timeoutMs, ChannelList *activeChannels) override;
+
+        void updateChannel(Channel *channel) override;
+
+        void removeChannel(Channel *channel) override;
+
+        bool hasChannel(Channel *channel) override;
+
+        const char* name() const override;
+
+    private:
+        // 每个文件描述符的注册信息，以文件描述符为下标
+        struct Registration {
+            Channel *channel;       // 对应的 Channel，nullptr 表示未注册
+            uint32_t generation;    // 注册代数，每次重新提交 poll 都会加一，用于丢弃过期的 CQE
+            uint32_t armedEvents;   // 已提交给内核的事件，0 表示当前没有提交 poll
+            uint32_t revents;       // 本轮 poll() 中累计的活动事件
+            bool active;            // 本轮 poll() 中是否已加入 activeChannels
+        };
+
+        static const unsigned kRingEntries = 1024;      // 提交队列的大小
+
+        int ringfd_;                                    // io_uring 文件描述符
+        unsigned features_;                             // 内核支持的特性
+
+        // 提交队列（SQ）
+        void *sqRing_;
+        size_t sqRingSize_;
+        unsigned *sqHead_;
+        unsigned *sqTail_;
+        unsigned *sqMask_;
+        unsigned *sqEntries_;
+        unsigned *sqArray_;
+        io_uring_sqe *sqes_;
+        size_t sqesSize_;
+        unsigned toSubmit_;                             // 已写入但还未提交的 SQE 数量
+
+        // 完成队列（CQ）
+        void *cqRing_;
+        size_t cqRingSize_;
+        unsigned *cqHead_;
+        unsigned *cqTail_;
+        unsigned *cqMask_;
+        io_uring_cqe *cqes_;
+
+        std::vector<Registration> registrations_;       // <文件描述符, 注册信息>
+        std::vector<int> rearmFds_;                     // 需要重新提交 one-shot poll 的文件描述符
+
+        /**
+         * 获取 fd 的注册信息，必要时扩容
+         * @param fd 文件描述符
+         * @return 注册信息
+         */
+        Registration& registration(int fd);
+
+        /**
+         * 提交 poll 请求
+         * @param fd 文件描述符
+         * @param reg 注册信息
+         * @param events 关心的事件，包含 EPOLLET 时使用 multishot poll
+         */
+        void armPoll(int fd, Registration &reg, uint32_t events);
+
+        /**
+         * 取消已提交的 poll 请求
+         * @param fd 文件描述符
+         * @param reg 注册信息
+         */
+        void cancelPoll(int fd, Registration &reg);
+
+        /**
+         * 将 SQE 写入提交队列，但不提交。如果 SQ 已满，则先提交已有的 SQE。
+         * @param sqe SQE
+         */
+        void queueSqe(const io_uring_sqe &sqe);
+
+        /**
+         * 调用 io_uring_enter(2)，提交 SQE 并等待 CQE
+         * @param waitNr 至少等待的 CQE 数量，0 表示只提交，不等待
+         * @param timeoutMs 超时时间
+         * @return io_uring_enter(2) 的返回值
+         */
+        int enter(unsigned waitNr, int timeoutMs);
+
+        /**
+         * 处理完成队列中的 CQE，把"活动"的 Channel 填入到 activeChannels 中
+         * @param activeChannels "活动"的 Channel 列表
+         */
+        void reapCompletions(ChannelList *activeChannels);
+
+        /**
+         * 生成 user_data
+         * @param fd 文件描述符
+         * @param generation 注册代数
+         * @return user_data
+         */
+        static uint64_t makeUserData(int fd, uint32_t generation);
+    };
+}
+
+#endif //TINYWS_IOURINGPOLLER_H
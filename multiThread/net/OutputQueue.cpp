@@ -0,0 +1,177 @@
+#include "OutputQueue.h"
+
+#include <cassert>
+#include <cerrno>
+#include <unistd.h>         // write
+#include <sys/uio.h>        // writev
+#include <sys/sendfile.h>   // sendfile
+
+#include <algorithm>
+
+using namespace tinyWS_thread;
+
+size_t OutputQueue::Segment::remaining() const {
+    return type == kBuffer ? buffer->readableBytes() : length;
+}
+
+const size_t OutputQueue::kMaxSendfileBytes;
+
+OutputQueue::OutputQueue() = default;
+
+size_t OutputQueue::readableBytes() const {
+    size_t bytes = 0;
+    for (const auto &segment : segments_) {
+        bytes += segment.remaining();
+    }
+    return bytes;
+}
+
+bool OutputQueue::empty() const {
+    for (const auto &segment : segments_) {
+        if (segment.remaining() > 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+Buffer* OutputQueue::tailBuffer() {
+    if (segments_.empty() || segments_.back().type != kBuffer) {
+        pushBackBuffer();
+    }
+    return segments_.back().buffer.get();
+}
+
+void OutputQueue::append(const void *data, size_t len) {
+    tailBuffer()->append(data, len);
+}
+
+void OutputQueue::appendBuffer(Buffer *buffer) {
+    // 新建一个段再交换，而不是追加到最后一个缓冲区，避免复制
+    pushBackBuffer();
+    segments_.back().buffer->swap(*buffer);
+    buffer->retrieveAll();
+}
+
+void OutputQueue::appendShared(const std::shared_ptr<const std::string> &data, size_t offset, size_t len) {
+    assert(offset + len <= data->size());
+    if (len == 0) {
+        return;
+    }
+    segments_.emplace_back(kShared);
+    segments_.back().shared = data;
+    segments_.back().offset = static_cast<off_t>(offset);
+    segments_.back().length = len;
+}
+
+void OutputQueue::appendFile(const FileHandlePtr &file, off_t offset, size_t len) {
+    if (len == 0) {
+        return;
+    }
+    segments_.emplace_back(kFile);
+    segments_.back().file = file;
+    segments_.back().offset = offset;
+    segments_.back().length = len;
+}
+
+ssize_t OutputQueue::writeTo(int fd, int *savedErrno) {
+    // 跳过队首空的段（如追加了 0 字节的缓冲区）
+    while (!segments_.empty() && segments_.front().remaining() == 0 && segments_.size() > 1) {
+        popFront();
+    }
+    if (segments_.empty() || segments_.front().remaining() == 0) {
+        return 0;
+    }
+
+    Segment &front = segments_.front();
+    if (front.type == kFile) {
+        off_t offset = front.offset;
+        ssize_t n = ::sendfile(fd, front.file->fd(), &offset, std::min(front.length, kMaxSendfileBytes));
+        if (n < 0) {
+            *savedErrno = errno;
+            return -1;
+        }
+        if (n == 0) {
+            // 文件在添加之后被截断
+            *savedErrno = EIO;
+            return -1;
+        }
+        retrieve(static_cast<size_t>(n));
+        return n;
+    }
+
+    // 收集队首连续的内存段
+    iovec vec[kMaxIovecs];
+    int count = 0;
+    for (auto it = segments_.begin(); it != segments_.end() && count < kMaxIovecs && it->type != kFile; ++it) {
+        size_t len = it->remaining();
+        if (len == 0) {
+            continue;
+        }
+        if (it->type == kBuffer) {
+            vec[count].iov_base = const_cast<char*>(it->buffer->peek());
+        } else {
+            vec[count].iov_base = const_cast<char*>(it->shared->data() + it->offset);
+        }
+        vec[count].iov_len = len;
+        ++count;
+    }
+
+    ssize_t n = count == 1 ? ::write(fd, vec[0].iov_base, vec[0].iov_len) : ::writev(fd, vec, count);
+    if (n < 0) {
+        *savedErrno = errno;
+        return -1;
+    }
+    retrieve(static_cast<size_t>(n));
+    return n;
+}
+
+void OutputQueue::clear(size_t maxRetainedCapacity) {
+    while (!segments_.empty()) {
+        popFront();
+    }
+    for (auto &buffer : spareBuffers_) {
+        if (buffer->internalCapacity() > maxRetainedCapacity) {
+            buffer->shrink(0);
+        }
+    }
+}
+
+void OutputQueue::retrieve(size_t n) {
+    while (n > 0) {
+        assert(!segments_.empty());
+        Segment &front = segments_.front();
+        size_t len = std::min(n, front.remaining());
+        if (front.type == kBuffer) {
+            front.buffer->retrieve(len);
+        } else {
+            front.offset += static_cast<off_t>(len);
+            front.length -= len;
+        }
+        n -= len;
+
+        // 最后一段自有缓冲区保留，用于继续追加数据
+        if (front.remaining() == 0 && (front.type != kBuffer || segments_.size() > 1)) {
+            popFront();
+        }
+    }
+}
+
+void OutputQueue::pushBackBuffer() {
+    segments_.emplace_back(kBuffer);
+    if (spareBuffers_.empty()) {
+        segments_.back().buffer.reset(new Buffer);
+    } else {
+        segments_.back().buffer = std::move(spareBuffers_.back());
+        spareBuffers_.pop_back();
+    }
+}
+
+void OutputQueue::popFront() {
+    Segment &front = segments_.front();
+    if (front.type == kBuffer && spareBuffers_.size() < kMaxSpareBuffers) {
+        front.buffer->retrieveAll();
+        spareBuffers_.push_back(std::move(front.buffer));
+    }
+    segments_.pop_front();
+}
@@ -0,0 +1,143 @@
+#ifndef TINYWS_OUTPUTQUEUE_H
+#define TINYWS_OUTPUTQUEUE_H
+
+#include <sys/types.h> // off_t ssize_t
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../base/noncopyable.h"
+#include "Buffer.h"
+#include "FileHandle.h"
+
+namespace tinyWS_thread {
+
+    // TcpConnection 的输出队列，由多个段按顺序组成：
+    // 1 自有缓冲区（Buffer）：send() 剩余的数据、用户直接序列化的数据（如响应头），追加数据时只追加到最后一个自有缓冲区；
+    // 2 共享的只读数据（shared_ptr<const std::string>）：如缓存的响应体，多个连接同时发送同一份数据，不复制；
+    // 3 文件区域（文件描述符 + 偏移 + 长度）：用 sendfile(2) 发送，数据不经过用户态。
+    //
+    // 连续的内存段（1 和 2）用一次 writev(2) 发送，文件段用 sendfile(2) 发送，
+    // 每个段记录自己已经发送的位置，部分写入时下次从该位置继续发送。
+    // 只在所属 IO 线程中访问。
+    class OutputQueue : noncopyable {
+    public:
+        OutputQueue();
+
+        /**
+         * 队列中还没有发送的字节数
+         * @return 字节数
+         */
+        size_t readableBytes() const;
+
+        /**
+         * 队列中是否没有需要发送的数据
+         * @return true / false
+         */
+        bool empty() const;
+
+        /**
+         * 获取最后一个自有缓冲区，用于追加数据。
+         * 最后一段不是自有缓冲区时，添加一个新的自有缓冲区（优先复用已发送完的缓冲区）。
+         * 之后再添加其他段时，返回的指针不再是最后一段，不能再使用。
+         * @return 缓冲区
+         */
+        Buffer* tailBuffer();
+
+        /**
+         * 复制数据到最后一个自有缓冲区
+         * @param data 数据的起始地址
+         * @param len 数据的长度
+         */
+        void append(const void *data, size_t len);
+
+        /**
+         * 把 buffer 中的数据作为一个新的自有缓冲区段（交换，不复制），调用后 buffer 为空
+         * @param buffer 数据
+         */
+        void appendBuffer(Buffer *buffer);
+
+        /**
+         * 添加共享的只读数据段
+         * @param data 数据
+         * @param offset 需要发送的数据在 data 中的起始位置
+         * @param len 需要发送的数据的长度
+         */
+        void appendShared(const std::shared_ptr<const std::string> &data, size_t offset, size_t len);
+
+        /**
+         * 添加文件段
+         * @param file 文件
+         * @param offset 需要发送的区域在文件中的起始位置
+         * @param len 需要发送的区域的长度
+         */
+        void appendFile(const FileHandlePtr &file, off_t offset, size_t len);
+
+        /**
+         * 发送一次数据：队首为内存段时，用一次 writev(2) 发送连续的内存段；队首为文件段时，用一次 sendfile(2) 发送。
+         * 文件比添加时短（sendfile(2) 返回 0）时，视为出错，错误码为 EIO。
+         * @param fd socket 文件描述符
+         * @param savedErrno 出错时的错误码
+         * @return 写入的字节数，出错时返回 -1
+         */
+        ssize_t writeTo(int fd, int *savedErrno);
+
+        /**
+         * 丢弃所有的段，保留不超过 maxRetainedCapacity 的空闲缓冲区内存（用于连接对象池）
+         * @param maxRetainedCapacity 保留的缓冲区最大容量
+         */
+        void clear(size_t maxRetainedCapacity);
+
+    private:
+        enum SegmentType { kBuffer, kShared, kFile };
+
+        // 队列中的一段
+        struct Segment {
+            explicit Segment(SegmentType segmentType)
+                : type(segmentType),
+                  offset(0),
+                  length(0) {}
+
+            SegmentType type;
+            std::unique_ptr<Buffer> buffer;                 // kBuffer：缓冲区，已发送的数据直接 retrieve
+            std::shared_ptr<const std::string> shared;      // kShared：共享的数据
+            FileHandlePtr file;                             // kFile：文件
+            off_t offset;                                   // kShared / kFile：下一个要发送的字节的位置
+            size_t length;                                  // kShared / kFile：剩余的字节数
+
+            /**
+             * 剩余的字节数
+             * @return 字节数
+             */
+            size_t remaining() const;
+        };
+
+        static const int kMaxIovecs = 64;                       // 每次 writev(2) 最多的段数
+        static const size_t kMaxSendfileBytes = 1024 * 1024;    // 每次 sendfile(2) 最多发送的字节数，避免一个连接占用 IO 线程太久
+        static const size_t kMaxSpareBuffers = 2;               // 最多保留的空闲缓冲区数
+
+        std::deque<Segment> segments_;                          // 段队列
+        std::vector<std::unique_ptr<Buffer>> spareBuffers_;     // 已发送完的缓冲区，用于复用内存
+
+        /**
+         * 队首的段已发送了 n 个字节，发送完的段出队
+         * @param n 字节数
+         */
+        void retrieve(size_t n);
+
+        /**
+         * 在队尾添加一个空的自有缓冲区段，优先复用空闲缓冲区
+         */
+        void pushBackBuffer();
+
+        /**
+         * 队首的段出队，缓冲区放入空闲缓冲区
+         */
+        void popFront();
+    };
+}
+
+
+#endif //TINYWS_OUTPUTQUEUE_H
@@ -0,0 +1,36 @@
+#include "Poller.h"
+
+#include <cstdlib>  // getenv
+#include <cstring>  // strcmp
+
+#include <memory>
+
+#include "../base/Logger.h"
+#include "EventLoop.h"
+#include "Epoll.h"
+#include "IoUringPoller.h"
+
+using namespace tinyWS_thread;
+
+Poller::Poller(EventLoop *loop) : ownerLoop_(loop) {
+
+}
+
+Poller::~Poller() = default;
+
+void Poller::assertInLoopThread() {
+    ownerLoop_->assertInLoopThread();
+}
+
+Poller* Poller::newDefaultPoller(EventLoop *loop) {
+    const char *backend = ::getenv("TINYWS_POLLER");
+    if (backend != nullptr && ::strcmp(backend, "io_uring") == 0) {
+        std::unique_ptr<IoUringPoller> poller(new IoUringPoller(loop));
+        if (poller->isValid()) {
+            return poller.release();
+        }
+        debug(LogLevel::WARN) << "io_uring is not supported, fall back to epoll" << std::endl;
+    }
+
+    return new Epoll(loop);
+}
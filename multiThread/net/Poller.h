@@ -0,0 +1,87 @@
+#ifndef TINYWS_POLLER_H
+#define TINYWS_POLLER_H
+
+#include <vector>
+
+#include "../base/noncopyable.h"
+#include "Timer.h"
+
+namespace tinyWS_thread {
+    class Channel;
+    class EventLoop;
+
+    // IO 多路复用的抽象基类，EventLoop 只通过该接口管理 Channel。
+    // 目前有两种实现：
+    // 1 Epoll：使用 epoll(7)，默认的实现；
+    // 2 IoUringPoller：使用 io_uring(7) 的 poll 操作，
+    //   Channel 的变更只写入提交队列，每次事件循环只调用一次 io_uring_enter(2) 批量提交。
+    //
+    // Poller 是 EventLoop 对象的间接成员，
+    // 只供 owner EventLoop 在 IO 线程调用，因此无须加锁。
+    // 其生命周期与 EVentLoop 一样长。
+    class Poller : noncopyable {
+    public:
+        using ChannelList = std::vector<Channel*>;  // Channel 列表类型
+
+        explicit Poller(EventLoop *loop);
+
+        virtual ~Poller();
+
+        /**
+         * --- 只能在 IO 线程中调用 ---
+         * 监听文件描述符
+         * @param timeoutMs 超时时间
+         * @param activeChannels "活动"的 Channel
+         * @return 响应时间
+         */
+        virtual Timer::TimeType poll(int timeoutMs, ChannelList *activeChannels) = 0;
+
+        /**
+         * --- 只能在 IO 线程中调用 ---
+         * 更新 Channel
+         * @param channel
+         */
+        virtual void updateChannel(Channel *channel) = 0;
+
+        /**
+         * --- 只能在 IO 线程中调用 ---
+         * 移除 Channel
+         * @param channel
+         */
+        virtual void removeChannel(Channel *channel) = 0;
+
+        /**
+         * --- 只能在 IO 线程中调用 ---
+         * channel 是否被 Poller 监听中。
+         * @param channel Channel
+         * @return true / false
+         */
+        virtual bool hasChannel(Channel *channel) = 0;
+
+        /**
+         * 后端名字，用于打印日志
+         * @return "epoll" / "io_uring"
+         */
+        virtual const char* name() const = 0;
+
+        /**
+         * 断言
+         * 判断该调用线程是否为 IO 线程
+         */
+        void assertInLoopThread();
+
+        /**
+         * 根据环境变量 TINYWS_POLLER 创建 Poller：
+         * - TINYWS_POLLER=io_uring，使用 IoUringPoller，如果内核不支持，则退回到 Epoll；
+         * - 其他情况，使用 Epoll。
+         * @param loop 所属事件循环
+         * @return Poller 对象指针，由 EventLoop 持有
+         */
+        static Poller* newDefaultPoller(EventLoop *loop);
+
+    private:
+        EventLoop *ownerLoop_;                      // 所属事件循环
+    };
+}
+
+#endif //TINYWS_POLLER_H
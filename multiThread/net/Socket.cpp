@@ -4,6 +4,7 @@
 #include <netinet/in.h>
 #include <netinet/tcp.h> // struct tcp_info
 #include <sys/socket.h>
+#include <linux/filter.h>   // struct sock_filter、SKF_AD_CPU
 #include <cerrno>
 
 #include "../base/Logger.h"
@@ -68,23 +69,21 @@ int Socket::accept(InternetAddress *peerAddress) {
         return connectionFd;
     } else {
         int savedErrno = errno;
-        debug(LogLevel::ERROR) << "Socket::accept" << std::endl;
         switch (savedErrno) {
             case EAGAIN:
-                debug(LogLevel::DEBUG) << "EAGAIN " << getpid() << std::endl;
+                // accept 队列已空，Acceptor 批量 accept 时每次可读都会遇到，不记录日志
                 break;
             case ECONNABORTED:
             case EINTR:
             case EPROTO: // ???
             case EPERM:
-            case EMFILE: // per-process lmit of open file desctiptor ???
+            case EMFILE: // per-process lmit of open file desctiptor，由 Acceptor 处理
+            case ENFILE:
                 // expected errors
-                errno = savedErrno;
                 break;
             case EBADF:
             case EFAULT:
             case EINVAL:
-            case ENFILE:
             case ENOBUFS:
             case ENOMEM:
             case ENOTSOCK:
@@ -99,6 +98,8 @@ int Socket::accept(InternetAddress *peerAddress) {
                 break;
         }
 
+        // 日志可能会修改 errno，调用者需要根据 errno 处理错误
+        errno = savedErrno;
         return -1;
     }
 }
@@ -119,6 +120,31 @@ void Socket::setReuseAddr(bool on) {
     setsockopt(sockfd_, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
 }
 
+void Socket::setReusePort(bool on) {
+    int opt = on ? 1 : 0;
+    if (setsockopt(sockfd_, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) < 0 && on) {
+        debug(LogLevel::ERROR) << "SO_REUSEPORT failed" << std::endl;
+    }
+}
+
+bool Socket::setIncomingCpu(int cpu) {
+    return setsockopt(sockfd_, SOL_SOCKET, SO_INCOMING_CPU, &cpu, sizeof(cpu)) == 0;
+}
+
+bool Socket::attachReusePortCpuFilter(int groupSize) {
+    // A = 当前 CPU 编号；A = A % groupSize；返回 A
+    sock_filter code[] = {
+            {BPF_LD | BPF_W | BPF_ABS, 0, 0, static_cast<__u32>(SKF_AD_OFF + SKF_AD_CPU)},
+            {BPF_ALU | BPF_MOD | BPF_K, 0, 0, static_cast<__u32>(groupSize)},
+            {BPF_RET | BPF_A, 0, 0, 0},
+    };
+    sock_fprog program{};
+    program.len = sizeof(code) / sizeof(code[0]);
+    program.filter = code;
+
+    return setsockopt(sockfd_, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &program, sizeof(program)) == 0;
+}
+
 void Socket::setKeepAlive(bool on) {
     int opt = on ? 1 : 0;
     setsockopt(sockfd_, SOL_SOCKET, SO_KEEPALIVE, &opt, sizeof(opt));
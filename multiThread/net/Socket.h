@@ -79,6 +79,29 @@ namespace tinyWS_thread {
          */
         void setReuseAddr(bool on);
 
+        /**
+         * 设置 SO_REUSEPORT，多个 socket 可以绑定同一个地址，由内核在它们之间分发新连接
+         * @param on
+         */
+        void setReusePort(bool on);
+
+        /**
+         * 设置 SO_INCOMING_CPU。
+         * 对于 SO_REUSEPORT 组中的监听 socket，内核优先把在该 CPU 上收到的连接分发给它。
+         * @param cpu CPU 编号
+         * @return 是否设置成功
+         */
+        bool setIncomingCpu(int cpu);
+
+        /**
+         * 给 socket 所在的 SO_REUSEPORT 组添加 classic BPF 程序（SO_ATTACH_REUSEPORT_CBPF），
+         * 按照收到连接的 CPU 选择监听 socket：下标 = CPU 编号 % groupSize。
+         * 组中 socket 的下标是调用 listen(2) 的顺序。
+         * @param groupSize 组中监听 socket 的数量
+         * @return 是否设置成功
+         */
+        bool attachReusePortCpuFilter(int groupSize);
+
         /**
          * 设置 keep alive
          * @param on
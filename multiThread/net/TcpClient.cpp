@@ -14,7 +14,7 @@ TcpClient::TcpClient(EventLoop *loop, const InternetAddress &serverAddress,
                      const std::string &name)
                      : loop_(loop),
                        connector_(std::make_shared<Connector>(loop_, serverAddress)),
-                       name_(name),
+                       name_(std::make_shared<const std::string>(name)),
                        connectionCallback_(defaultConnectionCallback),
                        messageCallback_(defaultMessageCallback),
                        retry_(false),
@@ -23,12 +23,12 @@ TcpClient::TcpClient(EventLoop *loop, const InternetAddress &serverAddress,
 
     connector_->setNewConnectionCallback(std::bind(&TcpClient::newConnection, this, _1));
 
-//    debug() << "TcpClient::TcpClient[" << name_
+//    debug() << "TcpClient::TcpClient[" << *name_
 //            << "] - connector " << connector_.get();
 }
 
 TcpClient::~TcpClient() {
-//    debug() << "TcpClient::~TcpClient[" << name_
+//    debug() << "TcpClient::~TcpClient[" << *name_
 //            << "] - connector " << connector_.get();
 
     TcpConnectionPtr connection;
@@ -47,7 +47,7 @@ TcpClient::~TcpClient() {
 }
 
 void TcpClient::connect() {
-//    debug() << "TcpClient::connect[" << name_ << "] - connecting to "
+//    debug() << "TcpClient::connect[" << *name_ << "] - connecting to "
 //            << connector_->serverAddress().toIPPort();
 
     connect_ = true;
@@ -100,14 +100,9 @@ void TcpClient::newConnection(int sockfd) {
     InternetAddress peerAddress(InternetAddress::getLocalAddress(sockfd));
     InternetAddress localAddress(InternetAddress::getLocalAddress(sockfd));
 
-    char buf[32];
-    snprintf(buf, sizeof(buf), "#%d", nextConnectionId_);
-    ++nextConnectionId_;
-    std::string connectionName = name_ + buf;
-
-
     auto connection = std::make_shared<TcpConnection>(loop_,
-                                                      connectionName,
+                                                      name_,
+                                                      static_cast<uint64_t>(nextConnectionId_++),
                                                       std::move(Socket(sockfd)),
                                                       localAddress,
                                                       peerAddress);
@@ -132,7 +127,7 @@ void TcpClient::removeConnection(const TcpConnectionPtr &conntion) {
     loop_->queueInLoop(
             std::bind(&TcpConnection::connectionDestroyed, conntion));
     if (retry_ && connect_) {
-//        debug() << "TcpClient::connect[" << name_ << "] - Reconnecting to "
+//        debug() << "TcpClient::connect[" << *name_ << "] - Reconnecting to "
 //                << connector_->serverAddress().toIPPort();
         connector_->restart();
     }
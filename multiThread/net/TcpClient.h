@@ -44,7 +44,7 @@ namespace tinyWS_thread {
     private:
         EventLoop* loop_;
         ConnectorPtr connector_;
-        const std::string name_;
+        const std::shared_ptr<const std::string> name_; // 名字，由所有连接共享
         ConnectionCallback connectionCallback_;
         WriteCompleteCallback writeCompleteCallback_;
         MessageCallback messageCallback_;
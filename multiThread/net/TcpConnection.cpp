@@ -11,6 +11,13 @@
 using namespace tinyWS_thread;
 using namespace std::placeholders;
 
+namespace {
+    // 回收的连接对象最多保留的缓冲区大小，超过时缩小
+    const size_t kMaxRecycledBufferSize = 64 * 1024;
+}
+
+const size_t TcpConnection::kDefaultHighWaterMark;
+
 void tinyWS_thread::defaultConnectionCallback(const TcpConnectionPtr& conn) {
 //    debug() << conn->localAddress().toIPPort() << " -> "
 //            << conn->peerAddress().toIPPort() << " is "
@@ -24,17 +31,23 @@ void tinyWS_thread::defaultMessageCallback(const TcpConnectionPtr&,
 }
 
 TcpConnection::TcpConnection(EventLoop *loop,
-                             const std::string &name,
+                             const std::shared_ptr<const std::string> &ownerName,
+                             uint64_t id,
                              Socket socket,
                              const InternetAddress &localAddress,
                              const InternetAddress &peerAddress)
                              : loop_(loop),
-                               name_(name),
+                               ownerName_(ownerName),
+                               id_(id),
                                state_(kConnecting),
                                socket_(new Socket(std::move(socket))),
                                channel_(new Channel(loop, socket_->fd())),
+                               edgeTriggered_(false),
                                localAddress_(localAddress),
-                               peerAddress_(peerAddress) {
+                               peerAddress_(peerAddress),
+                               bytesSent_(0),
+                               highWaterMark_(kDefaultHighWaterMark),
+                               aboveHighWaterMark_(false) {
 //    debug() << "move fd = " << socket_->fd() << std::endl;
     // 设置回调函数
     channel_->setReadCallback(
@@ -46,14 +59,14 @@ TcpConnection::TcpConnection(EventLoop *loop,
     channel_->setErrorCallback(
             std::bind(&TcpConnection::handleError, this));
 
-//    debug() << "TcpConnection::ctor[" <<  name_ << "] at " << this
+//    debug() << "TcpConnection::ctor[" <<  name() << "] at " << this
 //            << " fd=" << socket_->fd();
 
     socket_->setKeepAlive(true);
 }
 
 TcpConnection::~TcpConnection() {
-//    debug() << "TcpConnection::dtor[" <<  name_ << "] at " << this
+//    debug() << "TcpConnection::dtor[" <<  name() << "] at " << this
 //            << " fd=" << channel_->fd()
 //            << " state=" << stateToString();
 
@@ -66,16 +79,133 @@ void TcpConnection::send(const std::string &message) {
             // 如果当前线程为 IO 线程，则直接发送。
             sendInLoop(message);
         } else {
-            // 如果当前线程不是 IO 线程，则将发送数据工作转移到 IO 线程。
-            loop_->runInLoop(std::bind(&TcpConnection::sendInLoop, this, message));
+            // 如果当前线程不是 IO 线程，则将发送数据工作转移到 IO 线程（只复制一次数据）。
+            send(std::string(message));
+        }
+    }
+}
+
+void TcpConnection::send(std::string &&message) {
+    if (state_ == kConnected) {
+        if (loop_->isInLoopThread()) {
+            sendInLoop(message.data(), message.size());
+        } else {
+            // Functor 要求可以复制，所以通过交换把数据放入 shared_ptr 中，不复制数据。
+            // 持有 shared_ptr：连接对象可能被对象池回收并复用，不能让数据发送到下一个连接上。
+            auto holder = std::make_shared<std::string>();
+            holder->swap(message);
+            TcpConnectionPtr guardThis(shared_from_this());
+            loop_->runInLoop([guardThis, holder]() {
+                guardThis->sendInLoop(holder->data(), holder->size());
+            });
         }
     }
 }
 
 void TcpConnection::send(const void *message, size_t len) {
-    const char *cStr = static_cast<const char*>(message);
-    std::string str(cStr, len);
-    send(str);
+    if (state_ == kConnected) {
+        if (loop_->isInLoopThread()) {
+            sendInLoop(message, len);
+        } else {
+            send(std::string(static_cast<const char*>(message), len));
+        }
+    }
+}
+
+void TcpConnection::send(Buffer &&buffer) {
+    if (state_ == kConnected) {
+        if (loop_->isInLoopThread()) {
+            sendInLoop(&buffer);
+        } else {
+            auto holder = std::make_shared<Buffer>();
+            holder->swap(buffer);
+            TcpConnectionPtr guardThis(shared_from_this());
+            loop_->runInLoop([guardThis, holder]() {
+                guardThis->sendInLoop(holder.get());
+            });
+        }
+    }
+}
+
+void TcpConnection::send(const std::shared_ptr<const std::string> &data) {
+    if (state_ == kConnected) {
+        if (loop_->isInLoopThread()) {
+            sendSharedInLoop(data);
+        } else {
+            loop_->runInLoop(std::bind(&TcpConnection::sendSharedInLoop, shared_from_this(), data));
+        }
+    }
+}
+
+void TcpConnection::sendFile(const FileHandlePtr &file, off_t offset, size_t len) {
+    if (state_ == kConnected) {
+        if (loop_->isInLoopThread()) {
+            sendFileInLoop(file, offset, len);
+        } else {
+            loop_->runInLoop(std::bind(&TcpConnection::sendFileInLoop, shared_from_this(), file, offset, len));
+        }
+    }
+}
+
+Buffer* TcpConnection::outputBuffer() {
+    loop_->assertInLoopThread();
+    return outputQueue_.tailBuffer();
+}
+
+Buffer* TcpConnection::inputBuffer() {
+    loop_->assertInLoopThread();
+    return &inputBuffer_;
+}
+
+void TcpConnection::appendFileToOutput(const FileHandlePtr &file, off_t offset, size_t len) {
+    loop_->assertInLoopThread();
+    if (len > 0) {
+        outputQueue_.appendFile(file, offset, len);
+    }
+}
+
+void TcpConnection::appendSharedToOutput(const std::shared_ptr<const std::string> &data) {
+    loop_->assertInLoopThread();
+    if (!data->empty()) {
+        outputQueue_.appendShared(data, 0, data->size());
+    }
+}
+
+void TcpConnection::sendOutputBuffer() {
+    loop_->assertInLoopThread();
+    // Channel 正在写数据时，数据会在 handleWrite() 中发送
+    if (state_ == kConnected && !channel_->isWriting()) {
+        writeOutputQueue();
+    } else {
+        checkHighWaterMark();
+    }
+}
+
+bool TcpConnection::outputPending() const {
+    return !outputQueue_.empty();
+}
+
+void TcpConnection::stopRead() {
+    loop_->assertInLoopThread();
+    if (channel_->isReading()) {
+        channel_->disableReading();
+    }
+}
+
+void TcpConnection::startRead() {
+    loop_->assertInLoopThread();
+    // 连接断开之后 Channel 已经移除，不能再关注事件
+    if (!channel_->isReading() && (state_ == kConnected || state_ == kDisconnecting)) {
+        channel_->enableReading();
+    }
+}
+
+bool TcpConnection::isReading() const {
+    return channel_->isReading();
+}
+
+uint64_t TcpConnection::bytesSent() const {
+    return bytesSent_;
 }
 
 void TcpConnection::shutdown() {
@@ -85,6 +215,14 @@ void TcpConnection::shutdown() {
     }
 }
 
+void TcpConnection::forceClose() {
+    if (state_ == kConnected || state_ == kDisconnecting) {
+        setState(kDisconnecting);
+        // 使用 queueInLoop()，即使在 IO 线程中调用，也要等当前的事件处理完再关闭连接
+        loop_->queueInLoop(std::bind(&TcpConnection::forceCloseInLoop, shared_from_this()));
+    }
+}
+
 void TcpConnection::setContext(const tinyWS_thread::any &context) {
     context_ = context;
 }
@@ -105,6 +243,12 @@ void TcpConnection::setKeepAlive(bool on) {
     socket_->setKeepAlive(on);
 }
 
+void TcpConnection::setEdgeTriggered(bool on) {
+    assert(state_ == kConnecting);
+    edgeTriggered_ = on;
+    channel_->setEdgeTriggered(on);
+}
+
 void TcpConnection::setConnectionCallback(const ConnectionCallback &cb) {
     connectionCallback_ = cb;
 }
@@ -153,8 +297,58 @@ void TcpConnection::connectionDestroyed() {
     channel_->remove();
 }
 
-std::string TcpConnection::name() {
-    return name_;
+std::string TcpConnection::name() const {
+    return *ownerName_ + "#" + std::to_string(id_);
+}
+
+uint64_t TcpConnection::id() const {
+    return id_;
+}
+
+void TcpConnection::recycle() {
+    loop_->assertInLoopThread();
+    assert(state_ == kDisconnected);
+
+    // Channel 已经从 Poller 中移除（connectionDestroyed()），否则关闭 fd 之后 Poller 中留下旧的 fd，与复用的 fd 冲突
+    assert(!channel_->addedToLoop());
+
+    // 立即关闭 socket，不能等到复用时才关闭
+    Socket closing(std::move(*socket_));
+    // 解除 Channel 与本对象旧的 shared_ptr 的绑定
+    channel_->reset(-1);
+
+    // 缓冲区保留内存，但过大的缓冲区（如发送过大文件）要缩小，避免空闲的连接对象占用过多内存
+    inputBuffer_.retrieveAll();
+    if (inputBuffer_.internalCapacity() > kMaxRecycledBufferSize) {
+        inputBuffer_.shrink(0);
+    }
+    outputQueue_.clear(kMaxRecycledBufferSize);
+    bytesSent_ = 0;
+
+    context_ = tinyWS_thread::any();
+    // 以下回调函数由用户为单个连接设置，不能留给下一个连接
+    writeCompleteCallback_ = WriteCompleteCallback();
+    highWaterMarkCallback_ = HighWaterMarkCallback();
+    highWaterMark_ = kDefaultHighWaterMark;
+    aboveHighWaterMark_ = false;
+    edgeTriggered_ = false;
+}
+
+void TcpConnection::reset(uint64_t id,
+                          Socket socket,
+                          const InternetAddress &localAddress,
+                          const InternetAddress &peerAddress) {
+    assert(state_ == kDisconnected);
+    assert(socket_->fd() < 0);
+
+    id_ = id;
+    *socket_ = std::move(socket);
+    channel_->reset(socket_->fd());
+    localAddress_ = localAddress;
+    peerAddress_ = peerAddress;
+    state_ = kConnecting;
+
+    socket_->setKeepAlive(true);
 }
 
 EventLoop* TcpConnection::getLoop() const {
@@ -183,6 +377,11 @@ void TcpConnection::setState(TcpConnection::StateE s) {
 
 void TcpConnection::handleRead(Timer::TimeType receiveTime) {
     loop_->assertInLoopThread();
+    if (edgeTriggered_) {
+        handleReadUntilEAGAIN(receiveTime);
+        return;
+    }
+
     int savedErrno = 0;
     ssize_t n = inputBuffer_.readFd(socket_->fd(), &savedErrno);
     if (n > 0) {
@@ -198,38 +397,99 @@ void TcpConnection::handleRead(Timer::TimeType receiveTime) {
     }
 }
 
+void TcpConnection::handleReadUntilEAGAIN(Timer::TimeType receiveTime) {
+    // edge trigger 只在 socket 接收缓冲区"由空变为非空"时通知一次，
+    // 所以必须一直读到 EAGAIN 为止，否则剩余的数据要等到下次有新数据到来时才能读到。
+    ssize_t total = 0;
+    bool peerClosed = false;
+    int savedErrno = 0;
+    while (true) {
+        ssize_t n = inputBuffer_.readFd(socket_->fd(), &savedErrno);
+        if (n > 0) {
+            total += n;
+        } else if (n == 0) {
+            peerClosed = true;
+            break;
+        } else if (savedErrno == EINTR) {
+            continue;
+        } else {
+            break;
+        }
+    }
+
+    if (total > 0 && messageCallback_) {
+        messageCallback_(shared_from_this(), &inputBuffer_, receiveTime);
+    }
+
+    if (peerClosed) {
+        // message callback 中可能已经 shutdown 了连接
+        if (state_ == kConnected || state_ == kDisconnecting) {
+            handleClose();
+        }
+    } else if (savedErrno != EAGAIN && savedErrno != EWOULDBLOCK) {
+        errno = savedErrno;
+        debug(LogLevel::ERROR) << "TcpConnection::handleError" << std::endl;
+        handleError();
+    }
+}
+
 void TcpConnection::handleWrite() {
     loop_->assertInLoopThread();
     if (channel_->isWriting()) {
         // 如果 Channel 可写，则直接发送数据。
-        ssize_t n = ::write(
-                socket_->fd(),
-                outputBuffer_.peek(),
-                outputBuffer_.readableBytes());
+        writeOutputQueue();
+    } else {
+        debug(LogLevel::ERROR) << "Connection is down, no more writing" << std::endl;
+    }
+}
+
+void TcpConnection::writeOutputQueue() {
+    // edge trigger 模式下，EPOLLOUT 只会通知一次，所以要一直写到 outputQueue_ 为空或者 EAGAIN 为止。
+    ssize_t n;
+    int savedErrno = 0;
+    do {
+        n = outputQueue_.writeTo(socket_->fd(), &savedErrno);
         if (n > 0) {
-            outputBuffer_.retrieve(static_cast<size_t>(n)); // 更新 outputBuffer_ 中的缓冲区索引
-            if (outputBuffer_.readableBytes() == 0) {
-                // 如果 outputBuffer_ 中没有可读数据，即数据已经发送完毕，
-                // 则立即设置 Channel 不可写（因为 Epoll 采用的是 level trigger），避免 busy loop。
-                // 还有调用写完成回调函数。
-                channel_->disableWriting();
-                if (writeCompleteCallback_) {
-                    loop_->queueInLoop(
-                            std::bind(writeCompleteCallback_, shared_from_this()));
-                }
-                // 如果连接正在关闭，则调用 shutdownInLoop() ，继续执行关闭过程。
-                if (state_ == kDisconnecting) {
-                    // 该函数作为 Channel 的写回调函数，在 IO 线程中执行。
-                    shutdownInLoop();
-                }
-            } else {
-//                debug() << "I am going to write more data" << std::endl;
-            }
-        } else {
-//            debug() << "TcpConnection::handleWrite" << std:: endl;
+            bytesSent_ += static_cast<uint64_t>(n);
+        }
+    } while (edgeTriggered_ && n > 0 && !outputQueue_.empty());
+
+    if (n < 0) {
+        if (savedErrno == EIO) {
+            // 文件段的文件被截断，已经发送的响应头中的长度不再正确，只能关闭连接
+            debug(LogLevel::ERROR) << "TcpConnection::writeOutputQueue [" << name()
+                                   << "] - file truncated while sending" << std::endl;
+            forceClose();
+            return;
+        }
+        if (savedErrno != EWOULDBLOCK) {
+            debug(LogLevel::ERROR) << "TcpConnection::writeOutputQueue [" << name()
+                                   << "] - errno = " << savedErrno << std::endl;
+        }
+    }
+
+    if (outputQueue_.empty()) {
+        // 如果 outputQueue_ 中没有数据，即数据已经发送完毕，
+        // 则立即设置 Channel 不可写（因为 Epoll 采用的是 level trigger），避免 busy loop。
+        // 还有调用写完成回调函数。
+        if (channel_->isWriting()) {
+            channel_->disableWriting();
+        }
+        aboveHighWaterMark_ = false;
+        if (n > 0 && writeCompleteCallback_) {
+            loop_->queueInLoop(
+                    std::bind(writeCompleteCallback_, shared_from_this()));
+        }
+        // 如果连接正在关闭，则调用 shutdownInLoop() ，继续执行关闭过程。
+        if (state_ == kDisconnecting) {
+            shutdownInLoop();
         }
     } else {
-        debug(LogLevel::ERROR) << "Connection is down, no more writing" << std::endl;
+        if (!channel_->isWriting()) {
+            // 剩余的数据在 handleWrite() 中发送
+            channel_->enableWriting();
+        }
+        checkHighWaterMark();
     }
 }
 
@@ -240,57 +500,127 @@ void TcpConnection::handleClose() {
     setState(kDisconnected);
     // 不关闭 socket fd，让它（Socket 对象）自己析构，从而我们可以轻松地定位到内存泄漏。
     channel_->disableAll();
+
+    TcpConnectionPtr guardThis(shared_from_this());
+    // 通知用户连接断开。
+    // 此时状态已经是 kDisconnected，connectionDestroyed() 不会再调用 connectionCallback_。
+    if (connectionCallback_) {
+        connectionCallback_(guardThis);
+    }
     if (closeCallback_) {
         // 该回调实际是 TcpServer::removeConnection。
-        closeCallback_(shared_from_this());
+        closeCallback_(guardThis);
     }
 }
 
 void TcpConnection::handleError() {
     int err = socket_->getSocketError();
-    debug(LogLevel::ERROR) << "TcpConnection::handleError [" << name_
+    debug(LogLevel::ERROR) << "TcpConnection::handleError [" << name()
                                  << "] - SO_ERROR = " << err << std::endl;
 }
 
 void TcpConnection::sendInLoop(const std::string &message) {
+    sendInLoop(message.data(), message.size());
+}
+
+void TcpConnection::sendInLoop(const void *message, size_t len) {
     loop_->assertInLoopThread();
-    ssize_t n = 0;
-    if (!channel_->isWriting() && outputBuffer_.readableBytes() == 0) {
+    if (state_ == kDisconnected) {
+        debug(LogLevel::WARN) << "TcpConnection::sendInLoop [" << name() << "] - disconnected, give up writing" << std::endl;
+        return;
+    }
+    size_t written = 0;
+    if (!channel_->isWriting() && outputQueue_.empty()) {
         // 如果 Channel 当前不在写数据以及输出缓冲区没有可读数据，则尝试直接发送数据。
-        n = ::write(socket_->fd(), message.data(), message.size());
-        if (n >= 0) {
-            if (static_cast<size_t>(n) < message.size()) {
-                // 只发送了一部分数据
-//                debug() << "I am going to write more data" << std::endl;
-            } else {
-                if (writeCompleteCallback_) {
-                    loop_->queueInLoop(
-                            std::bind(writeCompleteCallback_, shared_from_this()));
-                }
-            }
-        } else {
-            // 发送数据出错
-            n = 0;
-            if (errno != EWOULDBLOCK) {
-                debug(LogLevel::ERROR) << "TcpConnection::sendInLoop" << std::endl;
-            }
+        written = afterDirectWrite(::write(socket_->fd(), message, len), len);
+    }
+
+    // 只发送了一部分数据，剩余的数据将被放入输出缓冲区中，
+    // 并开始关注写事件，以后在 handleWrite() 中发送剩余的数据。
+    if (written < len) {
+        outputQueue_.append(static_cast<const char*>(message) + written, len - written);
+        if (!channel_->isWriting()) {
+            channel_->enableWriting();
         }
+        checkHighWaterMark();
+    }
+}
 
-        assert(n >= 0);
-        // 只发送了一部分数据，剩余的数据将被放入输出缓冲区中，
-        // 并开始关注写事件，以后在 handleWrite() 中发送剩余的数据。
-        if (static_cast<size_t>(n) < message.size()) {
-            outputBuffer_.append(message.data() + n, message.size() - n);
-            if (!channel_->isWriting()) {
-                channel_->enableWriting();
-            }
+void TcpConnection::sendInLoop(Buffer *buffer) {
+    loop_->assertInLoopThread();
+    if (state_ == kDisconnected) {
+        debug(LogLevel::WARN) << "TcpConnection::sendInLoop [" << name() << "] - disconnected, give up writing" << std::endl;
+        return;
+    }
+    if (channel_->isWriting() || !outputQueue_.empty()) {
+        // 输出队列中还有数据，作为一个新的段放入队列（交换，不复制）
+        outputQueue_.appendBuffer(buffer);
+        checkHighWaterMark();
+        return;
+    }
+
+    size_t len = buffer->readableBytes();
+    buffer->retrieve(afterDirectWrite(::write(socket_->fd(), buffer->peek(), len), len));
+    if (buffer->readableBytes() > 0) {
+        // 剩余的数据交换到输出队列中，不需要复制
+        outputQueue_.appendBuffer(buffer);
+        channel_->enableWriting();
+        checkHighWaterMark();
+    }
+}
+
+void TcpConnection::sendSharedInLoop(const std::shared_ptr<const std::string> &data) {
+    loop_->assertInLoopThread();
+    if (state_ == kDisconnected) {
+        debug(LogLevel::WARN) << "TcpConnection::sendSharedInLoop [" << name() << "] - disconnected, give up writing" << std::endl;
+        return;
+    }
+    outputQueue_.appendShared(data, 0, data->size());
+    if (!channel_->isWriting()) {
+        writeOutputQueue();
+    } else {
+        checkHighWaterMark();
+    }
+}
+
+void TcpConnection::sendFileInLoop(const FileHandlePtr &file, off_t offset, size_t len) {
+    loop_->assertInLoopThread();
+    if (state_ == kDisconnected) {
+        debug(LogLevel::WARN) << "TcpConnection::sendFileInLoop [" << name() << "] - disconnected, give up writing" << std::endl;
+        return;
+    }
+    outputQueue_.appendFile(file, offset, len);
+    if (!channel_->isWriting()) {
+        writeOutputQueue();
+    } else {
+        checkHighWaterMark();
+    }
+}
+
+size_t TcpConnection::afterDirectWrite(ssize_t n, size_t len) {
+    if (n < 0) {
+        // 发送数据出错
+        if (errno != EWOULDBLOCK) {
+            debug(LogLevel::ERROR) << "TcpConnection::sendInLoop" << std::endl;
         }
+        return 0;
+    }
+
+    bytesSent_ += static_cast<uint64_t>(n);
+    if (static_cast<size_t>(n) == len && writeCompleteCallback_) {
+        loop_->queueInLoop(
+                std::bind(writeCompleteCallback_, shared_from_this()));
     }
+    // 只发送了一部分数据时，剩余的数据由调用者放入输出缓冲区
+    return static_cast<size_t>(n);
 }
 
-//void TcpConnection::sendInLoop(const void *message, size_t len) {
-//
-//}
+void TcpConnection::checkHighWaterMark() {
+    if (!aboveHighWaterMark_ && highWaterMarkCallback_ && outputQueue_.readableBytes() >= highWaterMark_) {
+        aboveHighWaterMark_ = true;
+        loop_->queueInLoop(std::bind(highWaterMarkCallback_, shared_from_this()));
+    }
+}
 
 void TcpConnection::shutdownInLoop() {
     loop_->assertInLoopThread();
@@ -299,6 +629,14 @@ void TcpConnection::shutdownInLoop() {
     }
 }
 
+void TcpConnection::forceCloseInLoop() {
+    loop_->assertInLoopThread();
+    if (state_ == kConnected || state_ == kDisconnecting) {
+        // 与对端关闭连接的处理过程相同
+        handleClose();
+    }
+}
+
 std::string TcpConnection::stateToString() const {
     switch (state_) {
         case kDisconnected:
@@ -1,6 +1,7 @@
 #ifndef TINYWS_TCPCONNECTION_H
 #define TINYWS_TCPCONNECTION_H
 
+#include <cstdint>
 #include <functional>
 #include <memory>
 #include <string>
@@ -9,6 +10,8 @@
 #include "Timer.h"
 #include "InternetAddress.h"
 #include "Buffer.h"
+#include "OutputQueue.h"
+#include "FileHandle.h"
 #include "CallBack.h"
 //#include "../http/HttpContext.h"
 #include "../base/any.h"
@@ -31,13 +34,15 @@ namespace tinyWS_thread {
         /**
          * 构造函数
          * @param loop 所属 EventLoop
-         * @param name 连接名
+         * @param ownerName 所属 TcpServer / TcpClient 的名字，由所有连接共享
+         * @param id 连接 ID
          * @param socket socket 对象
          * @param localAddress 本地地址对象
          * @param peerAddress 客户端地址对象
          */
         explicit TcpConnection(EventLoop *loop,
-                               const std::string &name,
+                               const std::shared_ptr<const std::string> &ownerName,
+                               uint64_t id,
                                Socket socket,
                                const InternetAddress &localAddress,
                                const InternetAddress &peerAddress);
@@ -49,6 +54,12 @@ namespace tinyWS_thread {
          */
         void send(const std::string &message);
 
+        /**
+         * 发送数据，在其他线程中调用时不复制数据
+         * @param message 数据，调用后内容不确定
+         */
+        void send(std::string &&message);
+
         /**
          * 发送数据
          * @param message 数据字符串指针
@@ -56,12 +67,113 @@ namespace tinyWS_thread {
          */
         void send(const void *message, size_t len);
 
+        /**
+         * 发送 Buffer 中的数据，调用后 buffer 为空。
+         * 没有发送完的数据通过交换缓冲区作为一个新的段放入输出队列，不复制；
+         * 在其他线程中调用时也只交换缓冲区，不复制数据。
+         * @param buffer 数据
+         */
+        void send(Buffer &&buffer);
+
+        /**
+         * 发送共享的只读数据（如缓存的响应体），数据不复制到连接的缓冲区中，发送完之前一直持有 data
+         * @param data 数据
+         */
+        void send(const std::shared_ptr<const std::string> &data);
+
+        /**
+         * 用 sendfile(2) 发送文件的一个区域，数据不经过用户态，发送完之前一直持有 file
+         * @param file 文件
+         * @param offset 区域在文件中的起始位置
+         * @param len 区域的长度
+         */
+        void sendFile(const FileHandlePtr &file, off_t offset, size_t len);
+
+        /**
+         * --- 只能在 IO 线程中调用 ---
+         * 获取输出队列最后的缓冲区，用于把数据直接序列化到输出缓冲区中（之后调用 sendOutputBuffer()），避免中间的复制。
+         * 之后再调用其他 send*() 函数时，返回的指针不能再使用。
+         * @return 输出缓冲区
+         */
+        Buffer* outputBuffer();
+
+        /**
+         * --- 只能在 IO 线程中调用 ---
+         * 获取输入缓冲区（如处理完一个请求之后，继续处理缓冲区中剩余的请求）
+         * @return 输入缓冲区
+         */
+        Buffer* inputBuffer();
+
+        /**
+         * --- 只能在 IO 线程中调用 ---
+         * 把文件区域添加到输出队列的末尾（在 outputBuffer() 已写入的数据之后），不立即发送，
+         * 与 outputBuffer() 交替使用可以组成由内存数据和多个文件区域组成的响应，之后调用 sendOutputBuffer() 发送。
+         * @param file 文件
+         * @param offset 区域在文件中的起始位置
+         * @param len 区域的长度
+         */
+        void appendFileToOutput(const FileHandlePtr &file, off_t offset, size_t len);
+
+        /**
+         * --- 只能在 IO 线程中调用 ---
+         * 把共享的只读数据添加到输出队列的末尾，不立即发送（之后调用 sendOutputBuffer() 发送），数据不复制
+         * @param data 数据
+         */
+        void appendSharedToOutput(const std::shared_ptr<const std::string> &data);
+
+        /**
+         * --- 只能在 IO 线程中调用 ---
+         * 发送用户直接写入输出缓冲区的数据，只有处于 kConnected 状态才会发送。
+         * 如果 Channel 没有在写数据，则立即发送一次（writev(2) / sendfile(2)），剩余的数据在 handleWrite() 中发送。
+         */
+        void sendOutputBuffer();
+
+        /**
+         * --- 只能在 IO 线程中调用 ---
+         * 输出队列中是否还有没有发送完的数据（如客户端读得慢、发送大文件）
+         * @return true / false
+         */
+        bool outputPending() const;
+
+        /**
+         * --- 只能在 IO 线程中调用 ---
+         * 停止读 socket（如输入缓冲区中等待处理的数据太多），TCP 的接收窗口填满之后客户端就不能再发送
+         */
+        void stopRead();
+
+        /**
+         * --- 只能在 IO 线程中调用 ---
+         * 继续读 socket，与 stopRead() 对应
+         */
+        void startRead();
+
+        /**
+         * --- 只能在 IO 线程中调用 ---
+         * 是否在读 socket
+         * @return true / false
+         */
+        bool isReading() const;
+
+        /**
+         * --- 只能在 IO 线程中调用 ---
+         * 连接建立以来已经写入 socket 的字节数，用于判断发送是否有进展
+         * @return 字节数
+         */
+        uint64_t bytesSent() const;
+
         /**
          * shutdown write 端
          * 只有处于 kConnected 状态才能 shutdown，转换成 kDisconnecting 状态。
          */
         void shutdown();
 
+        /**
+         * --- 线程安全 ---
+         * 强制关闭连接，不等待输出缓冲区的数据发送完，用于关闭超时的连接。
+         * 处于 kConnected 或者 kDisconnecting 状态才能关闭。
+         */
+        void forceClose();
+
         void setContext(const tinyWS_thread::any &context);
         const tinyWS_thread::any& getContext() const;
         tinyWS_thread::any* getMutableContext();
@@ -78,6 +190,13 @@ namespace tinyWS_thread {
          */
         void setKeepAlive(bool on);
 
+        /**
+         * 设置是否使用 edge trigger，必须在 connectionEstablished() 之前调用。
+         * 使用 edge trigger 时，handleRead() 和 handleWrite() 会一直读 / 写到 EAGAIN 为止。
+         * @param on true / false
+         */
+        void setEdgeTriggered(bool on);
+
         /**
          * 设置连接建立回调函数
          * @param cb 回调函数
@@ -103,7 +222,9 @@ namespace tinyWS_thread {
         void setWriteCompleteCallback(const WriteCompleteCallback &cb);
 
         /**
-         * 设置高水位回调函数
+         * 设置高水位回调函数：输出队列中还没有发送的数据量从低于 highWaterMark 变为不低于 highWaterMark 时，
+         * 在 IO 线程中调用（queueInLoop），之后输出队列发送完（写完成回调函数）之前不再调用。
+         * 可以用来暂停生成数据，等写完成回调函数再继续，避免输出队列无限增长。
          * @param cb 回调函数
          * @param highWaterMark 水位值
          */
@@ -122,7 +243,35 @@ namespace tinyWS_thread {
          */
         void connectionDestroyed();
 
-        std::string name();
+        /**
+         * 连接名（"所属 TcpServer 名字#连接 ID"），只在需要时（如打印日志）才构造
+         * @return 连接名
+         */
+        std::string name() const;
+
+        /**
+         * 连接 ID，在所属 TcpServer / TcpClient 中唯一
+         * @return 连接 ID
+         */
+        uint64_t id() const;
+
+        /**
+         * 连接对象池（TcpConnectionPool）使用：连接销毁后，关闭 socket，清空缓冲区和上下文，
+         * 保留 Channel、缓冲区的内存和 TcpServer 设置的回调函数，等待复用
+         */
+        void recycle();
+
+        /**
+         * 连接对象池（TcpConnectionPool）使用：复用对象，重新初始化为一个新建立的连接
+         * @param id 连接 ID
+         * @param socket socket 对象
+         * @param localAddress 本地地址对象
+         * @param peerAddress 客户端地址对象
+         */
+        void reset(uint64_t id,
+                   Socket socket,
+                   const InternetAddress &localAddress,
+                   const InternetAddress &peerAddress);
 
         EventLoop* getLoop() const;
 
@@ -138,7 +287,8 @@ namespace tinyWS_thread {
         enum StateE { kDisconnected, kConnecting, kConnected, kDisconnecting };
 
         EventLoop *loop_;                               // 所属 EventLoop
-        std::string name_;                              // 连接名
+        std::shared_ptr<const std::string> ownerName_;  // 所属 TcpServer / TcpClient 的名字，连接名由它和 id_ 构造
+        uint64_t id_;                                   // 连接 ID
         StateE state_;                                  // 当前连接状态
         std::unique_ptr<Socket> socket_;                // Socket 对象的只能指针，为 TcpConnection 独享。
 
@@ -149,19 +299,24 @@ namespace tinyWS_thread {
         // 当有事件到来时，IO 线程被唤醒，EventLoop 从 Epoll 中获得 Channel 的指针。
         // 但 EventLoop 只是短暂持有，在下一事件循环之前，持有的 Channel 指针已被销毁。
         std::unique_ptr<Channel> channel_;
+        bool edgeTriggered_;                            // 是否使用 edge trigger
 
         InternetAddress localAddress_;                  // 本地地址对象
         InternetAddress peerAddress_;                   // 客户端地址对象
         Buffer inputBuffer_;                            // 输入缓冲区
-        Buffer outputBuffer_;                           // 输出缓冲区
+        OutputQueue outputQueue_;                       // 输出队列（缓冲区、共享数据和文件段）
+        uint64_t bytesSent_;                            // 已经写入 socket 的字节数
         tinyWS_thread::any context_;                    // 接收到的请求的内容
 
         ConnectionCallback connectionCallback_;         // 连接建立回调函数
         MessageCallback messageCallback_;               // 消息读取成功回调函数
         CloseCallback closeCallback_;                   // 连接断开回调函数
         WriteCompleteCallback writeCompleteCallback_;   // 写完成回调函数，在 sendInLoop、handleWrite 中调用
-        HighWaterMarkCallback highWaterMarkCallback_;   // TODO 未实现"高水位回调"功能
-        size_t highWaterMark_;
+        HighWaterMarkCallback highWaterMarkCallback_;   // 高水位回调函数，输出队列的数据量达到 highWaterMark_ 时调用
+        size_t highWaterMark_;                          // 高水位值
+        bool aboveHighWaterMark_;                       // 是否已经达到高水位（输出队列发送完之前只回调一次）
+
+        static const size_t kDefaultHighWaterMark = 64 * 1024 * 1024;
 
         /**
          * 设置连接状态
@@ -169,6 +324,11 @@ namespace tinyWS_thread {
          */
         void setState(StateE s);
 
+        /**
+         * 向输出队列添加数据之后调用，输出队列的数据量达到高水位时调用高水位回调函数
+         */
+        void checkHighWaterMark();
+
         // TcpConnection 的一系列 handle* 函数会在 TcpConnection 构造函数中设置为 Channel 对应的回调函数。
         // 所以 TcpConnection 的 handle 动作由 Channel 调用回调函数导致的。
 
@@ -181,11 +341,27 @@ namespace tinyWS_thread {
          */
         void handleRead(Timer::TimeType receiveTime);
 
+        /**
+         * edge trigger 模式下读数据
+         * 一直读到 EAGAIN 为止，再调用一次 message callback。
+         * 如果读到了 EOF，则在调用 message callback 之后断开连接。
+         * @param receiveTime
+         */
+        void handleReadUntilEAGAIN(Timer::TimeType receiveTime);
+
         /**
          * 写数据
+         * level trigger 模式下每次只调用一次 write(2)；
+         * edge trigger 模式下一直写到 outputQueue_ 为空或者 EAGAIN 为止。
          */
         void handleWrite();
 
+        /**
+         * 发送输出队列中的数据（见 handleWrite()），
+         * 发送完时关闭写事件、调用写完成回调函数，没有发送完时关注写事件
+         */
+        void writeOutputQueue();
+
         /**
          * 断开连接
          */
@@ -203,13 +379,52 @@ namespace tinyWS_thread {
          * @param message
          */
         void sendInLoop(const std::string &message);
-//        void sendInLoop(const void *message, size_t len);
+
+        /**
+         * 在 IO 线程中发送数据：输出缓冲区为空时直接 write(2)，剩余的数据放入输出缓冲区
+         * @param message 数据的起始地址
+         * @param len 数据的长度
+         */
+        void sendInLoop(const void *message, size_t len);
+
+        /**
+         * 在 IO 线程中发送 Buffer 中的数据，剩余的数据通过交换缓冲区放入输出队列
+         * @param buffer 数据，调用后为空
+         */
+        void sendInLoop(Buffer *buffer);
+
+        /**
+         * 在 IO 线程中发送共享的只读数据
+         * @param data 数据
+         */
+        void sendSharedInLoop(const std::shared_ptr<const std::string> &data);
+
+        /**
+         * 在 IO 线程中发送文件的一个区域
+         * @param file 文件
+         * @param offset 区域在文件中的起始位置
+         * @param len 区域的长度
+         */
+        void sendFileInLoop(const FileHandlePtr &file, off_t offset, size_t len);
+
+        /**
+         * 直接 write(2) 写入一次数据之后的处理：全部写完时调用写完成回调函数，出错时打印日志
+         * @param n write(2) 的返回值
+         * @param len 需要写入的数据长度
+         * @return 写入的字节数（出错时为 0）
+         */
+        size_t afterDirectWrite(ssize_t n, size_t len);
 
         /**
          * 在 IO 线程中 shutdown write 端（只有当 Channel 不处在写数据的状态才能关闭）
          */
         void shutdownInLoop();
 
+        /**
+         * 在 IO 线程中强制关闭连接
+         */
+        void forceCloseInLoop();
+
         /**
          * 获取状态字符串信息。
          * @return
@@ -0,0 +1,102 @@
+#include "TcpConnectionPool.h"
+
+#include <cassert>
+
+#include "EventLoop.h"
+#include "Socket.h"
+#include "InternetAddress.h"
+
+using namespace tinyWS_thread;
+
+TcpConnectionPool::TcpConnectionPool(EventLoop *loop, size_t maxIdle)
+    : loop_(loop),
+      maxIdle_(maxIdle) {
+
+}
+
+TcpConnectionPool::~TcpConnectionPool() {
+    for (auto connection : idle_) {
+        delete connection;
+    }
+    for (auto block : freeBlocks_) {
+        ::operator delete(block);
+    }
+}
+
+TcpConnectionPtr TcpConnectionPool::acquire(const std::shared_ptr<const std::string> &ownerName,
+                                            uint64_t id,
+                                            Socket socket,
+                                            const InternetAddress &localAddress,
+                                            const InternetAddress &peerAddress,
+                                            bool *reused) {
+    loop_->assertInLoopThread();
+
+    TcpConnection *connection;
+    if (idle_.empty()) {
+        connection = new TcpConnection(loop_, ownerName, id, std::move(socket), localAddress, peerAddress);
+        created_.increment();
+        *reused = false;
+    } else {
+        connection = idle_.back();
+        idle_.pop_back();
+        connection->reset(id, std::move(socket), localAddress, peerAddress);
+        reused_.increment();
+        *reused = true;
+    }
+
+    std::weak_ptr<TcpConnectionPool> self(shared_from_this());
+    return TcpConnectionPtr(connection, Recycler{self}, BlockAllocator<TcpConnection>(self));
+}
+
+void TcpConnectionPool::close() {
+    loop_->assertInLoopThread();
+    maxIdle_ = 0;
+    for (auto connection : idle_) {
+        delete connection;
+    }
+    idle_.clear();
+}
+
+TcpConnectionPool::Stats TcpConnectionPool::stats() {
+    Stats stats;
+    stats.created = created_.get();
+    stats.reused = reused_.get();
+    stats.discarded = discarded_.get();
+    return stats;
+}
+
+void TcpConnectionPool::Recycler::operator()(TcpConnection *connection) const {
+    if (auto owner = pool.lock()) {
+        owner->release(connection);
+    } else {
+        delete connection;
+    }
+}
+
+void TcpConnectionPool::release(TcpConnection *connection) {
+    // 最后一个引用可能在其他线程释放（如用户的线程持有连接），此时不能访问 idle_
+    if (loop_->isInLoopThread() && idle_.size() < maxIdle_) {
+        connection->recycle();
+        idle_.push_back(connection);
+    } else {
+        delete connection;
+        discarded_.increment();
+    }
+}
+
+void* TcpConnectionPool::allocateBlock() {
+    if (loop_->isInLoopThread() && !freeBlocks_.empty()) {
+        void *block = freeBlocks_.back();
+        freeBlocks_.pop_back();
+        return block;
+    }
+    return ::operator new(kBlockSize);
+}
+
+void TcpConnectionPool::deallocateBlock(void *block) {
+    if (loop_->isInLoopThread() && freeBlocks_.size() < maxIdle_) {
+        freeBlocks_.push_back(block);
+    } else {
+        ::operator delete(block);
+    }
+}
@@ -0,0 +1,166 @@
+#ifndef TINYWS_TCPCONNECTIONPOOL_H
+#define TINYWS_TCPCONNECTIONPOOL_H
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "../base/noncopyable.h"
+#include "../base/Atomic.h"
+#include "TcpConnection.h"
+
+namespace tinyWS_thread {
+
+    class EventLoop;
+    class Socket;
+    class InternetAddress;
+
+    // 每个 IO 线程一个的 TcpConnection 对象池，只在所属 IO 线程中获取和回收对象。
+    //
+    // 新建一个连接需要分配 TcpConnection、Socket、Channel、两个 Buffer 的内存和 std::function 的闭包，
+    // 连接断开后对象不释放，而是由 shared_ptr 的自定义删除器（见 base/ObjectPool.h）放回对象池，
+    // 下一个连接直接复用这些对象和缓冲区的内存。
+    // shared_ptr 的控制块也由对象池分配和复用，所以复用连接对象时不需要分配内存。
+    //
+    // 对象在其他线程释放、对象池已满或已关闭时，直接删除对象。
+    class TcpConnectionPool : noncopyable,
+                              public std::enable_shared_from_this<TcpConnectionPool> {
+    public:
+        static const size_t kDefaultMaxIdle = 1024;
+
+        // 统计数据
+        struct Stats {
+            Stats() : created(0), reused(0), discarded(0) {}
+
+            int64_t created;        // 新建的连接对象数
+            int64_t reused;         // 复用的连接对象数，reused / (created + reused) 即复用率
+            int64_t discarded;      // 没有放回对象池而直接删除的连接对象数
+        };
+
+        /**
+         * 构造函数，必须由 std::make_shared 创建
+         * @param loop 所属的 EventLoop
+         * @param maxIdle 最多保留的空闲对象数，为 0 时不复用对象
+         */
+        TcpConnectionPool(EventLoop *loop, size_t maxIdle);
+
+        ~TcpConnectionPool();
+
+        /**
+         * --- 只能在 IO 线程中调用 ---
+         * 获取一个连接对象，优先复用空闲的对象
+         * @param ownerName 所属 TcpServer 的名字
+         * @param id 连接 ID
+         * @param socket socket 对象
+         * @param localAddress 本地地址对象
+         * @param peerAddress 客户端地址对象
+         * @param reused 输出参数，是否复用了空闲的对象（复用的对象保留了之前设置的回调函数）
+         * @return 连接对象
+         */
+        TcpConnectionPtr acquire(const std::shared_ptr<const std::string> &ownerName,
+                                 uint64_t id,
+                                 Socket socket,
+                                 const InternetAddress &localAddress,
+                                 const InternetAddress &peerAddress,
+                                 bool *reused);
+
+        /**
+         * --- 只能在 IO 线程中调用 ---
+         * 删除所有空闲的对象，之后释放的对象也不再放回对象池
+         */
+        void close();
+
+        /**
+         * --- 线程安全 ---
+         * 获取统计数据
+         * @return 统计数据
+         */
+        Stats stats();
+
+    private:
+        // shared_ptr 控制块的最大大小，超过时直接用 operator new 分配
+        static const size_t kBlockSize = 128;
+
+        // shared_ptr 的删除器：把对象放回对象池
+        struct Recycler {
+            std::weak_ptr<TcpConnectionPool> pool;
+
+            void operator()(TcpConnection *connection) const;
+        };
+
+        // shared_ptr 控制块的分配器：从对象池的空闲块中分配
+        template <class T>
+        struct BlockAllocator {
+            using value_type = T;
+
+            explicit BlockAllocator(const std::weak_ptr<TcpConnectionPool> &owner) : pool(owner) {}
+
+            template <class U>
+            BlockAllocator(const BlockAllocator<U> &other) : pool(other.pool) {}
+
+            T* allocate(size_t n) {
+                static_assert(alignof(T) <= alignof(std::max_align_t), "over-aligned control block");
+                if (n == 1 && sizeof(T) <= kBlockSize) {
+                    if (auto owner = pool.lock()) {
+                        return static_cast<T*>(owner->allocateBlock());
+                    }
+                }
+                return static_cast<T*>(::operator new(n * sizeof(T)));
+            }
+
+            void deallocate(T *p, size_t n) {
+                if (n == 1 && sizeof(T) <= kBlockSize) {
+                    if (auto owner = pool.lock()) {
+                        owner->deallocateBlock(p);
+                        return;
+                    }
+                }
+                ::operator delete(p);
+            }
+
+            template <class U>
+            bool operator==(const BlockAllocator<U> &other) const {
+                return !pool.owner_before(other.pool) && !other.pool.owner_before(pool);
+            }
+
+            template <class U>
+            bool operator!=(const BlockAllocator<U> &other) const {
+                return !(*this == other);
+            }
+
+            std::weak_ptr<TcpConnectionPool> pool;
+        };
+
+        EventLoop *loop_;                       // 所属的 EventLoop
+        size_t maxIdle_;                        // 最多保留的空闲对象数
+        std::vector<TcpConnection*> idle_;      // 空闲的连接对象
+        std::vector<void*> freeBlocks_;         // 空闲的控制块
+        AtomicInt64 created_;                   // 见 Stats
+        AtomicInt64 reused_;
+        AtomicInt64 discarded_;
+
+        /**
+         * 回收对象：在 IO 线程中且对象池未满时，放回对象池，否则删除对象
+         * @param connection 连接对象
+         */
+        void release(TcpConnection *connection);
+
+        /**
+         * 分配一个控制块，IO 线程中优先复用空闲的块
+         * @return 内存块，大小为 kBlockSize
+         */
+        void* allocateBlock();
+
+        /**
+         * 释放一个控制块，IO 线程中且空闲块未满时保留
+         * @param block 内存块
+         */
+        void deallocateBlock(void *block);
+    };
+}
+
+
+#endif //TINYWS_TCPCONNECTIONPOOL_H
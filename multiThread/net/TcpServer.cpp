@@ -1,11 +1,13 @@
 #include "TcpServer.h"
 
+#include <unistd.h> // sysconf
 #include <cstdio>
 #include <cassert>
 
 #include <functional>
 
 #include "../base/Logger.h"
+#include "../base/CountDownLatch.h"
 #include "EventLoop.h"
 #include "Acceptor.h"
 #include "InternetAddress.h"
@@ -16,23 +18,35 @@ using namespace std::placeholders;
 
 TcpServer::TcpServer(EventLoop *loop, const InternetAddress &address, const std::string &name)
     : loop_(loop),
-      name_(name),
-      acceptor_(new Acceptor(loop, address)),
+      name_(std::make_shared<const std::string>(name)),
+      listenAddress_(address),
       threadPool_(new EventLoopThreadPool(loop)),
-      nextConnectionId_(1),
+      edgeTriggered_(false),
+      reusePort_(false),
+      cpuSteering_(false),
+      maxAcceptsPerWakeup_(Acceptor::kDefaultMaxAcceptsPerWakeup),
+      connectionPoolSize_(TcpConnectionPool::kDefaultMaxIdle),
       connectionCallback_(defaultConnectionCallback),
       messageCallback_(defaultMessageCallback) {
 
-    acceptor_->setNewConnectionCallback(
-            std::bind(&TcpServer::newConnection, this, _1, _2));
+    // 是否使用 SO_REUSEPORT 在 start() 时才确定，所以 Acceptor 在 start() 中创建
 }
 
 TcpServer::~TcpServer() {
     loop_->assertInLoopThread();
-//    debug() << "TcpServer::~TcpServer [" << name_ << "] destructing" << std::endl;
-    for (const auto &connection : connectionMap_) {
-        connection.second->getLoop()->runInLoop(
-                std::bind(&TcpConnection::connectionDestroyed, connection.second.get()));
+//    debug() << "TcpServer::~TcpServer [" << *name_ << "] destructing" << std::endl;
+
+    // 连接表和 Acceptor 都属于 IO 线程，要在 IO 线程中销毁
+    for (auto &context : loopContexts_) {
+        LoopContext *loopContext = context.release();
+        loopContext->loop->runInLoop([loopContext]() {
+            for (const auto &connection : loopContext->registry.releaseAll()) {
+                connection->connectionDestroyed();
+            }
+            // 之后释放的连接对象直接删除
+            loopContext->connectionPool->close();
+            delete loopContext;
+        });
     }
 }
 
@@ -45,11 +59,83 @@ void TcpServer::setThreadNumber(int threadNumber) {
     threadPool_->setThreadNum(threadNumber);
 }
 
+void TcpServer::setEdgeTriggered(bool on) {
+    edgeTriggered_ = on;
+}
+
+void TcpServer::setLoopPlacementPolicy(EventLoopThreadPool::Policy policy) {
+    threadPool_->setPolicy(policy);
+}
+
+void TcpServer::setReusePort(bool on) {
+    reusePort_ = on;
+}
+
+void TcpServer::setReusePortCpuSteering(bool on) {
+    cpuSteering_ = on;
+}
+
+void TcpServer::setMaxAcceptsPerWakeup(int maxAccepts) {
+    assert(maxAccepts >= 1);
+    maxAcceptsPerWakeup_ = maxAccepts;
+}
+
+void TcpServer::setConnectionPoolSize(size_t maxIdle) {
+    connectionPoolSize_ = maxIdle;
+}
+
+TcpConnectionPool::Stats TcpServer::connectionPoolStats() const {
+    TcpConnectionPool::Stats total;
+    for (const auto &context : loopContexts_) {
+        TcpConnectionPool::Stats stats = context->connectionPool->stats();
+        total.created += stats.created;
+        total.reused += stats.reused;
+        total.discarded += stats.discarded;
+    }
+    return total;
+}
+
+Acceptor::Stats TcpServer::acceptorStats() const {
+    Acceptor::Stats total;
+    std::vector<Acceptor*> acceptors;
+    if (acceptor_) {
+        acceptors.push_back(acceptor_.get());
+    }
+    for (const auto &context : loopContexts_) {
+        if (context->acceptor) {
+            acceptors.push_back(context->acceptor.get());
+        }
+    }
+
+    for (auto acceptor : acceptors) {
+        Acceptor::Stats stats = acceptor->stats();
+        total.wakeups += stats.wakeups;
+        total.accepted += stats.accepted;
+        total.dropped += stats.dropped;
+        total.fullBatches += stats.fullBatches;
+    }
+    return total;
+}
+
+std::vector<EventLoopStats::Snapshot> TcpServer::loopStats() const {
+    return threadPool_->getAllStats();
+}
+
 void TcpServer::start() {
     if (started_.getAndSet(1) == 0) {
         threadPool_->start(threadInitCallback_);
-        loop_->runInLoop(
-                std::bind(&Acceptor::listen, acceptor_.get()));
+        createLoopContexts();
+
+        if (reusePort_) {
+            startReusePort();
+        } else {
+            acceptor_.reset(new Acceptor(loop_, listenAddress_));
+            acceptor_->setNewConnectionCallback(
+                    std::bind(&TcpServer::newConnection, this, _1, _2));
+            acceptor_->setMaxAcceptsPerWakeup(maxAcceptsPerWakeup_);
+            loop_->runInLoop(
+                    std::bind(&Acceptor::listen, acceptor_.get()));
+        }
     }
 }
 
@@ -67,55 +153,105 @@ void TcpServer::setThreadInitCallback(const ThreadInitCallback &cb) {
 
 void TcpServer::newConnection(Socket socket, const InternetAddress &peerAddress) {
     loop_->assertInLoopThread();
-    char buf[32];
-    snprintf(buf, sizeof(buf), "#%d", nextConnectionId_);
-    ++nextConnectionId_;
-    std::string connectionName = name_ + buf;
+    // 主线程只负责选择 IO 线程，TcpConnection 在 IO 线程中创建
+    LoopContext *context = loopContexts_[threadPool_->getNextLoopIndex(peerAddress)].get();
+    // 在主线程中立即增加连接数，下一个新连接选择 IO 线程时就能看到
+    context->loop->addConnectionCount(1);
 
-//    debug() << "TcpServer::newConnection [" << name_
-//            << "] - new connection [" << connectionName
-//            << "] from " << peerAddress.toIPPort() << std::endl;
+    // Socket 不能复制，而 Functor 要求可以复制，所以只传递文件描述符
+    int sockfd = socket.fd();
+    socket.setNoneFd();
+    context->loop->runInLoop([this, context, sockfd, peerAddress]() {
+        establishConnection(context, Socket(sockfd), peerAddress);
+    });
+}
 
-    InternetAddress localAddress(InternetAddress::getLocalAddress(socket.fd()));
+void TcpServer::newConnectionInLoop(LoopContext *context, Socket socket, const InternetAddress &peerAddress) {
+    context->loop->assertInLoopThread();
+    context->loop->addConnectionCount(1);
+    establishConnection(context, std::move(socket), peerAddress);
+}
 
-    // ioLoop 和 loop_ 线程切换都发生在连接建立和断开的时刻，则不影响正常业务的性能。
-    EventLoop *ioLoop = threadPool_->getNextLoop();
+void TcpServer::establishConnection(LoopContext *context, Socket socket, const InternetAddress &peerAddress) {
+    context->loop->assertInLoopThread();
+    InternetAddress localAddress(InternetAddress::getLocalAddress(socket.fd()));
 
-    auto connection = std::make_shared<TcpConnection>(ioLoop,
-                                                      connectionName,
-                                                      std::move(socket),
-                                                      localAddress,
-                                                      peerAddress);
-    connectionMap_[connectionName] = connection;
+    // 连接名只在需要时由 name_ 和 ID 构造，建立连接时不再拼接字符串
+    uint64_t id = context->registry.allocateId();
+    bool reused = false;
+    TcpConnectionPtr connection = context->connectionPool->acquire(name_,
+                                                                   id,
+                                                                   std::move(socket),
+                                                                   localAddress,
+                                                                   peerAddress,
+                                                                   &reused);
     connection->setTcpNoDelay(true); // 禁用 Nagle 算法
-    // 设置回调函数
-    connection->setConnectionCallback(connectionCallback_);
-    connection->setMessageCallback(messageCallback_);
-    connection->setCloseCallback(
-            std::bind(&TcpServer::removeConnection, this, _1));
-    // 在 IO 线程执行
-    ioLoop->runInLoop(
-            std::bind(&TcpConnection::connectionEstablished, connection));
-}
-
-void TcpServer::removeConnection(const TcpConnectionPtr &connection) {
-    // 因为还要从 connectionMap_ 中移除 TcpConnection，
-    // 所以将实际的移除工作转移到 IO 线程中。
-    loop_->runInLoop(
-            std::bind(&TcpServer::removeConnectionInLoop, this, connection));
-}
-
-void TcpServer::removeConnectionInLoop(const TcpConnectionPtr &connection) {
-    loop_->assertInLoopThread(); // 确保在 IO 线程中
-//    debug() << "TcpServer::removeConnectionInLoop [" << name_
-//            << "] - connection " << connection->name() << std::endl;
-    size_t n = connectionMap_.erase(connection->name());
-
-    assert(n == 1);
-    (void)n;
-
-    // ioLoop 和 loop_ 线程切换都发生在连接建立和断开的时刻，则不影响正常业务的性能。
-    EventLoop *ioLoop = connection->getLoop();
-    ioLoop->queueInLoop(
+    connection->setEdgeTriggered(edgeTriggered_);
+    // 设置回调函数。
+    // 对象池属于该 TcpServer 的该 IO 线程，复用的对象已经设置过相同的回调函数，不需要再复制 std::function。
+    if (!reused) {
+        connection->setConnectionCallback(connectionCallback_);
+        connection->setMessageCallback(messageCallback_);
+        connection->setCloseCallback(
+                std::bind(&TcpServer::removeConnection, this, context, _1));
+    }
+
+    context->registry.add(id, connection);
+    connection->connectionEstablished();
+}
+
+void TcpServer::createLoopContexts() {
+    std::vector<EventLoop*> loops = threadPool_->getAllLoops();
+    for (size_t i = 0; i < loops.size(); ++i) {
+        loopContexts_.emplace_back(new LoopContext(loops[i], static_cast<int>(i), connectionPoolSize_));
+    }
+}
+
+void TcpServer::startReusePort() {
+    loop_->assertInLoopThread();
+    long cpuCount = ::sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpuCount <= 0) {
+        cpuCount = 1;
+    }
+
+    for (const auto &context : loopContexts_) {
+        int i = context->index;
+        context->acceptor.reset(new Acceptor(context->loop, listenAddress_, true));
+        context->acceptor->setNewConnectionCallback(
+                std::bind(&TcpServer::newConnectionInLoop, this, context.get(), _1, _2));
+        context->acceptor->setMaxAcceptsPerWakeup(maxAcceptsPerWakeup_);
+        if (cpuSteering_ && !context->acceptor->setIncomingCpu(static_cast<int>(i % cpuCount))) {
+            debug(LogLevel::WARN) << "SO_INCOMING_CPU is not supported" << std::endl;
+        }
+
+        // 依次在各 IO 线程中 listen，并等待完成。
+        // SO_REUSEPORT 组中 socket 的下标就是 listen(2) 的顺序，这样可以保证与 IO 线程的下标一致。
+        Acceptor *acceptor = context->acceptor.get();
+        CountDownLatch latch(1);
+        context->loop->runInLoop([acceptor, &latch]() {
+            acceptor->listen();
+            latch.countDown();
+        });
+        latch.wait();
+    }
+
+    // BPF 程序属于整个 SO_REUSEPORT 组，添加到任意一个 socket 上即可
+    if (cpuSteering_ &&
+        !loopContexts_.front()->acceptor->attachReusePortCpuFilter(static_cast<int>(loopContexts_.size()))) {
+        debug(LogLevel::WARN) << "SO_ATTACH_REUSEPORT_CBPF is not supported" << std::endl;
+    }
+}
+
+void TcpServer::removeConnection(LoopContext *context, const TcpConnectionPtr &connection) {
+    context->loop->assertInLoopThread();
+    bool removed = context->registry.remove(connection->id());
+
+    assert(removed);
+    (void)removed;
+    context->loop->addConnectionCount(-1);
+
+    // 当前正在处理该连接的事件（在 Channel::handleEvent() 中），所以不能马上销毁，
+    // 要用 queueInLoop() 等事件处理完再调用 connectionDestroyed()。
+    context->loop->queueInLoop(
             std::bind(&TcpConnection::connectionDestroyed, connection));
 }
@@ -4,19 +4,21 @@
 #include <functional>
 #include <memory>
 #include <string>
-#include <map>
+#include <vector>
 
 #include "../base/noncopyable.h"
 #include "../base/Atomic.h"
 #include "TcpConnection.h"
 #include "CallBack.h"
+#include "InternetAddress.h"
+#include "Acceptor.h"
+#include "EventLoopThreadPool.h"
+#include "ConnectionRegistry.h"
+#include "TcpConnectionPool.h"
 
 namespace tinyWS_thread {
 
     class EventLoop;
-    class Acceptor;
-    class InternetAddress;
-    class EventLoopThreadPool;
     class Socket;
 
     // TcpServer 的功能：管理 Acceptor 获得的 TcpConnection。
@@ -26,6 +28,15 @@ namespace tinyWS_thread {
     // 尽量让依赖是单向的。
     // TcpServer 用到 Acceptor，但 Acceptor 并不知道 TcpServer 的存在。
     // TcpServer 创建 TcpConnection，但 TcpConnection 并不知道 TcpServer 的存在。
+    //
+    // 接受连接有两种模式：
+    // 1 默认模式：主 EventLoop 上的一个 Acceptor 接受所有连接，再按照派发策略把 socket 交给 IO 线程；
+    // 2 SO_REUSEPORT 模式（setReusePort(true)）：每个 IO 线程一个 SO_REUSEPORT 监听 socket 和 Acceptor，
+    //   由内核在它们之间分发新连接，连接的接受也在 IO 线程中完成。
+    //
+    // 两种模式下，TcpConnection 都在所属的 IO 线程中创建，并放入该 IO 线程自己的连接表（ConnectionRegistry），
+    // 连接用 64 位整数 ID 标识，连接的断开和移除也只在该 IO 线程中进行，不需要切换到主线程。
+    // 每个 IO 线程还有一个 TcpConnectionPool，断开的连接对象放回对象池，由该 IO 线程的新连接复用。
     class TcpServer : noncopyable,
                       std::enable_shared_from_this<TcpServer> {
     public:
@@ -58,6 +69,73 @@ namespace tinyWS_thread {
          */
         void setThreadNumber(int threadNumber);
 
+        /**
+         * 设置新连接是否使用 edge trigger，默认为 level trigger。
+         * 需要在 start() 之前调用。
+         * @param on true / false
+         */
+        void setEdgeTriggered(bool on);
+
+        /**
+         * 设置默认模式下为新连接选择 IO 线程的策略，见 EventLoopThreadPool::Policy，默认为 Round-robin。
+         * 需要在 start() 之前调用。
+         * @param policy 策略
+         */
+        void setLoopPlacementPolicy(EventLoopThreadPool::Policy policy);
+
+        /**
+         * 设置是否使用 SO_REUSEPORT 模式：每个 IO 线程有自己的监听 socket 和 Acceptor。
+         * 需要在 start() 之前调用。
+         * @param on true / false
+         */
+        void setReusePort(bool on);
+
+        /**
+         * SO_REUSEPORT 模式下，是否按照收到连接的 CPU 选择监听 socket：
+         * 第 i 个 IO 线程的监听 socket 设置 SO_INCOMING_CPU 为 i，
+         * 并给 SO_REUSEPORT 组添加 BPF 程序（CPU 编号 % IO 线程数）。
+         * IO 线程数等于 CPU 数，且 IO 线程绑定到对应的 CPU 上时，连接可以一直留在收到它的 CPU 上。
+         * 需要在 start() 之前调用。
+         * @param on true / false
+         */
+        void setReusePortCpuSteering(bool on);
+
+        /**
+         * 设置每个 Acceptor 在 listen socket 每次可读时最多 accept 的连接数，默认为 Acceptor::kDefaultMaxAcceptsPerWakeup。
+         * 需要在 start() 之前调用。
+         * @param maxAccepts 连接数，至少为 1
+         */
+        void setMaxAcceptsPerWakeup(int maxAccepts);
+
+        /**
+         * 设置每个 IO 线程的连接对象池最多保留的空闲连接对象数，默认为 TcpConnectionPool::kDefaultMaxIdle，
+         * 为 0 时不复用连接对象。
+         * 需要在 start() 之前调用。
+         * @param maxIdle 空闲连接对象数
+         */
+        void setConnectionPoolSize(size_t maxIdle);
+
+        /**
+         * ---线程安全---
+         * 获取所有 IO 线程的连接对象池的统计数据之和，start() 之后调用
+         * @return 统计数据
+         */
+        TcpConnectionPool::Stats connectionPoolStats() const;
+
+        /**
+         * ---线程安全---
+         * 获取所有 Acceptor 的 accept 统计数据之和，start() 之后调用
+         * @return 统计数据
+         */
+        Acceptor::Stats acceptorStats() const;
+
+        /**
+         * ---线程安全---
+         * 获取每个 IO 线程 EventLoop 的运行时统计，见 EventLoopThreadPool::getAllStats()，start() 之后调用
+         * @return 快照列表
+         */
+        std::vector<EventLoopStats::Snapshot> loopStats() const;
+
         /**
          * --- 安全线程 ---
          * 如果 Acceptor 为监听 socket，则调用该函数，启动服务，监听 socket。
@@ -85,40 +163,77 @@ namespace tinyWS_thread {
 
 
     private:
-        // <连接名，TcpConnection 对象的智能指针> 类型
-        using ConnectionMap = std::map<std::string, TcpConnectionPtr>;
+        // 每个 IO 线程的状态，只在对应的 IO 线程中访问
+        struct LoopContext {
+            LoopContext(EventLoop *ioLoop, int loopIndex, size_t connectionPoolSize)
+                : loop(ioLoop),
+                  index(loopIndex),
+                  registry(loopIndex),
+                  connectionPool(std::make_shared<TcpConnectionPool>(ioLoop, connectionPoolSize)) {}
+
+            EventLoop *loop;                                // IO 线程的 EventLoop
+            int index;                                      // IO 线程的下标
+            std::unique_ptr<Acceptor> acceptor;             // IO 线程的 Acceptor（SO_REUSEPORT 模式）
+            ConnectionRegistry registry;                    // IO 线程的连接表
+            std::shared_ptr<TcpConnectionPool> connectionPool;  // IO 线程的连接对象池（连接对象的删除器引用它，所以用 shared_ptr）
+        };
 
         EventLoop *loop_;                                   // Accept EventLoop
-        const std::string name_;                            // TcpServer 名字，方便打印日志
-        std::unique_ptr<Acceptor> acceptor_;                // Acceptor
+        const std::shared_ptr<const std::string> name_;     // TcpServer 名字，方便打印日志，由所有连接共享
+        const InternetAddress listenAddress_;               // 监听地址
+        std::unique_ptr<Acceptor> acceptor_;                // Acceptor（默认模式）
         std::unique_ptr<EventLoopThreadPool> threadPool_;   // EventLoop 线程池
         AtomicInt32 started_;                               // 是否启动
-        int nextConnectionId_;                              // 下一连接 ID，只会在 IO 线程中操作该值
-        ConnectionMap connectionMap_;                       // <连接名，TcpConnection 对象的智能指针>
+        bool edgeTriggered_;                                // 新连接是否使用 edge trigger
+        bool reusePort_;                                    // 是否使用 SO_REUSEPORT 模式
+        bool cpuSteering_;                                  // SO_REUSEPORT 模式下是否按 CPU 选择监听 socket
+        int maxAcceptsPerWakeup_;                           // 每次可读时最多 accept 的连接数
+        size_t connectionPoolSize_;                         // 每个 IO 线程的连接对象池最多保留的空闲对象数
+        std::vector<std::unique_ptr<LoopContext>> loopContexts_; // 每个 IO 线程的状态，与 EventLoopThreadPool::getAllLoops() 的顺序一致
 
         ConnectionCallback connectionCallback_;             // 连接建立的回调函数
         MessageCallback messageCallback_;                   // 消息到来的回调函数
         ThreadInitCallback threadInitCallback_;             // 线程初始化的回调函数
 
         /**
-         * 为新建立的连接创建 TcpConnectionPtr 对象
+         * 默认模式下，在主线程中选择 IO 线程，并把新连接的 socket 交给该 IO 线程
          * @param socket socket 文件描述符
          * @param peerAddress 客户端地址
          */
         void newConnection(Socket socket, const InternetAddress &peerAddress);
 
         /**
-         * ---线程安全---
-         * 删除 Connection 对象
-         * @param connection Connection 对象
+         * SO_REUSEPORT 模式下，IO 线程的 Acceptor 接受到新连接
+         * @param context IO 线程的状态
+         * @param socket socket 文件描述符
+         * @param peerAddress 客户端地址
+         */
+        void newConnectionInLoop(LoopContext *context, Socket socket, const InternetAddress &peerAddress);
+
+        /**
+         * 在 IO 线程中创建 TcpConnection 对象，设置回调函数，放入 IO 线程的连接表，并建立连接
+         * @param context IO 线程的状态
+         * @param socket socket 文件描述符
+         * @param peerAddress 客户端地址
+         */
+        void establishConnection(LoopContext *context, Socket socket, const InternetAddress &peerAddress);
+
+        /**
+         * 为每个 IO 线程创建 LoopContext
+         */
+        void createLoopContexts();
+
+        /**
+         * SO_REUSEPORT 模式下，为每个 IO 线程创建 Acceptor，并依次监听
          */
-        void removeConnection(const TcpConnectionPtr &connection);
+        void startReusePort();
 
         /**
-         * 在 IO 线程中删除 Connection 对象
+         * 在 IO 线程中从连接表中删除 Connection 对象
+         * @param context IO 线程的状态
          * @param connection Connection 对象
          */
-        void removeConnectionInLoop(const TcpConnectionPtr &connection);
+        void removeConnection(LoopContext *context, const TcpConnectionPtr &connection);
     };
 }
 
@@ -2,26 +2,52 @@
 
 #include <sys/time.h>
 
-#include <memory>
-
 using namespace tinyWS_thread;
 
 AtomicInt64 Timer::s_numCreated_;
 
+Timer::Timer()
+    : expiredTime_(0),
+      interval_(0),
+      repeat_(false),
+      canceled_(false),
+      sequence_(0),
+      next_(nullptr) {
+
+}
+
 Timer::Timer(const Timer::TimerCallback &cb, TimeType timeout, TimeType interval)
     : timerCallback_(cb),
       expiredTime_(timeout),
       interval_(interval),
       repeat_(interval > 0),
-      sequence_(s_numCreated_.incrementAndGet()) {
+      canceled_(false),
+      sequence_(s_numCreated_.incrementAndGet()),
+      next_(nullptr) {
 
 }
 
+void Timer::init(const TimerCallback &cb, TimeType timeout, TimeType interval) {
+    timerCallback_ = cb;
+    expiredTime_ = timeout;
+    interval_ = interval;
+    repeat_ = interval > 0;
+    canceled_ = false;
+    next_ = nullptr;
+    sequence_.store(s_numCreated_.incrementAndGet(), std::memory_order_release);
+}
+
+void Timer::release() {
+    sequence_.store(0, std::memory_order_release);
+    timerCallback_ = nullptr;
+    next_ = nullptr;
+}
+
 void Timer::run() const {
     timerCallback_();
 }
 
-Timer::TimeType Timer::getExpiredTime() {
+Timer::TimeType Timer::getExpiredTime() const {
     return expiredTime_;
 }
 
@@ -34,7 +60,16 @@ bool Timer::repeat() const {
 }
 
 int64_t Timer::getSequence() const {
-    return sequence_;
+    return sequence_.load(std::memory_order_acquire);
+}
+
+void Timer::cancel() {
+    canceled_ = true;
+    timerCallback_ = nullptr;   // 尽早释放回调函数绑定的资源（如 TcpConnection 的智能指针）
+}
+
+bool Timer::isCanceled() const {
+    return canceled_;
 }
 
 bool Timer::isValid() {
@@ -60,15 +95,14 @@ Timer::TimeType Timer::now() {
     //     time_t       tv_sec;   // seconds since Jan. 1, 1970
     //     suseconds_t  tv_usec;  // and microseconds
     //     };
-//    std::shared_ptr<timeval> tv(new timeval());
-    std::shared_ptr<timeval> tv(std::make_shared<timeval>());
+    timeval tv{};
 
     // SUSv4 指定 gettimeofday() 函数现已弃用。
     // gettimeofday() 不是系统调用，是在用户态实现的，没有上下文切换和陷入内核的开销。
     // 精度为1纳秒。
-    gettimeofday(tv.get(), nullptr);
+    gettimeofday(&tv, nullptr);
 
-    return static_cast<int64_t >(tv->tv_sec * Timer::kMicroSecondsPerSecond + tv->tv_usec);
+    return static_cast<int64_t >(tv.tv_sec * Timer::kMicroSecondsPerSecond + tv.tv_usec);
 }
 
 int64_t Timer::createNum() {
@@ -3,6 +3,7 @@
 
 #include <cstdint>
 
+#include <atomic>
 #include <functional>
 
 #include "../base/noncopyable.h"
@@ -10,6 +11,10 @@
 
 namespace tinyWS_thread {
     // 非线程安全，不暴露给用户，只向用户提供 TdmerId 对象，用于识别定时器。
+    //
+    // Timer 对象由 TimerQueue 的对象池分配，用完之后放回对象池，重复使用。
+    // 每次分配都会重新生成序列号，TimerId 通过 <Timer 指针，序列号> 识别定时器，
+    // 所以即使 Timer 对象被重复使用，过期的 TimerId 也不会误注销新的定时器。
     class Timer : noncopyable {
     public:
         using TimerCallback = std::function<void()>;                 // 定时器回调函数类型
@@ -17,6 +22,11 @@ namespace tinyWS_thread {
 
         const static TimeType kMicroSecondsPerSecond = 1000 * 1000; // 一秒有 1000 * 1000 微秒
 
+        /**
+         * 构造函数，构造空闲的定时器，由对象池调用
+         */
+        Timer();
+
         /**
          * 构造函数
          * @param cb 回调函数
@@ -25,6 +35,19 @@ namespace tinyWS_thread {
          */
         Timer(const TimerCallback &cb, TimeType timeout, TimeType interval = 0);
 
+        /**
+         * 初始化从对象池中取出的定时器，并生成新的序列号
+         * @param cb 回调函数
+         * @param timeout 到期时间
+         * @param interval 执行周期，0 表示不是周期定时器
+         */
+        void init(const TimerCallback &cb, TimeType timeout, TimeType interval);
+
+        /**
+         * 将定时器放回对象池之前调用，释放回调函数（及其绑定的资源），并使序列号失效
+         */
+        void release();
+
         /**
          * 执行回调函数
          */
@@ -34,7 +57,7 @@ namespace tinyWS_thread {
          * 获取到期时间
          * @return 到期时间
          */
-        TimeType getExpiredTime();
+        TimeType getExpiredTime() const;
 
         /**
          * 更新到期时间
@@ -49,11 +72,25 @@ namespace tinyWS_thread {
         bool repeat() const;
 
         /**
+         * --- 线程安全 ---
          * 获取定时器序列号
-         * @return 序列号
+         * @return 序列号，0 表示定时器空闲
          */
         int64_t getSequence() const;
 
+        /**
+         * 注销定时器。
+         * 定时器并不会马上从时间轮中移除，而是成为"墓碑"，
+         * 回调函数会马上被释放，等时间轮处理到定时器所在的槽时，再回收定时器。
+         */
+        void cancel();
+
+        /**
+         * 是否已被注销
+         * @return true / false
+         */
+        bool isCanceled() const;
+
         /**
          * 是否有效
          * @return true / false
@@ -84,12 +121,18 @@ namespace tinyWS_thread {
 
         static int64_t createNum();
 
+        // 友元类，TimerQueue 通过 next_ 把定时器串成时间轮槽中的链表和对象池的空闲链表
+        friend class TimerQueue;
+
     private:
-        const TimerCallback timerCallback_;   // 定时器回调函数
+        TimerCallback timerCallback_;       // 定时器回调函数
         TimeType expiredTime_;              // 到期时间
-        const TimeType interval_;           // 执行周期
-        const bool repeat_;                 // 是否周期执行
-        const int64_t sequence_;            // 定时器序列号
+        TimeType interval_;                 // 执行周期
+        bool repeat_;                       // 是否周期执行
+        bool canceled_;                     // 是否已被注销
+        // 序列号在分配定时器的线程中写入，在 IO 线程中读取（注销定时器时比较），所以使用原子变量
+        std::atomic<int64_t> sequence_;     // 定时器序列号
+        Timer *next_;                       // 链表中的下一个定时器
 
         static AtomicInt64 s_numCreated_;   // 序列号生成器
     };
@@ -1,19 +1,21 @@
 #ifndef TINYWS_TIMERID_H
 #define TINYWS_TIMERID_H
 
-#include <memory>
+#include <cstdint>
 
 #include "Timer.h"
 
 namespace tinyWS_thread {
     // Timer 对象是非线程安全的，不暴露给用户，
     // 只向用户提供 TdmerId 对象，用于识别定时器（主要用于注销定时器队列中定时器）
+    //
+    // Timer 对象由对象池重复使用，所以只有指针和序列号都相同，才是同一个定时器。
     class TimerId {
     public:
-        TimerId() : sequence_(0) {}
-        explicit TimerId(const std::weak_ptr<Timer> &timer)
+        TimerId() : timer_(nullptr), sequence_(0) {}
+        TimerId(Timer *timer, int64_t sequence)
                 : timer_(timer),
-                  sequence_(timer.lock() ? timer.lock()->getSequence() : 0) {
+                  sequence_(sequence) {
         }
 
         // 使用合成的拷贝函数、析构函数和赋值函数
@@ -22,7 +24,7 @@ namespace tinyWS_thread {
         friend class TimerQueue;
 
     private:
-        std::weak_ptr<Timer> timer_;    // 定时器
+        Timer *timer_;                  // 定时器
         int64_t sequence_;              // 定时器序列号
     };
 }
@@ -5,7 +5,6 @@
 #include <cassert>
 
 #include <functional>
-#include <algorithm>
 #include <utility>
 
 #include "../base/Logger.h"
@@ -78,7 +77,15 @@ TimerQueue::TimerQueue(EventLoop *loop)
     : loop_(loop),
       timerfd_(Timerfd::createTimerfd()),
       timerfdChannel_(loop, timerfd_),
-      callingExpiredTimers_(false) {
+      level0_(),
+      levels_(),
+      currentTick_(toTick(Timer::now())),
+      level0Count_(0),
+      count_(0),
+      armedTick_(kNoTick),
+      callingExpiredTimers_(false),
+      runningTimer_(nullptr),
+      freeTimers_(nullptr) {
 
     // 设置"读"回调函数和可读
     timerfdChannel_.setReadCallback(std::bind(&TimerQueue::handleRead, this));
@@ -86,158 +93,245 @@ TimerQueue::TimerQueue(EventLoop *loop)
 }
 
 TimerQueue::~TimerQueue() {
+    // TimerQueue 在 EventLoop 析构函数中析构，此时 Poller 还存在，可以移除 Channel
+    timerfdChannel_.disableAll();
+    timerfdChannel_.remove();
     close(timerfd_);
-    // 直到 EventLoop 析构之前，都不能移除 channel
+    // 时间轮和空闲链表中的定时器都在 chunks_ 中，随 chunks_ 一起释放
 }
 
 TimerId TimerQueue::addTimer(const Timer::TimerCallback &cb, Timer::TimeType timeout, Timer::TimeType interval) {
-    std::shared_ptr<Timer> timer(new Timer(cb, timeout, interval));
+    Timer *timer = allocateTimer();
+    timer->init(cb, timeout, interval);
+    TimerId timerId(timer, timer->getSequence());
     // 将添加定时器的实际工作转移到 IO 线程，使得不加锁也能保证线程安全性
     loop_->runInLoop(std::bind(&TimerQueue::addTimerInLoop, this, timer));
 
-    return *new TimerId(std::weak_ptr<Timer>(timer));
+    return timerId;
 }
 
 void TimerQueue::cancel(const TimerId &timerId) {
     // TimerQueue 是 TimerId 的友元类
-    auto timer = timerId.timer_.lock();
-    if (timer) {
+    if (timerId.timer_ != nullptr) {
         // 将注销定时器的实际工作转移到 IO 线程，使得不加锁也能保证线程安全性
         loop_->runInLoop(std::bind(&TimerQueue::cancelInLoop, this, timerId));
     }
 }
 
-void TimerQueue::addTimerInLoop(const std::shared_ptr<Timer> &timer) {
+Timer* TimerQueue::allocateTimer() {
+    SpinLockGuard lock(poolLock_);
+    if (freeTimers_ == nullptr) {
+        std::unique_ptr<Timer[]> chunk(new Timer[kTimersPerChunk]);
+        for (size_t i = 0; i < kTimersPerChunk; ++i) {
+            chunk[i].next_ = freeTimers_;
+            freeTimers_ = &chunk[i];
+        }
+        chunks_.push_back(std::move(chunk));
+    }
+
+    Timer *timer = freeTimers_;
+    freeTimers_ = timer->next_;
+
+    return timer;
+}
+
+void TimerQueue::deallocateTimer(Timer *timer) {
+    timer->release();
+
+    SpinLockGuard lock(poolLock_);
+    timer->next_ = freeTimers_;
+    freeTimers_ = timer;
+}
+
+void TimerQueue::addTimerInLoop(Timer *timer) {
     loop_->assertInLoopThread();
-    Timer::TimeType expiredTime = timer->getExpiredTime();
-    bool isEarliest = insert(timer); // 插入的定时器是否是最早到期的定时器
-    if (isEarliest) {
-        Timerfd::resetTimerfd(timerfd_, expiredTime); // 更新定时器文件描述符
+
+    // 定时器在加入时间轮之前就被注销了
+    if (timer->isCanceled()) {
+        deallocateTimer(timer);
+        return;
+    }
+
+    int64_t wakeTick = insert(timer);
+    // 处理到期定时器期间，在 handleRead() 的最后统一更新 timerfd
+    if (!callingExpiredTimers_) {
+        armTimerfd(wakeTick);
     }
 }
 
 void TimerQueue::cancelInLoop(const TimerId &timerId) {
-    loop_->isInLoopThread();
-    assert(timers_.size() == activeTimers_.size());
-
-    auto cancelTimer = timerId.timer_.lock();
-    assert(cancelTimer);
-    ActiveTimer timer(cancelTimer, cancelTimer->getSequence());
-    auto it = activeTimers_.find(timer);
-    if (it != activeTimers_.end()) {
-        // 删除两个容器中的定时器
-        auto n = timers_.erase(Entry(it->first->getExpiredTime(), it->first));
-        assert(n == 1);
-        (void)(n);
-        activeTimers_.erase(it);
-    } else if (callingExpiredTimers_) {
-        // 防止定时器"自注销"，即定时器在自己的回调函数中注销自己。
-        // callingExpiredTimers_ 为 true，即当前为处理到期定时器期间。
-        // 此时，Timer 不在 timers_ 集合中，而是在 expired 集合中，且正在处理（即调用回调函数，运行到这里）。
-        // 记录在处理到期定时器期间，有哪些定时器请求"自注销"（cancel）。
-        // 处理完定时器后，更新定时器（reset）时，不再把"自注销"的定时器添加到 timers_ 中。
-        // 等到下次处理到期定时器时，清理该集合，释放定时器资源。
-        cancelingTimers_.insert(timer);
-    }
+    loop_->assertInLoopThread();
 
-    assert(timers_.size() == activeTimers_.size());
+    // 序列号不同，说明定时器已经执行完（或者已被注销）并被回收了
+    Timer *timer = timerId.timer_;
+    if (timer->getSequence() == timerId.sequence_ && !timer->isCanceled()) {
+        if (timer == runningTimer_) {
+            // 定时器在自己的回调函数中注销自己（"自注销"）。
+            // 此时回调函数正在执行，不能释放，只做标记。
+            // advance() 在回调函数返回之后会检查该标记，不会重新插入周期定时器。
+            timer->canceled_ = true;
+        } else {
+            // 只标记为"墓碑"，等时间轮处理到所在的槽时再回收
+            timer->cancel();
+        }
+    }
 }
 
 void TimerQueue::handleRead() {
     loop_->assertInLoopThread();
     Timer::TimeType now = Timer::now();
     Timerfd::readTimerfd(timerfd_, now); // 读取数据，防止重复触发可读事件
-    std::vector<Entry> expiredTimers = getExpired(now); // 读取到期定时器
+    armedTick_ = kNoTick;                // timerfd 已经到期
 
     callingExpiredTimers_ = true; // 标记正在处理定时器
-    cancelingTimers_.clear(); // 清理上次处理定时器期间的"自注销"定时器
-    for (const auto &timer : expiredTimers) {
-        timer.second->run();
-    }
+    // 到期时间向上取整到刻度，所以刻度 <= now / kMicroSecondsPerTick 的定时器都已到期
+    advance(now / kMicroSecondsPerTick, now);
     callingExpiredTimers_ = false;
 
-    reset(expiredTimers, now);
+    armTimerfd(nextWakeTick());
 }
 
-std::vector<TimerQueue::Entry> TimerQueue::getExpired(Timer::TimeType now) {
-    assert(timers_.size() == activeTimers_.size());
-
-    // UINTPTR_MAX 是 uintptr_t 的最大值，使用最大值，避免冲突
-    Entry sentry = std::make_pair(now, std::shared_ptr<Timer>());
-    auto it = timers_.lower_bound(sentry); // 找到第一个未到期 Timer 的迭代器
-
-    assert(it == timers_.end() || now < it->first);
+void TimerQueue::advance(int64_t nowTick, Timer::TimeType now) {
+    while (currentTick_ <= nowTick) {
+        int index = static_cast<int>(currentTick_ & kLevel0Mask);
+        // 第 0 层转完一圈，从上层级联定时器。
+        // 第 1 层也转完一圈（级联的槽下标为 0），则继续从更上一层级联，以此类推。
+        if (index == 0) {
+            for (int level = 1; level <= kUpperLevels; ++level) {
+                int shift = kLevel0Bits + (level - 1) * kLevelBits;
+                if (cascade(level, static_cast<int>((currentTick_ >> shift) & kLevelMask)) != 0) {
+                    break;
+                }
+            }
+        }
 
-    std::vector<Entry> expired;
-    std::copy(timers_.begin(), it, std::back_inserter(expired));
-    timers_.erase(timers_.begin(), it);
+        // 第 0 层为空，直接跳到下一次级联的刻度，不必逐个刻度推进
+        if (level0Count_ == 0) {
+            int64_t nextCascadeTick = (currentTick_ | kLevel0Mask) + 1;
+            currentTick_ = nextCascadeTick <= nowTick ? nextCascadeTick : nowTick + 1;
+            continue;
+        }
 
-    // 从 activeTimers_ 中删除过期定时器
-    for (const auto &activated : expired) {
-        ActiveTimer timer(activated.second, activated.second->getSequence());
-        auto n = activeTimers_.erase(timer);
-        assert(n == 1);
-        (void)(n);
+        Timer *expired = level0_[index];
+        level0_[index] = nullptr;
+        ++currentTick_;
+
+        while (expired != nullptr) {
+            Timer *timer = expired;
+            expired = timer->next_;
+            --level0Count_;
+            --count_;
+
+            if (!timer->isCanceled()) {
+                loop_->recordTimerLag(now - timer->getExpiredTime());
+                runningTimer_ = timer;
+                timer->run();
+                runningTimer_ = nullptr;
+            }
+
+            // 更新周期执行且不是"自注销"定时器的到期时间，并且重新插入到时间轮中
+            if (timer->repeat() && !timer->isCanceled()) {
+                timer->restart(now);
+                insert(timer);
+            } else {
+                deallocateTimer(timer);
+            }
+        }
     }
+}
 
-    assert(timers_.size() == activeTimers_.size());
+int TimerQueue::cascade(int level, int index) {
+    Timer *list = levels_[level - 1][index];
+    levels_[level - 1][index] = nullptr;
+    reinsertList(list);
 
-    // ROV优化，此处不会拷贝 vector
-    return expired;
+    return index;
 }
 
-void TimerQueue::reset(const std::vector<Entry> &expired, Timer::TimeType now) {
-    for (const auto &entry : expired) {
-        ActiveTimer timer(entry.second, entry.second->getSequence());
-        // 更新周期执行且不是"自注销"定时器的到期时间，并且重新插入到定时器集合中
-        if (entry.second->repeat() && cancelingTimers_.find(timer) == cancelingTimers_.end()) {
-            entry.second->restart(now);
-            insert(entry.second);
-        }
-    }
+void TimerQueue::reinsertList(Timer *list) {
+    while (list != nullptr) {
+        Timer *timer = list;
+        list = timer->next_;
+        --count_;
 
-    // 更新 timerfd 到期时间
-    if (!timers_.empty() ) {
-        auto earliestTimer = timers_.begin()->second;
-        if (earliestTimer->isValid()) {
-            auto newExpiredTime = earliestTimer->getExpiredTime();
-            Timerfd::resetTimerfd(timerfd_, newExpiredTime);
+        if (timer->isCanceled()) {
+            deallocateTimer(timer);
+        } else {
+            insert(timer);
         }
     }
-
 }
 
-bool TimerQueue::insert(const std::shared_ptr<Timer>& timer) {
+int64_t TimerQueue::insert(Timer *timer) {
     loop_->assertInLoopThread();
-    assert(timers_.size() == activeTimers_.size());
 
-    bool isEarliest = false; // 定时器插入后是否为最早到期的定时器
-    auto it = timers_.begin();
-    // timers_ 没有定时器或者 timer 的到期时间比第一个定时器（timers_ 中最早到期的定时器）的到期时间早
-    if (it == timers_.end() || timer->getExpiredTime() < it->first) {
-        isEarliest = true;
+    int64_t expiredTick = toTick(timer->getExpiredTime());
+    int64_t ticks = expiredTick - currentTick_;
+    Timer **slot;
+    int64_t wakeTick;
+
+    if (ticks < kLevel0Size) {
+        // 已经到期的定时器放到下一个要处理的槽中
+        if (ticks < 0) {
+            expiredTick = currentTick_;
+        }
+        slot = &level0_[expiredTick & kLevel0Mask];
+        wakeTick = expiredTick;
+        ++level0Count_;
+    } else {
+        // 超出时间轮范围的定时器，先放在最远的槽中，级联时再重新放置
+        if (ticks > kMaxTicks) {
+            ticks = kMaxTicks;
+            expiredTick = currentTick_ + kMaxTicks;
+        }
+
+        int level = 1;
+        int shift = kLevel0Bits;
+        while (level < kUpperLevels && ticks >= (1LL << (shift + kLevelBits))) {
+            ++level;
+            shift += kLevelBits;
+        }
+        slot = &levels_[level - 1][(expiredTick >> shift) & kLevelMask];
+        // 上层的定时器需要在下一次级联时移到下层
+        wakeTick = (currentTick_ + kLevel0Mask) & ~static_cast<int64_t>(kLevel0Mask);
     }
 
-    // 将定时器插入到两个容器中
-    {
-        // std::pair<iterator,bool> insert( const value_type& value );
-        // 使用该版本的 insert 函数
-        // T1 为插入后的迭代器，T2 为是否插入成功
-        std::pair<TimerList::iterator, bool> result
-            = timers_.insert(std::make_pair(timer->getExpiredTime(), timer));
-        assert(result.second);
-        (void)result;
+    timer->next_ = *slot;
+    *slot = timer;
+    ++count_;
+
+    return wakeTick;
+}
+
+int64_t TimerQueue::nextWakeTick() const {
+    if (count_ == 0) {
+        return kNoTick;
     }
 
-    {
-        // 同上
-        std::pair<ActiveTimerSet::iterator, bool> result
-                = activeTimers_.insert(std::make_pair(timer, timer->getSequence()));
-        assert(result.second);
-        (void)result;
+    // 下一次级联的刻度
+    int64_t nextCascadeTick = (currentTick_ + kLevel0Mask) & ~static_cast<int64_t>(kLevel0Mask);
+    int64_t wakeTick = count_ > level0Count_ ? nextCascadeTick : currentTick_ + kLevel0Size;
+
+    if (level0Count_ > 0) {
+        for (int64_t tick = currentTick_; tick < wakeTick; ++tick) {
+            if (level0_[tick & kLevel0Mask] != nullptr) {
+                return tick;
+            }
+        }
     }
 
-    assert(timers_.size() == activeTimers_.size());
+    return wakeTick;
+}
+
+void TimerQueue::armTimerfd(int64_t tick) {
+    // 只有需要提前唤醒时才更新 timerfd。
+    // 唤醒刻度推迟（例如定时器被注销）时不更新，多唤醒一次不会出错。
+    if (tick != kNoTick && (armedTick_ == kNoTick || tick < armedTick_)) {
+        armedTick_ = tick;
+        Timerfd::resetTimerfd(timerfd_, tick * kMicroSecondsPerTick);
+    }
+}
 
-    return isEarliest;
+int64_t TimerQueue::toTick(Timer::TimeType time) {
+    return (time + kMicroSecondsPerTick - 1) / kMicroSecondsPerTick;
 }
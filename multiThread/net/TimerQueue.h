@@ -1,13 +1,14 @@
 #ifndef TINYWS_TIMERQUEUE_H
 #define TINYWS_TIMERQUEUE_H
 
+#include <cstddef>
 #include <cstdint>
 
-#include <set>
 #include <vector>
 #include <memory>
 
 #include "../base/noncopyable.h"
+#include "../base/SpinLock.h"
 #include "Timer.h"
 #include "TimerId.h"
 #include "Channel.h"
@@ -15,6 +16,20 @@
 namespace tinyWS_thread {
     class EventLoop;
 
+    // 定时器队列，使用分层时间轮（hierarchical timing wheel）实现，参考 Linux 内核的 timer wheel。
+    //
+    // 时间轮的刻度（tick）为 1 毫秒，共 4 层：
+    // 第 0 层有 256 个槽，每个槽对应 1 个刻度；
+    // 第 1 ~ 3 层各有 64 个槽，每个槽分别对应 2^8、2^14、2^20 个刻度。
+    // 4 层可以表示 2^26 毫秒（约 18.6 小时）以内的定时器，更远的定时器先放在第 3 层最远的槽中，
+    // 级联（cascade）时再根据实际到期时间重新放置。
+    //
+    // 1 添加定时器：根据到期时间直接计算所在的槽，O(1)；
+    // 2 注销定时器：只把定时器标记为"墓碑"，并释放回调函数，O(1)，处理到所在的槽时再回收；
+    // 3 第 0 层转完一圈时，把上一层对应槽中的定时器级联到下一层。
+    //
+    // Timer 对象由对象池分配，按块（chunk）申请内存，用完放回空闲链表，避免每个定时器都申请一次内存。
+    // 只使用一个 timerfd，只有下一次需要唤醒的刻度提前时，才调用 timerfd_settime(2)。
     class TimerQueue : noncopyable {
     public:
         /**
@@ -26,6 +41,7 @@ namespace tinyWS_thread {
         ~TimerQueue();
 
         /**
+         * --- 线程安全 ---
          * 添加定时器
          * @param cb 回调函数
          * @param timeout 到期时间
@@ -35,51 +51,67 @@ namespace tinyWS_thread {
         TimerId addTimer(const Timer::TimerCallback &cb, Timer::TimeType timeout, Timer::TimeType interval);
 
         /**
+         * --- 线程安全 ---
          * 注销定时器
          * @param timerId 定时器 ID
          */
         void cancel(const TimerId& timerId);
 
     private:
-        using Entry = std::pair<Timer::TimeType , std::shared_ptr<Timer>>;      // <时间，Timer 智能指针> pair 类型
+        static const Timer::TimeType kMicroSecondsPerTick = 1000;   // 每个刻度的微秒数
+        static const int kLevel0Bits = 8;                           // 第 0 层槽数的位数
+        static const int kLevelBits = 6;                            // 第 1 ~ 3 层槽数的位数
+        static const int kLevel0Size = 1 << kLevel0Bits;            // 第 0 层的槽数
+        static const int kLevelSize = 1 << kLevelBits;              // 第 1 ~ 3 层的槽数
+        static const int kLevel0Mask = kLevel0Size - 1;
+        static const int kLevelMask = kLevelSize - 1;
+        static const int kUpperLevels = 3;                          // 第 1 ~ 3 层
+        static const int64_t kMaxTicks = (1LL << (kLevel0Bits + kUpperLevels * kLevelBits)) - 1; // 时间轮能表示的最大刻度数
+        static const int64_t kNoTick = -1;                          // 没有设置 timerfd
+        static const size_t kTimersPerChunk = 256;                  // 对象池每次申请的定时器数量
+
+        EventLoop *loop_;                                           // 所属事件循环
+
+        const int timerfd_;                                         // 时间描述符
+        Channel timerfdChannel_;                                    // timerfd Channel
+
+        Timer *level0_[kLevel0Size];                                // 第 0 层，槽中是定时器的单链表
+        Timer *levels_[kUpperLevels][kLevelSize];                   // 第 1 ~ 3 层
+        int64_t currentTick_;                                       // 下一个要处理的刻度
+        size_t level0Count_;                                        // 第 0 层中定时器（包括"墓碑"）的数量
+        size_t count_;                                              // 时间轮中定时器（包括"墓碑"）的数量
+        int64_t armedTick_;                                         // timerfd 已设置的刻度，kNoTick 表示没有设置
+        bool callingExpiredTimers_;                                 // 是否在处理到期定时器
+        Timer *runningTimer_;                                       // 正在执行回调函数的定时器，用于处理"自注销"
+
+        // 对象池，addTimer() 可以在任意线程调用，所以需要加锁。
+        // 临界区只有几条指令，所以使用自旋锁。
+        SpinLock poolLock_;
+        Timer *freeTimers_;                                         // 空闲定时器链表
+        std::vector<std::unique_ptr<Timer[]>> chunks_;              // 对象池申请的内存块
 
-        // set 默认升序排序（按照定时器过期时间排序），
-        // 方便 insert 函数判断插入定时器是否为最早到期的和获取到期定时器
-        using TimerList = std::set<Entry>;                                      // <时间，Timer 智能指针> pair 的集合的类型
-
-        using ActiveTimer = std::pair<std::shared_ptr<Timer>, int64_t>;
-        using ActiveTimerSet = std::set<ActiveTimer>;
-
-        EventLoop *loop_;                                                       // 所属事件循环
-
-        // TimerQueue 只关注最早到期时间，所以只使用一个 timerfd 即可。
-        // 当最早的定时器到期后，获取所有到期的定时器并处理。
-        // 获取所有而不是一个原因：
-        // 1. 定时器队列中，可能有多个定时器的到期时间都等于最早到期时间；
-        // 2. 可能存在周期处理的定时器；
-        // 3. 由于调用函数或者陷入内核需要时间，在此段时间内，也有定时器到期了，尽早处理到期定时器
-        const int timerfd_;                                                     // 时间描述符
-        Channel timerfdChannel_;                                                // timerfd Channel
-        TimerList timers_;                                                      // 定时器集合，定时器根据过期时间升序排序
-
-        // 用于 cancel 操作
+        /**
+         * --- 线程安全 ---
+         * 从对象池中分配定时器
+         * @return 定时器
+         */
+        Timer* allocateTimer();
 
-        // 保存目前有效的 Timer 的智能指针，满足 timers_.size() == activeTimers_.size()。
-        // 两个容器保存相同的定时器，只是 timers_ 是按到期时间排序，activeTimers_ 按对象地址排序。
-        ActiveTimerSet activeTimers_;
-        // 用于防止定时器"自注销"
-        bool callingExpiredTimers_;                                             // 是否在处理到期定时器
-        ActiveTimerSet cancelingTimers_;                                        // "自注销"定时器集合
+        /**
+         * 回收定时器到对象池
+         * @param timer 定时器
+         */
+        void deallocateTimer(Timer *timer);
 
         /**
-         * 在 EventLoop 中往定时器队列添加定时器
+         * 在 EventLoop 中往时间轮添加定时器
          * @param timer 定时器
          */
-        void addTimerInLoop(const std::shared_ptr<Timer>& timer);
+        void addTimerInLoop(Timer *timer);
 
         /**
          * 在 EventLoop 中注销定时器
-         * @param timer
+         * @param timerId 定时器 ID
          */
         void cancelInLoop(const TimerId& timerId);
 
@@ -89,26 +121,52 @@ namespace tinyWS_thread {
         void handleRead();
 
         /**
-         * 获取所有到期定时器，并从定时器队列中移除定时器
-         * @param now 到期时间
-         * @return 到期定时器
+         * 将时间轮推进到 nowTick，处理所有到期的定时器
+         * @param nowTick 当前刻度
+         * @param now 当前时间，用于重设周期定时器
+         */
+        void advance(int64_t nowTick, Timer::TimeType now);
+
+        /**
+         * 把第 level 层 index 槽中的定时器重新放置到下层
+         * @param level 层（1 ~ 3）
+         * @param index 槽下标
+         * @return index
+         */
+        int cascade(int level, int index);
+
+        /**
+         * 插入定时器到时间轮中
+         * @param timer 定时器
+         * @return 时间轮需要在哪个刻度唤醒，才能及时处理该定时器
+         */
+        int64_t insert(Timer *timer);
+
+        /**
+         * 回收链表中的"墓碑"，其余定时器重新插入时间轮
+         * @param list 链表
+         */
+        void reinsertList(Timer *list);
+
+        /**
+         * 时间轮下一次需要唤醒的刻度：
+         * 第 0 层最近的非空槽，或者上层非空时，下一次级联的刻度
+         * @return 刻度，时间轮为空时返回 kNoTick
          */
-        std::vector<Entry> getExpired(Timer::TimeType now);
+        int64_t nextWakeTick() const;
 
         /**
-         * 将存储到期定时器的定时器队列中的周期定时器更新到期时间，并重新添加到定时器队列中。
-         * 同时，更新 timerfd 的时间
-         * @param expired
-         * @param now
+         * 如果 tick 比 timerfd 已设置的刻度早，则更新 timerfd
+         * @param tick 刻度
          */
-        void reset(const std::vector<Entry> &expired, Timer::TimeType now);
+        void armTimerfd(int64_t tick);
 
         /**
-         * 插入定时器
-         * @param timer 定时器智能指针
-         * @return 被插入的定时器是否为最早到期的定时器
+         * 到期时间所在的刻度（向上取整，定时器不会提前执行）
+         * @param time 到期时间
+         * @return 刻度
          */
-        bool insert(const std::shared_ptr<Timer>& timer);
+        static int64_t toTick(Timer::TimeType time);
     };
 }
 